@@ -96,6 +96,7 @@
 #include <86box/version.h>
 #include <86box/gdbstub.h>
 #include <86box/machine_status.h>
+#include <86box/savestate.h>
 
 // Disable c99-designator to avoid the warnings about int ng
 #ifdef __clang__
@@ -128,6 +129,7 @@ int video_fps = RENDER_FPS; /* (O) render speed in fps */
 #endif
 int settings_only     = 0; /* (O) show only the settings dialog */
 int confirm_exit_cmdl = 1; /* (O) do not ask for confirmation on quit if set to 0 */
+int dynarec_profile   = 0; /* (O) profile the dynamic recompiler */
 #ifdef _WIN32
 uint64_t unique_id   = 0;
 uint64_t source_hwnd = 0;
@@ -137,8 +139,23 @@ rom_path_t rom_paths      = { "", NULL }; /* (O) full paths to ROMs */
 char       log_path[1024] = { '\0' };     /* (O) full path of logfile */
 char       vm_name[1024]  = { '\0' };     /* (O) display name of the VM */
 #ifdef USE_INSTRUMENT
-uint8_t  instru_enabled = 0;
-uint64_t instru_run_ms  = 0;
+uint8_t  instru_enabled          = 0;
+uint8_t  instru_benchmark        = 0;
+uint8_t  instru_render_benchmark = 0;
+uint8_t  instru_dma_benchmark    = 0;
+uint8_t  instru_emu8k_benchmark  = 0;
+uint8_t  instru_mix_benchmark    = 0;
+uint8_t  instru_hdd_cow_test     = 0;
+uint8_t  instru_hdd_benchmark    = 0;
+uint8_t  instru_timer_benchmark  = 0;
+char    *instru_timer_trace      = NULL;
+uint64_t instru_run_ms           = 0;
+
+uint64_t instru_ins           = 0;
+uint64_t instru_frames        = 0;
+uint64_t instru_timer_events  = 0;
+uint64_t instru_io_accesses   = 0;
+uint64_t instru_mmio_accesses = 0;
 #endif
 
 /* Configuration values. */
@@ -158,6 +175,7 @@ int      force_43                         = 0;              /* (C) video */
 int      video_filter_method              = 1;              /* (C) video */
 int      video_vsync                      = 0;              /* (C) video */
 int      video_framerate                  = -1;             /* (C) video */
+int      video_render_threads             = 0;              /* (C) video */
 char     video_shader[512]                = { '\0' };       /* (C) video */
 int      bugger_enabled                   = 0;              /* (C) enable ISAbugger */
 int      postcard_enabled                 = 0;              /* (C) enable POST card */
@@ -176,6 +194,8 @@ int      xga_enabled                      = 0;              /* (C) video option
 uint32_t mem_size                         = 0;              /* (C) memory size (Installed on system board)*/
 uint32_t isa_mem_size                     = 0;              /* (C) memory size (ISA Memory Cards) */
 int      cpu_use_dynarec                  = 0;              /* (C) cpu uses/needs Dyna */
+int      cpu_dynarec_cache                = 0;              /* (C) recompiler code cache in MB, 0 = default */
+int      cpu_dynarec_async                = 0;              /* (C) recompiler compiles on a separate thread */
 int      cpu                              = 0;              /* (C) cpu type */
 int      fpu_type                         = 0;              /* (C) fpu type */
 int      time_sync                        = 0;              /* (C) enable time sync */
@@ -185,6 +205,7 @@ int      confirm_save                     = 1;              /* (C) enable save c
 int      enable_discord                   = 0;              /* (C) enable Discord integration */
 int      pit_mode                         = -1;             /* (C) force setting PIT mode */
 int      fm_driver                        = 0;              /* (C) select FM sound driver */
+int      fm_offload                       = 0;              /* (C) synthesize FM on a worker thread */
 int      open_dir_usr_path                = 0;              /* default file open dialog directory of usr_path */
 int      video_fullscreen_scale_maximized = 0;              /* (C) Whether fullscreen scaling settings also apply when maximized. */
 
@@ -468,7 +489,21 @@ usage:
             printf("\nUsage: 86box [options] [cfg-file]\n\n");
             printf("Valid options are:\n\n");
             printf("-? or --help         - show this information\n");
+#ifdef USE_INSTRUMENT
+            printf("-B or --benchmark s  - run headless for 's' emulated seconds, then print statistics\n");
+            printf("--render-benchmark   - time the SVGA scanline renderers, then exit\n");
+            printf("--dma-benchmark      - time bus master DMA transfers to RAM, then exit\n");
+            printf("--emu8k-benchmark    - time the EMU8000 voice and effects rendering, then exit\n");
+            printf("--mix-benchmark      - time the final sound mix against the old conversion loop, then exit\n");
+            printf("--hdd-cow-test       - check copy-on-write overlay images against a raw image, then exit\n");
+            printf("--hdd-benchmark      - time hard disk image accesses with and without the I/O thread, then exit\n");
+            printf("--timer-trace file   - record timer scheduling to 'file'\n");
+            printf("--timer-benchmark f  - replay the timer trace 'f' through the timer scheduler, then exit\n");
+#endif
             printf("-C or --config path  - set 'path' to be config file\n");
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+            printf("--dynarec-profile    - write a perf map of recompiled code, and report hot blocks on exit\n");
+#endif
 #ifdef _WIN32
             printf("-D or --debug        - force debug output logging\n");
 #endif
@@ -487,6 +522,7 @@ usage:
             printf("-P or --vmpath path  - set 'path' to be root for vm\n");
             printf("-R or --rompath path - set 'path' to be ROM path\n");
             printf("-S or --settings     - show only the settings dialog\n");
+            printf("-U or --resume path  - resume the machine from save state 'path'\n");
             printf("-V or --vmname name  - overrides the name of the running VM\n");
             printf("-Z or --lastvmpath   - the last parameter is VM path rather than config\n");
             printf("\nA config file can be specified. If none is, the default file will be used.\n");
@@ -555,6 +591,11 @@ usage:
             strcpy(vm_name, argv[++c]);
         } else if (!strcasecmp(argv[c], "--settings") || !strcasecmp(argv[c], "-S")) {
             settings_only = 1;
+        } else if (!strcasecmp(argv[c], "--resume") || !strcasecmp(argv[c], "-U")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            savestate_request(1, argv[++c]);
         } else if (!strcasecmp(argv[c], "--noconfirm") || !strcasecmp(argv[c], "-N")) {
             confirm_exit_cmdl = 0;
 #ifdef _WIN32
@@ -578,6 +619,10 @@ usage:
             // The return value of 0 only means that the code is invalid,
             //   not related to that translation is exists or not for the
             //  selected language.
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+        } else if (!strcasecmp(argv[c], "--dynarec-profile")) {
+            dynarec_profile = 1;
+#endif
         } else if (!strcasecmp(argv[c], "--test")) {
             /* some (undocumented) test function here.. */
 
@@ -589,6 +634,34 @@ usage:
                 goto usage;
             instru_enabled = 1;
             sscanf(argv[++c], "%llu", &instru_run_ms);
+        } else if (!strcasecmp(argv[c], "--benchmark") || !strcasecmp(argv[c], "-B")) {
+            if ((c + 1) == argc)
+                goto usage;
+            instru_benchmark = 1;
+            instru_run_ms    = (uint64_t) (atof(argv[++c]) * 1000.0);
+            if (!instru_run_ms)
+                goto usage;
+        } else if (!strcasecmp(argv[c], "--render-benchmark")) {
+            instru_render_benchmark = 1;
+        } else if (!strcasecmp(argv[c], "--dma-benchmark")) {
+            instru_dma_benchmark = 1;
+        } else if (!strcasecmp(argv[c], "--emu8k-benchmark")) {
+            instru_emu8k_benchmark = 1;
+        } else if (!strcasecmp(argv[c], "--mix-benchmark")) {
+            instru_mix_benchmark = 1;
+        } else if (!strcasecmp(argv[c], "--hdd-cow-test")) {
+            instru_hdd_cow_test = 1;
+        } else if (!strcasecmp(argv[c], "--hdd-benchmark")) {
+            instru_hdd_benchmark = 1;
+        } else if (!strcasecmp(argv[c], "--timer-trace")) {
+            if ((c + 1) == argc)
+                goto usage;
+            instru_timer_trace = argv[++c];
+        } else if (!strcasecmp(argv[c], "--timer-benchmark")) {
+            if ((c + 1) == argc)
+                goto usage;
+            instru_timer_benchmark = 1;
+            instru_timer_trace     = argv[++c];
 #endif
         }
 
@@ -1189,6 +1262,9 @@ pc_close(thread_t *ptr)
 
     /* Turn off timer processing to avoid potential segmentation faults. */
     timer_close();
+#ifdef USE_INSTRUMENT
+    timer_trace_close();
+#endif
 
     lpt_devices_close();
 
@@ -1247,6 +1323,10 @@ pc_run(void)
         pc_reset_hard_init();
     }
 
+    /* Save or restore the machine state if asked to. */
+    if (savestate_pending)
+        savestate_process();
+
     /* Run a block of code. */
     startblit();
     cpu_exec(cpu_s->rspeed / 100);
@@ -1284,6 +1364,9 @@ pc_onesec(void)
     fps        = framecount;
     framecount = 0;
 
+    mem_onesec();
+    video_onesec();
+
     title_update = 1;
 }
 
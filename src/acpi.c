@@ -39,6 +39,7 @@
 #include <86box/machine.h>
 #include <86box/i2c.h>
 #include <86box/video.h>
+#include <86box/savestate.h>
 
 int acpi_rtc_status = 0;
 
@@ -1618,6 +1619,25 @@ acpi_reset(void *priv)
     acpi_rtc_status = 0;
 }
 
+/* The I/O base and the IRQ routing belong to the southbridge, which has
+   already set them up by the time this runs. */
+static void
+acpi_savestate(savestate_t *st, void *priv)
+{
+    acpi_t *dev = (acpi_t *) priv;
+
+    savestate_var(st, dev->regs);
+    savestate_var(st, acpi_rtc_status);
+    savestate_timer(st, &dev->timer);
+    savestate_timer(st, &dev->resume_timer);
+
+    if (savestate_loading(st)) {
+        acpi_i2c_set(dev);
+        if (dev->trap_update)
+            dev->trap_update(dev->trap_priv);
+    }
+}
+
 static void
 acpi_speed_changed(void *priv)
 {
@@ -1724,7 +1744,8 @@ const device_t acpi_ali_device = {
     { .available = NULL },
     .speed_changed = acpi_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = acpi_savestate
 };
 
 const device_t acpi_intel_device = {
@@ -1738,7 +1759,8 @@ const device_t acpi_intel_device = {
     { .available = NULL },
     .speed_changed = acpi_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = acpi_savestate
 };
 
 const device_t acpi_via_device = {
@@ -1752,7 +1774,8 @@ const device_t acpi_via_device = {
     { .available = NULL },
     .speed_changed = acpi_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = acpi_savestate
 };
 
 const device_t acpi_via_596b_device = {
@@ -1766,7 +1789,8 @@ const device_t acpi_via_596b_device = {
     { .available = NULL },
     .speed_changed = acpi_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = acpi_savestate
 };
 
 const device_t acpi_smc_device = {
@@ -1780,5 +1804,6 @@ const device_t acpi_smc_device = {
     { .available = NULL },
     .speed_changed = acpi_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = acpi_savestate
 };
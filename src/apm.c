@@ -26,6 +26,7 @@
 #include <86box/device.h>
 #include <86box/io.h>
 #include <86box/apm.h>
+#include <86box/savestate.h>
 
 #ifdef ENABLE_APM_LOG
 int apm_do_log = ENABLE_APM_LOG;
@@ -94,6 +95,14 @@ apm_reset(void *p)
     dev->cmd = dev->stat = 0x00;
 }
 
+static void
+apm_savestate(savestate_t *st, void *p)
+{
+    apm_t *dev = (apm_t *) p;
+
+    savestate_var(st, *dev);
+}
+
 static void
 apm_close(void *p)
 {
@@ -126,7 +135,8 @@ const device_t apm_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = apm_savestate
 };
 
 const device_t apm_pci_device = {
@@ -140,7 +150,8 @@ const device_t apm_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = apm_savestate
 };
 
 const device_t apm_pci_acpi_device = {
@@ -154,5 +165,6 @@ const device_t apm_pci_acpi_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = apm_savestate
 };
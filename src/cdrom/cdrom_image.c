@@ -220,6 +220,13 @@ image_exit(cdrom_t *dev)
     dev->cd_status = CD_STATUS_EMPTY;
 
     if (img) {
+#ifdef ENABLE_CDROM_IMAGE_LOG
+        cdi_cache_stats_t stats;
+
+        cdi_get_cache_stats(img, &stats);
+        cdrom_image_log("CDROM: Read-ahead: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " prefetches\n",
+                        stats.hits, stats.misses, stats.prefetches);
+#endif
         cdi_close(img);
         dev->image = NULL;
     }
@@ -38,6 +38,8 @@
 #include <86box/86box.h>
 #include <86box/path.h>
 #include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/cdrom.h>
 #include <86box/cdrom_image_backend.h>
 
 #define CDROM_BCD(x)        (((x) % 10) | (((x) / 10) << 4))
@@ -66,6 +68,38 @@ cdrom_image_backend_log(const char *fmt, ...)
 #    define cdrom_image_backend_log(fmt, ...)
 #endif
 
+#define CACHE_EMPTY   0
+#define CACHE_PENDING 1
+#define CACHE_VALID   2
+#define CACHE_FILLING 3
+
+/* Read-ahead cache. Sequential reads are served from one of two windows,
+   while the I/O thread fills the other one with what comes next. */
+typedef struct {
+    track_file_t *file;
+    uint64_t      start, len;
+    uint8_t      *data;
+    int           state, ahead;
+} cdi_window_t;
+
+struct cdi_cache_t {
+    thread_t *thread;
+    mutex_t  *mutex;    /* Protects the windows and the statistics. */
+    mutex_t  *io_mutex; /* Serializes all accesses to the track files. */
+    event_t  *wake, *done;
+    int       quit;
+
+    cdi_window_t win[2];
+    uint32_t     size;
+
+    track_file_t *last_file, *len_file;
+    uint64_t      last_end, len;
+
+    cdi_cache_stats_t stats;
+};
+
+int cdrom_image_readahead = 64;
+
 /* Binary file functions. */
 static int
 bin_read(void *p, uint8_t *buffer, uint64_t seek, size_t count)
@@ -190,6 +224,260 @@ track_file_close(track_t *trk)
     trk->file = NULL;
 }
 
+static void
+cdi_cache_thread(void *priv)
+{
+    cdi_cache_t  *cache = (cdi_cache_t *) priv;
+    cdi_window_t *w;
+    int           i, ret;
+
+    while (1) {
+        thread_wait_mutex(cache->mutex);
+        w = NULL;
+        while (!cache->quit) {
+            for (i = 0; i < 2; i++) {
+                if (cache->win[i].state == CACHE_PENDING)
+                    w = &cache->win[i];
+            }
+            if (w != NULL)
+                break;
+            thread_reset_event(cache->wake);
+            thread_release_mutex(cache->mutex);
+            thread_wait_event(cache->wake, -1);
+            thread_wait_mutex(cache->mutex);
+        }
+        thread_release_mutex(cache->mutex);
+
+        if (w == NULL)
+            break;
+
+        /* Nothing but this thread touches a pending window. */
+        thread_wait_mutex(cache->io_mutex);
+        ret = w->file->read(w->file, w->data, w->start, w->len);
+        thread_release_mutex(cache->io_mutex);
+
+        thread_wait_mutex(cache->mutex);
+        w->state = ret ? CACHE_VALID : CACHE_EMPTY;
+        thread_release_mutex(cache->mutex);
+
+        thread_set_event(cache->done);
+    }
+}
+
+static void
+cdi_cache_init(cd_img_t *cdi)
+{
+    cdi_cache_t *cache;
+
+    if (cdrom_image_readahead <= 0)
+        return;
+
+    cache = (cdi_cache_t *) calloc(1, sizeof(cdi_cache_t));
+    if (cache == NULL)
+        return;
+    cache->size = cdrom_image_readahead * 2448;
+
+    cache->win[0].data = (uint8_t *) malloc(cache->size);
+    cache->win[1].data = (uint8_t *) malloc(cache->size);
+
+    /* Without the windows, reads simply go straight to the file. */
+    if ((cache->win[0].data == NULL) || (cache->win[1].data == NULL)) {
+        cdrom_image_backend_log("CD-ROM image: Unable to allocate the read-ahead cache\n");
+        free(cache->win[0].data);
+        free(cache->win[1].data);
+        free(cache);
+        return;
+    }
+
+    cache->mutex    = thread_create_mutex();
+    cache->io_mutex = thread_create_mutex();
+    cache->wake     = thread_create_event();
+    cache->done     = thread_create_event();
+    cache->thread   = thread_create(cdi_cache_thread, cache);
+
+    cdi->cache = cache;
+}
+
+static void
+cdi_cache_close(cd_img_t *cdi)
+{
+    cdi_cache_t *cache = cdi->cache;
+
+    if (cache == NULL)
+        return;
+
+    thread_wait_mutex(cache->mutex);
+    cache->quit = 1;
+    thread_release_mutex(cache->mutex);
+    thread_set_event(cache->wake);
+    thread_wait(cache->thread);
+
+    thread_destroy_event(cache->done);
+    thread_destroy_event(cache->wake);
+    thread_close_mutex(cache->io_mutex);
+    thread_close_mutex(cache->mutex);
+
+    free(cache->win[0].data);
+    free(cache->win[1].data);
+    free(cache);
+
+    cdi->cache = NULL;
+}
+
+/* Queue the window after the current one for the I/O thread. Must be
+   called with the mutex held. */
+static void
+cdi_cache_prefetch(cdi_cache_t *cache, cdi_window_t *w, track_file_t *file, uint64_t start)
+{
+    if ((w->state == CACHE_PENDING) || (w->state == CACHE_FILLING) || (start >= cache->len))
+        return;
+
+    w->file  = file;
+    w->start = start;
+    w->len   = cache->len - start;
+    if (w->len > cache->size)
+        w->len = cache->size;
+    w->state = CACHE_PENDING;
+    w->ahead = 0;
+
+    cache->stats.prefetches++;
+
+    thread_set_event(cache->wake);
+}
+
+static int
+cdi_file_read(cd_img_t *cdi, track_file_t *file, uint8_t *buffer, uint64_t seek, size_t count)
+{
+    cdi_cache_t  *cache = cdi->cache;
+    cdi_window_t *w, *other;
+    int           i, ret;
+
+    if ((cache == NULL) || (count > cache->size)) {
+        if (cache != NULL)
+            thread_wait_mutex(cache->io_mutex);
+        ret = file->read(file, buffer, seek, count);
+        if (cache != NULL)
+            thread_release_mutex(cache->io_mutex);
+        return ret;
+    }
+
+    thread_wait_mutex(cache->mutex);
+
+    if (file != cache->len_file) {
+        thread_wait_mutex(cache->io_mutex);
+        cache->len = file->get_length(file);
+        thread_release_mutex(cache->io_mutex);
+        cache->len_file = file;
+    }
+
+    while (1) {
+        w = NULL;
+        for (i = 0; i < 2; i++) {
+            if ((cache->win[i].state != CACHE_EMPTY) && (cache->win[i].file == file) &&
+                (seek >= cache->win[i].start) && ((seek + count) <= (cache->win[i].start + cache->win[i].len))) {
+                w     = &cache->win[i];
+                other = &cache->win[i ^ 1];
+            }
+        }
+
+        if ((w == NULL) || (w->state == CACHE_VALID))
+            break;
+
+        /* The data is on its way. */
+        thread_reset_event(cache->done);
+        thread_release_mutex(cache->mutex);
+        thread_wait_event(cache->done, -1);
+        thread_wait_mutex(cache->mutex);
+    }
+
+    if (w != NULL)
+        cache->stats.hits++;
+    else {
+        cache->stats.misses++;
+
+        /* A sequential read that the read-ahead has not caught up with reads a
+           whole window and restarts the read-ahead from there. The audio
+           thread reads through here as well, so leave windows that are being
+           filled alone. */
+        w = NULL;
+        for (i = 0; i < 2; i++) {
+            if ((cache->win[i].state != CACHE_PENDING) && (cache->win[i].state != CACHE_FILLING)) {
+                w     = &cache->win[i];
+                other = &cache->win[i ^ 1];
+            }
+        }
+
+        if ((w == NULL) || (file != cache->last_file) || (seek < cache->last_end) ||
+            (seek > (cache->last_end + 2448)) || ((seek + count) > cache->len)) {
+            /* Random access, do not bother with the cache. */
+            cache->last_file = file;
+            cache->last_end  = seek + count;
+            thread_release_mutex(cache->mutex);
+
+            thread_wait_mutex(cache->io_mutex);
+            ret = file->read(file, buffer, seek, count);
+            thread_release_mutex(cache->io_mutex);
+            return ret;
+        }
+
+        w->state = CACHE_FILLING;
+        w->file  = file;
+        w->start = seek;
+        w->len   = cache->len - seek;
+        if (w->len > cache->size)
+            w->len = cache->size;
+        w->ahead = 0;
+        thread_release_mutex(cache->mutex);
+
+        thread_wait_mutex(cache->io_mutex);
+        ret = file->read(file, w->data, w->start, w->len);
+        thread_release_mutex(cache->io_mutex);
+
+        thread_wait_mutex(cache->mutex);
+        w->state = ret ? CACHE_VALID : CACHE_EMPTY;
+        thread_set_event(cache->done);
+        if (!ret) {
+            cache->last_file = file;
+            cache->last_end  = seek + count;
+            thread_release_mutex(cache->mutex);
+
+            thread_wait_mutex(cache->io_mutex);
+            ret = file->read(file, buffer, seek, count);
+            thread_release_mutex(cache->io_mutex);
+            return ret;
+        }
+    }
+
+    memcpy(buffer, w->data + (seek - w->start), count);
+
+    /* Once half of the window has been consumed, fetch the next one, starting
+       where this read ended so that reads straddling the two are covered. */
+    if (!w->ahead && ((seek + count - w->start) >= (w->len >> 1))) {
+        w->ahead = 1;
+        cdi_cache_prefetch(cache, other, file, seek + count);
+    }
+
+    cache->last_file = file;
+    cache->last_end  = seek + count;
+
+    thread_release_mutex(cache->mutex);
+
+    return 1;
+}
+
+void
+cdi_get_cache_stats(cd_img_t *cdi, cdi_cache_stats_t *stats)
+{
+    if (cdi->cache == NULL) {
+        memset(stats, 0, sizeof(cdi_cache_stats_t));
+        return;
+    }
+
+    thread_wait_mutex(cdi->cache->mutex);
+    *stats = cdi->cache->stats;
+    thread_release_mutex(cdi->cache->mutex);
+}
+
 /* Root functions. */
 static void
 cdi_clear_tracks(cd_img_t *cdi)
@@ -223,6 +511,7 @@ cdi_clear_tracks(cd_img_t *cdi)
 void
 cdi_close(cd_img_t *cdi)
 {
+    cdi_cache_close(cdi);
     cdi_clear_tracks(cdi);
     free(cdi);
 }
@@ -232,11 +521,10 @@ cdi_set_device(cd_img_t *cdi, const char *path)
 {
     int ret;
 
-    if ((ret = cdi_load_cue(cdi, path)))
-        return ret;
-
-    if ((ret = cdi_load_iso(cdi, path)))
+    if ((ret = cdi_load_cue(cdi, path)) || (ret = cdi_load_iso(cdi, path))) {
+        cdi_cache_init(cdi);
         return ret;
+    }
 
     return 0;
 }
@@ -397,7 +685,7 @@ cdi_read_sector(cd_img_t *cdi, uint8_t *buffer, int raw, uint32_t sector)
 
     if (raw && !track_is_raw) {
         memset(buffer, 0x00, 2448);
-        ret = trk->file->read(trk->file, buffer + offset, seek, length);
+        ret = cdi_file_read(cdi, trk->file, buffer + offset, seek, length);
         if (!ret)
             return 0;
         /* Construct the rest of the raw sector. */
@@ -412,9 +700,9 @@ cdi_read_sector(cd_img_t *cdi, uint8_t *buffer, int raw, uint32_t sector)
         buffer[15] = trk->mode2 ? 2 : 1;
         return 1;
     } else if (!raw && track_is_raw)
-        return trk->file->read(trk->file, buffer, seek + offset, length);
+        return cdi_file_read(cdi, trk->file, buffer, seek + offset, length);
     else
-        return trk->file->read(trk->file, buffer, seek, length);
+        return cdi_file_read(cdi, trk->file, buffer, seek, length);
 }
 
 int
@@ -463,7 +751,7 @@ cdi_read_sector_sub(cd_img_t *cdi, uint8_t *buffer, uint32_t sector)
     if (trk->sector_size != 2448)
         return 0;
 
-    return trk->file->read(trk->file, buffer, seek, 2448);
+    return cdi_file_read(cdi, trk->file, buffer, seek, 2448);
 }
 
 int
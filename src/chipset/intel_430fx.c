@@ -22,6 +22,7 @@
 
 #include <86box/mem.h>
 #include <86box/pci.h>
+#include <86box/savestate.h>
 #include <86box/smram.h>
 #include <86box/spd.h>
 #include <86box/chipset.h>
@@ -235,6 +236,18 @@ intel_430fx_reset(void *priv)
         intel_pam_recalc(i, 0);
 }
 
+/* The PAM and DRAM hole state are kept by the memory section, SMRAM is not. */
+static void
+intel_430fx_savestate(savestate_t *st, void *priv)
+{
+    intel_430fx_t *dev = (intel_430fx_t *) priv;
+
+    savestate_var(st, dev->pci_conf);
+
+    if (savestate_loading(st))
+        intel_430fx_smram(dev);
+}
+
 static void
 intel_430fx_close(void *priv)
 {
@@ -271,5 +284,6 @@ const device_t intel_430fx_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = intel_430fx_savestate
 };
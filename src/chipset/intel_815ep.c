@@ -22,6 +22,7 @@
 
 #include <86box/mem.h>
 #include <86box/pci.h>
+#include <86box/savestate.h>
 #include <86box/smram.h>
 #include <86box/spd.h>
 
@@ -358,6 +359,21 @@ intel_815ep_reset(void *priv)
     intel_815ep_gart_table(dev); /* Reset AGP GART to defaults */
 }
 
+/* The PAM state is kept by the memory section and the AGP aperture by the
+   GART, SMRAM has to be set up again. */
+static void
+intel_815ep_savestate(savestate_t *st, void *priv)
+{
+    intel_815ep_t *dev = (intel_815ep_t *) priv;
+
+    savestate_var(st, dev->pci_conf);
+
+    if (savestate_loading(st)) {
+        intel_usmm_segment_recalc(dev, (dev->pci_conf[0x70] >> 4) & 3);
+        intel_lsmm_segment_recalc(dev, (dev->pci_conf[0x70] >> 2) & 3);
+    }
+}
+
 static void
 intel_815ep_close(void *priv)
 {
@@ -415,5 +431,6 @@ const device_t intel_815ep_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = intel_815ep_savestate
 };
@@ -33,6 +33,7 @@
 #include <86box/mem.h>
 #include <86box/pci.h>
 #include <86box/pic.h>
+#include <86box/savestate.h>
 #include <86box/smbus.h>
 #include <86box/sound.h>
 #include <86box/tco.h>
@@ -847,6 +848,36 @@ intel_ich2_reset(void *priv)
     intel_ich2_usb_setup(4, dev);
 }
 
+/* The sub-devices keep their own state, here only the decoding set up by the
+   LPC bridge is applied again. BIOSWE is left alone as it would raise an SMI. */
+static void
+intel_ich2_savestate(savestate_t *st, void *priv)
+{
+    intel_ich2_t *dev = (intel_ich2_t *) priv;
+
+    savestate_var(st, dev->pci_conf);
+
+    if (savestate_loading(st)) {
+        intel_ich2_acpi_setup(dev);
+        intel_ich2_tco_interrupt(dev);
+        intel_ich2_gpio_setup(dev);
+
+        intel_ich2_pirq_update(1, 0x60, 0);
+        for (int i = 0; i < 4; i++) {
+            intel_ich2_pirq_update(0, 0x60 + i, dev->pci_conf[0][0x60 + i]);
+            intel_ich2_pirq_update(0, 0x68 + i, dev->pci_conf[0][0x68 + i]);
+        }
+
+        intel_ich2_nvr_handler(dev);
+        intel_ich2_trap_update(dev);
+        intel_ich2_ide_setup(dev);
+        intel_ich2_usb_setup(2, dev);
+        intel_ich2_usb_setup(4, dev);
+        intel_ich2_smbus_setup(dev);
+        intel_ich2_function_disable(dev);
+    }
+}
+
 static void
 intel_ich2_close(void *priv)
 {
@@ -926,5 +957,6 @@ const device_t intel_ich2_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = intel_ich2_savestate
 };
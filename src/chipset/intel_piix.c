@@ -27,6 +27,7 @@
 #include <86box/mem.h>
 #include <86box/pci.h>
 #include <86box/port_92.h>
+#include <86box/savestate.h>
 #include <86box/chipset.h>
 
 #ifdef ENABLE_INTEL_PIIX_LOG
@@ -418,6 +419,28 @@ intel_piix_reset(void *priv)
     intel_piix_ide(dev);
 }
 
+static void
+intel_piix_savestate(savestate_t *st, void *priv)
+{
+    intel_piix_t *dev = (intel_piix_t *) priv;
+
+    savestate_var(st, dev->pci_conf);
+    savestate_var(st, dev->apm_smi);
+
+    /* The bus master registers are restored by the SFF-8038i devices. */
+    if (savestate_loading(st)) {
+        intel_piix_dma_alias(dev);
+        intel_piix_pirq(0x60, dev);
+        intel_piix_pirq(0x61, dev);
+        intel_piix_pirq(0x62, dev);
+        intel_piix_pirq(0x63, dev);
+        intel_piix_clock_divisor(dev);
+        intel_piix_mirq(0x70, dev);
+        intel_piix_mirq(0x71, dev);
+        intel_piix_ide(dev);
+    }
+}
+
 static void
 intel_piix_close(void *priv)
 {
@@ -471,5 +494,6 @@ const device_t intel_piix_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = intel_piix_savestate
 };
@@ -86,6 +86,7 @@
 
 #include <86box/mem.h>
 #include <86box/port_92.h>
+#include <86box/savestate.h>
 #include <86box/chipset.h>
 
 typedef struct
@@ -242,6 +243,16 @@ sarc_2016a_reset(void *priv)
     sarc_2016a_fast_a20(dev);
 }
 
+/* The shadow RAM and A20 state are kept by the memory section. */
+static void
+sarc_2016a_savestate(savestate_t *st, void *priv)
+{
+    sarc_2016a_t *dev = (sarc_2016a_t *) priv;
+
+    savestate_var(st, dev->index);
+    savestate_var(st, dev->regs);
+}
+
 static void
 sarc_2016a_close(void *priv)
 {
@@ -278,5 +289,6 @@ const device_t sarc_2016a_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = sarc_2016a_savestate
 };
@@ -22,6 +22,7 @@
 #include <86box/mem.h>
 #include <86box/pic.h>
 #include <86box/port_92.h>
+#include <86box/savestate.h>
 #include <86box/smram.h>
 #include <86box/chipset.h>
 
@@ -404,6 +405,25 @@ sis_471_reset(void *priv)
     sis_471_port_92_handler(dev);
 }
 
+static void
+sis_471_savestate(savestate_t *st, void *priv)
+{
+    sis_471_t *dev = (sis_471_t *) priv;
+
+    savestate_var(st, dev->index);
+    savestate_var(st, dev->regs);
+    savestate_var(st, dev->clear_smi);
+
+    /* Shadow RAM is kept by the memory section, Port 92h restores its own
+       features. */
+    if (savestate_loading(st)) {
+        sis_471_relocation(dev);
+        sis_471_smram(dev);
+        sis_471_sw_smi_set_base(dev);
+        sis_471_port_92_handler(dev);
+    }
+}
+
 static void
 sis_471_close(void *priv)
 {
@@ -444,5 +464,6 @@ const device_t sis_471_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = sis_471_savestate
 };
@@ -78,6 +78,7 @@
 
 #include <86box/mem.h>
 #include <86box/port_92.h>
+#include <86box/savestate.h>
 #include <86box/chipset.h>
 
 typedef struct
@@ -268,6 +269,21 @@ symphony_haydn_reset(void *priv)
     symphony_haydn_shadow_high(1, dev);
 }
 
+/* The shadow RAM and A20 state are kept by the memory section. */
+static void
+symphony_haydn_savestate(savestate_t *st, void *priv)
+{
+    symphony_haydn_t *dev = (symphony_haydn_t *) priv;
+
+    savestate_var(st, dev->index);
+    savestate_var(st, dev->regs);
+
+    if (savestate_loading(st)) {
+        symphony_haydn_bus_recalc(dev);
+        symphony_haydn_mem_relocate(dev);
+    }
+}
+
 static void
 symphony_haydn_close(void *priv)
 {
@@ -301,5 +317,6 @@ const device_t symphony_haydn_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = symphony_haydn_savestate
 };
@@ -78,6 +78,8 @@ codegen_timing_set(codegen_timing_t *timing)
 
 int codegen_in_recompile;
 
+uint32_t codegen_fallthrough;
+
 static int      last_op_ssegs;
 static x86seg  *last_op_ea_seg;
 static uint32_t last_op_32;
@@ -85,10 +87,11 @@ static uint32_t last_op_32;
 void
 codegen_generate_reset(void)
 {
-    last_op_ssegs  = -1;
-    last_op_ea_seg = NULL;
-    last_op_32     = -1;
-    has_ea         = 0;
+    last_op_ssegs       = -1;
+    last_op_ea_seg      = NULL;
+    last_op_32          = -1;
+    codegen_fallthrough = BLOCK_PC_INVALID;
+    has_ea              = 0;
 }
 
 void
@@ -381,20 +384,19 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
     int          test_modrm         = 1;
     int          pc_off             = 0;
     uint32_t     next_pc            = 0;
-#ifdef DEBUG_EXTRA
-    uint8_t last_prefix = 0;
-#endif
+    uint8_t      last_prefix        = 0;
+
     op_ea_seg = &cpu_state.seg_ds;
     op_ssegs  = 0;
 
+    codegen_fallthrough = BLOCK_PC_INVALID;
+
     codegen_timing_start();
 
     while (!over) {
         switch (opcode) {
             case 0x0f:
-#ifdef DEBUG_EXTRA
                 last_prefix = 0x0f;
-#endif
                 op_table        = (OpFn *) x86_dynarec_opcodes_0f;
                 recomp_op_table = recomp_opcodes_0f;
                 over            = 1;
@@ -433,9 +435,7 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
                 break;
 
             case 0xd8:
-#ifdef DEBUG_EXTRA
                 last_prefix = 0xd8;
-#endif
                 op_table        = (op_32 & 0x200) ? (OpFn *) x86_dynarec_opcodes_d8_a32 : (OpFn *) x86_dynarec_opcodes_d8_a16;
                 recomp_op_table = recomp_opcodes_d8;
                 opcode_shift    = 3;
@@ -446,9 +446,7 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
                 block->flags |= CODEBLOCK_HAS_FPU;
                 break;
             case 0xd9:
-#ifdef DEBUG_EXTRA
                 last_prefix = 0xd9;
-#endif
                 op_table        = (op_32 & 0x200) ? (OpFn *) x86_dynarec_opcodes_d9_a32 : (OpFn *) x86_dynarec_opcodes_d9_a16;
                 recomp_op_table = recomp_opcodes_d9;
                 opcode_mask     = 0xff;
@@ -458,9 +456,7 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
                 block->flags |= CODEBLOCK_HAS_FPU;
                 break;
             case 0xda:
-#ifdef DEBUG_EXTRA
                 last_prefix = 0xda;
-#endif
                 op_table        = (op_32 & 0x200) ? (OpFn *) x86_dynarec_opcodes_da_a32 : (OpFn *) x86_dynarec_opcodes_da_a16;
                 recomp_op_table = recomp_opcodes_da;
                 opcode_mask     = 0xff;
@@ -470,9 +466,7 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
                 block->flags |= CODEBLOCK_HAS_FPU;
                 break;
             case 0xdb:
-#ifdef DEBUG_EXTRA
                 last_prefix = 0xdb;
-#endif
                 op_table        = (op_32 & 0x200) ? (OpFn *) x86_dynarec_opcodes_db_a32 : (OpFn *) x86_dynarec_opcodes_db_a16;
                 recomp_op_table = recomp_opcodes_db;
                 opcode_mask     = 0xff;
@@ -482,9 +476,7 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
                 block->flags |= CODEBLOCK_HAS_FPU;
                 break;
             case 0xdc:
-#ifdef DEBUG_EXTRA
                 last_prefix = 0xdc;
-#endif
                 op_table        = (op_32 & 0x200) ? (OpFn *) x86_dynarec_opcodes_dc_a32 : (OpFn *) x86_dynarec_opcodes_dc_a16;
                 recomp_op_table = recomp_opcodes_dc;
                 opcode_shift    = 3;
@@ -495,9 +487,7 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
                 block->flags |= CODEBLOCK_HAS_FPU;
                 break;
             case 0xdd:
-#ifdef DEBUG_EXTRA
                 last_prefix = 0xdd;
-#endif
                 op_table        = (op_32 & 0x200) ? (OpFn *) x86_dynarec_opcodes_dd_a32 : (OpFn *) x86_dynarec_opcodes_dd_a16;
                 recomp_op_table = recomp_opcodes_dd;
                 opcode_mask     = 0xff;
@@ -507,9 +497,7 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
                 block->flags |= CODEBLOCK_HAS_FPU;
                 break;
             case 0xde:
-#ifdef DEBUG_EXTRA
                 last_prefix = 0xde;
-#endif
                 op_table        = (op_32 & 0x200) ? (OpFn *) x86_dynarec_opcodes_de_a32 : (OpFn *) x86_dynarec_opcodes_de_a16;
                 recomp_op_table = recomp_opcodes_de;
                 opcode_mask     = 0xff;
@@ -519,9 +507,7 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
                 block->flags |= CODEBLOCK_HAS_FPU;
                 break;
             case 0xdf:
-#ifdef DEBUG_EXTRA
                 last_prefix = 0xdf;
-#endif
                 op_table        = (op_32 & 0x200) ? (OpFn *) x86_dynarec_opcodes_df_a32 : (OpFn *) x86_dynarec_opcodes_df_a16;
                 recomp_op_table = recomp_opcodes_df;
                 opcode_mask     = 0xff;
@@ -535,16 +521,12 @@ codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_p
                 break;
 
             case 0xf2: /*REPNE*/
-#ifdef DEBUG_EXTRA
                 last_prefix = 0xf2;
-#endif
                 op_table        = (OpFn *) x86_dynarec_opcodes_REPNE;
                 recomp_op_table = NULL; // recomp_opcodes_REPNE;
                 break;
             case 0xf3: /*REPE*/
-#ifdef DEBUG_EXTRA
                 last_prefix = 0xf3;
-#endif
                 op_table        = (OpFn *) x86_dynarec_opcodes_REPE;
                 recomp_op_table = NULL; // recomp_opcodes_REPE;
                 break;
@@ -649,8 +631,10 @@ generate_call:
     if (recomp_op_table && recomp_op_table[(opcode | op_32) & recomp_opcode_mask]) {
         uint32_t new_pc = recomp_op_table[(opcode | op_32) & recomp_opcode_mask](block, ir, opcode, fetchdat, op_32, op_pc);
         if (new_pc) {
-            if (new_pc != -1)
+            if (new_pc != -1) {
                 uop_MOV_IMM(ir, IREG_pc, new_pc);
+                codegen_fallthrough = cs + new_pc;
+            }
 
             codegen_endpc = (cs + cpu_state.pc) + 8;
 
@@ -708,6 +692,8 @@ generate_call:
         uop_MOV_PTR(ir, IREG_ea_seg, (void *) op_ea_seg);
     if (op_ssegs != last_op_ssegs)
         uop_MOV_IMM(ir, IREG_ssegs, op_ssegs);
+    if (dynarec_profile)
+        codegen_profile_fallback(block, opcode | (last_prefix << 8));
     uop_LOAD_FUNC_ARG_IMM(ir, 0, fetchdat);
     uop_CALL_INSTRUCTION_FUNC(ir, op);
     codegen_mark_code_present(block, cs + cpu_state.pc, 8);
@@ -54,6 +54,19 @@ typedef struct codeblock_t {
     uint16_t prev, next;
     uint16_t prev_2, next_2;
 
+    /*Chained exits out of this block, and exits from other blocks that have
+      been chained to it.*/
+    uint16_t chain_out, chain_in;
+
+    /*Set when this block is entered from the dispatcher and cleared as the
+      eviction clock hand passes it. Used to pick blocks to evict when the
+      cache is full.*/
+    uint8_t referenced;
+
+    /*Number of times this block has been entered since it was compiled. Only
+      counted when profiling.*/
+    uint64_t entries;
+
     /*First mem_block_t used by this block. Any subsequent mem_block_ts
       will be in the list starting at head_mem_block->next.*/
     struct mem_block_t *head_mem_block;
@@ -81,6 +94,12 @@ extern uint8_t *block_write_data;
 #define CODEBLOCK_IN_DIRTY_LIST 0x40
 /*Code block is not inlining immediate parameters, parameters must be fetched from memory*/
 #define CODEBLOCK_NO_IMMEDIATES 0x80
+/*Code block is being compiled on the compile thread, and is interpreted until
+  the code has been published*/
+#define CODEBLOCK_COMPILING 0x100
+/*Code block did not fit in the memory set aside for the compile thread, and is
+  compiled on the CPU thread instead*/
+#define CODEBLOCK_COMPILE_SYNC 0x200
 
 #define BLOCK_PC_INVALID        0xffffffff
 
@@ -303,13 +322,53 @@ x86seg     *codegen_generate_ea(struct ir_data_t *ir, x86seg *op_ea_seg, uint32_
 extern void codegen_check_seg_read(codeblock_t *block, struct ir_data_t *ir, x86seg *seg);
 extern void codegen_check_seg_write(codeblock_t *block, struct ir_data_t *ir, x86seg *seg);
 
+/*An exit from a code block to a destination known at compile time. Once the
+  destination has been compiled, the backend patches the exit to jump straight
+  into it instead of returning to the dispatcher. The patched code still checks
+  that the CPU status matches the destination, that the linear to physical
+  mapping has not been flushed, that no interrupt is pending and that the cycle
+  budget has not run out, and returns to the dispatcher if any of these fail.*/
+typedef struct codegen_chain_t {
+    uint8_t *status_p; /*Immediate compared against cpu_cur_status*/
+    uint8_t *gen_p;    /*Immediate compared against cpu_state.chain_gen*/
+    uint8_t *jump_p;   /*Offset of the jump to the destination block*/
+#ifdef USE_INSTRUMENT
+    uint8_t *ins_p; /*Instruction count added to instru_ins on the way in*/
+#endif
+    uint32_t target;   /*Linear address of the destination*/
+    uint16_t block;    /*Block containing this exit, BLOCK_INVALID if free*/
+    uint16_t dest;     /*Block this exit is chained to, BLOCK_INVALID if none*/
+    uint16_t next;     /*Next exit out of the same block, or next free entry*/
+    uint16_t prev_in, next_in; /*Exits chained to the same destination*/
+} codegen_chain_t;
+
+#define CHAIN_SIZE 0x10000
+
+extern codegen_chain_t codegen_chains[CHAIN_SIZE];
+
+/*Allocate a new exit out of block. Returns 0 if none are free, in which case
+  the exit must go through the dispatcher*/
+extern int  codegen_chain_add(codeblock_t *block, uint32_t target);
+/*Called by the dispatcher before entering block*/
+extern void codegen_chain_enter(codeblock_t *block);
+
+/*Set while a block is being compiled on the compile thread. The IR buffers
+  belong to that thread until the block is published, so the CPU thread must
+  not start compiling another block.*/
+extern int  codegen_compile_pending;
+/*Publish the block being compiled on the compile thread, if it is done*/
+extern void codegen_compile_poll(void);
+
 extern int codegen_purge_purgable_list(void);
-/*Delete a random code block to free memory. This is obviously quite expensive, and
-  will only be called when the allocator is out of memory*/
-extern void codegen_delete_random_block(int required_mem_block);
+/*Evict the least recently used code block that can be found, to free up a
+  code block or (if required_mem_block is set) executable memory*/
+extern void codegen_evict_block(int required_mem_block);
 
 extern int      cpu_block_end;
 extern uint32_t codegen_endpc;
+/*Linear address execution continues at after the last instruction generated,
+  or BLOCK_PC_INVALID if not known at compile time*/
+extern uint32_t codegen_fallthrough;
 
 extern int cpu_reps;
 extern int cpu_notreps;
@@ -375,4 +434,18 @@ void codegen_set_loop_start(struct ir_data_t *ir, int first_instruction);
 extern uint32_t instr_counts[256 * 256];
 #endif
 
+/*Dynarec profiler, enabled with dynarec_profile. Writes a perf map of the
+  generated code, and reports the most frequently entered blocks and the most
+  frequently interpreted instructions on exit.*/
+extern void codegen_profile_init(void);
+extern void codegen_profile_close(void);
+/*Called when compilation of block starts and ends*/
+extern void codegen_profile_block_start(codeblock_t *block);
+extern void codegen_profile_block_end(codeblock_t *block);
+/*Record that an instruction in block is handled by the interpreter. instr is
+  the opcode, with any 0f/FPU/REP prefix in the high byte*/
+extern void codegen_profile_fallback(codeblock_t *block, uint16_t instr);
+/*Called when the code of block is discarded*/
+extern void codegen_profile_retire(codeblock_t *block);
+
 #endif
@@ -16,6 +16,7 @@
 
 #include "codegen.h"
 #include "codegen_allocator.h"
+#include "codegen_public.h"
 
 typedef struct mem_block_t {
     uint32_t offset; /*Offset into mem_block_alloc*/
@@ -23,31 +24,52 @@ typedef struct mem_block_t {
     uint16_t code_block;
 } mem_block_t;
 
-static mem_block_t mem_blocks[MEM_BLOCK_NR];
-static uint32_t    mem_block_free_list;
-static uint8_t    *mem_block_alloc = NULL;
+static mem_block_t *mem_blocks;
+static int          mem_block_nr;
+static uint32_t     mem_block_free_list;
+static uint8_t     *mem_block_alloc = NULL;
 
-int codegen_allocator_usage = 0;
+/*Blocks set aside for the compile thread, and a spare block that is handed out
+  over and over once they have run out*/
+static uint32_t mem_block_staging_list;
+static uint32_t mem_block_staging_spare;
+static int      mem_block_staging;
+
+int codegen_allocator_usage            = 0;
+int codegen_allocator_staging_overflow = 0;
 
 void
 codegen_allocator_init(void)
 {
     int c;
 
+    mem_block_nr = MEM_BLOCK_NR;
+    if (cpu_dynarec_cache > 0) {
+        mem_block_nr = (int) (((uint64_t) cpu_dynarec_cache << 20) / MEM_BLOCK_SIZE);
+        if (mem_block_nr < MEM_BLOCK_NR_MIN)
+            mem_block_nr = MEM_BLOCK_NR_MIN;
+        else if (mem_block_nr > MEM_BLOCK_NR_MAX)
+            mem_block_nr = MEM_BLOCK_NR_MAX;
+    }
+
+    mem_blocks = malloc(mem_block_nr * sizeof(mem_block_t));
+    if (!mem_blocks)
+        fatal("codegen_allocator_init: out of memory\n");
+
 #if defined WIN32 || defined _WIN32 || defined _WIN32
-    mem_block_alloc = VirtualAlloc(NULL, MEM_BLOCK_NR * MEM_BLOCK_SIZE, MEM_COMMIT, PAGE_EXECUTE_READWRITE);
+    mem_block_alloc = VirtualAlloc(NULL, (size_t) mem_block_nr * MEM_BLOCK_SIZE, MEM_COMMIT, PAGE_EXECUTE_READWRITE);
     /* TODO: check deployment target: older Intel-based versions of macOS don't play
        nice with MAP_JIT. */
 #elif defined(__APPLE__) && defined(MAP_JIT)
-    mem_block_alloc = mmap(0, MEM_BLOCK_NR * MEM_BLOCK_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANON | MAP_PRIVATE | MAP_JIT, -1, 0);
+    mem_block_alloc = mmap(0, (size_t) mem_block_nr * MEM_BLOCK_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANON | MAP_PRIVATE | MAP_JIT, -1, 0);
 #else
-    mem_block_alloc = mmap(0, MEM_BLOCK_NR * MEM_BLOCK_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANON | MAP_PRIVATE, -1, 0);
+    mem_block_alloc = mmap(0, (size_t) mem_block_nr * MEM_BLOCK_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANON | MAP_PRIVATE, -1, 0);
 #endif
 
-    for (c = 0; c < MEM_BLOCK_NR; c++) {
+    for (c = 0; c < mem_block_nr; c++) {
         mem_blocks[c].offset     = c * MEM_BLOCK_SIZE;
         mem_blocks[c].code_block = BLOCK_INVALID;
-        if (c < MEM_BLOCK_NR - 1)
+        if (c < mem_block_nr - 1)
             mem_blocks[c].next = c + 2;
         else
             mem_blocks[c].next = 0;
@@ -61,21 +83,31 @@ codegen_allocator_allocate(mem_block_t *parent, int code_block)
     mem_block_t *block;
     uint32_t     block_nr;
 
-    while (!mem_block_free_list) {
-        /*Pick a random memory block and free the owning code block*/
-        block_nr = rand() & MEM_BLOCK_MASK;
-        block    = &mem_blocks[block_nr];
-
-        if (block->code_block && block->code_block != code_block)
-            codegen_delete_block(&codeblock[block->code_block]);
+    if (mem_block_staging) {
+        /*Called from the compile thread. The free list belongs to the CPU
+          thread, only the blocks set aside can be used*/
+        if (!mem_block_staging_list) {
+            codegen_allocator_staging_overflow = 1;
+            return &mem_blocks[mem_block_staging_spare - 1];
+        }
+        block_nr               = mem_block_staging_list;
+        block                  = &mem_blocks[block_nr - 1];
+        mem_block_staging_list = block->next;
+    } else {
+        /*Free the memory of the least recently used code block*/
+        while (!mem_block_free_list)
+            codegen_evict_block(1);
+
+        /*Remove from free list*/
+        block_nr            = mem_block_free_list;
+        block               = &mem_blocks[block_nr - 1];
+        mem_block_free_list = block->next;
+
+        block->code_block = code_block;
+        codegen_allocator_usage++;
+        codegen_cache_allocs++;
     }
 
-    /*Remove from free list*/
-    block_nr            = mem_block_free_list;
-    block               = &mem_blocks[block_nr - 1];
-    mem_block_free_list = block->next;
-
-    block->code_block = code_block;
     if (parent) {
         /*Add to parent list*/
         block->next  = parent->next;
@@ -83,9 +115,44 @@ codegen_allocator_allocate(mem_block_t *parent, int code_block)
     } else
         block->next = 0;
 
-    codegen_allocator_usage++;
     return block;
 }
+
+void
+codegen_allocator_stage(int nr, int code_block)
+{
+    mem_block_t *block;
+    uint32_t     block_nr;
+    int          c;
+
+    mem_block_staging_list  = 0;
+    mem_block_staging_spare = 0;
+    for (c = 0; c <= nr; c++) {
+        block    = codegen_allocator_allocate(NULL, code_block);
+        block_nr = (block - mem_blocks) + 1;
+
+        if (!mem_block_staging_spare)
+            mem_block_staging_spare = block_nr;
+        else {
+            block->next            = mem_block_staging_list;
+            mem_block_staging_list = block_nr;
+        }
+    }
+
+    codegen_allocator_staging_overflow = 0;
+    mem_block_staging                  = 1;
+}
+
+void
+codegen_allocator_unstage(void)
+{
+    mem_block_staging = 0;
+
+    if (mem_block_staging_list)
+        codegen_allocator_free(&mem_blocks[mem_block_staging_list - 1]);
+    codegen_allocator_free(&mem_blocks[mem_block_staging_spare - 1]);
+    mem_block_staging_list = mem_block_staging_spare = 0;
+}
 void
 codegen_allocator_free(mem_block_t *block)
 {
@@ -113,6 +180,14 @@ codeblock_allocator_get_ptr(mem_block_t *block)
     return &mem_block_alloc[block->offset];
 }
 
+mem_block_t *
+codegen_allocator_get_next(mem_block_t *block)
+{
+    if (!block->next)
+        return NULL;
+    return &mem_blocks[block->next - 1];
+}
+
 void
 codegen_allocator_clean_blocks(struct mem_block_t *block)
 {
@@ -12,14 +12,22 @@
 
   Due to the chaining, the total memory size is limited by the range of a jump
   instruction. ARMv7 is restricted to +/- 32 MB, ARMv8 to +/- 128 MB, x86 to
-  +/- 2GB. As a result, total memory size is limited to 32 MB on ARMv7*/
+  +/- 2GB. As a result, total memory size is limited to 32 MB on ARMv7.
+
+  The number of blocks can be set with cpu_dynarec_cache (in MB), between
+  MEM_BLOCK_NR_MIN and MEM_BLOCK_NR_MAX. MEM_BLOCK_NR is the default.*/
 #if defined __ARM_EABI__ || defined _ARM_ || defined _M_ARM
-#    define MEM_BLOCK_NR 32768
+#    define MEM_BLOCK_NR     32768
+#    define MEM_BLOCK_NR_MAX 32768
+#elif defined __aarch64__ || defined _M_ARM64
+#    define MEM_BLOCK_NR     131072
+#    define MEM_BLOCK_NR_MAX 131072
 #else
-#    define MEM_BLOCK_NR 131072
+#    define MEM_BLOCK_NR     131072
+#    define MEM_BLOCK_NR_MAX 1048576
 #endif
+#define MEM_BLOCK_NR_MIN 4096
 
-#define MEM_BLOCK_MASK (MEM_BLOCK_NR - 1)
 #define MEM_BLOCK_SIZE 0x3c0
 
 void codegen_allocator_init(void);
@@ -31,9 +39,22 @@ struct mem_block_t *codegen_allocator_allocate(struct mem_block_t *parent, int c
 void codegen_allocator_free(struct mem_block_t *block);
 /*Get a pointer to the backing memory associated with block*/
 uint8_t *codeblock_allocator_get_ptr(struct mem_block_t *block);
+/*Get the next block in the list at block->next, or NULL if there isn't one*/
+struct mem_block_t *codegen_allocator_get_next(struct mem_block_t *block);
 /*Cache clean memory block list*/
 void codegen_allocator_clean_blocks(struct mem_block_t *block);
 
+/*Set aside nr blocks for code_block, which is about to be compiled on the
+  compile thread. Until codegen_allocator_unstage() is called,
+  codegen_allocator_allocate() hands out only these blocks, so that the compile
+  thread never has to evict anything. Once they have run out,
+  codegen_allocator_staging_overflow is set and the compiled code must be
+  thrown away.*/
+void codegen_allocator_stage(int nr, int code_block);
+/*Return any blocks set aside by codegen_allocator_stage() that were not used*/
+void codegen_allocator_unstage(void);
+
 extern int codegen_allocator_usage;
+extern int codegen_allocator_staging_overflow;
 
 #endif
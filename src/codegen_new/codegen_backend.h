@@ -16,6 +16,10 @@
 void codegen_backend_init(void);
 void codegen_backend_prologue(codeblock_t *block);
 void codegen_backend_epilogue(codeblock_t *block);
+#ifdef CODEGEN_BACKEND_HAS_CHAIN
+/*Point a chained exit at dest, or back at the dispatcher if dest is NULL*/
+void codegen_backend_chain_patch(codegen_chain_t *chain, codeblock_t *dest);
+#endif
 
 struct ir_data_t;
 struct uop_t;
@@ -41,6 +41,10 @@ void *codegen_mem_store_double;
 void *codegen_gpf_rout;
 void *codegen_exit_rout;
 
+/*Offset of the code following the stack frame setup in the prologue.
+  Chained exits jump here, reusing the frame of the block they leave*/
+static int codegen_chain_entry;
+
 host_reg_def_t codegen_host_reg_list[CODEGEN_HOST_REGS] = {
   /*Note: while EAX and EDX are normally volatile registers under x86
   calling conventions, the recompiler will explicitly save and restore
@@ -351,6 +355,7 @@ codegen_backend_prologue(codeblock_t *block)
     host_x86_PUSH(block, REG_R14);
     host_x86_PUSH(block, REG_R15);
     host_x86_SUB64_REG_IMM(block, REG_RSP, 0x38);
+    codegen_chain_entry = block_pos;
     host_x86_MOV64_REG_IMM(block, REG_RBP, ((uintptr_t) &cpu_state) + 128);
     if (block->flags & CODEBLOCK_HAS_FPU) {
         host_x86_MOV32_REG_ABS(block, REG_EAX, &cpu_state.TOP);
@@ -361,6 +366,24 @@ codegen_backend_prologue(codeblock_t *block)
         host_x86_MOV64_REG_IMM(block, REG_R12, (uintptr_t) ram);
 }
 
+void
+codegen_backend_chain_patch(codegen_chain_t *chain, codeblock_t *dest)
+{
+    if (dest) {
+        *(uint16_t *) chain->status_p = dest->status;
+        *(uint32_t *) chain->gen_p    = cpu_state.chain_gen;
+#    ifdef USE_INSTRUMENT
+        *(uint32_t *) chain->ins_p = dest->ins;
+#    endif
+        *(uint32_t *) chain->jump_p = (uintptr_t) &dest->data[codegen_chain_entry] - (uintptr_t) &chain->jump_p[4];
+    } else {
+#    ifdef USE_INSTRUMENT
+        *(uint32_t *) chain->ins_p = 0;
+#    endif
+        *(uint32_t *) chain->jump_p = 0;
+    }
+}
+
 void
 codegen_backend_epilogue(codeblock_t *block)
 {
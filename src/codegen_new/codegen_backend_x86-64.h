@@ -12,3 +12,4 @@
 #define BLOCK_MAX   0x3c0
 
 #define CODEGEN_BACKEND_HAS_MOV_IMM
+#define CODEGEN_BACKEND_HAS_CHAIN
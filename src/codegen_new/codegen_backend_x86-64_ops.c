@@ -4,6 +4,7 @@
 #    include <86box/86box.h>
 #    include "cpu.h"
 #    include <86box/mem.h>
+#    include <86box/pic.h>
 
 #    include "codegen.h"
 #    include "codegen_allocator.h"
@@ -308,6 +309,78 @@ host_x86_JMP(codeblock_t *block, void *p)
     jmp(block, (uintptr_t) p);
 }
 
+#    ifdef USE_INSTRUMENT
+#        define CHAIN_EXIT_SIZE (86 + 17)
+#    else
+#        define CHAIN_EXIT_SIZE 86
+#    endif
+
+void
+host_x86_JMP_CHAIN(codeblock_t *block, codegen_chain_t *chain, uint16_t chain_nr)
+{
+    int64_t  cycles_offset = (uintptr_t) &cycles - (((uintptr_t) &cpu_state) + 128);
+    int64_t  limit_offset  = (uintptr_t) &cpu_state.chain_limit - (((uintptr_t) &cpu_state) + 128);
+    int64_t  gen_offset    = (uintptr_t) &cpu_state.chain_gen - (((uintptr_t) &cpu_state) + 128);
+    int64_t  exit_offset   = (uintptr_t) &cpu_state.chain_exit - (((uintptr_t) &cpu_state) + 128);
+    uint8_t *branch_offset[4];
+    int      c;
+
+    /*The whole exit must be in one piece, so that the short branches and the
+      patched fields stay where they are*/
+    codegen_alloc_bytes(block, CHAIN_EXIT_SIZE);
+
+    codegen_addbyte2(block, 0x48, 0xbe); /*MOV RSI, &cpu_cur_status*/
+    codegen_addquad(block, (uintptr_t) &cpu_cur_status);
+    codegen_addbyte3(block, 0x66, 0x81, 0x3e); /*CMP W[RSI], status*/
+    chain->status_p = &block_write_data[block_pos];
+    codegen_addword(block, 0xffff);
+    codegen_addbyte2(block, 0x75, 0); /*JNZ unlinked*/
+    branch_offset[0] = &block_write_data[block_pos - 1];
+
+    codegen_addbyte2(block, 0x48, 0xbe); /*MOV RSI, &pic.int_pending*/
+    codegen_addquad(block, (uintptr_t) &pic.int_pending);
+    codegen_addbyte3(block, 0x80, 0x3e, 0); /*CMP B[RSI], 0*/
+    codegen_addbyte2(block, 0x75, 0);       /*JNZ unlinked*/
+    branch_offset[1] = &block_write_data[block_pos - 1];
+
+    codegen_addbyte2(block, 0x8b, 0x8d); /*MOV ECX, cycles*/
+    codegen_addlong(block, cycles_offset);
+    codegen_addbyte2(block, 0x3b, 0x8d); /*CMP ECX, cpu_state.chain_limit*/
+    codegen_addlong(block, limit_offset);
+    codegen_addbyte2(block, 0x7e, 0); /*JLE unlinked*/
+    branch_offset[2] = &block_write_data[block_pos - 1];
+
+    codegen_addbyte2(block, 0x81, 0xbd); /*CMP cpu_state.chain_gen, gen*/
+    codegen_addlong(block, gen_offset);
+    chain->gen_p = &block_write_data[block_pos];
+    codegen_addlong(block, 0);
+    codegen_addbyte2(block, 0x75, 0); /*JNZ unlinked*/
+    branch_offset[3] = &block_write_data[block_pos - 1];
+
+#    ifdef USE_INSTRUMENT
+    /*The dispatcher counts the instructions of the blocks it enters, so
+      chained entries have to count their own. The count is 0 while the exit
+      is unlinked*/
+    codegen_addbyte2(block, 0x48, 0xbe); /*MOV RSI, &instru_ins*/
+    codegen_addquad(block, (uintptr_t) &instru_ins);
+    codegen_addbyte3(block, 0x48, 0x81, 0x06); /*ADD Q[RSI], ins*/
+    chain->ins_p = &block_write_data[block_pos];
+    codegen_addlong(block, 0);
+#    endif
+
+    /*A zero offset falls through to the unlinked path*/
+    codegen_addbyte(block, 0xe9); /*JMP dest*/
+    chain->jump_p = &block_write_data[block_pos];
+    codegen_addlong(block, 0);
+
+    for (c = 0; c < 4; c++)
+        *branch_offset[c] = (uint8_t) ((uintptr_t) &block_write_data[block_pos] - (uintptr_t) branch_offset[c]) - 1;
+    codegen_addbyte2(block, 0xc7, 0x85); /*MOV cpu_state.chain_exit, chain_nr*/
+    codegen_addlong(block, exit_offset);
+    codegen_addlong(block, chain_nr);
+    host_x86_JMP(block, codegen_exit_rout);
+}
+
 void
 host_x86_JNZ(codeblock_t *block, void *p)
 {
@@ -774,6 +774,19 @@ codegen_JMP(codeblock_t *block, uop_t *uop)
     return 0;
 }
 
+static int
+codegen_JMP_CHAIN(codeblock_t *block, uop_t *uop)
+{
+    int chain_nr = codegen_chain_add(block, uop->imm_data);
+
+    if (chain_nr)
+        host_x86_JMP_CHAIN(block, &codegen_chains[chain_nr], chain_nr);
+    else
+        host_x86_JMP(block, codegen_exit_rout);
+
+    return 0;
+}
+
 static int
 codegen_LOAD_FUNC_ARG0(codeblock_t *block, uop_t *uop)
 {
@@ -2630,6 +2643,9 @@ const uOpFn uop_handlers[UOP_MAX] = {
     [UOP_JMP &
         UOP_MASK]
     = codegen_JMP,
+    [UOP_JMP_CHAIN &
+        UOP_MASK]
+    = codegen_JMP_CHAIN,
 
     [UOP_LOAD_SEG &
         UOP_MASK]
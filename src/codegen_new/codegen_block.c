@@ -1,9 +1,15 @@
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(__APPLE__) && defined(__aarch64__)
+#    include <pthread.h>
+#endif
 #include <86box/86box.h>
 #include "cpu.h"
 #include <86box/mem.h>
+#include <86box/thread.h>
+#include <86box/timer.h>
 
 #include "x86.h"
 #include "x86_flags.h"
@@ -55,6 +61,47 @@ static uint16_t block_free_list;
 static void     delete_block(codeblock_t *block);
 static void     delete_dirty_block(codeblock_t *block);
 
+static int evict_hand;
+/*Physical address of the last block evicted for each hash entry, to spot
+  blocks being compiled again after eviction*/
+static uint32_t *evicted_phys;
+
+uint64_t codegen_cache_allocs;
+uint64_t codegen_cache_evictions;
+uint64_t codegen_cache_recompiles;
+
+codegen_chain_t codegen_chains[CHAIN_SIZE];
+static uint16_t chain_free_list;
+int             codegen_chain_links;
+
+/*With cpu_dynarec_async set, the IR of a block is still built on the CPU
+  thread while the block is interpreted, but optimising it and generating the
+  host code is left to the compile thread. Only one block is compiled at a
+  time. The compile thread works on a copy of the block and on memory and exits
+  set aside for it in advance, so that it never touches anything the CPU thread
+  uses. The code is published by the CPU thread once it is done, and is thrown
+  away if the block is invalidated in the meantime.*/
+#define COMPILE_MEM_BLOCKS 16
+#define COMPILE_CHAINS     8
+
+static struct {
+    codeblock_t block; /*Copy of the block, as the compile thread sees it*/
+    uint16_t    block_nr;
+    int         cancelled;
+    ir_data_t  *ir;
+    atomic_int  done;
+} compile_job;
+
+static thread_t *compile_thread;
+static event_t  *compile_wake;
+static event_t  *compile_done;
+static int       compile_quit;
+/*Set while the compile thread takes exits from compile_chain_list*/
+static int      compile_staging;
+static uint16_t compile_chain_list;
+
+int codegen_compile_pending;
+
 /*Temporary list of code blocks that have recently been evicted. This allows for
   some historical state to be kept when a block is the target of self-modifying
   code.
@@ -197,7 +244,7 @@ block_free_list_get(void)
         }
         /*Free list is empty - free up a block*/
         if (!codegen_purge_purgable_list())
-            codegen_delete_random_block(0);
+            codegen_evict_block(0);
     }
 
     block           = &codeblock[block_free_list];
@@ -207,6 +254,292 @@ block_free_list_get(void)
     return block;
 }
 
+static void
+chain_init(void)
+{
+    int c;
+
+    memset(codegen_chains, 0, sizeof(codegen_chains));
+
+    /*Entry 0 is never used, so that it can mean no exit*/
+    chain_free_list = 0;
+    for (c = CHAIN_SIZE - 1; c > 0; c--) {
+        codegen_chains[c].next = chain_free_list;
+        chain_free_list        = c;
+    }
+    codegen_chain_links  = 0;
+    cpu_state.chain_exit = 0;
+}
+
+int
+codegen_chain_add(codeblock_t *block, uint32_t target)
+{
+    codegen_chain_t *chain;
+    uint16_t        *free_list = compile_staging ? &compile_chain_list : &chain_free_list;
+    uint16_t         chain_nr  = *free_list;
+
+    if (!chain_nr)
+        return 0;
+
+    chain      = &codegen_chains[chain_nr];
+    *free_list = chain->next;
+
+    chain->target    = target;
+    chain->block     = compile_staging ? compile_job.block_nr : get_block_nr(block);
+    chain->dest      = BLOCK_INVALID;
+    chain->next      = block->chain_out;
+    block->chain_out = chain_nr;
+
+    return chain_nr;
+}
+
+static void
+chain_unlink(codegen_chain_t *chain, int patch)
+{
+    codeblock_t *dest = &codeblock[chain->dest];
+
+    if (chain->prev_in)
+        codegen_chains[chain->prev_in].next_in = chain->next_in;
+    else
+        dest->chain_in = chain->next_in;
+    if (chain->next_in)
+        codegen_chains[chain->next_in].prev_in = chain->prev_in;
+
+    chain->dest = BLOCK_INVALID;
+    codegen_chain_links--;
+#ifdef CODEGEN_BACKEND_HAS_CHAIN
+    if (patch)
+        codegen_backend_chain_patch(chain, NULL);
+#endif
+}
+
+/*Send all exits chained to this block back through the dispatcher*/
+static void
+chain_unlink_in(codeblock_t *block)
+{
+    while (block->chain_in)
+        chain_unlink(&codegen_chains[block->chain_in], 1);
+}
+
+/*Release all chaining state for a block whose code is about to go away*/
+static void
+chain_free_block(codeblock_t *block)
+{
+    chain_unlink_in(block);
+
+    while (block->chain_out) {
+        uint16_t         chain_nr = block->chain_out;
+        codegen_chain_t *chain    = &codegen_chains[chain_nr];
+
+        /*No point patching code that is being freed*/
+        if (chain->dest != BLOCK_INVALID)
+            chain_unlink(chain, 0);
+
+        block->chain_out = chain->next;
+        chain->block     = BLOCK_INVALID;
+        chain->next      = chain_free_list;
+        chain_free_list  = chain_nr;
+    }
+}
+
+#ifdef CODEGEN_BACKEND_HAS_CHAIN
+static void
+chain_link(uint16_t chain_nr, codeblock_t *dest)
+{
+    codegen_chain_t *chain   = &codegen_chains[chain_nr];
+    uint16_t         dest_nr = get_block_nr(dest);
+
+    /*The exit may have been freed, or reused by another block, since it was
+      taken*/
+    if ((chain->block == BLOCK_INVALID) || (chain->target != dest->pc) || (codeblock[chain->block]._cs != dest->_cs))
+        return;
+    /*Leave blocks that span two pages or that depend on the FPU top-of-stack
+      to the checks in the dispatcher*/
+    if (dest->flags & (CODEBLOCK_HAS_PAGE2 | CODEBLOCK_STATIC_TOP | CODEBLOCK_IN_DIRTY_LIST))
+        return;
+
+    /*Relinking refreshes the status and mapping generation checked by the
+      exit*/
+    if (chain->dest != BLOCK_INVALID)
+        chain_unlink(chain, 0);
+
+    chain->dest    = dest_nr;
+    chain->prev_in = BLOCK_INVALID;
+    chain->next_in = dest->chain_in;
+    if (dest->chain_in)
+        codegen_chains[dest->chain_in].prev_in = chain_nr;
+    dest->chain_in = chain_nr;
+    codegen_chain_links++;
+
+    codegen_backend_chain_patch(chain, dest);
+}
+#endif
+
+void
+codegen_chain_enter(codeblock_t *block)
+{
+#ifdef CODEGEN_BACKEND_HAS_CHAIN
+    int32_t until_timer = (int32_t) (timer_target - (uint32_t) tsc);
+
+    /*The profiler counts block entries in the dispatcher*/
+    if (dynarec_profile) {
+        cpu_state.chain_exit  = 0;
+        cpu_state.chain_limit = INT32_MAX;
+        return;
+    }
+
+    if (cpu_state.chain_exit) {
+        chain_link(cpu_state.chain_exit, block);
+        cpu_state.chain_exit = 0;
+    }
+
+    /*Chained blocks must come back to the dispatcher by the time the next
+      timer is due, so timers fire exactly when they would without chaining.
+      Single stepping needs the dispatcher after every block.*/
+    if ((until_timer <= 0) || (cpu_state.flags & T_FLAG))
+        cpu_state.chain_limit = INT32_MAX;
+    else if (until_timer >= cycles)
+        cpu_state.chain_limit = 0;
+    else
+        cpu_state.chain_limit = cycles - until_timer;
+#endif
+}
+
+void
+codegen_chain_check_page(page_t *page)
+{
+    uint16_t block_nr = page->block;
+
+    /*Only blocks within a single page are chained to, so the list of blocks
+      starting in this page covers all of them*/
+    while (block_nr) {
+        codeblock_t *block = &codeblock[block_nr];
+
+        if (block->chain_in && (*block->dirty_mask & block->page_mask))
+            chain_unlink_in(block);
+
+        block_nr = block->next;
+    }
+}
+
+static void
+codegen_compile_thread(void *priv)
+{
+#if defined(__APPLE__) && defined(__aarch64__)
+    pthread_jit_write_protect_np(0);
+#endif
+    while (1) {
+        thread_wait_event(compile_wake, -1);
+        thread_reset_event(compile_wake);
+        if (compile_quit)
+            break;
+
+        codegen_ir_compile(compile_job.ir, &compile_job.block);
+
+        atomic_store_explicit(&compile_job.done, 1, memory_order_release);
+        thread_set_event(compile_done);
+    }
+}
+
+/*Hand block to the compile thread. The CPU thread keeps interpreting it until
+  it has been published*/
+static void
+codegen_compile_start(codeblock_t *block, ir_data_t *ir)
+{
+    int c;
+
+    block->flags = (block->flags & ~CODEBLOCK_WAS_RECOMPILED) | CODEBLOCK_COMPILING;
+
+    compile_job.block           = *block;
+    compile_job.block.chain_out = 0;
+    compile_job.block.chain_in  = 0;
+    compile_job.block_nr        = get_block_nr(block);
+    compile_job.cancelled       = 0;
+    compile_job.ir              = ir;
+    atomic_store_explicit(&compile_job.done, 0, memory_order_relaxed);
+
+    codegen_allocator_stage(COMPILE_MEM_BLOCKS, compile_job.block_nr);
+    for (c = 0; (c < COMPILE_CHAINS) && chain_free_list; c++) {
+        uint16_t chain_nr = chain_free_list;
+
+        chain_free_list                = codegen_chains[chain_nr].next;
+        codegen_chains[chain_nr].next  = compile_chain_list;
+        codegen_chains[chain_nr].block = BLOCK_INVALID;
+        compile_chain_list             = chain_nr;
+    }
+    compile_staging         = 1;
+    codegen_compile_pending = 1;
+
+    thread_set_event(compile_wake);
+}
+
+/*Called when block is invalidated or deleted while it is being compiled. The
+  memory is still being written to, so it stays with the job until the compile
+  thread is done*/
+static void
+codegen_compile_cancel(codeblock_t *block)
+{
+    compile_job.cancelled = 1;
+    block->flags &= ~CODEBLOCK_COMPILING;
+    block->head_mem_block = NULL;
+}
+
+static void
+codegen_compile_publish(void)
+{
+    codeblock_t *block = &codeblock[compile_job.block_nr];
+    uint16_t     chain_nr;
+
+    codegen_compile_pending = 0;
+    compile_staging         = 0;
+    codegen_allocator_unstage();
+    while (compile_chain_list) {
+        chain_nr                      = compile_chain_list;
+        compile_chain_list            = codegen_chains[chain_nr].next;
+        codegen_chains[chain_nr].next = chain_free_list;
+        chain_free_list               = chain_nr;
+    }
+
+    if (!compile_job.cancelled && codegen_allocator_staging_overflow) {
+        /*Try again on the CPU thread, which can allocate as much as it needs*/
+        block->flags = (block->flags & ~CODEBLOCK_COMPILING) | CODEBLOCK_COMPILE_SYNC;
+        block->head_mem_block = NULL;
+        compile_job.cancelled = 1;
+    }
+    if (compile_job.cancelled) {
+        chain_free_block(&compile_job.block);
+        if (compile_job.block.head_mem_block)
+            codegen_allocator_free(compile_job.block.head_mem_block);
+        return;
+    }
+
+    block->chain_out = compile_job.block.chain_out;
+    block->flags     = (block->flags & ~CODEBLOCK_COMPILING) | CODEBLOCK_WAS_RECOMPILED;
+    codegen_profile_block_end(block);
+}
+
+void
+codegen_compile_poll(void)
+{
+    if (atomic_load_explicit(&compile_job.done, memory_order_acquire))
+        codegen_compile_publish();
+}
+
+/*Wait for the compile thread to be done with the current block, if any*/
+static void
+codegen_compile_sync(void)
+{
+    if (!codegen_compile_pending)
+        return;
+
+    thread_reset_event(compile_done);
+    while (!atomic_load_explicit(&compile_job.done, memory_order_acquire)) {
+        thread_wait_event(compile_done, -1);
+        thread_reset_event(compile_done);
+    }
+    codegen_compile_publish();
+}
+
 void
 codegen_init(void)
 {
@@ -220,14 +553,39 @@ codegen_init(void)
         block_free_list_add(&codeblock[c]);
     block_dirty_list_head = block_dirty_list_tail = 0;
     dirty_list_size                               = 0;
+    chain_init();
+
+    evicted_phys = malloc(HASH_SIZE * sizeof(uint32_t));
+    if (!evicted_phys)
+        fatal("codegen_init: out of memory\n");
+    memset(evicted_phys, 0xff, HASH_SIZE * sizeof(uint32_t));
 #ifdef DEBUG_EXTRA
     memset(instr_counts, 0, sizeof(instr_counts));
 #endif
+    codegen_profile_init();
+
+    if (cpu_dynarec_async) {
+        compile_quit   = 0;
+        compile_wake   = thread_create_event();
+        compile_done   = thread_create_event();
+        compile_thread = thread_create(codegen_compile_thread, NULL);
+    }
 }
 
 void
 codegen_close(void)
 {
+    if (compile_thread) {
+        codegen_compile_sync();
+        compile_quit = 1;
+        thread_set_event(compile_wake);
+        thread_wait(compile_thread);
+        thread_destroy_event(compile_done);
+        thread_destroy_event(compile_wake);
+        compile_thread = NULL;
+    }
+
+    codegen_profile_close();
 #ifdef DEBUG_EXTRA
     pclog("Instruction counts :\n");
     while (1) {
@@ -257,10 +615,13 @@ codegen_reset(void)
 {
     int c;
 
+    codegen_compile_sync();
+
     for (c = 1; c < BLOCK_SIZE; c++) {
         codeblock_t *block = &codeblock[c];
 
         if (block->pc != BLOCK_PC_INVALID) {
+            codegen_profile_retire(block);
             block->phys   = 0;
             block->phys_2 = 0;
             delete_block(block);
@@ -269,7 +630,9 @@ codegen_reset(void)
 
     memset(codeblock, 0, BLOCK_SIZE * sizeof(codeblock_t));
     memset(codeblock_hash, 0, HASH_SIZE * sizeof(uint16_t));
+    memset(evicted_phys, 0xff, HASH_SIZE * sizeof(uint32_t));
     mem_reset_page_blocks();
+    chain_init();
 
     block_free_list = 0;
     for (c = 0; c < BLOCK_SIZE; c++) {
@@ -396,6 +759,10 @@ invalidate_block(codeblock_t *block)
 #endif
     remove_from_block_list(block, old_pc);
     block_dirty_list_add(block);
+    chain_free_block(block);
+    codegen_profile_retire(block);
+    if (block->flags & CODEBLOCK_COMPILING)
+        codegen_compile_cancel(block);
     if (block->head_mem_block)
         codegen_allocator_free(block->head_mem_block);
     block->head_mem_block = NULL;
@@ -413,6 +780,7 @@ delete_block(codeblock_t *block)
     if (block->pc == BLOCK_PC_INVALID)
         fatal("Deleting deleted block\n");
 #endif
+    codegen_profile_retire(block);
     block->pc = BLOCK_PC_INVALID;
 
     codeblock_tree_delete(block);
@@ -420,6 +788,9 @@ delete_block(codeblock_t *block)
         block_dirty_list_remove(block);
     else
         remove_from_block_list(block, old_pc);
+    chain_free_block(block);
+    if (block->flags & CODEBLOCK_COMPILING)
+        codegen_compile_cancel(block);
     if (block->head_mem_block)
         codegen_allocator_free(block->head_mem_block);
     block->head_mem_block = NULL;
@@ -450,21 +821,40 @@ codegen_delete_block(codeblock_t *block)
 }
 
 void
-codegen_delete_random_block(int required_mem_block)
+codegen_evict_block(int required_mem_block)
 {
-    int block_nr = rand() & BLOCK_MASK;
-
-    while (1) {
-        if (block_nr && block_nr != block_current) {
-            codeblock_t *block = &codeblock[block_nr];
+    int c;
 
-            if (block->pc != BLOCK_PC_INVALID && (!required_mem_block || block->head_mem_block)) {
-                delete_block(block);
-                return;
-            }
+    /*Clock algorithm. Blocks that have been entered since the hand last
+      passed have their referenced flag cleared and get a second chance, any
+      other block is evicted. Blocks that are
+      only reached through chained exits are never seen by the dispatcher,
+      so those exits are unlinked to find out whether the block is still in
+      use.*/
+    for (c = 0; c < 2 * BLOCK_SIZE; c++) {
+        codeblock_t *block;
+
+        evict_hand = (evict_hand + 1) & BLOCK_MASK;
+        if (!evict_hand || evict_hand == block_current)
+            continue;
+
+        block = &codeblock[evict_hand];
+        if (block->pc == BLOCK_PC_INVALID || (required_mem_block && !block->head_mem_block) || (block->flags & CODEBLOCK_COMPILING))
+            continue;
+
+        if (c < BLOCK_SIZE && (block->referenced || block->chain_in)) {
+            block->referenced = 0;
+            chain_unlink_in(block);
+            continue;
         }
-        block_nr = (block_nr + 1) & BLOCK_MASK;
+
+        evicted_phys[HASH(block->phys)] = block->phys;
+        codegen_cache_evictions++;
+        delete_block(block);
+        return;
     }
+
+    fatal("codegen_evict_block: no block to evict\n");
 }
 
 void
@@ -548,6 +938,8 @@ codegen_block_init(uint32_t phys_addr)
     block->page_mask = block->page_mask2 = 0;
     block->flags                         = CODEBLOCK_STATIC_TOP;
     block->status                        = cpu_cur_status;
+    block->referenced                    = 1;
+    block->entries                       = 0;
 
     recomp_page = block->phys & ~0xfff;
     codeblock_tree_add(block);
@@ -577,6 +969,17 @@ codegen_block_start_recompile(codeblock_t *block)
         fatal("Recompile to used block!\n");
 #endif
 
+    /*Exits out of any previous version of this block are no longer used*/
+    chain_free_block(block);
+    codegen_profile_retire(block);
+    codegen_profile_block_start(block);
+
+    if (evicted_phys[block_num] == block->phys) {
+        evicted_phys[block_num] = BLOCK_PC_INVALID;
+        codegen_cache_recompiles++;
+    }
+    block->referenced = 1;
+
     block->head_mem_block = codegen_allocator_allocate(NULL, block_current);
     block->data           = codeblock_allocator_get_ptr(block->head_mem_block);
 
@@ -794,13 +1197,20 @@ codegen_block_end_recompile(codeblock_t *block)
         block->flags &= ~CODEBLOCK_STATIC_TOP;
 
     codegen_accumulate_flush(ir_data);
-    codegen_ir_compile(ir_data, block);
+    if (compile_thread && !(block->flags & CODEBLOCK_COMPILE_SYNC))
+        codegen_compile_start(block, ir_data);
+    else {
+        codegen_ir_compile(ir_data, block);
+        codegen_profile_block_end(block);
+    }
 }
 
 void
 codegen_flush(void)
 {
-    return;
+    /*The linear to physical mapping may have changed, so chained exits
+      must go back through the dispatcher's checks*/
+    cpu_state.chain_gen++;
 }
 
 void
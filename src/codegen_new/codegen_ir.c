@@ -79,9 +79,16 @@ codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
             }
         }
     }
+#ifdef CODEGEN_BACKEND_HAS_CHAIN
+    else if (codegen_fallthrough != BLOCK_PC_INVALID) {
+        /*The block ends on an instruction that leaves the PC at a known
+          address, so the end of the block can be chained to the next one*/
+        uop_JMP_CHAIN(ir, codegen_fallthrough);
+    }
+#endif
 
     codegen_reg_mark_as_required();
-    codegen_reg_process_dead_list(ir);
+    codegen_ir_optimise(ir, block);
     block_write_data = codeblock_allocator_get_ptr(block->head_mem_block);
     block_pos        = 0;
     codegen_backend_prologue(block);
@@ -55,6 +55,9 @@
 #define UOP_JMP_DEST       (UOP_TYPE_PARAMS_IMM | UOP_TYPE_PARAMS_POINTER | 0x17 | UOP_TYPE_ORDER_BARRIER | UOP_TYPE_JUMP)
 #define UOP_NOP_BARRIER    (UOP_TYPE_BARRIER | 0x18)
 #define UOP_STORE_P_IMM_16 (UOP_TYPE_PARAMS_IMM | 0x19)
+/*UOP_JMP_CHAIN - leave block for linear address in imm_data, IREG_pc must already be set.
+  Only generated by backends that define CODEGEN_BACKEND_HAS_CHAIN*/
+#define UOP_JMP_CHAIN (UOP_TYPE_PARAMS_IMM | 0x1a | UOP_TYPE_ORDER_BARRIER)
 
 #ifdef DEBUG_EXTRA
 /*UOP_LOG_INSTR - log non-recompiled instruction in imm_data*/
@@ -703,6 +706,7 @@ uop_gen_reg_src2_pointer(uint32_t uop_type, ir_data_t *ir, int src_reg_a, int sr
     } while (0)
 
 #define uop_JMP(ir, p)                                                   uop_gen_pointer(UOP_JMP, ir, p)
+#define uop_JMP_CHAIN(ir, target)                                        uop_gen_imm(UOP_JMP_CHAIN, ir, target)
 #define uop_JMP_DEST(ir)                                                 uop_gen(UOP_JMP_DEST, ir)
 
 #define uop_LOAD_SEG(ir, p, src_reg)                                     uop_gen_reg_src_pointer(UOP_LOAD_SEG, ir, src_reg, p)
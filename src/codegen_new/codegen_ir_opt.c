@@ -0,0 +1,355 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/mem.h>
+
+#include "codegen.h"
+#include "codegen_ir.h"
+#include "codegen_reg.h"
+
+/*Optimisation passes run over a complete block of uOPs, before any host
+  registers are allocated. These don't remove uOPs themselves; they rewrite
+  uOPs in place and add the register versions that are no longer needed to
+  the dead register list, which then removes the parent uOPs as usual.*/
+
+#ifdef ENABLE_CODEGEN_IR_OPT_LOG
+int codegen_ir_opt_do_log = ENABLE_CODEGEN_IR_OPT_LOG;
+
+static void
+codegen_ir_opt_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (codegen_ir_opt_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+
+static uint64_t uops_total_before, uops_total_after;
+#endif
+
+/*Non-zero for uOPs that are the target of a jump within the block*/
+static uint8_t jump_dest[UOP_NR_MAX];
+
+static void
+find_jump_dests(ir_data_t *ir)
+{
+    int c;
+
+    memset(jump_dest, 0, ir->wr_pos);
+
+    for (c = 0; c < ir->wr_pos; c++) {
+        uop_t *uop = &ir->uops[c];
+
+        if ((uop->type & UOP_TYPE_JUMP) && uop->jump_dest_uop != -1 && uop->jump_dest_uop < ir->wr_pos)
+            jump_dest[uop->jump_dest_uop] = 1;
+    }
+}
+
+static int
+reg_is_dword(ir_reg_t ir_reg)
+{
+    return (IREG_GET_SIZE(ir_reg.reg) == IREG_SIZE_L) && reg_is_native_size(ir_reg);
+}
+
+/*Drop a read of a register version that a uOP no longer performs. Temporary
+  registers are never written back, so once nothing reads a version it can be
+  optimised out. Versions followed by a partial write are kept, as the partial
+  write has an implicit dependency on them.*/
+static void
+drop_read(ir_data_t *ir, ir_reg_t ir_reg)
+{
+    int            reg  = IREG_GET_REG(ir_reg.reg);
+    reg_version_t *regv = &reg_version[reg][ir_reg.version];
+
+    regv->refcount--;
+    if (regv->refcount || !ir_reg.version || !reg_is_volatile(ir_reg))
+        return;
+    if (ir_reg.version < reg_last_version[reg]) {
+        uop_t *next = &ir->uops[reg_version[reg][ir_reg.version + 1].parent_uop];
+
+        if (!reg_is_native_size(next->dest_reg_a))
+            return;
+    }
+    add_to_dead_list(regv, reg, ir_reg.version);
+}
+
+/*Returns non-zero if this register version was loaded with a constant by a
+  UOP_MOV_IMM at or after region_start*/
+static int
+get_const(ir_data_t *ir, ir_reg_t ir_reg, int region_start, uint32_t *val)
+{
+    reg_version_t *regv;
+    uop_t         *parent;
+
+    if (ir_reg_is_invalid(ir_reg) || !ir_reg.version)
+        return 0;
+
+    regv = &reg_version[IREG_GET_REG(ir_reg.reg)][ir_reg.version];
+    if (regv->parent_uop < region_start)
+        return 0;
+    parent = &ir->uops[regv->parent_uop];
+    if ((parent->type & UOP_MASK) != (UOP_MOV_IMM & UOP_MASK) || IREG_GET_REG(parent->dest_reg_a.reg) != IREG_GET_REG(ir_reg.reg) || parent->dest_reg_a.version != ir_reg.version || !reg_is_dword(parent->dest_reg_a))
+        return 0;
+
+    switch (IREG_GET_SIZE(ir_reg.reg)) {
+        case IREG_SIZE_L:
+            *val = parent->imm_data;
+            return 1;
+        case IREG_SIZE_W:
+            *val = parent->imm_data & 0xffff;
+            return 1;
+        case IREG_SIZE_B:
+            *val = parent->imm_data & 0xff;
+            return 1;
+        case IREG_SIZE_BH:
+            *val = (parent->imm_data >> 8) & 0xff;
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+/*Constant folding. A 32-bit MOV, MOVZX or ALU uOP whose sources are all known
+  constants is replaced by a UOP_MOV_IMM of the result, which in turn may be
+  folded into later uOPs. SUB and XOR of a register with itself always give
+  zero.
+
+  Register versions are only treated as constants within a region that the
+  block can't enter part way through, and where no called function can have
+  modified cpu_state; ie constants don't propagate past barriers or jump
+  destinations.*/
+static int
+fold_constants(ir_data_t *ir)
+{
+    int region_start = 0;
+    int folded       = 0;
+    int c;
+
+    for (c = 0; c < ir->wr_pos; c++) {
+        uop_t   *uop = &ir->uops[c];
+        uint32_t src_a;
+        uint32_t src_b;
+        uint32_t result;
+
+        if ((uop->type & UOP_TYPE_BARRIER) || jump_dest[c])
+            region_start = c;
+
+        if (ir_reg_is_invalid(uop->dest_reg_a) || !reg_is_dword(uop->dest_reg_a))
+            continue;
+
+        switch (uop->type & UOP_MASK) {
+            case (UOP_MOV & UOP_MASK):
+            case (UOP_MOVZX & UOP_MASK):
+                if (!get_const(ir, uop->src_reg_a, region_start, &src_a))
+                    continue;
+                result = src_a;
+                break;
+
+            case (UOP_ADD_IMM & UOP_MASK):
+            case (UOP_SUB_IMM & UOP_MASK):
+            case (UOP_AND_IMM & UOP_MASK):
+            case (UOP_OR_IMM & UOP_MASK):
+            case (UOP_XOR_IMM & UOP_MASK):
+                if (IREG_GET_SIZE(uop->src_reg_a.reg) != IREG_SIZE_L || !get_const(ir, uop->src_reg_a, region_start, &src_a))
+                    continue;
+                switch (uop->type & UOP_MASK) {
+                    case (UOP_ADD_IMM & UOP_MASK):
+                        result = src_a + uop->imm_data;
+                        break;
+                    case (UOP_SUB_IMM & UOP_MASK):
+                        result = src_a - uop->imm_data;
+                        break;
+                    case (UOP_AND_IMM & UOP_MASK):
+                        result = src_a & uop->imm_data;
+                        break;
+                    case (UOP_OR_IMM & UOP_MASK):
+                        result = src_a | uop->imm_data;
+                        break;
+                    default:
+                        result = src_a ^ uop->imm_data;
+                        break;
+                }
+                break;
+
+            case (UOP_ADD & UOP_MASK):
+            case (UOP_SUB & UOP_MASK):
+            case (UOP_AND & UOP_MASK):
+            case (UOP_OR & UOP_MASK):
+            case (UOP_XOR & UOP_MASK):
+                if (IREG_GET_SIZE(uop->src_reg_a.reg) != IREG_SIZE_L || IREG_GET_SIZE(uop->src_reg_b.reg) != IREG_SIZE_L)
+                    continue;
+                if (((uop->type & UOP_MASK) == (UOP_SUB & UOP_MASK) || (uop->type & UOP_MASK) == (UOP_XOR & UOP_MASK)) && uop->src_reg_a.reg == uop->src_reg_b.reg && uop->src_reg_a.version == uop->src_reg_b.version) {
+                    result = 0;
+                    break;
+                }
+                if (!get_const(ir, uop->src_reg_a, region_start, &src_a) || !get_const(ir, uop->src_reg_b, region_start, &src_b))
+                    continue;
+                switch (uop->type & UOP_MASK) {
+                    case (UOP_ADD & UOP_MASK):
+                        result = src_a + src_b;
+                        break;
+                    case (UOP_SUB & UOP_MASK):
+                        result = src_a - src_b;
+                        break;
+                    case (UOP_AND & UOP_MASK):
+                        result = src_a & src_b;
+                        break;
+                    case (UOP_OR & UOP_MASK):
+                        result = src_a | src_b;
+                        break;
+                    default:
+                        result = src_a ^ src_b;
+                        break;
+                }
+                break;
+
+            default:
+                continue;
+        }
+
+        drop_read(ir, uop->src_reg_a);
+        if (!ir_reg_is_invalid(uop->src_reg_b))
+            drop_read(ir, uop->src_reg_b);
+        uop->type      = UOP_MOV_IMM;
+        uop->src_reg_a = invalid_ir_reg;
+        uop->src_reg_b = invalid_ir_reg;
+        uop->imm_data  = result;
+        folded++;
+    }
+
+    return folded;
+}
+
+static int
+is_mem_access(uop_t *uop)
+{
+    switch (uop->type & UOP_MASK) {
+        case (UOP_MEM_LOAD_ABS & UOP_MASK):
+        case (UOP_MEM_LOAD_REG & UOP_MASK):
+        case (UOP_MEM_LOAD_SINGLE & UOP_MASK):
+        case (UOP_MEM_LOAD_DOUBLE & UOP_MASK):
+        case (UOP_MEM_STORE_ABS & UOP_MASK):
+        case (UOP_MEM_STORE_REG & UOP_MASK):
+        case (UOP_MEM_STORE_IMM_8 & UOP_MASK):
+        case (UOP_MEM_STORE_IMM_16 & UOP_MASK):
+        case (UOP_MEM_STORE_IMM_32 & UOP_MASK):
+        case (UOP_MEM_STORE_SINGLE & UOP_MASK):
+        case (UOP_MEM_STORE_DOUBLE & UOP_MASK):
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+static const int flags_regs[4] = { IREG_flags_op, IREG_flags_res, IREG_flags_op1, IREG_flags_op2 };
+
+/*Dead lazy flag write elimination. Every barrier marks the current version of
+  each flags register as required, so a flags write that is overwritten later
+  in the block is only removed when there is no barrier between the two.
+
+  A memory access can only leave the block by faulting, in which case the
+  instruction is restarted from IREG_oldpc and only the flags as they were at
+  that point matter. Flags written after the last write to IREG_oldpc are
+  therefore not needed by a memory access, and are removed if they are
+  overwritten before anything else needs them. This covers the operands an
+  ALU op with a memory destination writes before its store.*/
+static int
+remove_dead_flags(ir_data_t *ir)
+{
+    int written_at[4];
+    int version[4];
+    int needed[4];
+    int restart_point = -1;
+    int removed       = 0;
+    int c;
+    int f;
+
+    for (f = 0; f < 4; f++) {
+        written_at[f] = -1;
+        version[f]    = 0;
+        needed[f]     = 1;
+    }
+
+    for (c = 0; c < ir->wr_pos; c++) {
+        uop_t *uop = &ir->uops[c];
+        int    reg;
+
+        if (uop->type & (UOP_TYPE_BARRIER | UOP_TYPE_ORDER_BARRIER)) {
+            int mem_access = is_mem_access(uop);
+
+            for (f = 0; f < 4; f++) {
+                if (!mem_access || restart_point == -1 || written_at[f] < restart_point)
+                    needed[f] = 1;
+            }
+        }
+
+        if (ir_reg_is_invalid(uop->dest_reg_a))
+            continue;
+
+        reg = IREG_GET_REG(uop->dest_reg_a.reg);
+        if (reg == IREG_oldpc)
+            restart_point = c;
+
+        for (f = 0; f < 4; f++) {
+            if (reg != flags_regs[f])
+                continue;
+
+            if (version[f] && !needed[f] && reg_is_native_size(uop->dest_reg_a)) {
+                reg_version_t *regv = &reg_version[reg][version[f]];
+
+                /*Versions that weren't required are already on the dead
+                  list*/
+                if (!regv->refcount && (regv->flags & REG_FLAGS_REQUIRED)) {
+                    regv->flags &= ~REG_FLAGS_REQUIRED;
+                    add_to_dead_list(regv, reg, version[f]);
+                    removed++;
+                }
+            }
+            written_at[f] = c;
+            version[f]    = uop->dest_reg_a.version;
+            needed[f]     = 0;
+        }
+    }
+
+    return removed;
+}
+
+void
+codegen_ir_optimise(ir_data_t *ir, codeblock_t *block)
+{
+#ifdef ENABLE_CODEGEN_IR_OPT_LOG
+    int uops_after = 0;
+    int folded;
+    int flags_removed;
+    int c;
+
+    find_jump_dests(ir);
+    folded        = fold_constants(ir);
+    flags_removed = remove_dead_flags(ir);
+    codegen_reg_process_dead_list(ir);
+
+    for (c = 0; c < ir->wr_pos; c++) {
+        if ((ir->uops[c].type & UOP_MASK) != UOP_INVALID)
+            uops_after++;
+    }
+    uops_total_before += ir->wr_pos;
+    uops_total_after += uops_after;
+    codegen_ir_opt_log("IR opt: block %08x: %i uOPs, %i after optimisation (%i folded, %i flag writes removed); total %" PRIu64 " -> %" PRIu64 "\n",
+                       block->pc, ir->wr_pos, uops_after, folded, flags_removed, uops_total_before, uops_total_after);
+#else
+    find_jump_dests(ir);
+    fold_constants(ir);
+    remove_dead_flags(ir);
+    codegen_reg_process_dead_list(ir);
+#endif
+}
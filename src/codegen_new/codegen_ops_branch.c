@@ -57,8 +57,7 @@ ropJO_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
             jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, 0);
             break;
     }
-    uop_MOV_IMM(ir, IREG_pc, dest_addr);
-    uop_JMP(ir, codegen_exit_rout);
+    codegen_exit_to(ir, dest_addr);
     uop_set_jump_dest(ir, jump_uop);
     return 0;
 }
@@ -72,8 +71,7 @@ ropJNO_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         case FLAGS_ZN16:
         case FLAGS_ZN32:
             /*Overflow is always zero*/
-            uop_MOV_IMM(ir, IREG_pc, dest_addr);
-            uop_JMP(ir, codegen_exit_rout);
+            codegen_exit_to(ir, dest_addr);
             return 0;
 
         case FLAGS_SUB8:
@@ -97,8 +95,7 @@ ropJNO_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
             jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
             break;
     }
-    uop_MOV_IMM(ir, IREG_pc, dest_addr);
-    uop_JMP(ir, codegen_exit_rout);
+    codegen_exit_to(ir, dest_addr);
     uop_set_jump_dest(ir, jump_uop);
     return 0;
 }
@@ -146,8 +143,7 @@ ropJB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
                 jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, 0);
             break;
     }
-    uop_MOV_IMM(ir, IREG_pc, do_unroll ? next_pc : dest_addr);
-    uop_JMP(ir, codegen_exit_rout);
+    codegen_exit_to(ir, do_unroll ? next_pc : dest_addr);
     uop_set_jump_dest(ir, jump_uop);
     return do_unroll ? 1 : 0;
 }
@@ -162,8 +158,7 @@ ropJNB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         case FLAGS_ZN16:
         case FLAGS_ZN32:
             /*Carry is always zero*/
-            uop_MOV_IMM(ir, IREG_pc, dest_addr);
-            uop_JMP(ir, codegen_exit_rout);
+            codegen_exit_to(ir, dest_addr);
             return 0;
 
         case FLAGS_SUB8:
@@ -196,8 +191,7 @@ ropJNB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
                 jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
             break;
     }
-    uop_MOV_IMM(ir, IREG_pc, do_unroll ? next_pc : dest_addr);
-    uop_JMP(ir, codegen_exit_rout);
+    codegen_exit_to(ir, do_unroll ? next_pc : dest_addr);
     uop_set_jump_dest(ir, jump_uop);
     return do_unroll ? 1 : 0;
 }
@@ -214,8 +208,7 @@ ropJE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
         } else {
             jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_flags_res, 0);
         }
-        uop_MOV_IMM(ir, IREG_pc, next_pc);
-        uop_JMP(ir, codegen_exit_rout);
+        codegen_exit_to(ir, next_pc);
         uop_set_jump_dest(ir, jump_uop);
         return 1;
     } else {
@@ -225,8 +218,7 @@ ropJE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
         } else {
             jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_flags_res, 0);
         }
-        uop_MOV_IMM(ir, IREG_pc, dest_addr);
-        uop_JMP(ir, codegen_exit_rout);
+        codegen_exit_to(ir, dest_addr);
         uop_set_jump_dest(ir, jump_uop);
     }
     return 0;
@@ -243,8 +235,7 @@ ropJNE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         } else {
             jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_flags_res, 0);
         }
-        uop_MOV_IMM(ir, IREG_pc, next_pc);
-        uop_JMP(ir, codegen_exit_rout);
+        codegen_exit_to(ir, next_pc);
         uop_set_jump_dest(ir, jump_uop);
         return 1;
     } else {
@@ -254,8 +245,7 @@ ropJNE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         } else {
             jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_flags_res, 0);
         }
-        uop_MOV_IMM(ir, IREG_pc, dest_addr);
-        uop_JMP(ir, codegen_exit_rout);
+        codegen_exit_to(ir, dest_addr);
         uop_set_jump_dest(ir, jump_uop);
     }
     return 0;
@@ -313,8 +303,7 @@ ropJBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
             break;
     }
     if (do_unroll) {
-        uop_MOV_IMM(ir, IREG_pc, next_pc);
-        uop_JMP(ir, codegen_exit_rout);
+        codegen_exit_to(ir, next_pc);
         uop_set_jump_dest(ir, jump_uop);
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
@@ -322,8 +311,7 @@ ropJBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
     } else {
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
-        uop_MOV_IMM(ir, IREG_pc, dest_addr);
-        uop_JMP(ir, codegen_exit_rout);
+        codegen_exit_to(ir, dest_addr);
         uop_set_jump_dest(ir, jump_uop);
         return 0;
     }
@@ -382,13 +370,11 @@ ropJNBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
     if (do_unroll) {
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
-        uop_MOV_IMM(ir, IREG_pc, next_pc);
-        uop_JMP(ir, codegen_exit_rout);
+        codegen_exit_to(ir, next_pc);
         uop_set_jump_dest(ir, jump_uop);
         return 1;
     } else {
-        uop_MOV_IMM(ir, IREG_pc, dest_addr);
-        uop_JMP(ir, codegen_exit_rout);
+        codegen_exit_to(ir, dest_addr);
         uop_set_jump_dest(ir, jump_uop);
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
@@ -454,8 +440,7 @@ ropJS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
                 jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, 0);
             break;
     }
-    uop_MOV_IMM(ir, IREG_pc, do_unroll ? next_pc : dest_addr);
-    uop_JMP(ir, codegen_exit_rout);
+    codegen_exit_to(ir, do_unroll ? next_pc : dest_addr);
     uop_set_jump_dest(ir, jump_uop);
     return do_unroll ? 1 : 0;
 }
@@ -517,8 +502,7 @@ ropJNS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
                 jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
             break;
     }
-    uop_MOV_IMM(ir, IREG_pc, do_unroll ? next_pc : dest_addr);
-    uop_JMP(ir, codegen_exit_rout);
+    codegen_exit_to(ir, do_unroll ? next_pc : dest_addr);
     uop_set_jump_dest(ir, jump_uop);
     return do_unroll ? 1 : 0;
 }
@@ -530,8 +514,7 @@ ropJP_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
 
     uop_CALL_FUNC_RESULT(ir, IREG_temp0, PF_SET);
     jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, 0);
-    uop_MOV_IMM(ir, IREG_pc, dest_addr);
-    uop_JMP(ir, codegen_exit_rout);
+    codegen_exit_to(ir, dest_addr);
     uop_set_jump_dest(ir, jump_uop);
     return 0;
 }
@@ -542,8 +525,7 @@ ropJNP_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 
     uop_CALL_FUNC_RESULT(ir, IREG_temp0, PF_SET);
     jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
-    uop_MOV_IMM(ir, IREG_pc, dest_addr);
-    uop_JMP(ir, codegen_exit_rout);
+    codegen_exit_to(ir, dest_addr);
     uop_set_jump_dest(ir, jump_uop);
     return 0;
 }
@@ -608,10 +590,9 @@ ropJL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
             break;
     }
     if (do_unroll)
-        uop_MOV_IMM(ir, IREG_pc, next_pc);
+        codegen_exit_to(ir, next_pc);
     else
-        uop_MOV_IMM(ir, IREG_pc, dest_addr);
-    uop_JMP(ir, codegen_exit_rout);
+        codegen_exit_to(ir, dest_addr);
     uop_set_jump_dest(ir, jump_uop);
     return do_unroll ? 1 : 0;
 }
@@ -675,10 +656,9 @@ ropJNL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
             break;
     }
     if (do_unroll)
-        uop_MOV_IMM(ir, IREG_pc, next_pc);
+        codegen_exit_to(ir, next_pc);
     else
-        uop_MOV_IMM(ir, IREG_pc, dest_addr);
-    uop_JMP(ir, codegen_exit_rout);
+        codegen_exit_to(ir, dest_addr);
     uop_set_jump_dest(ir, jump_uop);
     return do_unroll ? 1 : 0;
 }
@@ -730,8 +710,7 @@ ropJLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
             break;
     }
     if (do_unroll) {
-        uop_MOV_IMM(ir, IREG_pc, next_pc);
-        uop_JMP(ir, codegen_exit_rout);
+        codegen_exit_to(ir, next_pc);
         uop_set_jump_dest(ir, jump_uop);
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
@@ -739,8 +718,7 @@ ropJLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
     } else {
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
-        uop_MOV_IMM(ir, IREG_pc, dest_addr);
-        uop_JMP(ir, codegen_exit_rout);
+        codegen_exit_to(ir, dest_addr);
         uop_set_jump_dest(ir, jump_uop);
         return 0;
     }
@@ -794,13 +772,11 @@ ropJNLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
     if (do_unroll) {
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
-        uop_MOV_IMM(ir, IREG_pc, next_pc);
-        uop_JMP(ir, codegen_exit_rout);
+        codegen_exit_to(ir, next_pc);
         uop_set_jump_dest(ir, jump_uop);
         return 1;
     } else {
-        uop_MOV_IMM(ir, IREG_pc, dest_addr);
-        uop_JMP(ir, codegen_exit_rout);
+        codegen_exit_to(ir, dest_addr);
         uop_set_jump_dest(ir, jump_uop);
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
@@ -875,8 +851,7 @@ ropJ(O)
         jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_ECX, 0);
     else
         jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_CX, 0);
-    uop_MOV_IMM(ir, IREG_pc, dest_addr);
-    uop_JMP(ir, codegen_exit_rout);
+    codegen_exit_to(ir, dest_addr);
     uop_set_jump_dest(ir, jump_uop);
 
     codegen_mark_code_present(block, cs + op_pc, 1);
@@ -902,7 +877,7 @@ ropLOOP(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat, ui
             uop_SUB_IMM(ir, IREG_CX, IREG_CX, 1);
             jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_CX, 0);
         }
-        uop_MOV_IMM(ir, IREG_pc, op_pc + 1);
+        codegen_exit_to(ir, op_pc + 1);
         ret_addr = dest_addr;
         CPU_BLOCK_END();
     } else {
@@ -913,10 +888,9 @@ ropLOOP(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat, ui
             uop_SUB_IMM(ir, IREG_CX, IREG_CX, 1);
             jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_CX, 0);
         }
-        uop_MOV_IMM(ir, IREG_pc, dest_addr);
+        codegen_exit_to(ir, dest_addr);
         ret_addr = op_pc + 1;
     }
-    uop_JMP(ir, codegen_exit_rout);
     uop_set_jump_dest(ir, jump_uop);
 
     codegen_mark_code_present(block, cs + op_pc, 1);
@@ -946,8 +920,7 @@ ropLOOPE(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat, u
     } else {
         jump_uop2 = uop_CMP_IMM_JNZ_DEST(ir, IREG_flags_res, 0);
     }
-    uop_MOV_IMM(ir, IREG_pc, dest_addr);
-    uop_JMP(ir, codegen_exit_rout);
+    codegen_exit_to(ir, dest_addr);
     uop_NOP_BARRIER(ir);
     uop_set_jump_dest(ir, jump_uop);
     uop_set_jump_dest(ir, jump_uop2);
@@ -978,8 +951,7 @@ ropLOOPNE(codeblock_t *block, ir_data_t *ir, uint8_t opcode, uint32_t fetchdat,
     } else {
         jump_uop2 = uop_CMP_IMM_JZ_DEST(ir, IREG_flags_res, 0);
     }
-    uop_MOV_IMM(ir, IREG_pc, dest_addr);
-    uop_JMP(ir, codegen_exit_rout);
+    codegen_exit_to(ir, dest_addr);
     uop_NOP_BARRIER(ir);
     uop_set_jump_dest(ir, jump_uop);
     uop_set_jump_dest(ir, jump_uop2);
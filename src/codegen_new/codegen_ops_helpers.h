@@ -125,3 +125,17 @@ codegen_can_unroll(codeblock_t *block, ir_data_t *ir, uint32_t next_pc, uint32_t
 
     return codegen_can_unroll_full(block, ir, next_pc, dest_addr);
 }
+
+/*Leave the block for dest_pc, which is known at compile time. Where the
+  backend supports it, the exit can later be chained straight to the block
+  at dest_pc.*/
+static inline void
+codegen_exit_to(ir_data_t *ir, uint32_t dest_pc)
+{
+    uop_MOV_IMM(ir, IREG_pc, dest_pc);
+#ifdef CODEGEN_BACKEND_HAS_CHAIN
+    uop_JMP_CHAIN(ir, cs + dest_pc);
+#else
+    uop_JMP(ir, codegen_exit_rout);
+#endif
+}
@@ -0,0 +1,272 @@
+#if defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__)
+#    include <unistd.h>
+#endif
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/mem.h>
+
+#include "codegen.h"
+#include "codegen_allocator.h"
+#include "codegen_backend.h"
+
+/*Dynarec profiler.
+
+  Each time a block is compiled, the executable memory it occupies is written
+  to /tmp/perf-<pid>.map, so that perf can put a name to samples in generated
+  code. The dispatcher counts the entries to each block; blocks are not
+  chained to each other while profiling, so every entry goes through the
+  dispatcher. When a block is discarded its count is added to a record for
+  its address, and the report on exit lists the records with the most entries.
+
+  Instructions that the recompiler hands to the interpreter are recorded per
+  block at compile time. Their execution count is estimated as the number of
+  entries to the blocks containing them.*/
+
+#define PROFILE_FALLBACKS_MAX 64
+#define PROFILE_REPORT_NR     50
+
+typedef struct profile_block_t {
+    uint8_t  compiled;
+    uint8_t  nr_fallbacks;
+    uint16_t fallbacks[PROFILE_FALLBACKS_MAX];
+} profile_block_t;
+
+typedef struct profile_record_t {
+    uint32_t pc;
+    uint32_t phys;
+    uint64_t entries;
+    uint32_t compiles;
+    uint8_t  ins;
+    uint8_t  interpreted;
+} profile_record_t;
+
+static FILE            *perf_map;
+static profile_block_t *profile_blocks;
+
+static profile_record_t *records;
+static int               records_size;
+static int               records_nr;
+
+static uint64_t *fallback_counts;
+static uint64_t  total_entries;
+
+static uint32_t
+record_hash(uint32_t pc, uint32_t phys)
+{
+    return (phys ^ (pc * 0x9e3779b1)) & (records_size - 1);
+}
+
+static profile_record_t *
+record_get(uint32_t pc, uint32_t phys)
+{
+    uint32_t hash;
+
+    if ((records_nr * 2) >= records_size) {
+        profile_record_t *old      = records;
+        int               old_size = records_size;
+        int               c;
+
+        records_size = old_size ? (old_size * 2) : 4096;
+        records      = calloc(records_size, sizeof(profile_record_t));
+        if (!records)
+            fatal("codegen_profile: out of memory\n");
+        for (c = 0; c < old_size; c++) {
+            if (old[c].compiles) {
+                hash = record_hash(old[c].pc, old[c].phys);
+                while (records[hash].compiles)
+                    hash = (hash + 1) & (records_size - 1);
+                records[hash] = old[c];
+            }
+        }
+        free(old);
+    }
+
+    hash = record_hash(pc, phys);
+    while (records[hash].compiles) {
+        if (records[hash].pc == pc && records[hash].phys == phys)
+            return &records[hash];
+        hash = (hash + 1) & (records_size - 1);
+    }
+
+    records[hash].pc   = pc;
+    records[hash].phys = phys;
+    records_nr++;
+    return &records[hash];
+}
+
+void
+codegen_profile_init(void)
+{
+    if (!dynarec_profile)
+        return;
+
+    profile_blocks  = calloc(BLOCK_SIZE, sizeof(profile_block_t));
+    fallback_counts = calloc(256 * 256, sizeof(uint64_t));
+    if (!profile_blocks || !fallback_counts)
+        fatal("codegen_profile_init: out of memory\n");
+
+#if defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__)
+    {
+        char fn[64];
+
+        sprintf(fn, "/tmp/perf-%i.map", (int) getpid());
+        perf_map = fopen(fn, "w");
+        if (perf_map)
+            pclog("Dynarec profiler: writing perf map to %s\n", fn);
+        else
+            pclog("Dynarec profiler: can't create %s\n", fn);
+    }
+#endif
+}
+
+void
+codegen_profile_block_start(codeblock_t *block)
+{
+    if (!dynarec_profile)
+        return;
+
+    profile_blocks[block - codeblock].nr_fallbacks = 0;
+}
+
+void
+codegen_profile_fallback(codeblock_t *block, uint16_t instr)
+{
+    profile_block_t *prof = &profile_blocks[block - codeblock];
+
+    if (prof->nr_fallbacks < PROFILE_FALLBACKS_MAX)
+        prof->fallbacks[prof->nr_fallbacks++] = instr;
+}
+
+void
+codegen_profile_block_end(codeblock_t *block)
+{
+    struct mem_block_t *mem_block;
+
+    if (!dynarec_profile)
+        return;
+
+    profile_blocks[block - codeblock].compiled = 1;
+    block->entries                             = 0;
+
+    if (perf_map) {
+        /*Code may continue into further memory blocks, each of which is used
+          only by this code block*/
+        for (mem_block = block->head_mem_block; mem_block; mem_block = codegen_allocator_get_next(mem_block))
+            fprintf(perf_map, "%" PRIxPTR " %x dynarec %08x (phys %08x)\n",
+                    (uintptr_t) codeblock_allocator_get_ptr(mem_block), MEM_BLOCK_SIZE, block->pc, block->phys);
+    }
+}
+
+void
+codegen_profile_retire(codeblock_t *block)
+{
+    profile_block_t  *prof;
+    profile_record_t *rec;
+    int               c;
+
+    if (!dynarec_profile)
+        return;
+
+    prof = &profile_blocks[block - codeblock];
+    if (!prof->compiled)
+        return;
+    prof->compiled = 0;
+
+    rec = record_get(block->pc, block->phys);
+    rec->entries += block->entries;
+    rec->compiles++;
+    rec->ins         = block->ins;
+    rec->interpreted = prof->nr_fallbacks;
+
+    for (c = 0; c < prof->nr_fallbacks; c++)
+        fallback_counts[prof->fallbacks[c]] += block->entries;
+    total_entries += block->entries;
+    block->entries = 0;
+}
+
+static int
+record_compare(const void *a, const void *b)
+{
+    const profile_record_t *rec_a = (const profile_record_t *) a;
+    const profile_record_t *rec_b = (const profile_record_t *) b;
+
+    if (rec_a->entries != rec_b->entries)
+        return (rec_a->entries < rec_b->entries) ? 1 : -1;
+    return 0;
+}
+
+void
+codegen_profile_close(void)
+{
+    profile_record_t *sorted;
+    int               nr = 0;
+    int               c;
+
+    if (!dynarec_profile)
+        return;
+
+    for (c = 1; c < BLOCK_SIZE; c++)
+        codegen_profile_retire(&codeblock[c]);
+
+    if (perf_map) {
+        fclose(perf_map);
+        perf_map = NULL;
+    }
+
+    pclog("Dynarec profile: %i blocks, %" PRIu64 " block entries\n", records_nr, total_entries);
+    if (records_nr && total_entries) {
+        sorted = malloc(records_nr * sizeof(profile_record_t));
+        if (!sorted)
+            fatal("codegen_profile_close: out of memory\n");
+        for (c = 0; c < records_size; c++) {
+            if (records[c].compiles)
+                sorted[nr++] = records[c];
+        }
+        qsort(sorted, nr, sizeof(profile_record_t), record_compare);
+
+        pclog("Hot blocks :\n");
+        pclog("  pc       phys          entries      %%  ins  interp  compiles\n");
+        for (c = 0; c < nr && c < PROFILE_REPORT_NR && sorted[c].entries; c++) {
+            pclog("  %08x %08x %14" PRIu64 " %6.2f  %3i  %6i  %8u\n", sorted[c].pc, sorted[c].phys, sorted[c].entries,
+                  (double) sorted[c].entries * 100.0 / (double) total_entries, sorted[c].ins, sorted[c].interpreted, sorted[c].compiles);
+        }
+        free(sorted);
+    }
+
+    pclog("Interpreted instructions (estimated executions) :\n");
+    for (c = 0; c < PROFILE_REPORT_NR; c++) {
+        uint64_t highest_num = 0;
+        int      highest_idx = 0;
+        int      d;
+
+        for (d = 0; d < 256 * 256; d++) {
+            if (fallback_counts[d] > highest_num) {
+                highest_num = fallback_counts[d];
+                highest_idx = d;
+            }
+        }
+        if (!highest_num)
+            break;
+
+        fallback_counts[highest_idx] = 0;
+        if (highest_idx > 0xff)
+            pclog(" %02x %02x = %" PRIu64 "\n", highest_idx >> 8, highest_idx & 0xff, highest_num);
+        else
+            pclog("    %02x = %" PRIu64 "\n", highest_idx & 0xff, highest_num);
+    }
+
+    free(records);
+    records      = NULL;
+    records_size = 0;
+    records_nr   = 0;
+    free(fallback_counts);
+    fallback_counts = NULL;
+    free(profile_blocks);
+    profile_blocks = NULL;
+    total_entries  = 0;
+}
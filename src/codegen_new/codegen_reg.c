@@ -223,6 +223,12 @@ reg_is_native_size(ir_reg_t ir_reg)
     return 0;
 }
 
+int
+reg_is_volatile(ir_reg_t ir_reg)
+{
+    return (ireg_data[IREG_GET_REG(ir_reg.reg)].is_volatile == REG_VOLATILE);
+}
+
 void
 codegen_reg_reset(void)
 {
@@ -198,6 +198,8 @@ load_general(void)
     video_vsync     = ini_section_get_int(cat, "video_gl_vsync", 0);
     strncpy(video_shader, ini_section_get_string(cat, "video_gl_shader", ""), sizeof(video_shader) - 1);
 
+    video_render_threads = ini_section_get_int(cat, "video_render_threads", 0);
+
     window_remember = ini_section_get_int(cat, "window_remember", 0);
     if (window_remember) {
         p = ini_section_get_string(cat, "window_coordinates", NULL);
@@ -497,7 +499,9 @@ load_machine(void)
     if (mem_size > machine_get_max_ram(machine))
         mem_size = machine_get_max_ram(machine);
 
-    cpu_use_dynarec = !!ini_section_get_int(cat, "cpu_use_dynarec", 0);
+    cpu_use_dynarec   = !!ini_section_get_int(cat, "cpu_use_dynarec", 0);
+    cpu_dynarec_cache = ini_section_get_int(cat, "cpu_dynarec_cache", 0);
+    cpu_dynarec_async = !!ini_section_get_int(cat, "cpu_dynarec_async", 0);
 
     p = ini_section_get_string(cat, "time_sync", NULL);
     if (p != NULL) {
@@ -704,6 +708,8 @@ load_sound(void)
     } else {
         fm_driver = FM_DRV_NUKED;
     }
+
+    fm_offload = !!ini_section_get_int(cat, "fm_offload", 0);
 }
 
 /* Load "Network" section. */
@@ -755,6 +761,12 @@ load_network(void)
     ini_section_delete_var(cat, "net_type");
     ini_section_delete_var(cat, "net_host_device");
 
+    network_queue_len = ini_section_get_int(cat, "net_queue_len", NET_QUEUE_LEN);
+    if (network_queue_len < 4)
+        network_queue_len = 4;
+    else if (network_queue_len > NET_QUEUE_LEN_MAX)
+        network_queue_len = NET_QUEUE_LEN_MAX;
+
     for (c = min; c < NET_CARD_MAX; c++) {
         sprintf(temp, "net_%02i_card", c + 1);
         p = ini_section_get_string(cat, temp, NULL);
@@ -906,6 +918,7 @@ load_storage_controllers(void)
 
     ide_ter_enabled = !!ini_section_get_int(cat, "ide_ter", 0);
     ide_qua_enabled = !!ini_section_get_int(cat, "ide_qua", 0);
+    hdd_image_async = !!ini_section_get_int(cat, "hdd_async_io", 0);
 
     /* TODO: Re-enable by default after we actually have a proper machine flag for this. */
     cassette_enable = !!ini_section_get_int(cat, "cassette_enabled", 0);
@@ -1301,6 +1314,10 @@ load_floppy_and_cdrom_drives(void)
         }
     }
 
+    cdrom_image_readahead = ini_section_get_int(cat, "cdrom_readahead", 64);
+    if (cdrom_image_readahead < 0)
+        cdrom_image_readahead = 0;
+
     memset(temp, 0x00, sizeof(temp));
     for (c = 0; c < CDROM_NUM; c++) {
         sprintf(temp, "cdrom_%02i_host_drive", c + 1);
@@ -2054,6 +2071,11 @@ save_general(void)
     else
         ini_section_delete_var(cat, "video_gl_shader");
 
+    if (video_render_threads > 0)
+        ini_section_set_int(cat, "video_render_threads", video_render_threads);
+    else
+        ini_section_delete_var(cat, "video_render_threads");
+
     ini_delete_section_if_empty(config, cat);
 }
 
@@ -2174,6 +2196,16 @@ save_machine(void)
 
     ini_section_set_int(cat, "cpu_use_dynarec", cpu_use_dynarec);
 
+    if (cpu_dynarec_cache == 0)
+        ini_section_delete_var(cat, "cpu_dynarec_cache");
+    else
+        ini_section_set_int(cat, "cpu_dynarec_cache", cpu_dynarec_cache);
+
+    if (cpu_dynarec_async == 0)
+        ini_section_delete_var(cat, "cpu_dynarec_async");
+    else
+        ini_section_set_int(cat, "cpu_dynarec_async", cpu_dynarec_async);
+
     if (time_sync & TIME_SYNC_ENABLED)
         if (time_sync & TIME_SYNC_UTC)
             ini_section_set_string(cat, "time_sync", "utc");
@@ -2338,6 +2370,11 @@ save_sound(void)
 
     ini_section_set_string(cat, "fm_driver", (fm_driver == FM_DRV_NUKED) ? "nuked" : "ymfm");
 
+    if (fm_offload)
+        ini_section_set_int(cat, "fm_offload", fm_offload);
+    else
+        ini_section_delete_var(cat, "fm_offload");
+
     ini_delete_section_if_empty(config, cat);
 }
 
@@ -2353,6 +2390,11 @@ save_network(void)
     ini_section_delete_var(cat, "net_host_device");
     ini_section_delete_var(cat, "net_card");
 
+    if (network_queue_len == NET_QUEUE_LEN)
+        ini_section_delete_var(cat, "net_queue_len");
+    else
+        ini_section_set_int(cat, "net_queue_len", network_queue_len);
+
     for (c = 0; c < NET_CARD_MAX; c++) {
         sprintf(temp, "net_%02i_card", c + 1);
         if (net_cards_conf[c].device_num == 0) {
@@ -2480,6 +2522,11 @@ save_storage_controllers(void)
     else
         ini_section_set_int(cat, "ide_qua", ide_qua_enabled);
 
+    if (hdd_image_async == 0)
+        ini_section_delete_var(cat, "hdd_async_io");
+    else
+        ini_section_set_int(cat, "hdd_async_io", hdd_image_async);
+
     ini_delete_section_if_empty(config, cat);
 
     if (cassette_enable == 0)
@@ -2702,6 +2749,11 @@ save_floppy_and_cdrom_drives(void)
         }
     }
 
+    if (cdrom_image_readahead == 64)
+        ini_section_delete_var(cat, "cdrom_readahead");
+    else
+        ini_section_set_int(cat, "cdrom_readahead", cdrom_image_readahead);
+
     for (c = 0; c < CDROM_NUM; c++) {
         sprintf(temp, "cdrom_%02i_host_drive", c + 1);
         if ((cdrom[c].bus_type == 0) || (cdrom[c].host_drive != 200)) {
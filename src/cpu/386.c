@@ -155,6 +155,7 @@ exec386(int cycs)
                 trap = cpu_state.flags & T_FLAG;
 
                 cpu_state.pc++;
+                INSTRU_COUNT(ins, 1);
                 x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
                 if (x86_was_reset)
                     break;
@@ -29,6 +29,7 @@
 
 #ifdef USE_DYNAREC
 #    include "codegen.h"
+#    include "codegen_public.h"
 #    define CPU_BLOCK_END() cpu_block_end = 1
 #else
 #    define CPU_BLOCK_END()
@@ -1845,6 +1846,9 @@ smi_raise(void)
         cpu_fast_off_advance();
 
     smi_line = 1;
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    codegen_chain_break();
+#endif
 }
 
 void
@@ -1854,6 +1858,9 @@ nmi_raise(void)
         cpu_fast_off_advance();
 
     nmi = 1;
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    codegen_chain_break();
+#endif
 }
 
 #ifndef USE_DYNAREC
@@ -361,6 +361,7 @@ exec386_dynarec_int(void)
             trap = cpu_state.flags & T_FLAG;
 
             cpu_state.pc++;
+            INSTRU_COUNT(ins, 1);
             x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
         }
 
@@ -416,6 +417,9 @@ exec386_dynarec_dyn(void)
     int valid_block = 0;
 
 #    ifdef USE_NEW_DYNAREC
+    if (codegen_compile_pending)
+        codegen_compile_poll();
+
     if (!cpu_state.abrt)
 #    else
     if (block && !cpu_state.abrt)
@@ -532,9 +536,16 @@ exec386_dynarec_dyn(void)
 
 #    ifndef USE_NEW_DYNAREC
         codeblock_hash[hash] = block;
+#    else
+        block->referenced = 1;
+        if (dynarec_profile)
+            block->entries++;
+        codegen_chain_enter(block);
 #    endif
         inrecomp = 1;
         code();
+        /* Approximate, a block can be left early on an exception. */
+        INSTRU_COUNT(ins, block->ins);
 #    ifdef USE_ACYCS
         acycs = 0;
 #    endif
@@ -544,7 +555,16 @@ exec386_dynarec_dyn(void)
         if (!use32)
             cpu_state.pc &= 0xffff;
 #    endif
-    } else if (valid_block && !cpu_state.abrt) {
+    }
+#    ifdef USE_NEW_DYNAREC
+    else if (valid_block && !cpu_state.abrt && codegen_compile_pending) {
+        /* The compile thread is busy with another block, and owns the IR
+           buffers until it is done. Interpret this one for now, it will be
+           compiled the next time it is run. */
+        exec386_dynarec_int();
+    }
+#    endif
+    else if (valid_block && !cpu_state.abrt) {
 #    ifdef USE_NEW_DYNAREC
         start_pc                 = cs + cpu_state.pc;
         const int max_block_size = (block->flags & CODEBLOCK_BYTE_MASK) ? ((128 - 25) - (start_pc & 0x3f)) : 1000;
@@ -586,6 +606,7 @@ exec386_dynarec_dyn(void)
 
                 codegen_generate_call(opcode, x86_opcodes[(opcode | cpu_state.op32) & 0x3ff], fetchdat, cpu_state.pc, cpu_state.pc - 1);
 
+                INSTRU_COUNT(ins, 1);
                 x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
 
                 if (x86_was_reset)
@@ -681,6 +702,7 @@ exec386_dynarec_dyn(void)
 
                 cpu_state.pc++;
 
+                INSTRU_COUNT(ins, 1);
                 x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
 
                 if (x86_was_reset)
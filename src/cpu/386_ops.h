@@ -204,6 +204,7 @@ extern void x386_dynarec_log(const char *fmt, ...);
 #include "x86_ops_mul.h"
 #include "x86_ops_pmode.h"
 #include "x86_ops_prefix.h"
+#include "x86_ops_rep_io.h"
 #ifdef IS_DYNAREC
 #    include "x86_ops_rep_dyn.h"
 #else
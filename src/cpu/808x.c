@@ -1671,6 +1671,7 @@ execx86(int cycs)
             cpu_state.oldpc = cpu_state.pc;
             opcode          = pfq_fetchb();
             handled         = 0;
+            INSTRU_COUNT(ins, 1);
             oldc            = cpu_state.flags & C_FLAG;
             if (clear_lock) {
                 in_lock    = 0;
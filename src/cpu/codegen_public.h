@@ -55,6 +55,25 @@ extern void codegen_close(void);
 #endif
 extern void codegen_flush(void);
 
+#ifdef USE_NEW_DYNAREC
+/*Code cache statistics: memory blocks allocated, code blocks evicted to make
+  room, and evicted code blocks that had to be compiled again*/
+extern uint64_t codegen_cache_allocs;
+extern uint64_t codegen_cache_evictions;
+extern uint64_t codegen_cache_recompiles;
+
+/*Number of block exits currently chained to another block*/
+extern int codegen_chain_links;
+
+struct page_t;
+/*Unchain exits leading into blocks on this page that have been written to*/
+extern void codegen_chain_check_page(struct page_t *page);
+
+/*Make any chained exit return to the dispatcher, so that it can act on an
+  interrupt or similar before running the next block*/
+#    define codegen_chain_break() cpu_state.chain_limit = INT32_MAX
+#endif
+
 /*Current physical page of block being recompiled. -1 if no recompilation taking place */
 extern uint32_t recomp_page;
 extern int      codegen_in_recompile;
@@ -31,15 +31,19 @@
 #include <86box/device.h>
 #include <86box/machine.h>
 #include <86box/io.h>
+#include "x86.h"
 #include "x86_ops.h"
 #include <86box/mem.h>
 #include <86box/nmi.h>
 #include <86box/pic.h>
 #include <86box/pci.h>
 #include <86box/gdbstub.h>
+#include <86box/timer.h>
+#include <86box/savestate.h>
 #ifdef USE_DYNAREC
 #    include "codegen.h"
 #endif
+#include "x87.h"
 #include "x87_timings.h"
 
 #define CCR1_USE_SMI  (1 << 1)
@@ -3195,3 +3199,74 @@ cpu_update_waitstates(void)
     if (cpu_s->rspeed <= 8000000)
         cpu_rom_prefetch_cycles = cpu_mem_prefetch_cycles;
 }
+
+/* Save or restore the processor state. This is only ever done between two
+   blocks of code, so nothing that is only live within an instruction needs
+   to be kept. */
+void
+cpu_savestate(savestate_t *st, void *priv)
+{
+    uint64_t new_tsc       = tsc;
+    int      new_effective = cpu_effective;
+
+    savestate_var(st, new_effective);
+    if (savestate_loading(st))
+        cpu_dynamic_switch(new_effective);
+
+    savestate_var(st, cpu_state);
+    savestate_var(st, msr);
+    savestate_var(st, cyrix);
+    savestate_var(st, cr2);
+    savestate_var(st, cr3);
+    savestate_var(st, cr4);
+    savestate_var(st, dr);
+    savestate_var(st, _tr);
+    savestate_var(st, gdt);
+    savestate_var(st, ldt);
+    savestate_var(st, idt);
+    savestate_var(st, tr);
+    savestate_var(st, use32);
+    savestate_var(st, stack32);
+    savestate_var(st, cpu_cur_status);
+    savestate_var(st, new_tsc);
+    savestate_var(st, pmc);
+    savestate_var(st, cs_msr);
+    savestate_var(st, esp_msr);
+    savestate_var(st, eip_msr);
+    savestate_var(st, amd_efer);
+    savestate_var(st, star);
+    savestate_var(st, x87_pc_off);
+    savestate_var(st, x87_op_off);
+    savestate_var(st, x87_pc_seg);
+    savestate_var(st, x87_op_seg);
+    savestate_var(st, smi_latched);
+    savestate_var(st, smm_in_hlt);
+    savestate_var(st, smi_block);
+    savestate_var(st, in_sys);
+    savestate_var(st, nmi);
+    savestate_var(st, nmi_mask);
+    savestate_var(st, cpu_cache_int_enabled);
+    savestate_var(st, cpu_cache_ext_enabled);
+    savestate_var(st, cpu_fast_off_count);
+    savestate_var(st, cpu_fast_off_val);
+    savestate_var(st, cpu_fast_off_flags);
+    savestate_var(st, ccr0);
+    savestate_var(st, ccr1);
+    savestate_var(st, ccr2);
+    savestate_var(st, ccr3);
+    savestate_var(st, ccr4);
+    savestate_var(st, ccr5);
+    savestate_var(st, ccr6);
+    savestate_var(st, cyrix_addr);
+
+    if (savestate_loading(st)) {
+        cpu_state.ea_seg = &cpu_state.seg_ds;
+
+        /* Timers of devices that have no state of their own are moved
+           along with the TSC, so they keep their distance from it. */
+        timer_set_tsc(new_tsc);
+
+        cpu_update_waitstates();
+        flushmmucache();
+    }
+}
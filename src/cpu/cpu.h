@@ -395,6 +395,14 @@ typedef struct {
     uint32_t _smbase;
 
     uint8_t inside_emulation_mode;
+
+#ifdef USE_NEW_DYNAREC
+    /*Chained jumps between code blocks are only taken while cycles is above
+      chain_limit and chain_gen still matches the value they were linked with.
+      chain_exit is the exit last left through without a link.*/
+    int32_t  chain_limit;
+    uint32_t chain_gen, chain_exit;
+#endif
 } cpu_state_t;
 
 #define in_smm   cpu_state._in_smm
@@ -0,0 +1,84 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Host CPU feature checks, used to pick vector code paths.
+ */
+#include <stdint.h>
+#if defined(_MSC_VER) && !defined(__clang__) && (defined(_M_X64) || defined(_M_IX86))
+#    include <immintrin.h>
+#    include <intrin.h>
+#endif
+#include <86box/host_cpu.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+int
+host_cpu_has_sse2(void)
+{
+#    if defined(__x86_64__) || defined(_M_X64)
+    return 1;
+#    elif defined(_MSC_VER) && !defined(__clang__)
+    int regs[4];
+
+    __cpuid(regs, 1);
+    return !!(regs[3] & (1 << 26));
+#    else
+    return __builtin_cpu_supports("sse2");
+#    endif
+}
+
+int
+host_cpu_has_ssse3(void)
+{
+#    if defined(_MSC_VER) && !defined(__clang__)
+    int regs[4];
+
+    __cpuid(regs, 1);
+    return !!(regs[2] & (1 << 9));
+#    else
+    return __builtin_cpu_supports("ssse3");
+#    endif
+}
+
+int
+host_cpu_has_avx2(void)
+{
+#    if defined(_MSC_VER) && !defined(__clang__)
+    int regs[4];
+
+    __cpuid(regs, 0);
+    if (regs[0] < 7)
+        return 0;
+    __cpuid(regs, 1);
+    /* The OS must also save the YMM registers. */
+    if (!(regs[2] & (1 << 27)) || ((_xgetbv(0) & 6) != 6))
+        return 0;
+    __cpuidex(regs, 7, 0);
+    return !!(regs[1] & (1 << 5));
+#    else
+    return __builtin_cpu_supports("avx2");
+#    endif
+}
+#else
+int
+host_cpu_has_sse2(void)
+{
+    return 0;
+}
+
+int
+host_cpu_has_ssse3(void)
+{
+    return 0;
+}
+
+int
+host_cpu_has_avx2(void)
+{
+    return 0;
+}
+#endif
@@ -6,7 +6,8 @@
         addr64 = 0x00000000;                                                                                      \
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
-            uint8_t temp;                                                                                         \
+            uint8_t  temp;                                                                                        \
+            uint32_t done;                                                                                        \
                                                                                                                   \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
             check_io_perm(DX);                                                                                    \
@@ -15,20 +16,27 @@
             do_mmut_wb(es, DEST_REG, &addr64);                                                                    \
             if (cpu_state.abrt)                                                                                   \
                 return 1;                                                                                         \
-            temp = inb(DX);                                                                                       \
-            writememb_n(es, DEST_REG, addr64, temp);                                                              \
-            if (cpu_state.abrt)                                                                                   \
-                return 1;                                                                                         \
-                                                                                                                  \
-            if (cpu_state.flags & D_FLAG)                                                                         \
-                DEST_REG--;                                                                                       \
-            else                                                                                                  \
-                DEST_REG++;                                                                                       \
-            CNT_REG--;                                                                                            \
-            cycles -= 15;                                                                                         \
-            reads++;                                                                                              \
-            writes++;                                                                                             \
-            total_cycles += 15;                                                                                   \
+            done = rep_ins_block(DX, DEST_REG, CNT_REG, 1, REP_IO_ADDR_MASK(DEST_REG));                           \
+            if (done) {                                                                                           \
+                DEST_REG += done;                                                                                 \
+                CNT_REG -= done;                                                                                  \
+            } else {                                                                                              \
+                temp = inb(DX);                                                                                   \
+                writememb_n(es, DEST_REG, addr64, temp);                                                          \
+                if (cpu_state.abrt)                                                                               \
+                    return 1;                                                                                     \
+                                                                                                                  \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    DEST_REG--;                                                                                   \
+                else                                                                                              \
+                    DEST_REG++;                                                                                   \
+                CNT_REG--;                                                                                        \
+                done = 1;                                                                                         \
+            }                                                                                                     \
+            cycles -= 15 * done;                                                                                  \
+            reads += done;                                                                                        \
+            writes += done;                                                                                       \
+            total_cycles += 15 * done;                                                                            \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, reads, 0, writes, 0, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -46,6 +54,7 @@
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
             uint16_t temp;                                                                                        \
+            uint32_t done;                                                                                        \
                                                                                                                   \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
             check_io_perm(DX);                                                                                    \
@@ -55,20 +64,27 @@
             do_mmut_ww(es, DEST_REG, addr64a);                                                                    \
             if (cpu_state.abrt)                                                                                   \
                 return 1;                                                                                         \
-            temp = inw(DX);                                                                                       \
-            writememw_n(es, DEST_REG, addr64a, temp);                                                             \
-            if (cpu_state.abrt)                                                                                   \
-                return 1;                                                                                         \
-                                                                                                                  \
-            if (cpu_state.flags & D_FLAG)                                                                         \
-                DEST_REG -= 2;                                                                                    \
-            else                                                                                                  \
-                DEST_REG += 2;                                                                                    \
-            CNT_REG--;                                                                                            \
-            cycles -= 15;                                                                                         \
-            reads++;                                                                                              \
-            writes++;                                                                                             \
-            total_cycles += 15;                                                                                   \
+            done = rep_ins_block(DX, DEST_REG, CNT_REG, 2, REP_IO_ADDR_MASK(DEST_REG));                           \
+            if (done) {                                                                                           \
+                DEST_REG += done << 1;                                                                            \
+                CNT_REG -= done;                                                                                  \
+            } else {                                                                                              \
+                temp = inw(DX);                                                                                   \
+                writememw_n(es, DEST_REG, addr64a, temp);                                                         \
+                if (cpu_state.abrt)                                                                               \
+                    return 1;                                                                                     \
+                                                                                                                  \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    DEST_REG -= 2;                                                                                \
+                else                                                                                              \
+                    DEST_REG += 2;                                                                                \
+                CNT_REG--;                                                                                        \
+                done = 1;                                                                                         \
+            }                                                                                                     \
+            cycles -= 15 * done;                                                                                  \
+            reads += done;                                                                                        \
+            writes += done;                                                                                       \
+            total_cycles += 15 * done;                                                                            \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, reads, 0, writes, 0, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -86,6 +102,7 @@
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
             uint32_t temp;                                                                                        \
+            uint32_t done;                                                                                        \
                                                                                                                   \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
             check_io_perm(DX);                                                                                    \
@@ -97,20 +114,27 @@
             do_mmut_wl(es, DEST_REG, addr64a);                                                                    \
             if (cpu_state.abrt)                                                                                   \
                 return 1;                                                                                         \
-            temp = inl(DX);                                                                                       \
-            writememl_n(es, DEST_REG, addr64a, temp);                                                             \
-            if (cpu_state.abrt)                                                                                   \
-                return 1;                                                                                         \
-                                                                                                                  \
-            if (cpu_state.flags & D_FLAG)                                                                         \
-                DEST_REG -= 4;                                                                                    \
-            else                                                                                                  \
-                DEST_REG += 4;                                                                                    \
-            CNT_REG--;                                                                                            \
-            cycles -= 15;                                                                                         \
-            reads++;                                                                                              \
-            writes++;                                                                                             \
-            total_cycles += 15;                                                                                   \
+            done = rep_ins_block(DX, DEST_REG, CNT_REG, 4, REP_IO_ADDR_MASK(DEST_REG));                           \
+            if (done) {                                                                                           \
+                DEST_REG += done << 2;                                                                            \
+                CNT_REG -= done;                                                                                  \
+            } else {                                                                                              \
+                temp = inl(DX);                                                                                   \
+                writememl_n(es, DEST_REG, addr64a, temp);                                                         \
+                if (cpu_state.abrt)                                                                               \
+                    return 1;                                                                                     \
+                                                                                                                  \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    DEST_REG -= 4;                                                                                \
+                else                                                                                              \
+                    DEST_REG += 4;                                                                                \
+                CNT_REG--;                                                                                        \
+                done = 1;                                                                                         \
+            }                                                                                                     \
+            cycles -= 15 * done;                                                                                  \
+            reads += done;                                                                                        \
+            writes += done;                                                                                       \
+            total_cycles += 15 * done;                                                                            \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, 0, reads, 0, writes, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -126,23 +150,31 @@
         int reads = 0, writes = 0, total_cycles = 0;                                                              \
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
-            uint8_t temp;                                                                                         \
+            uint8_t  temp;                                                                                        \
+            uint32_t done;                                                                                        \
             SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
             CHECK_READ(cpu_state.ea_seg, SRC_REG, SRC_REG);                                                       \
             temp = readmemb(cpu_state.ea_seg->base, SRC_REG);                                                     \
             if (cpu_state.abrt)                                                                                   \
                 return 1;                                                                                         \
             check_io_perm(DX);                                                                                    \
-            outb(DX, temp);                                                                                       \
-            if (cpu_state.flags & D_FLAG)                                                                         \
-                SRC_REG--;                                                                                        \
-            else                                                                                                  \
-                SRC_REG++;                                                                                        \
-            CNT_REG--;                                                                                            \
-            cycles -= 14;                                                                                         \
-            reads++;                                                                                              \
-            writes++;                                                                                             \
-            total_cycles += 14;                                                                                   \
+            done = rep_outs_block(DX, cpu_state.ea_seg, SRC_REG, CNT_REG, 1, REP_IO_ADDR_MASK(SRC_REG), temp);    \
+            if (done) {                                                                                           \
+                SRC_REG += done;                                                                                  \
+                CNT_REG -= done;                                                                                  \
+            } else {                                                                                              \
+                outb(DX, temp);                                                                                   \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    SRC_REG--;                                                                                    \
+                else                                                                                              \
+                    SRC_REG++;                                                                                    \
+                CNT_REG--;                                                                                        \
+                done = 1;                                                                                         \
+            }                                                                                                     \
+            cycles -= 14 * done;                                                                                  \
+            reads += done;                                                                                        \
+            writes += done;                                                                                       \
+            total_cycles += 14 * done;                                                                            \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, reads, 0, writes, 0, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -158,6 +190,7 @@
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
             uint16_t temp;                                                                                        \
+            uint32_t done;                                                                                        \
             SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
             CHECK_READ(cpu_state.ea_seg, SRC_REG, SRC_REG + 1UL);                                                 \
             temp = readmemw(cpu_state.ea_seg->base, SRC_REG);                                                     \
@@ -165,16 +198,23 @@
                 return 1;                                                                                         \
             check_io_perm(DX);                                                                                    \
             check_io_perm(DX + 1);                                                                                \
-            outw(DX, temp);                                                                                       \
-            if (cpu_state.flags & D_FLAG)                                                                         \
-                SRC_REG -= 2;                                                                                     \
-            else                                                                                                  \
-                SRC_REG += 2;                                                                                     \
-            CNT_REG--;                                                                                            \
-            cycles -= 14;                                                                                         \
-            reads++;                                                                                              \
-            writes++;                                                                                             \
-            total_cycles += 14;                                                                                   \
+            done = rep_outs_block(DX, cpu_state.ea_seg, SRC_REG, CNT_REG, 2, REP_IO_ADDR_MASK(SRC_REG), temp);    \
+            if (done) {                                                                                           \
+                SRC_REG += done << 1;                                                                             \
+                CNT_REG -= done;                                                                                  \
+            } else {                                                                                              \
+                outw(DX, temp);                                                                                   \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    SRC_REG -= 2;                                                                                 \
+                else                                                                                              \
+                    SRC_REG += 2;                                                                                 \
+                CNT_REG--;                                                                                        \
+                done = 1;                                                                                         \
+            }                                                                                                     \
+            cycles -= 14 * done;                                                                                  \
+            reads += done;                                                                                        \
+            writes += done;                                                                                       \
+            total_cycles += 14 * done;                                                                            \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, reads, 0, writes, 0, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -190,6 +230,7 @@
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
             uint32_t temp;                                                                                        \
+            uint32_t done;                                                                                        \
             SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
             CHECK_READ(cpu_state.ea_seg, SRC_REG, SRC_REG + 3UL);                                                 \
             temp = readmeml(cpu_state.ea_seg->base, SRC_REG);                                                     \
@@ -199,16 +240,23 @@
             check_io_perm(DX + 1);                                                                                \
             check_io_perm(DX + 2);                                                                                \
             check_io_perm(DX + 3);                                                                                \
-            outl(DX, temp);                                                                                       \
-            if (cpu_state.flags & D_FLAG)                                                                         \
-                SRC_REG -= 4;                                                                                     \
-            else                                                                                                  \
-                SRC_REG += 4;                                                                                     \
-            CNT_REG--;                                                                                            \
-            cycles -= 14;                                                                                         \
-            reads++;                                                                                              \
-            writes++;                                                                                             \
-            total_cycles += 14;                                                                                   \
+            done = rep_outs_block(DX, cpu_state.ea_seg, SRC_REG, CNT_REG, 4, REP_IO_ADDR_MASK(SRC_REG), temp);    \
+            if (done) {                                                                                           \
+                SRC_REG += done << 2;                                                                             \
+                CNT_REG -= done;                                                                                  \
+            } else {                                                                                              \
+                outl(DX, temp);                                                                                   \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    SRC_REG -= 4;                                                                                 \
+                else                                                                                              \
+                    SRC_REG += 4;                                                                                 \
+                CNT_REG--;                                                                                        \
+                done = 1;                                                                                         \
+            }                                                                                                     \
+            cycles -= 14 * done;                                                                                  \
+            reads += done;                                                                                        \
+            writes += done;                                                                                       \
+            total_cycles += 14 * done;                                                                            \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, 0, reads, 0, writes, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
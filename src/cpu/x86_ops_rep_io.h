@@ -0,0 +1,80 @@
+/*Block transfers for REP INS/OUTS.
+
+  When the port has a block handler (see io_sethandler_block()), a run of
+  elements is moved with one call rather than one instruction iteration per
+  element. The run must go upwards, and lie within the segment limit and a
+  single page without wrapping the index register, so that once the first
+  element has passed the usual checks none of the others can fault. The
+  device may take fewer elements than offered; the rest are left to the
+  following iterations.*/
+#define REP_IO_BLOCK_SIZE 4096
+
+#define REP_IO_ADDR_MASK(reg) ((sizeof(reg) == 2) ? 0xffffu : 0xffffffffu)
+
+static uint8_t rep_io_buf[REP_IO_BLOCK_SIZE];
+
+static __inline uint32_t
+rep_io_block_count(x86seg *seg, uint32_t addr, uint32_t cnt, int size, uint32_t addr_mask)
+{
+    uint32_t limit = (seg->limit_high < addr_mask) ? seg->limit_high : addr_mask;
+    uint32_t n;
+
+    if ((cpu_state.flags & D_FLAG) || trap || (cnt < 2) || (addr > limit))
+        return 0;
+
+    n = (0x1000 - ((seg->base + addr) & 0xfff)) / size;
+    if (n > cnt)
+        n = cnt;
+    if (n > (((uint64_t) limit - addr + 1) / size))
+        n = ((uint64_t) limit - addr + 1) / size;
+
+    return (n < 2) ? 0 : n;
+}
+
+/*Returns the number of elements read from the port and stored at ES:addr,
+  0 if the caller should do a single element itself*/
+static __inline uint32_t
+rep_ins_block(uint16_t port, uint32_t addr, uint32_t cnt, int size, uint32_t addr_mask)
+{
+    uint32_t n = rep_io_block_count(&cpu_state.seg_es, addr, cnt, size, addr_mask);
+    uint32_t c;
+
+    if (!n)
+        return 0;
+
+    n = io_in_block(port, rep_io_buf, n, size);
+    for (c = 0; c < n; c++, addr += size) {
+        if (size == 1)
+            writememb(es, addr, rep_io_buf[c]);
+        else if (size == 2)
+            writememw(es, addr, ((uint16_t *) rep_io_buf)[c]);
+        else
+            writememl(es, addr, ((uint32_t *) rep_io_buf)[c]);
+    }
+
+    return n;
+}
+
+/*Returns the number of elements written to the port from seg:addr, the
+  first of which has already been read into first; 0 if the caller should
+  write that one itself*/
+static __inline uint32_t
+rep_outs_block(uint16_t port, x86seg *seg, uint32_t addr, uint32_t cnt, int size, uint32_t addr_mask, uint32_t first)
+{
+    uint32_t n = rep_io_block_count(seg, addr, cnt, size, addr_mask);
+    uint32_t c;
+
+    if (!n || !io_block_available(port, size, 1))
+        return 0;
+
+    for (c = 0; c < n; c++, addr += size) {
+        if (size == 1)
+            rep_io_buf[c] = c ? readmemb(seg->base, addr) : first;
+        else if (size == 2)
+            ((uint16_t *) rep_io_buf)[c] = c ? readmemw(seg->base, addr) : first;
+        else
+            ((uint32_t *) rep_io_buf)[c] = c ? readmeml(seg->base, addr) : first;
+    }
+
+    return io_out_block(port, rep_io_buf, n, size);
+}
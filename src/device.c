@@ -52,6 +52,7 @@
 #include <86box/mem.h>
 #include <86box/rom.h>
 #include <86box/sound.h>
+#include <86box/savestate.h>
 
 #define DEVICE_MAX 256 /* max # of devices */
 
@@ -290,6 +291,39 @@ device_reset_all_pci(void)
     }
 }
 
+/* Return the first device that cannot have its state saved, NULL if all of
+   them can. */
+const device_t *
+device_savestate_missing(void)
+{
+    int c;
+
+    for (c = 0; c < DEVICE_MAX; c++) {
+        if ((devices[c] != NULL) && (devices[c]->state == NULL))
+            return devices[c];
+    }
+
+    return NULL;
+}
+
+/* Save or restore the state of all devices, in the order they were added. */
+void
+device_savestate_all(savestate_t *st)
+{
+    const char *name;
+    int         c;
+
+    for (c = 0; c < DEVICE_MAX; c++) {
+        if (devices[c] != NULL) {
+            name = devices[c]->internal_name ? devices[c]->internal_name : devices[c]->name;
+            if (name == NULL)
+                name = "";
+
+            savestate_section(st, name, devices[c]->state, device_priv[c]);
+        }
+    }
+}
+
 void *
 device_get_priv(const device_t *d)
 {
@@ -23,6 +23,7 @@
 
 #include <86box/hwm.h>
 #include <86box/nsc366.h>
+#include <86box/savestate.h>
 
 /* Fan Algorithms */
 #define FAN_TO_REG(val, div)   ((val) <= 100 ? 0 : 480000 / ((val) * (div)))
@@ -319,6 +320,19 @@ nsc366_update_tms_io(int enable, uint16_t addr, nsc366_hwm_t *dev)
 
 #define TEMP_FROM_REG(val) ((val) *1000)
 
+/* The addresses are set up again by the Super I/O chip. */
+static void
+nsc366_hwm_savestate(savestate_t *st, void *priv)
+{
+    nsc366_hwm_t *dev = (nsc366_hwm_t *) priv;
+
+    savestate_var(st, dev->fscm_config);
+    savestate_var(st, dev->vlm_config_global);
+    savestate_var(st, dev->vlm_config_bank);
+    savestate_var(st, dev->tms_config_global);
+    savestate_var(st, dev->tms_config_bank);
+}
+
 static void
 nsc366_hwm_reset(void *priv)
 {
@@ -407,5 +421,6 @@ const device_t nsc366_hwm_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nsc366_hwm_savestate
 };
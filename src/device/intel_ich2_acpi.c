@@ -40,6 +40,7 @@
 #include <86box/video.h>
 #include <86box/machine.h>
 #include <86box/i2c.h>
+#include <86box/savestate.h>
 
 int acpi_rtc_status = 0;
 
@@ -655,6 +656,25 @@ acpi_reset(void *priv)
     acpi_timer_update(dev);
 }
 
+/* The I/O base and the IRQ routing belong to the southbridge, which has
+   already set them up by the time this runs. */
+static void
+acpi_savestate(savestate_t *st, void *priv)
+{
+    acpi_t *dev = (acpi_t *) priv;
+
+    savestate_var(st, dev->regs);
+    savestate_var(st, acpi_rtc_status);
+    savestate_timer(st, &dev->timer);
+    savestate_timer(st, &dev->resume_timer);
+
+    if (savestate_loading(st)) {
+        acpi_i2c_set(dev);
+        if (dev->trap_update)
+            dev->trap_update(dev->trap_priv);
+    }
+}
+
 static void
 acpi_speed_changed(void *priv)
 {
@@ -728,5 +748,6 @@ const device_t intel_ich2_acpi_device = {
     { .available = NULL },
     .speed_changed = acpi_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = acpi_savestate
 };
@@ -19,6 +19,7 @@
 #include <86box/io.h>
 #include <86box/device.h>
 #include <86box/intel_ich2_gpio.h>
+#include <86box/savestate.h>
 
 #ifdef ENABLE_INTEL_ICH2_GPIO_LOG
 int intel_ich2_gpio_do_log = ENABLE_INTEL_ICH2_GPIO_LOG;
@@ -140,6 +141,15 @@ intel_ich2_gpio_reset(void *priv)
     dev->gpio_regs[0x17] = 0x06;
 }
 
+/* The base address is programmed by the LPC bridge. */
+static void
+intel_ich2_gpio_savestate(savestate_t *st, void *priv)
+{
+    intel_ich2_gpio_t *dev = (intel_ich2_gpio_t *) priv;
+
+    savestate_var(st, dev->gpio_regs);
+}
+
 static void
 intel_ich2_gpio_close(void *priv)
 {
@@ -170,5 +180,6 @@ const device_t intel_ich2_gpio_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = intel_ich2_gpio_savestate
 };
@@ -24,6 +24,7 @@
 #include <86box/acpi.h>
 
 #include <86box/intel_ich2_trap.h>
+#include <86box/savestate.h>
 
 #ifdef ENABLE_INTEL_ICH2_TRAP_LOG
 int intel_ich2_trap_do_log = ENABLE_INTEL_ICH2_TRAP_LOG;
@@ -68,6 +69,12 @@ intel_ich2_device_trap_setup(uint8_t acpi_reg, uint8_t acpi_reg_val, uint16_t ad
     io_trap_remap(dev->trap, enable, addr, size);
 }
 
+/* Nothing to keep, the LPC bridge and the ACPI block remap the traps. */
+static void
+intel_ich2_trap_savestate(savestate_t *st, void *priv)
+{
+}
+
 static void
 intel_ich2_trap_close(void *priv)
 {
@@ -101,5 +108,6 @@ const device_t intel_ich2_trap_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = intel_ich2_trap_savestate
 };
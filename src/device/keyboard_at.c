@@ -25,6 +25,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stddef.h>
 #define HAVE_STDARG_H
 #include <wchar.h>
 #include <86box/86box.h>
@@ -44,6 +45,7 @@
 #include <86box/snd_speaker.h>
 #include <86box/video.h>
 #include <86box/keyboard.h>
+#include <86box/savestate.h>
 
 #define STAT_PARITY        0x80
 #define STAT_RTIMEOUT      0x40
@@ -2480,6 +2482,36 @@ kbd_close(void *priv)
     free(dev);
 }
 
+static void
+kbd_savestate(savestate_t *st, void *priv)
+{
+    atkbd_t *dev = (atkbd_t *) priv;
+
+    savestate_data(st, dev, offsetof(atkbd_t, pulse_cb));
+    savestate_timer(st, &dev->pulse_cb);
+    savestate_timer(st, &dev->send_delay_timer);
+
+    savestate_var(st, keyboard_mode);
+    savestate_var(st, keyboard_scan);
+    savestate_var(st, keyboard_set3_flags);
+    savestate_var(st, keyboard_set3_all_repeat);
+    savestate_var(st, keyboard_set3_all_break);
+    savestate_var(st, key_ctrl_queue);
+    savestate_var(st, key_ctrl_queue_start);
+    savestate_var(st, key_ctrl_queue_end);
+    savestate_var(st, key_queue);
+    savestate_var(st, key_queue_start);
+    savestate_var(st, key_queue_end);
+    savestate_var(st, mouse_queue);
+    savestate_var(st, mouse_queue_start);
+    savestate_var(st, mouse_queue_end);
+    savestate_var(st, kbd_last_scan_code);
+    savestate_var(st, sc_or);
+
+    if (savestate_loading(st))
+        set_scancode_map(dev);
+}
+
 static void *
 kbd_init(const device_t *info)
 {
@@ -2556,7 +2588,8 @@ const device_t keyboard_at_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_at_ami_device = {
@@ -2570,7 +2603,8 @@ const device_t keyboard_at_ami_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_at_samsung_device = {
@@ -2584,7 +2618,8 @@ const device_t keyboard_at_samsung_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_at_toshiba_device = {
@@ -2598,7 +2633,8 @@ const device_t keyboard_at_toshiba_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_at_olivetti_device = {
@@ -2612,7 +2648,8 @@ const device_t keyboard_at_olivetti_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_at_ncr_device = {
@@ -2626,7 +2663,8 @@ const device_t keyboard_at_ncr_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_device = {
@@ -2640,7 +2678,8 @@ const device_t keyboard_ps2_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_ps2_device = {
@@ -2654,7 +2693,8 @@ const device_t keyboard_ps2_ps2_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_ps1_device = {
@@ -2668,7 +2708,8 @@ const device_t keyboard_ps2_ps1_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_ps1_pci_device = {
@@ -2682,7 +2723,8 @@ const device_t keyboard_ps2_ps1_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_xi8088_device = {
@@ -2696,7 +2738,8 @@ const device_t keyboard_ps2_xi8088_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_ami_device = {
@@ -2710,7 +2753,8 @@ const device_t keyboard_ps2_ami_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_olivetti_device = {
@@ -2724,7 +2768,8 @@ const device_t keyboard_ps2_olivetti_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_mca_device = {
@@ -2738,7 +2783,8 @@ const device_t keyboard_ps2_mca_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_mca_2_device = {
@@ -2752,7 +2798,8 @@ const device_t keyboard_ps2_mca_2_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_quadtel_device = {
@@ -2766,7 +2813,8 @@ const device_t keyboard_ps2_quadtel_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_pci_device = {
@@ -2780,7 +2828,8 @@ const device_t keyboard_ps2_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_ami_pci_device = {
@@ -2794,7 +2843,8 @@ const device_t keyboard_ps2_ami_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_ali_pci_device = {
@@ -2808,7 +2858,8 @@ const device_t keyboard_ps2_ali_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_intel_ami_pci_device = {
@@ -2822,7 +2873,8 @@ const device_t keyboard_ps2_intel_ami_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 const device_t keyboard_ps2_acer_pci_device = {
@@ -2836,7 +2888,8 @@ const device_t keyboard_ps2_acer_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = kbd_savestate
 };
 
 void
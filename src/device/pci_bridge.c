@@ -30,6 +30,7 @@
 #include <86box/mem.h>
 #include <86box/device.h>
 #include <86box/pci.h>
+#include <86box/savestate.h>
 
 #define PCI_BRIDGE_DEC_21150   0x10110022
 #define PCI_BRIDGE_INTEL_ICH2  0x8086244e
@@ -529,6 +530,18 @@ pci_bridge_reset(void *priv)
         dev->regs[0x70] = 0x20;
 }
 
+static void
+pci_bridge_savestate(savestate_t *st, void *priv)
+{
+    pci_bridge_t *dev = (pci_bridge_t *) priv;
+
+    savestate_var(st, dev->regs);
+    savestate_var(st, dev->ctl);
+
+    if (savestate_loading(st))
+        pci_remap_bus(dev->bus_index, dev->regs[0x19]);
+}
+
 static void *
 pci_bridge_init(const device_t *info)
 {
@@ -586,7 +599,8 @@ const device_t dec21150_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pci_bridge_savestate
 };
 
 /* AGP bridges */
@@ -601,7 +615,8 @@ const device_t ali5243_agp_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pci_bridge_savestate
 };
 
 /* AGP bridges */
@@ -616,7 +631,8 @@ const device_t ali5247_agp_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pci_bridge_savestate
 };
 
 const device_t i440lx_agp_device = {
@@ -630,7 +646,8 @@ const device_t i440lx_agp_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pci_bridge_savestate
 };
 
 const device_t i440bx_agp_device = {
@@ -644,7 +661,8 @@ const device_t i440bx_agp_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pci_bridge_savestate
 };
 
 const device_t i440gx_agp_device = {
@@ -658,7 +676,8 @@ const device_t i440gx_agp_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pci_bridge_savestate
 };
 
 const device_t intel_ich2_hub_device = {
@@ -672,7 +691,8 @@ const device_t intel_ich2_hub_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pci_bridge_savestate
 };
 
 const device_t intel_815ep_agp_device = {
@@ -686,7 +706,8 @@ const device_t intel_815ep_agp_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pci_bridge_savestate
 };
 
 const device_t via_vp3_agp_device = {
@@ -700,7 +721,8 @@ const device_t via_vp3_agp_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pci_bridge_savestate
 };
 
 const device_t via_mvp3_agp_device = {
@@ -714,7 +736,8 @@ const device_t via_mvp3_agp_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pci_bridge_savestate
 };
 
 const device_t via_apro_agp_device = {
@@ -728,7 +751,8 @@ const device_t via_apro_agp_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pci_bridge_savestate
 };
 
 const device_t via_vt8601_agp_device = {
@@ -742,5 +766,6 @@ const device_t via_vt8601_agp_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pci_bridge_savestate
 };
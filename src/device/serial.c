@@ -21,6 +21,7 @@
  *          Copyright 2017-2020 Fred N. van Kempen.
  */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -37,6 +38,7 @@
 #include <86box/rom.h>
 #include <86box/serial.h>
 #include <86box/mouse.h>
+#include <86box/savestate.h>
 
 serial_port_t com_ports[SERIAL_MAX];
 
@@ -645,6 +647,23 @@ serial_speed_changed(void *priv)
     serial_update_speed(dev);
 }
 
+/* The address is left as the Super I/O chip or the machine set it up. */
+static void
+serial_savestate(savestate_t *st, void *priv)
+{
+    serial_t *dev  = (serial_t *) priv;
+    uint16_t  base = dev->base_address;
+
+    savestate_data(st, dev, offsetof(serial_t, transmit_timer));
+    savestate_var(st, dev->clock_src);
+    savestate_var(st, dev->transmit_period);
+    savestate_timer(st, &dev->transmit_timer);
+    savestate_timer(st, &dev->timeout_timer);
+
+    if (savestate_loading(st))
+        dev->base_address = base;
+}
+
 static void
 serial_close(void *priv)
 {
@@ -717,7 +736,8 @@ const device_t ns8250_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = serial_savestate
 };
 
 const device_t ns8250_pcjr_device = {
@@ -731,7 +751,8 @@ const device_t ns8250_pcjr_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = serial_savestate
 };
 
 const device_t ns16450_device = {
@@ -745,7 +766,8 @@ const device_t ns16450_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = serial_savestate
 };
 
 const device_t ns16550_device = {
@@ -759,7 +781,8 @@ const device_t ns16550_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = serial_savestate
 };
 
 const device_t ns16650_device = {
@@ -773,7 +796,8 @@ const device_t ns16650_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = serial_savestate
 };
 
 const device_t ns16750_device = {
@@ -787,7 +811,8 @@ const device_t ns16750_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = serial_savestate
 };
 
 const device_t ns16850_device = {
@@ -801,7 +826,8 @@ const device_t ns16850_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = serial_savestate
 };
 
 const device_t ns16950_device = {
@@ -815,5 +841,6 @@ const device_t ns16950_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = serial_savestate
 };
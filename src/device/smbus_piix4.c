@@ -32,6 +32,7 @@
 #include <86box/nvr.h>
 #include <86box/acpi.h>
 #include <86box/pci.h>
+#include <86box/savestate.h>
 
 #include <86box/smbus.h>
 
@@ -446,6 +447,32 @@ smbus_piix4_init(const device_t *info)
     return dev;
 }
 
+/* The I/O base is remapped by the southbridge. */
+static void
+smbus_piix4_savestate(savestate_t *st, void *priv)
+{
+    smbus_piix4_t *dev = (smbus_piix4_t *) priv;
+
+    savestate_var(st, dev->byte_rw);
+    savestate_var(st, dev->clock);
+    savestate_var(st, dev->stat);
+    savestate_var(st, dev->next_stat);
+    savestate_var(st, dev->ctl);
+    savestate_var(st, dev->cmd);
+    savestate_var(st, dev->addr);
+    savestate_var(st, dev->data0);
+    savestate_var(st, dev->data1);
+    savestate_var(st, dev->index);
+    savestate_var(st, dev->data);
+    savestate_var(st, dev->block_data_byte);
+    savestate_var(st, dev->irq);
+    savestate_var(st, dev->smi_en);
+    savestate_timer(st, &dev->response_timer);
+
+    if (savestate_loading(st))
+        smbus_piix4_setclock(dev, dev->clock);
+}
+
 static void
 smbus_piix4_close(void *priv)
 {
@@ -469,7 +496,8 @@ const device_t piix4_smbus_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = smbus_piix4_savestate
 };
 
 const device_t intel_ich2_smbus_device = {
@@ -483,7 +511,8 @@ const device_t intel_ich2_smbus_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = smbus_piix4_savestate
 };
 
 const device_t via_smbus_device = {
@@ -497,5 +526,6 @@ const device_t via_smbus_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = smbus_piix4_savestate
 };
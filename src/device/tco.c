@@ -24,6 +24,7 @@
 #include <86box/nmi.h>
 #include <86box/pic.h>
 #include <86box/pit.h>
+#include <86box/savestate.h>
 #include <86box/tco.h>
 
 #ifdef ENABLE_TCO_LOG
@@ -138,6 +139,15 @@ tco_reset(void *priv)
     dev->regs[0x10] = 0x03;
 }
 
+/* The IRQ line is routed by the LPC bridge. */
+static void
+tco_savestate(savestate_t *st, void *priv)
+{
+    tco_t *dev = (tco_t *) priv;
+
+    savestate_var(st, dev->regs);
+}
+
 static void
 tco_close(void *priv)
 {
@@ -168,5 +178,6 @@ const device_t tco_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = tco_savestate
 };
@@ -18,6 +18,7 @@
  *          Copyright 2016-2020 Miran Grca.
  */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -45,6 +46,7 @@
 #include <86box/hdd.h>
 #include <86box/zip.h>
 #include <86box/version.h>
+#include <86box/savestate.h>
 
 /* Bits of 'atastat' */
 #define ERR_STAT     0x01 /* Error */
@@ -1571,6 +1573,11 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
             ide_irq_lower(ide);
             ide->command = val;
 
+            /* A background read into the sector buffer may still be pending
+               from the previous command. */
+            if (ide->type == IDE_HDD)
+                hdd_image_read_discard(ide->hdd_num);
+
             ide->error = 0;
             if (ide->type == IDE_ATAPI)
                 ide->sc->error = 0;
@@ -1647,6 +1654,13 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
                             wait_time        = seek_time + xfer_time;
                         }
                         ide_set_callback(ide, wait_time);
+
+                        /* Start fetching the data while the command's delay
+                           runs; ide_callback() picks it up when it reads the
+                           same sectors. */
+                        if ((ide->lba || ide->cfg_spt) && ((val != WIN_READ_MULTIPLE) || ide->blocksize))
+                            hdd_image_read_async(ide->hdd_num, ide_get_sector(ide),
+                                                 ide->secount ? ide->secount : 256, ide->sector_buffer);
                     } else
                         ide_set_callback(ide, 200.0 * IDE_TIME);
                     ide->do_initial_read = 1;
@@ -2592,6 +2606,61 @@ ide_read_ali_76(void)
     return ret;
 }
 
+/* Block transfers through the data port, for REP INSW/OUTSW and their
+   32-bit forms. Only ATA PIO data is handled here, ATAPI packet data goes
+   through the port handlers. The last word of each sector is also left to
+   them, so that the end of sector handling is done in one place. */
+static int
+ide_data_block_count(ide_board_t *dev, ide_t *ide, uint16_t addr, int count, int size)
+{
+    int n;
+
+    if ((addr & 0x7) || !ide->buffer || (ide->command == WIN_PACKETCMD) || (ide->pos & 1))
+        return 0;
+    if ((size != 2) && ((size != 4) || !dev->bit32))
+        return 0;
+
+    n = ((512 - (int) ide->pos) / size) - 1;
+    return (n > count) ? count : n;
+}
+
+static int
+ide_read_data_block(uint16_t addr, void *buf, int count, int size, void *priv)
+{
+    ide_board_t *dev = (ide_board_t *) priv;
+    ide_t       *ide = ide_drives[dev->cur_dev];
+    int          n;
+
+    n = ide_data_block_count(dev, ide, addr, count, size);
+    if (n <= 0)
+        return 0;
+
+    memcpy(buf, &((uint8_t *) ide->buffer)[ide->pos], n * size);
+    ide->pos += n * size;
+
+    return n;
+}
+
+static int
+ide_write_data_block(uint16_t addr, const void *buf, int count, int size, void *priv)
+{
+    ide_board_t *dev = (ide_board_t *) priv;
+    ide_t       *ide = ide_drives[dev->cur_dev];
+    int          n;
+
+    if (ide->type == IDE_NONE)
+        return 0;
+
+    n = ide_data_block_count(dev, ide, addr, count, size);
+    if (n <= 0)
+        return 0;
+
+    memcpy(&((uint8_t *) ide->buffer)[ide->pos], buf, n * size);
+    ide->pos += n * size;
+
+    return n;
+}
+
 void
 ide_set_handlers(uint8_t board)
 {
@@ -2603,6 +2672,9 @@ ide_set_handlers(uint8_t board)
                       ide_readb, ide_readw, ide_readl,
                       ide_writeb, ide_writew, ide_writel,
                       ide_boards[board]);
+        io_sethandler_block(ide_boards[board]->base_main, 1,
+                            ide_read_data_block, ide_write_data_block,
+                            ide_boards[board]);
     }
 
     if (ide_boards[board]->side_main) {
@@ -2624,6 +2696,9 @@ ide_remove_handlers(uint8_t board)
                          ide_readb, ide_readw, ide_readl,
                          ide_writeb, ide_writew, ide_writel,
                          ide_boards[board]);
+        io_removehandler_block(ide_boards[board]->base_main, 1,
+                               ide_read_data_block, ide_write_data_block,
+                               ide_boards[board]);
     }
 
     if (ide_boards[board]->side_main) {
@@ -2702,6 +2777,53 @@ ide_board_set_force_ata3(int board, int force_ata3)
     ide_boards[board]->force_ata3 = force_ata3;
 }
 
+/* Save or restore the task file state of all the IDE channels, no matter
+   which device owns them. ATAPI devices only keep their task file, so they
+   should be idle when the state is saved. */
+void
+ide_savestate(savestate_t *st, void *priv)
+{
+    ide_t *ide;
+    int    board, d, present, drq;
+
+    for (board = 0; board < 4; board++) {
+        present = (ide_boards[board] != NULL);
+        savestate_var(st, present);
+        if (present != (ide_boards[board] != NULL))
+            return;
+        if (!present)
+            continue;
+
+        savestate_var(st, ide_boards[board]->cur_dev);
+        savestate_timer(st, &ide_boards[board]->timer);
+
+        for (d = (board << 1); d < ((board << 1) + 2); d++) {
+            ide = ide_drives[d];
+            if (ide == NULL)
+                continue;
+
+            savestate_data(st, ide, offsetof(ide_t, buffer));
+            savestate_var(st, ide->interrupt_drq);
+            savestate_var(st, ide->pending_delay);
+            savestate_timer(st, &ide->timer);
+
+            /* The buffers only matter in the middle of a transfer. */
+            drq = (ide->buffer != NULL) && (ide->atastat & DRQ_STAT);
+            savestate_var(st, drq);
+            if (drq) {
+                if (ide->buffer == NULL)
+                    ide_allocate_buffer(ide);
+                savestate_data(st, ide->buffer, 65536 * sizeof(uint16_t));
+
+                drq = (ide->sector_buffer != NULL);
+                savestate_var(st, drq);
+                if (drq && (ide->sector_buffer != NULL))
+                    savestate_data(st, ide->sector_buffer, 256 * 512);
+            }
+        }
+    }
+}
+
 static void
 ide_board_close(int board)
 {
@@ -2742,6 +2864,8 @@ ide_board_close(int board)
         }
 
         if (dev->sector_buffer) {
+            if (dev->type == IDE_HDD)
+                hdd_image_read_discard(dev->hdd_num);
             free(dev->sector_buffer);
             dev->buffer = NULL;
         }
@@ -3000,8 +3124,11 @@ ide_drive_reset(int d)
 
     ide_set_signature(ide_drives[d]);
 
-    if (ide_drives[d]->sector_buffer)
+    if (ide_drives[d]->sector_buffer) {
+        if (ide_drives[d]->type == IDE_HDD)
+            hdd_image_read_discard(ide_drives[d]->hdd_num);
         memset(ide_drives[d]->sector_buffer, 0, 256 * 512);
+    }
 
     if (ide_drives[d]->buffer)
         memset(ide_drives[d]->buffer, 0, 65536 * sizeof(uint16_t));
@@ -3053,6 +3180,12 @@ ide_close(void *priv)
     }
 }
 
+/* The channels of all the controllers go into the "ide" section. */
+static void
+ide_dev_savestate(savestate_t *st, void *priv)
+{
+}
+
 const device_t ide_isa_device = {
     .name          = "ISA PC/AT IDE Controller",
     .internal_name = "ide_isa",
@@ -3064,7 +3197,8 @@ const device_t ide_isa_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = ide_dev_savestate
 };
 
 const device_t ide_isa_2ch_device = {
@@ -3078,7 +3212,8 @@ const device_t ide_isa_2ch_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = ide_dev_savestate
 };
 
 const device_t ide_vlb_device = {
@@ -3092,7 +3227,8 @@ const device_t ide_vlb_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = ide_dev_savestate
 };
 
 const device_t ide_vlb_2ch_device = {
@@ -3106,7 +3242,8 @@ const device_t ide_vlb_2ch_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = ide_dev_savestate
 };
 
 const device_t ide_pci_device = {
@@ -3120,7 +3257,8 @@ const device_t ide_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = ide_dev_savestate
 };
 
 const device_t ide_pci_2ch_device = {
@@ -3134,7 +3272,8 @@ const device_t ide_pci_2ch_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = ide_dev_savestate
 };
 
 // clang-format off
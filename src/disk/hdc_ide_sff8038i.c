@@ -40,6 +40,7 @@
 #include <86box/hdc.h>
 #include <86box/hdc_ide.h>
 #include <86box/hdc_ide_sff8038i.h>
+#include <86box/savestate.h>
 #include <86box/zip.h>
 #include <86box/mo.h>
 
@@ -522,6 +523,24 @@ sff_set_irq_pin(sff8038i_t *dev, int irq_pin)
     dev->irq_pin = irq_pin;
 }
 
+static void
+sff_savestate(savestate_t *st, void *p)
+{
+    sff8038i_t *dev = (sff8038i_t *) p;
+    sff8038i_t  temp;
+
+    memcpy(&temp, dev, sizeof(sff8038i_t));
+    savestate_var(st, temp);
+
+    if (savestate_loading(st)) {
+        /* Move the registers over to where they were. */
+        sff_bus_master_handler(dev, 0, 0x0000);
+        memcpy(dev, &temp, sizeof(sff8038i_t));
+        dev->base = 0x0000;
+        sff_bus_master_handler(dev, temp.enabled, temp.base);
+    }
+}
+
 static void
 sff_close(void *p)
 {
@@ -570,5 +589,6 @@ const device_t sff8038i_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = sff_savestate
 };
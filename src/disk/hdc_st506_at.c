@@ -471,6 +471,50 @@ mfm_readw(uint16_t port, void *priv)
     return (ret);
 }
 
+/* Block transfers through the data port. The last word of the sector is
+   left to mfm_readw()/mfm_writew(), which handle the end of the sector. */
+static int
+mfm_data_block_count(mfm_t *mfm, uint16_t port, int count, int size)
+{
+    int n;
+
+    if ((port != 0x01f0) || (size != 2) || (mfm->pos & 1))
+        return 0;
+
+    n = ((512 - mfm->pos) >> 1) - 1;
+    return (n > count) ? count : n;
+}
+
+static int
+mfm_read_block(uint16_t port, void *buf, int count, int size, void *priv)
+{
+    mfm_t *mfm = (mfm_t *) priv;
+    int    n   = mfm_data_block_count(mfm, port, count, size);
+
+    if (n <= 0)
+        return 0;
+
+    memcpy(buf, &mfm->buffer[mfm->pos >> 1], n << 1);
+    mfm->pos += n << 1;
+
+    return n;
+}
+
+static int
+mfm_write_block(uint16_t port, const void *buf, int count, int size, void *priv)
+{
+    mfm_t *mfm = (mfm_t *) priv;
+    int    n   = mfm_data_block_count(mfm, port, count, size);
+
+    if (n <= 0)
+        return 0;
+
+    memcpy(&mfm->buffer[mfm->pos >> 1], buf, n << 1);
+    mfm->pos += n << 1;
+
+    return n;
+}
+
 static uint8_t
 mfm_read(uint16_t port, void *priv)
 {
@@ -713,6 +757,7 @@ mfm_init(const device_t *info)
 
     io_sethandler(0x01f0, 1,
                   mfm_read, mfm_readw, NULL, mfm_write, mfm_writew, NULL, mfm);
+    io_sethandler_block(0x01f0, 1, mfm_read_block, mfm_write_block, mfm);
     io_sethandler(0x01f1, 7,
                   mfm_read, mfm_readw, NULL, mfm_write, mfm_writew, NULL, mfm);
     io_sethandler(0x03f6, 1,
@@ -1173,6 +1173,52 @@ st506_callback(void *priv)
     }
 }
 
+/* Block transfers through the data register, sector data only. The last
+   byte of the transfer is left to st506_read()/st506_write(), which start
+   the next step of the command. */
+static int
+st506_read_block(uint16_t port, void *buf, int count, int size, void *priv)
+{
+    hdc_t *dev = (hdc_t *) priv;
+    int    n;
+
+    if ((port & 3) || (size != 1) || (dev->state != STATE_SEND_DATA))
+        return 0;
+
+    n = dev->buff_cnt - dev->buff_pos - 1;
+    if (n > count)
+        n = count;
+    if (n <= 0)
+        return 0;
+
+    dev->status &= ~STAT_IRQ;
+    memcpy(buf, &dev->buff[dev->buff_pos], n);
+    dev->buff_pos += n;
+
+    return n;
+}
+
+static int
+st506_write_block(uint16_t port, const void *buf, int count, int size, void *priv)
+{
+    hdc_t *dev = (hdc_t *) priv;
+    int    n;
+
+    if ((port & 3) || (size != 1) || (dev->state != STATE_RECEIVE_DATA))
+        return 0;
+
+    n = dev->buff_cnt - dev->buff_pos - 1;
+    if (n > count)
+        n = count;
+    if (n <= 0)
+        return 0;
+
+    memcpy(&dev->buff[dev->buff_pos], buf, n);
+    dev->buff_pos += n;
+
+    return n;
+}
+
 /* Read from one of the registers. */
 static uint8_t
 st506_read(uint16_t port, void *priv)
@@ -1652,6 +1698,8 @@ st506_init(const device_t *info)
     /* Set up the I/O region. */
     io_sethandler(dev->base, 4,
                   st506_read, NULL, NULL, st506_write, NULL, NULL, dev);
+    io_sethandler_block(dev->base, 1,
+                        st506_read_block, st506_write_block, dev);
 
     /* Add the timer. */
     timer_add(&dev->timer, st506_callback, dev, 0);
@@ -856,6 +856,51 @@ do_recv:
     }
 }
 
+/* Block transfers through the DATA register. The last byte of the transfer
+   is left to hdc_read()/hdc_write(), which move on to the next state. */
+static int
+hdc_read_block(uint16_t port, void *buf, int count, int size, void *priv)
+{
+    hdc_t *dev = (hdc_t *) priv;
+    int    n;
+
+    if ((port & 7) || (size != 1) || (dev->state != STATE_SDATA))
+        return 0;
+
+    n = dev->buf_len - dev->buf_idx - 1;
+    if (n > count)
+        n = count;
+    if (n <= 0)
+        return 0;
+
+    dev->status &= ~STAT_IRQ;
+    memcpy(buf, &dev->buf_ptr[dev->buf_idx], n);
+    dev->buf_idx += n;
+
+    return n;
+}
+
+static int
+hdc_write_block(uint16_t port, const void *buf, int count, int size, void *priv)
+{
+    hdc_t *dev = (hdc_t *) priv;
+    int    n;
+
+    if ((port & 7) || (size != 1) || (dev->state != STATE_RDATA) || !(dev->status & STAT_REQ))
+        return 0;
+
+    n = dev->buf_len - dev->buf_idx - 1;
+    if (n > count)
+        n = count;
+    if (n <= 0)
+        return 0;
+
+    memcpy(&dev->buf_ptr[dev->buf_idx], buf, n);
+    dev->buf_idx += n;
+
+    return n;
+}
+
 /* Read one of the controller registers. */
 static uint8_t
 hdc_read(uint16_t port, void *priv)
@@ -1044,6 +1089,8 @@ xta_init(const device_t *info)
     /* Enable the I/O block. */
     io_sethandler(dev->base, 4,
                   hdc_read, NULL, NULL, hdc_write, NULL, NULL, dev);
+    io_sethandler_block(dev->base, 1,
+                        hdc_read_block, hdc_write_block, dev);
 
     /* Load BIOS if it has one. */
     if (dev->rom_addr != 0x000000) {
@@ -1067,6 +1114,8 @@ xta_close(void *priv)
     /* Remove the I/O handler. */
     io_removehandler(dev->base, 4,
                      hdc_read, NULL, NULL, hdc_write, NULL, NULL, dev);
+    io_removehandler_block(dev->base, 1,
+                           hdc_read_block, hdc_write_block, dev);
 
     /* Close all disks and their images. */
     for (d = 0; d < XTA_NUM; d++) {
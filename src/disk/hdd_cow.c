@@ -0,0 +1,846 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Copy-on-write overlay hard disk images.
+ *
+ *          An overlay consists of a read-only raw base image, which is
+ *          mapped into memory where possible so that it is shared with
+ *          all other emulator instances using it, and a per-machine delta
+ *          file holding every cluster that has been written to.
+ *
+ *          Delta file layout (all values little endian):
+ *
+ *          0x000  "86BOXCOW" signature
+ *          0x008  format version (1)
+ *          0x00C  log2 of the sectors per cluster
+ *          0x010  number of sectors (64-bit)
+ *          0x018  sectors per track, heads, cylinders
+ *          0x024  offset of the cluster bitmap
+ *          0x028  offset of the cluster data (64-bit)
+ *          0x040  file name of the base image, relative names are
+ *                 relative to the directory of the delta file
+ *
+ *          Sector n of the disk lives at data offset + n * 512 whether
+ *          or not its cluster is allocated, which leaves the delta file
+ *          sparse on file systems that support it.
+ */
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <wchar.h>
+#ifdef _WIN32
+#    include <windows.h>
+#    include <io.h>
+#else
+#    include <sys/mman.h>
+#    include <unistd.h>
+#endif
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/path.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/hdd.h>
+
+#define COW_SIGNATURE     0x574F43584F423638ll /* "86BOXCOW" */
+#define COW_VERSION       1
+#define COW_CLUSTER_SHIFT 7 /* 64 kB clusters. */
+#define COW_BITMAP_OFFSET 0x1000
+#define COW_BASE_FN_LEN   1024
+#define COW_HEADER_SIZE   0x40
+
+struct hdd_cow_t {
+    FILE    *file;
+    FILE    *base;
+    uint8_t *map;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+    uint64_t base_size;
+    uint64_t data_off;
+    uint32_t sectors;
+    uint32_t spt, hpc, tracks;
+    uint32_t shift, clusters;
+    uint32_t bitmap_off, bitmap_size;
+    uint8_t *bitmap;
+    uint8_t *cluster_buf;
+    char     base_fn[COW_BASE_FN_LEN];
+
+    /* Commit and flatten are run from the monitor, while the machine is
+       still using the disk. */
+    mutex_t *mutex;
+};
+
+#ifdef ENABLE_HDD_COW_LOG
+int hdd_cow_do_log = ENABLE_HDD_COW_LOG;
+
+static void
+hdd_cow_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (hdd_cow_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define hdd_cow_log(fmt, ...)
+#endif
+
+/* The header is stored little endian regardless of the host. */
+static uint32_t
+hdd_cow_get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint64_t
+hdd_cow_get64(const uint8_t *p)
+{
+    return hdd_cow_get32(p) | ((uint64_t) hdd_cow_get32(p + 4) << 32);
+}
+
+static void
+hdd_cow_put32(uint8_t *p, uint32_t val)
+{
+    p[0] = val & 0xff;
+    p[1] = (val >> 8) & 0xff;
+    p[2] = (val >> 16) & 0xff;
+    p[3] = (val >> 24) & 0xff;
+}
+
+static void
+hdd_cow_put64(uint8_t *p, uint64_t val)
+{
+    hdd_cow_put32(p, (uint32_t) val);
+    hdd_cow_put32(p + 4, (uint32_t) (val >> 32));
+}
+
+int
+image_is_cow(const char *s, int check_signature)
+{
+    FILE   *f;
+    uint8_t signature[8];
+
+    if (strcasecmp(path_get_extension((char *) s), "COW"))
+        return 0;
+
+    if (!check_signature)
+        return 1;
+
+    f = plat_fopen(s, "rb");
+    if (f == NULL)
+        return 0;
+    if (fread(signature, 1, 8, f) != 8)
+        memset(signature, 0, 8);
+    fclose(f);
+
+    return (hdd_cow_get64(signature) == COW_SIGNATURE);
+}
+
+static void
+hdd_cow_base_close(hdd_cow_t *cow)
+{
+    if (cow->map != NULL) {
+#ifdef _WIN32
+        UnmapViewOfFile(cow->map);
+        CloseHandle(cow->mapping);
+        cow->mapping = NULL;
+#else
+        munmap(cow->map, (size_t) cow->base_size);
+#endif
+        cow->map = NULL;
+    }
+
+    if (cow->base != NULL) {
+        fclose(cow->base);
+        cow->base = NULL;
+    }
+}
+
+static int
+hdd_cow_base_open(hdd_cow_t *cow, const char *fn)
+{
+    char  temp[COW_BASE_FN_LEN * 2];
+    char  dir[COW_BASE_FN_LEN];
+
+    if (path_abs(cow->base_fn))
+        strcpy(temp, cow->base_fn);
+    else {
+        path_get_dirname(dir, fn);
+        path_append_filename(temp, dir, cow->base_fn);
+    }
+
+    cow->base = plat_fopen64(temp, "rb");
+    if (cow->base == NULL) {
+        hdd_cow_log("COW: Unable to open base image '%s'\n", temp);
+        return 0;
+    }
+
+    if (fseeko64(cow->base, 0, SEEK_END) == -1)
+        fatal("hdd_cow_base_open(): Error seeking to the end of the base image\n");
+    cow->base_size = ftello64(cow->base);
+
+    /* Sectors that have not been written to are copied straight out of the
+       mapping, without going through the C library. If the image can not be
+       mapped (for example, it is too big for a 32-bit address space), it is
+       read through the file instead. */
+    if ((cow->base_size == 0) || (cow->base_size > (uint64_t) SIZE_MAX))
+        return 1;
+
+#ifdef _WIN32
+    cow->mapping = CreateFileMapping((HANDLE) _get_osfhandle(_fileno(cow->base)),
+                                     NULL, PAGE_READONLY, 0, 0, NULL);
+    if (cow->mapping != NULL) {
+        cow->map = (uint8_t *) MapViewOfFile(cow->mapping, FILE_MAP_READ, 0, 0, 0);
+        if (cow->map == NULL) {
+            CloseHandle(cow->mapping);
+            cow->mapping = NULL;
+        }
+    }
+#else
+    cow->map = (uint8_t *) mmap(NULL, (size_t) cow->base_size, PROT_READ, MAP_SHARED,
+                                fileno(cow->base), 0);
+    if (cow->map == (uint8_t *) MAP_FAILED)
+        cow->map = NULL;
+#endif
+
+    if (cow->map == NULL)
+        hdd_cow_log("COW: Unable to map base image '%s', using file reads\n", temp);
+
+    return 1;
+}
+
+int
+hdd_cow_create(const char *fn, const char *base_fn, uint32_t spt, uint32_t hpc, uint32_t tracks)
+{
+    FILE    *f;
+    char     name[COW_BASE_FN_LEN];
+    uint8_t  header[COW_HEADER_SIZE];
+    uint64_t sectors = ((uint64_t) spt) * ((uint64_t) hpc) * ((uint64_t) tracks);
+    uint64_t data_off;
+    uint32_t shift      = COW_CLUSTER_SHIFT;
+    uint32_t bitmap_off = COW_BITMAP_OFFSET;
+    uint32_t clusters, bitmap_size;
+
+    if ((sectors == 0) || (sectors > 0xffffffffULL) || (strlen(base_fn) >= COW_BASE_FN_LEN))
+        return 0;
+
+    clusters    = (uint32_t) ((sectors + (1ULL << shift) - 1) >> shift);
+    bitmap_size = (clusters + 7) >> 3;
+    data_off    = bitmap_off + bitmap_size;
+    data_off    = (data_off + (512ULL << shift) - 1) & ~((512ULL << shift) - 1);
+
+    f = plat_fopen64(fn, "wb");
+    if (f == NULL)
+        return 0;
+
+    memset(name, 0, COW_BASE_FN_LEN);
+    strcpy(name, base_fn);
+
+    memset(header, 0, COW_HEADER_SIZE);
+    hdd_cow_put64(&header[0x00], COW_SIGNATURE);
+    hdd_cow_put32(&header[0x08], COW_VERSION);
+    hdd_cow_put32(&header[0x0c], shift);
+    hdd_cow_put64(&header[0x10], sectors);
+    hdd_cow_put32(&header[0x18], spt);
+    hdd_cow_put32(&header[0x1c], hpc);
+    hdd_cow_put32(&header[0x20], tracks);
+    hdd_cow_put32(&header[0x24], bitmap_off);
+    hdd_cow_put64(&header[0x28], data_off);
+
+    fwrite(header, 1, COW_HEADER_SIZE, f);
+    fwrite(name, 1, COW_BASE_FN_LEN, f);
+
+    /* An empty bitmap; the data area is only ever written cluster by cluster. */
+    fseeko64(f, bitmap_off + bitmap_size - 1, SEEK_SET);
+    fputc(0, f);
+
+    fclose(f);
+
+    return 1;
+}
+
+hdd_cow_t *
+hdd_cow_open(const char *fn)
+{
+    hdd_cow_t *cow;
+    uint8_t    header[COW_HEADER_SIZE];
+    uint64_t   sectors;
+
+    cow = (hdd_cow_t *) calloc(1, sizeof(hdd_cow_t));
+    if (cow == NULL)
+        return NULL;
+
+    cow->file = plat_fopen64(fn, "rb+");
+    if (cow->file == NULL) {
+        hdd_cow_log("COW: Unable to open overlay image '%s'\n", fn);
+        free(cow);
+        return NULL;
+    }
+
+    if ((fread(header, 1, COW_HEADER_SIZE, cow->file) != COW_HEADER_SIZE) ||
+        (hdd_cow_get64(&header[0x00]) != COW_SIGNATURE) || (hdd_cow_get32(&header[0x08]) != COW_VERSION)) {
+        hdd_cow_log("COW: '%s' is not a valid overlay image\n", fn);
+        goto fail;
+    }
+
+    cow->shift      = hdd_cow_get32(&header[0x0c]);
+    sectors         = hdd_cow_get64(&header[0x10]);
+    cow->spt        = hdd_cow_get32(&header[0x18]);
+    cow->hpc        = hdd_cow_get32(&header[0x1c]);
+    cow->tracks     = hdd_cow_get32(&header[0x20]);
+    cow->bitmap_off = hdd_cow_get32(&header[0x24]);
+    cow->data_off   = hdd_cow_get64(&header[0x28]);
+
+    if ((cow->shift > 16) || (sectors == 0) || (sectors > 0xffffffffULL)) {
+        hdd_cow_log("COW: '%s' has an invalid header\n", fn);
+        goto fail;
+    }
+
+    cow->sectors     = (uint32_t) sectors;
+    cow->clusters    = (uint32_t) ((sectors + (1ULL << cow->shift) - 1) >> cow->shift);
+    cow->bitmap_size = (cow->clusters + 7) >> 3;
+
+    /* The bitmap must follow the header and the base image name, and the
+       data area must not overlap it. */
+    if ((cow->bitmap_off < (COW_HEADER_SIZE + COW_BASE_FN_LEN)) ||
+        (cow->data_off < ((uint64_t) cow->bitmap_off + cow->bitmap_size))) {
+        hdd_cow_log("COW: '%s' has an invalid bitmap or data offset\n", fn);
+        goto fail;
+    }
+
+    if (fread(cow->base_fn, 1, COW_BASE_FN_LEN, cow->file) != COW_BASE_FN_LEN) {
+        hdd_cow_log("COW: '%s' has a truncated header\n", fn);
+        goto fail;
+    }
+    cow->base_fn[COW_BASE_FN_LEN - 1] = '\0';
+
+    cow->bitmap      = (uint8_t *) malloc(cow->bitmap_size);
+    cow->cluster_buf = (uint8_t *) malloc(512 << cow->shift);
+    if ((cow->bitmap == NULL) || (cow->cluster_buf == NULL))
+        fatal("hdd_cow_open(): Out of memory\n");
+
+    if ((fseeko64(cow->file, cow->bitmap_off, SEEK_SET) == -1) ||
+        (fread(cow->bitmap, 1, cow->bitmap_size, cow->file) != cow->bitmap_size)) {
+        hdd_cow_log("COW: '%s' has a truncated cluster bitmap\n", fn);
+        goto fail;
+    }
+
+    if (!hdd_cow_base_open(cow, fn))
+        goto fail;
+
+    cow->mutex = thread_create_mutex();
+
+    return cow;
+
+fail:
+    hdd_cow_close(cow);
+    return NULL;
+}
+
+void
+hdd_cow_close(hdd_cow_t *cow)
+{
+    if (cow == NULL)
+        return;
+
+    hdd_cow_base_close(cow);
+
+    if (cow->file != NULL)
+        fclose(cow->file);
+
+    if (cow->bitmap != NULL)
+        free(cow->bitmap);
+    if (cow->cluster_buf != NULL)
+        free(cow->cluster_buf);
+
+    if (cow->mutex != NULL)
+        thread_close_mutex(cow->mutex);
+
+    free(cow);
+}
+
+void
+hdd_cow_get_geometry(hdd_cow_t *cow, uint32_t *spt, uint32_t *hpc, uint32_t *tracks)
+{
+    *spt    = cow->spt;
+    *hpc    = cow->hpc;
+    *tracks = cow->tracks;
+}
+
+uint32_t
+hdd_cow_get_sectors(hdd_cow_t *cow)
+{
+    return cow->sectors;
+}
+
+static __inline int
+hdd_cow_allocated(hdd_cow_t *cow, uint32_t cluster)
+{
+    return !!(cow->bitmap[cluster >> 3] & (1 << (cluster & 7)));
+}
+
+static void
+hdd_cow_read_base(hdd_cow_t *cow, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    uint64_t addr  = (uint64_t) sector << 9;
+    uint64_t len   = (uint64_t) count << 9;
+    uint64_t avail = 0;
+
+    /* The base image may be smaller than the disk, the rest reads as zeroes. */
+    if (addr < cow->base_size) {
+        avail = cow->base_size - addr;
+        if (avail > len)
+            avail = len;
+
+        if (cow->map != NULL)
+            memcpy(buffer, cow->map + addr, (size_t) avail);
+        else {
+            if (fseeko64(cow->base, addr, SEEK_SET) == -1)
+                fatal("hdd_cow_read_base(): Error seeking\n");
+            avail = fread(buffer, 1, (size_t) avail, cow->base);
+        }
+    }
+
+    if (avail < len)
+        memset(buffer + avail, 0, (size_t) (len - avail));
+}
+
+static void
+hdd_cow_read_delta(hdd_cow_t *cow, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    size_t num;
+
+    if (fseeko64(cow->file, cow->data_off + ((uint64_t) sector << 9), SEEK_SET) == -1)
+        fatal("hdd_cow_read_delta(): Error seeking\n");
+    num = fread(buffer, 512, count, cow->file);
+    if (num < count)
+        memset(buffer + (num << 9), 0, (count - num) << 9);
+}
+
+static int
+hdd_cow_read_sectors(hdd_cow_t *cow, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    uint32_t done = 0;
+    uint32_t cluster, next, n;
+    int      alloc;
+
+    if (sector >= cow->sectors)
+        return 0;
+    if (count > (cow->sectors - sector))
+        count = cow->sectors - sector;
+
+    while (done < count) {
+        /* Read runs of clusters that come from the same file in one go. */
+        cluster = (sector + done) >> cow->shift;
+        alloc   = hdd_cow_allocated(cow, cluster);
+        next    = cluster + 1;
+        while ((next < cow->clusters) && (((uint64_t) next << cow->shift) < ((uint64_t) sector + count)) &&
+               (hdd_cow_allocated(cow, next) == alloc))
+            next++;
+
+        n = (next << cow->shift) - (sector + done);
+        if (n > (count - done))
+            n = count - done;
+
+        if (alloc)
+            hdd_cow_read_delta(cow, sector + done, n, buffer + (done << 9));
+        else
+            hdd_cow_read_base(cow, sector + done, n, buffer + (done << 9));
+
+        done += n;
+    }
+
+    return done;
+}
+
+static int
+hdd_cow_write_sectors(hdd_cow_t *cow, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    uint32_t done = 0;
+    uint32_t cluster, first, spc, n, len;
+    uint8_t *data;
+
+    if (sector >= cow->sectors)
+        return 0;
+    if (count > (cow->sectors - sector))
+        count = cow->sectors - sector;
+
+    spc = 1 << cow->shift;
+
+    while (done < count) {
+        cluster = (sector + done) >> cow->shift;
+        first   = cluster << cow->shift;
+        n       = first + spc - (sector + done);
+        if (n > (count - done))
+            n = count - done;
+
+        if (hdd_cow_allocated(cow, cluster)) {
+            first = sector + done;
+            len   = n;
+            data  = buffer + (done << 9);
+        } else {
+            /* First write to this cluster, the part not being written comes
+               from the base image. */
+            len = spc;
+            if ((first + len) > cow->sectors)
+                len = cow->sectors - first;
+            if (n < len)
+                hdd_cow_read_base(cow, first, len, cow->cluster_buf);
+            memcpy(cow->cluster_buf + ((sector + done - first) << 9), buffer + (done << 9), n << 9);
+            data = cow->cluster_buf;
+        }
+
+        if (fseeko64(cow->file, cow->data_off + ((uint64_t) first << 9), SEEK_SET) == -1)
+            fatal("hdd_cow_write(): Error seeking\n");
+        if (fwrite(data, 512, len, cow->file) != len)
+            break;
+
+        if (!hdd_cow_allocated(cow, cluster)) {
+            /* The data goes to the file before the bitmap says it is there. */
+            fflush(cow->file);
+            cow->bitmap[cluster >> 3] |= (1 << (cluster & 7));
+            if (fseeko64(cow->file, cow->bitmap_off + (cluster >> 3), SEEK_SET) == -1)
+                fatal("hdd_cow_write(): Error seeking to the cluster bitmap\n");
+            fputc(cow->bitmap[cluster >> 3], cow->file);
+        }
+
+        done += n;
+    }
+
+    return done;
+}
+
+int
+hdd_cow_read(hdd_cow_t *cow, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    int ret;
+
+    thread_wait_mutex(cow->mutex);
+    ret = hdd_cow_read_sectors(cow, sector, count, buffer);
+    thread_release_mutex(cow->mutex);
+
+    return ret;
+}
+
+int
+hdd_cow_write(hdd_cow_t *cow, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    int ret;
+
+    thread_wait_mutex(cow->mutex);
+    ret = hdd_cow_write_sectors(cow, sector, count, buffer);
+    thread_release_mutex(cow->mutex);
+
+    return ret;
+}
+
+int
+hdd_cow_zero(hdd_cow_t *cow, uint32_t sector, uint32_t count)
+{
+    static const uint8_t zero[512] = { 0 };
+    uint32_t             i;
+
+    thread_wait_mutex(cow->mutex);
+    for (i = 0; i < count; i++) {
+        if (hdd_cow_write_sectors(cow, sector + i, 1, (uint8_t *) zero) != 1)
+            break;
+    }
+    thread_release_mutex(cow->mutex);
+
+    return i;
+}
+
+static int
+hdd_cow_commit_clusters(hdd_cow_t *cow, const char *fn)
+{
+    FILE    *f;
+    char     temp[COW_BASE_FN_LEN * 2];
+    char     dir[COW_BASE_FN_LEN];
+    uint32_t c, first, len;
+    uint32_t spc = 1 << cow->shift;
+
+    if (path_abs(cow->base_fn))
+        strcpy(temp, cow->base_fn);
+    else {
+        path_get_dirname(dir, fn);
+        path_append_filename(temp, dir, cow->base_fn);
+    }
+
+    f = plat_fopen64(temp, "rb+");
+    if (f == NULL)
+        return 0;
+
+    for (c = 0; c < cow->clusters; c++) {
+        if (!hdd_cow_allocated(cow, c))
+            continue;
+
+        first = c << cow->shift;
+        len   = spc;
+        if ((first + len) > cow->sectors)
+            len = cow->sectors - first;
+
+        hdd_cow_read_delta(cow, first, len, cow->cluster_buf);
+        if ((fseeko64(f, (uint64_t) first << 9, SEEK_SET) == -1) ||
+            (fwrite(cow->cluster_buf, 512, len, f) != len)) {
+            fclose(f);
+            return 0;
+        }
+    }
+
+    fclose(f);
+
+    memset(cow->bitmap, 0, cow->bitmap_size);
+    if (fseeko64(cow->file, cow->bitmap_off, SEEK_SET) == -1)
+        fatal("hdd_cow_commit(): Error seeking to the cluster bitmap\n");
+    fwrite(cow->bitmap, 1, cow->bitmap_size, cow->file);
+    fflush(cow->file);
+
+    /* Give the space taken by the clusters back. */
+#ifdef _WIN32
+    _chsize_s(_fileno(cow->file), cow->data_off);
+#else
+    if (ftruncate(fileno(cow->file), (off_t) cow->data_off) != 0)
+        hdd_cow_log("COW: Unable to truncate overlay image\n");
+#endif
+
+    /* The base image may have grown. */
+    hdd_cow_base_close(cow);
+    return hdd_cow_base_open(cow, fn);
+}
+
+static int
+hdd_cow_flatten_sectors(hdd_cow_t *cow, const char *dest_fn)
+{
+    FILE    *f;
+    uint32_t sector = 0;
+    uint32_t n;
+    uint32_t spc = 1 << cow->shift;
+
+    f = plat_fopen64(dest_fn, "wb");
+    if (f == NULL)
+        return 0;
+
+    while (sector < cow->sectors) {
+        n = cow->sectors - sector;
+        if (n > spc)
+            n = spc;
+
+        hdd_cow_read_sectors(cow, sector, n, cow->cluster_buf);
+        if (fwrite(cow->cluster_buf, 512, n, f) != n) {
+            fclose(f);
+            return 0;
+        }
+
+        sector += n;
+    }
+
+    fclose(f);
+
+    return 1;
+}
+
+/* Write all the clusters held in the delta file back into the base image
+   and empty the delta file. Every other overlay sharing the base image
+   sees the changes as well, so this is only safe if there are none. */
+int
+hdd_cow_commit(hdd_cow_t *cow, const char *fn)
+{
+    int ret;
+
+    thread_wait_mutex(cow->mutex);
+    ret = hdd_cow_commit_clusters(cow, fn);
+    thread_release_mutex(cow->mutex);
+
+    return ret;
+}
+
+/* Write the contents of the overlay out as a standalone raw image. */
+int
+hdd_cow_flatten(hdd_cow_t *cow, const char *dest_fn)
+{
+    int ret;
+
+    thread_wait_mutex(cow->mutex);
+    ret = hdd_cow_flatten_sectors(cow, dest_fn);
+    thread_release_mutex(cow->mutex);
+
+    return ret;
+}
+
+#ifdef USE_INSTRUMENT
+#    define COW_TEST_SPT    16
+#    define COW_TEST_HPC    16
+#    define COW_TEST_TRACKS 32
+#    define COW_TEST_SECTORS (COW_TEST_SPT * COW_TEST_HPC * COW_TEST_TRACKS)
+#    define COW_TEST_BASE   (COW_TEST_SECTORS - 200) /* Shorter than the disk. */
+#    define COW_TEST_WRITES 2000
+
+static uint32_t cow_test_seed;
+
+static uint32_t
+hdd_cow_test_rand(void)
+{
+    cow_test_seed = cow_test_seed * 1103515245 + 12345;
+    return cow_test_seed >> 8;
+}
+
+static void
+hdd_cow_test_fill(uint8_t *buf, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+        buf[i] = hdd_cow_test_rand() & 0xff;
+}
+
+/* Non-zero if the overlay reads back the same as the reference disk. */
+static int
+hdd_cow_test_compare(hdd_cow_t *cow, const uint8_t *ref, uint8_t *buf)
+{
+    if ((cow == NULL) || (hdd_cow_read(cow, 0, COW_TEST_SECTORS, buf) != COW_TEST_SECTORS))
+        return 0;
+
+    return !memcmp(ref, buf, COW_TEST_SECTORS * 512);
+}
+
+/* Non-zero if a raw image holds the reference disk, anything past the end
+   of the file counting as zeroes. */
+static int
+hdd_cow_test_compare_raw(const char *fn, const uint8_t *ref, uint8_t *buf)
+{
+    FILE  *f;
+    size_t len;
+
+    f = plat_fopen64(fn, "rb");
+    if (f == NULL)
+        return 0;
+    len = fread(buf, 1, COW_TEST_SECTORS * 512, f);
+    fclose(f);
+
+    memset(buf + len, 0x00, (COW_TEST_SECTORS * 512) - len);
+
+    return !memcmp(ref, buf, COW_TEST_SECTORS * 512);
+}
+
+/* Apply random writes to an overlay and the same writes to a plain copy of
+   the disk, then check that the overlay, a reopened overlay, a flattened
+   image and a committed base image all match the copy. Returns non-zero
+   if any of them does not. */
+int
+hdd_cow_test(void)
+{
+    char       base_fn[1024], cow_fn[1024], flat_fn[1024];
+    uint8_t   *ref, *buf, *data;
+    hdd_cow_t *cow;
+    FILE      *f;
+    uint32_t   sector, count;
+    int        fresh, written, reopened, flattened, base_kept, committed, emptied;
+
+    ref  = (uint8_t *) calloc(COW_TEST_SECTORS, 512);
+    buf  = (uint8_t *) malloc(COW_TEST_SECTORS * 512);
+    data = (uint8_t *) malloc(256 * 512);
+    if ((ref == NULL) || (buf == NULL) || (data == NULL))
+        fatal("hdd_cow_test: out of memory\n");
+
+    path_append_filename(base_fn, usr_path, "cow_test_base.img");
+    path_append_filename(cow_fn, usr_path, "cow_test.cow");
+    path_append_filename(flat_fn, usr_path, "cow_test_flat.img");
+
+    cow_test_seed = 1;
+    hdd_cow_test_fill(ref, COW_TEST_BASE * 512);
+
+    f = plat_fopen64(base_fn, "wb");
+    if ((f == NULL) || (fwrite(ref, 512, COW_TEST_BASE, f) != COW_TEST_BASE))
+        fatal("hdd_cow_test: unable to write '%s'\n", base_fn);
+    fclose(f);
+
+    /* The base is named relative to the overlay. */
+    if (!hdd_cow_create(cow_fn, "cow_test_base.img", COW_TEST_SPT, COW_TEST_HPC, COW_TEST_TRACKS))
+        fatal("hdd_cow_test: unable to create '%s'\n", cow_fn);
+
+    cow   = hdd_cow_open(cow_fn);
+    fresh = hdd_cow_test_compare(cow, ref, buf);
+
+    /* Runs of up to 256 sectors, so that some start and end in the middle of
+       a cluster and some cover several, with the odd zeroed run. */
+    written = (cow != NULL);
+    for (int i = 0; written && (i < COW_TEST_WRITES); i++) {
+        sector = hdd_cow_test_rand() % COW_TEST_SECTORS;
+        count  = 1 + (hdd_cow_test_rand() % 256);
+        if (count > (COW_TEST_SECTORS - sector))
+            count = COW_TEST_SECTORS - sector;
+
+        if (!(hdd_cow_test_rand() % 16)) {
+            memset(&ref[sector * 512], 0x00, count * 512);
+            written = (hdd_cow_zero(cow, sector, count) == count);
+        } else {
+            hdd_cow_test_fill(data, count * 512);
+            memcpy(&ref[sector * 512], data, count * 512);
+            written = (hdd_cow_write(cow, sector, count, data) == count);
+        }
+    }
+    written = written && hdd_cow_test_compare(cow, ref, buf);
+
+    hdd_cow_close(cow);
+    cow      = hdd_cow_open(cow_fn);
+    reopened = hdd_cow_test_compare(cow, ref, buf);
+
+    flattened = (cow != NULL) && hdd_cow_flatten(cow, flat_fn) && hdd_cow_test_compare_raw(flat_fn, ref, buf);
+
+    /* The base must not have been touched until now. */
+    cow_test_seed = 1;
+    f = plat_fopen64(base_fn, "rb");
+    base_kept = (f != NULL);
+    for (sector = 0; base_kept && (sector < COW_TEST_BASE); sector++) {
+        hdd_cow_test_fill(data, 512);
+        base_kept = (fread(buf, 1, 512, f) == 512) && !memcmp(buf, data, 512);
+    }
+    if (f != NULL) {
+        base_kept = base_kept && (fread(buf, 1, 1, f) == 0);
+        fclose(f);
+    }
+
+    committed = (cow != NULL) && hdd_cow_commit(cow, cow_fn) && hdd_cow_test_compare_raw(base_fn, ref, buf) &&
+                hdd_cow_test_compare(cow, ref, buf);
+
+    /* A committed overlay has nothing left in it. */
+    emptied = committed;
+    for (uint32_t c = 0; emptied && (c < cow->clusters); c++)
+        emptied = !hdd_cow_allocated(cow, c);
+
+    hdd_cow_close(cow);
+
+    plat_remove(cow_fn);
+    plat_remove(flat_fn);
+    plat_remove(base_fn);
+
+    free(data);
+    free(buf);
+    free(ref);
+
+    printf("{\n");
+    printf("    \"sectors\": %i,\n", COW_TEST_SECTORS);
+    printf("    \"writes\": %i,\n", COW_TEST_WRITES);
+    printf("    \"fresh\": %s,\n", fresh ? "true" : "false");
+    printf("    \"written\": %s,\n", written ? "true" : "false");
+    printf("    \"reopened\": %s,\n", reopened ? "true" : "false");
+    printf("    \"flattened\": %s,\n", flattened ? "true" : "false");
+    printf("    \"base_kept\": %s,\n", base_kept ? "true" : "false");
+    printf("    \"committed\": %s,\n", committed ? "true" : "false");
+    printf("    \"emptied\": %s\n", emptied ? "true" : "false");
+    printf("}\n");
+    fflush(stdout);
+
+    return !(fresh && written && reopened && flattened && base_kept && committed && emptied);
+}
+#endif
@@ -25,10 +25,17 @@
 #include <time.h>
 #include <wchar.h>
 #include <errno.h>
+#ifdef _WIN32
+#    include <windows.h>
+#    include <io.h>
+#else
+#    include <unistd.h>
+#endif
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include <86box/path.h>
 #include <86box/plat.h>
+#include <86box/thread.h>
 #include <86box/random.h>
 #include <86box/hdd.h>
 #include "minivhd/minivhd.h"
@@ -38,19 +45,51 @@
 #define HDD_IMAGE_HDI 1
 #define HDD_IMAGE_HDX 2
 #define HDD_IMAGE_VHD 3
+#define HDD_IMAGE_COW 4
+
+#define HDD_IMAGE_QUEUE_LEN 64
+
+typedef struct
+{
+    uint8_t  write;
+    uint32_t sector, count;
+    uint8_t *buffer; /* Caller's buffer for reads, a private copy for writes. */
+} hdd_image_req_t;
 
 typedef struct
 {
     FILE     *file; /* Used for HDD_IMAGE_RAW, HDD_IMAGE_HDI, and HDD_IMAGE_HDX. */
-    MVHDMeta *vhd;  /* Used for HDD_IMAGE_VHD. */
+    MVHDMeta  *vhd; /* Used for HDD_IMAGE_VHD. */
+    hdd_cow_t *cow; /* Used for HDD_IMAGE_COW. */
     uint32_t  base;
     uint32_t  pos, last_sector;
-    uint8_t   type; /* HDD_IMAGE_RAW, HDD_IMAGE_HDI, HDD_IMAGE_HDX, or HDD_IMAGE_VHD */
+    uint8_t   type; /* HDD_IMAGE_RAW, HDD_IMAGE_HDI, HDD_IMAGE_HDX, HDD_IMAGE_VHD, or HDD_IMAGE_COW */
     uint8_t   loaded;
+
+    /* Background I/O, used for raw, HDI and HDX images if hdd_image_async
+       is set. All file access then goes through positional reads and writes,
+       and requests are carried out in order by the I/O thread. */
+    thread_t       *io_thread;
+    mutex_t        *io_mutex;
+    event_t        *io_wake, *io_done;
+    hdd_image_req_t io_queue[HDD_IMAGE_QUEUE_LEN];
+    int             io_head, io_count, io_quit;
+
+    /* Set by the I/O thread when a background write comes up short, and
+       reported on the emulation thread at the next access. */
+    uint8_t  io_error;
+    uint32_t io_error_sector, io_error_count;
+
+    /* The outstanding background read, if any. */
+    uint8_t  prefetch;
+    uint32_t prefetch_sector, prefetch_count, prefetch_done;
+    uint8_t *prefetch_buffer;
 } hdd_image_t;
 
 hdd_image_t hdd_images[HDD_NUM];
 
+int hdd_image_async = 0;
+
 static char  empty_sector[512];
 static char *empty_sector_1mb;
 
@@ -72,6 +111,222 @@ hdd_image_log(const char *fmt, ...)
 #    define hdd_image_log(fmt, ...)
 #endif
 
+static int
+hdd_image_pread(hdd_image_t *img, uint8_t *buffer, uint32_t sector, uint32_t count)
+{
+    uint64_t addr = ((uint64_t) sector << 9LL) + img->base;
+    uint32_t len  = count << 9;
+    uint32_t done = 0;
+#ifdef _WIN32
+    HANDLE     h = (HANDLE) _get_osfhandle(_fileno(img->file));
+    OVERLAPPED ov;
+    DWORD      ret;
+
+    while (done < len) {
+        memset(&ov, 0, sizeof(OVERLAPPED));
+        ov.Offset     = (DWORD) (addr + done);
+        ov.OffsetHigh = (DWORD) ((addr + done) >> 32);
+        if (!ReadFile(h, buffer + done, len - done, &ret, &ov) || (ret == 0))
+            break;
+        done += ret;
+    }
+#else
+    ssize_t ret;
+
+    while (done < len) {
+        ret = pread(fileno(img->file), buffer + done, len - done, (off_t) (addr + done));
+        if (ret <= 0) {
+            if ((ret < 0) && (errno == EINTR))
+                continue;
+            break;
+        }
+        done += ret;
+    }
+#endif
+
+    return (int) (done >> 9);
+}
+
+static int
+hdd_image_pwrite(hdd_image_t *img, uint8_t *buffer, uint32_t sector, uint32_t count)
+{
+    uint64_t addr = ((uint64_t) sector << 9LL) + img->base;
+    uint32_t len  = count << 9;
+    uint32_t done = 0;
+#ifdef _WIN32
+    HANDLE     h = (HANDLE) _get_osfhandle(_fileno(img->file));
+    OVERLAPPED ov;
+    DWORD      ret;
+
+    while (done < len) {
+        memset(&ov, 0, sizeof(OVERLAPPED));
+        ov.Offset     = (DWORD) (addr + done);
+        ov.OffsetHigh = (DWORD) ((addr + done) >> 32);
+        if (!WriteFile(h, buffer + done, len - done, &ret, &ov) || (ret == 0))
+            break;
+        done += ret;
+    }
+#else
+    ssize_t ret;
+
+    while (done < len) {
+        ret = pwrite(fileno(img->file), buffer + done, len - done, (off_t) (addr + done));
+        if (ret <= 0) {
+            if ((ret < 0) && (errno == EINTR))
+                continue;
+            break;
+        }
+        done += ret;
+    }
+#endif
+
+    return (int) (done >> 9);
+}
+
+static void
+hdd_image_io_thread(void *priv)
+{
+    hdd_image_t     *img = (hdd_image_t *) priv;
+    hdd_image_req_t *req;
+    int              num;
+
+    while (1) {
+        thread_wait_mutex(img->io_mutex);
+        while (!img->io_count && !img->io_quit) {
+            thread_reset_event(img->io_wake);
+            thread_release_mutex(img->io_mutex);
+            thread_wait_event(img->io_wake, -1);
+            thread_wait_mutex(img->io_mutex);
+        }
+        if (!img->io_count) {
+            thread_release_mutex(img->io_mutex);
+            break;
+        }
+        req = &img->io_queue[img->io_head];
+        thread_release_mutex(img->io_mutex);
+
+        if (req->write) {
+            num = hdd_image_pwrite(img, req->buffer, req->sector, req->count);
+            if (num != req->count) {
+                hdd_image_log("Hard disk image: Background write of %i sectors at %08X only wrote %i\n",
+                              req->count, req->sector, num);
+                thread_wait_mutex(img->io_mutex);
+                if (!img->io_error) {
+                    img->io_error        = 1;
+                    img->io_error_sector = req->sector + num;
+                    img->io_error_count  = req->count - num;
+                }
+                thread_release_mutex(img->io_mutex);
+            }
+            free(req->buffer);
+        } else {
+            num = hdd_image_pread(img, req->buffer, req->sector, req->count);
+            if (img->prefetch && (req->buffer == img->prefetch_buffer))
+                img->prefetch_done = num;
+        }
+
+        thread_wait_mutex(img->io_mutex);
+        img->io_head = (img->io_head + 1) % HDD_IMAGE_QUEUE_LEN;
+        img->io_count--;
+        thread_release_mutex(img->io_mutex);
+
+        thread_set_event(img->io_done);
+    }
+}
+
+/* Wait until the I/O thread has no more than max requests left queued. */
+static void
+hdd_image_io_wait(hdd_image_t *img, int max)
+{
+    if (img->io_thread == NULL)
+        return;
+
+    thread_wait_mutex(img->io_mutex);
+    while (img->io_count > max) {
+        thread_reset_event(img->io_done);
+        thread_release_mutex(img->io_mutex);
+        thread_wait_event(img->io_done, -1);
+        thread_wait_mutex(img->io_mutex);
+    }
+    thread_release_mutex(img->io_mutex);
+
+    /* fatal() must not be called from the I/O thread itself. */
+    if (img->io_error)
+        fatal("Hard disk image %i: Write error, %i sectors at %08X were not written\n",
+              (int) (img - hdd_images), img->io_error_count, img->io_error_sector);
+}
+
+static void
+hdd_image_io_submit(hdd_image_t *img, uint8_t write, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_image_req_t *req;
+
+    hdd_image_io_wait(img, HDD_IMAGE_QUEUE_LEN - 1);
+
+    thread_wait_mutex(img->io_mutex);
+    req         = &img->io_queue[(img->io_head + img->io_count) % HDD_IMAGE_QUEUE_LEN];
+    req->write  = write;
+    req->sector = sector;
+    req->count  = count;
+    req->buffer = buffer;
+    img->io_count++;
+    thread_release_mutex(img->io_mutex);
+
+    thread_set_event(img->io_wake);
+}
+
+static void
+hdd_image_io_start(uint8_t id)
+{
+    hdd_image_t *img = &hdd_images[id];
+
+    if (!hdd_image_async || (img->file == NULL) || (img->io_thread != NULL))
+        return;
+
+    /* Everything written through the stream so far must reach the file
+       before it is accessed by position. */
+    fflush(img->file);
+
+    img->io_head = img->io_count = img->io_quit = 0;
+    img->prefetch = img->io_error = 0;
+
+    img->io_mutex  = thread_create_mutex();
+    img->io_wake   = thread_create_event();
+    img->io_done   = thread_create_event();
+    img->io_thread = thread_create(hdd_image_io_thread, img);
+}
+
+static void
+hdd_image_io_stop(uint8_t id)
+{
+    hdd_image_t *img = &hdd_images[id];
+
+    if (img->io_thread == NULL)
+        return;
+
+    thread_wait_mutex(img->io_mutex);
+    img->io_quit = 1;
+    thread_release_mutex(img->io_mutex);
+    thread_set_event(img->io_wake);
+    thread_wait(img->io_thread);
+
+    /* The image is going away, so a write that failed while draining the
+       queue can only be logged. */
+    if (img->io_error)
+        pclog("Hard disk image %i: Write error, %i sectors at %08X were not written\n",
+              id, img->io_error_count, img->io_error_sector);
+    img->io_error = 0;
+
+    thread_destroy_event(img->io_done);
+    thread_destroy_event(img->io_wake);
+    thread_close_mutex(img->io_mutex);
+
+    img->io_thread = NULL;
+    img->io_mutex  = NULL;
+    img->io_wake = img->io_done = NULL;
+    img->prefetch               = 0;
+}
+
 int
 image_is_hdi(const char *s)
 {
@@ -252,12 +507,16 @@ hdd_image_load(int id)
     hdd_images[id].base = 0;
 
     if (hdd_images[id].loaded) {
+        hdd_image_io_stop(id);
         if (hdd_images[id].file) {
             fclose(hdd_images[id].file);
             hdd_images[id].file = NULL;
         } else if (hdd_images[id].vhd) {
             mvhd_close(hdd_images[id].vhd);
             hdd_images[id].vhd = NULL;
+        } else if (hdd_images[id].cow) {
+            hdd_cow_close(hdd_images[id].cow);
+            hdd_images[id].cow = NULL;
         }
         hdd_images[id].loaded = 0;
     }
@@ -276,6 +535,24 @@ hdd_image_load(int id)
         memset(hdd[id].fn, 0, sizeof(hdd[id].fn));
         return 0;
     }
+
+    if (image_is_cow(fn, 0)) {
+        /* Overlays are created against a base image with hdd_cow_create(),
+           so there is nothing sensible to create here. */
+        hdd_images[id].cow = hdd_cow_open(fn);
+        if (hdd_images[id].cow == NULL) {
+            hdd_image_log("Unable to open overlay image\n");
+            memset(hdd[id].fn, 0, sizeof(hdd[id].fn));
+            return 0;
+        }
+
+        hdd_cow_get_geometry(hdd_images[id].cow, &hdd[id].spt, &hdd[id].hpc, &hdd[id].tracks);
+        hdd_images[id].type        = HDD_IMAGE_COW;
+        hdd_images[id].last_sector = hdd_cow_get_sectors(hdd_images[id].cow) - 1;
+        hdd_images[id].loaded      = 1;
+        return 1;
+    }
+
     hdd_images[id].file = plat_fopen(fn, "rb+");
     if (hdd_images[id].file == NULL) {
         /* Failed to open existing hard disk image */
@@ -344,6 +621,8 @@ hdd_image_load(int id)
             s = full_size = ((uint64_t) hdd[id].spt) * ((uint64_t) hdd[id].hpc) * ((uint64_t) hdd[id].tracks) << 9LL;
 
             ret = prepare_new_hard_disk(id, full_size);
+            if (ret)
+                hdd_image_io_start(id);
             return ret;
         } else {
             /* Failed for another reason */
@@ -452,6 +731,9 @@ hdd_image_load(int id)
         ret                        = 1;
     }
 
+    if (ret)
+        hdd_image_io_start(id);
+
     return ret;
 }
 
@@ -462,21 +744,66 @@ hdd_image_seek(uint8_t id, uint32_t sector)
     addr         = (uint64_t) sector << 9LL;
 
     hdd_images[id].pos = sector;
-    if (hdd_images[id].type != HDD_IMAGE_VHD) {
+    if ((hdd_images[id].type != HDD_IMAGE_VHD) && (hdd_images[id].type != HDD_IMAGE_COW)) {
         if (fseeko64(hdd_images[id].file, addr + hdd_images[id].base, SEEK_SET) == -1)
             fatal("hdd_image_seek(): Error seeking\n");
     }
 }
 
+void
+hdd_image_read_async(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_image_t *img = &hdd_images[id];
+
+    if (img->io_thread == NULL)
+        return;
+
+    hdd_image_read_discard(id);
+
+    img->prefetch        = 1;
+    img->prefetch_sector = sector;
+    img->prefetch_count  = count;
+    img->prefetch_buffer = buffer;
+    img->prefetch_done   = 0;
+
+    hdd_image_io_submit(img, 0, sector, count, buffer);
+}
+
+void
+hdd_image_read_discard(uint8_t id)
+{
+    hdd_image_t *img = &hdd_images[id];
+
+    if (!img->prefetch)
+        return;
+
+    /* The read may still be writing to the buffer. */
+    hdd_image_io_wait(img, 0);
+    img->prefetch = 0;
+}
+
 void
 hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
     int    non_transferred_sectors;
     size_t num_read;
 
-    if (hdd_images[id].type == HDD_IMAGE_VHD) {
+    if (hdd_images[id].io_thread != NULL) {
+        hdd_image_io_wait(&hdd_images[id], 0);
+
+        if (hdd_images[id].prefetch && (hdd_images[id].prefetch_sector == sector) && (hdd_images[id].prefetch_count == count) && (hdd_images[id].prefetch_buffer == buffer))
+            num_read = hdd_images[id].prefetch_done;
+        else
+            num_read = hdd_image_pread(&hdd_images[id], buffer, sector, count);
+
+        hdd_images[id].prefetch = 0;
+        hdd_images[id].pos      = sector + num_read;
+    } else if (hdd_images[id].type == HDD_IMAGE_VHD) {
         non_transferred_sectors = mvhd_read_sectors(hdd_images[id].vhd, sector, count, buffer);
         hdd_images[id].pos      = sector + count - non_transferred_sectors - 1;
+    } else if (hdd_images[id].type == HDD_IMAGE_COW) {
+        num_read           = hdd_cow_read(hdd_images[id].cow, sector, count, buffer);
+        hdd_images[id].pos = sector + num_read;
     } else {
         if (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1) {
             fatal("Hard disk image %i: Read error during seek\n", id);
@@ -519,12 +846,30 @@ hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 void
 hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
-    int    non_transferred_sectors;
-    size_t num_write;
+    int      non_transferred_sectors;
+    size_t   num_write;
+    uint8_t *copy;
+
+    if (hdd_images[id].io_thread != NULL) {
+        /* Writes are carried out in the background from a private copy of
+           the data; reads are queued behind them so they see the new data. */
+        hdd_image_read_discard(id);
+
+        if (count > 0) {
+            copy = (uint8_t *) malloc(count << 9);
+            if (copy == NULL)
+                fatal("Hard disk image %i: Out of memory queuing a write of %i sectors\n", id, count);
+            memcpy(copy, buffer, count << 9);
+            hdd_image_io_submit(&hdd_images[id], 1, sector, count, copy);
+        }
 
-    if (hdd_images[id].type == HDD_IMAGE_VHD) {
+        hdd_images[id].pos = sector + count;
+    } else if (hdd_images[id].type == HDD_IMAGE_VHD) {
         non_transferred_sectors = mvhd_write_sectors(hdd_images[id].vhd, sector, count, buffer);
         hdd_images[id].pos      = sector + count - non_transferred_sectors - 1;
+    } else if (hdd_images[id].type == HDD_IMAGE_COW) {
+        num_write          = hdd_cow_write(hdd_images[id].cow, sector, count, buffer);
+        hdd_images[id].pos = sector + num_write;
     } else {
         if (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1) {
             fatal("Hard disk image %i: Write error during seek\n", id);
@@ -558,6 +903,21 @@ hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
     if (hdd_images[id].type == HDD_IMAGE_VHD) {
         int non_transferred_sectors = mvhd_format_sectors(hdd_images[id].vhd, sector, count);
         hdd_images[id].pos          = sector + count - non_transferred_sectors - 1;
+    } else if (hdd_images[id].type == HDD_IMAGE_COW) {
+        hdd_images[id].pos = sector + hdd_cow_zero(hdd_images[id].cow, sector, count);
+    } else if (hdd_images[id].io_thread != NULL) {
+        uint32_t i = 0;
+
+        memset(empty_sector, 0, 512);
+
+        hdd_image_read_discard(id);
+        hdd_image_io_wait(&hdd_images[id], 0);
+
+        for (i = 0; i < count; i++) {
+            hdd_images[id].pos = sector + i;
+            if (hdd_image_pwrite(&hdd_images[id], (uint8_t *) empty_sector, sector + i, 1) != 1)
+                break;
+        }
     } else {
         uint32_t i = 0;
 
@@ -594,6 +954,24 @@ hdd_image_zero_ex(uint8_t id, uint32_t sector, uint32_t count)
     return 0;
 }
 
+int
+hdd_image_commit(uint8_t id)
+{
+    if (!hdd_images[id].loaded || (hdd_images[id].type != HDD_IMAGE_COW))
+        return 0;
+
+    return hdd_cow_commit(hdd_images[id].cow, hdd[id].fn);
+}
+
+int
+hdd_image_flatten(uint8_t id, const char *fn)
+{
+    if (!hdd_images[id].loaded || (hdd_images[id].type != HDD_IMAGE_COW))
+        return 0;
+
+    return hdd_cow_flatten(hdd_images[id].cow, fn);
+}
+
 uint32_t
 hdd_image_get_pos(uint8_t id)
 {
@@ -613,12 +991,16 @@ hdd_image_unload(uint8_t id, int fn_preserve)
         return;
 
     if (hdd_images[id].loaded) {
+        hdd_image_io_stop(id);
         if (hdd_images[id].file != NULL) {
             fclose(hdd_images[id].file);
             hdd_images[id].file = NULL;
         } else if (hdd_images[id].vhd != NULL) {
             mvhd_close(hdd_images[id].vhd);
             hdd_images[id].vhd = NULL;
+        } else if (hdd_images[id].cow != NULL) {
+            hdd_cow_close(hdd_images[id].cow);
+            hdd_images[id].cow = NULL;
         }
         hdd_images[id].loaded = 0;
     }
@@ -639,14 +1021,176 @@ hdd_image_close(uint8_t id)
     if (!hdd_images[id].loaded)
         return;
 
+    hdd_image_io_stop(id);
+
     if (hdd_images[id].file != NULL) {
         fclose(hdd_images[id].file);
         hdd_images[id].file = NULL;
     } else if (hdd_images[id].vhd != NULL) {
         mvhd_close(hdd_images[id].vhd);
         hdd_images[id].vhd = NULL;
+    } else if (hdd_images[id].cow != NULL) {
+        hdd_cow_close(hdd_images[id].cow);
+        hdd_images[id].cow = NULL;
     }
 
     memset(&hdd_images[id], 0, sizeof(hdd_image_t));
     hdd_images[id].loaded = 0;
 }
+
+#ifdef USE_INSTRUMENT
+#    define HDD_BENCH_SPT     63
+#    define HDD_BENCH_HPC     16
+#    define HDD_BENCH_TRACKS  130 /* 64 MB */
+#    define HDD_BENCH_SECTORS (HDD_BENCH_SPT * HDD_BENCH_HPC * HDD_BENCH_TRACKS)
+#    define HDD_BENCH_SEQ     128  /* Sectors per sequential request. */
+#    define HDD_BENCH_RANDOM  8192 /* Random 4 kB requests. */
+
+typedef struct {
+    uint32_t seq_write_call_us, seq_write_us, seq_read_us;
+    uint32_t rnd_write_call_us, rnd_write_us, rnd_read_us;
+    uint32_t checksum;
+} hdd_bench_result_t;
+
+static uint32_t hdd_bench_seed;
+
+static uint32_t
+hdd_image_bench_rand(void)
+{
+    hdd_bench_seed = hdd_bench_seed * 1103515245 + 12345;
+    return hdd_bench_seed >> 8;
+}
+
+/* Wait until everything written so far has reached the file. */
+static void
+hdd_image_bench_drain(uint8_t id)
+{
+    if (hdd_images[id].io_thread != NULL)
+        hdd_image_io_wait(&hdd_images[id], 0);
+    else
+        fflush(hdd_images[id].file);
+}
+
+static void
+hdd_image_bench_run(uint8_t id, hdd_bench_result_t *res)
+{
+    uint8_t *buf;
+    uint32_t start, t, sector, n, i;
+
+    buf = (uint8_t *) malloc(HDD_BENCH_SEQ * 512);
+    if (buf == NULL)
+        fatal("hdd_image_benchmark: out of memory\n");
+
+    hdd_bench_seed = 1;
+    for (i = 0; i < (HDD_BENCH_SEQ * 512); i++)
+        buf[i] = hdd_image_bench_rand() & 0xff;
+
+    /* The time spent in the calls is what the CPU thread sees, the total
+       includes waiting for the writes to land. */
+    res->seq_write_call_us = 0;
+    start                  = plat_get_micro_ticks();
+    for (sector = 0; sector < HDD_BENCH_SECTORS; sector += n) {
+        n = MIN(HDD_BENCH_SEQ, HDD_BENCH_SECTORS - sector);
+        memcpy(buf, &sector, sizeof(sector));
+
+        t = plat_get_micro_ticks();
+        hdd_image_write(id, sector, n, buf);
+        res->seq_write_call_us += plat_get_micro_ticks() - t;
+    }
+    hdd_image_bench_drain(id);
+    res->seq_write_us = plat_get_micro_ticks() - start;
+
+    start = plat_get_micro_ticks();
+    for (sector = 0; sector < HDD_BENCH_SECTORS; sector += n) {
+        n = MIN(HDD_BENCH_SEQ, HDD_BENCH_SECTORS - sector);
+        hdd_image_read(id, sector, n, buf);
+    }
+    res->seq_read_us = plat_get_micro_ticks() - start;
+
+    res->rnd_write_call_us = 0;
+    start                  = plat_get_micro_ticks();
+    for (i = 0; i < HDD_BENCH_RANDOM; i++) {
+        sector = (hdd_image_bench_rand() % (HDD_BENCH_SECTORS / 8)) * 8;
+        memcpy(buf, &i, sizeof(i));
+
+        t = plat_get_micro_ticks();
+        hdd_image_write(id, sector, 8, buf);
+        res->rnd_write_call_us += plat_get_micro_ticks() - t;
+    }
+    hdd_image_bench_drain(id);
+    res->rnd_write_us = plat_get_micro_ticks() - start;
+
+    start = plat_get_micro_ticks();
+    for (i = 0; i < HDD_BENCH_RANDOM; i++) {
+        sector = (hdd_image_bench_rand() % (HDD_BENCH_SECTORS / 8)) * 8;
+        hdd_image_read(id, sector, 8, buf);
+    }
+    res->rnd_read_us = plat_get_micro_ticks() - start;
+
+    /* Both paths must leave the same data behind. */
+    res->checksum = 2166136261;
+    for (sector = 0; sector < HDD_BENCH_SECTORS; sector += n) {
+        n = MIN(HDD_BENCH_SEQ, HDD_BENCH_SECTORS - sector);
+        hdd_image_read(id, sector, n, buf);
+        for (i = 0; i < (n * 512); i++)
+            res->checksum = (res->checksum ^ buf[i]) * 16777619;
+    }
+
+    free(buf);
+}
+
+static void
+hdd_image_bench_print(const char *name, hdd_bench_result_t *res, int last)
+{
+    const double mb = (double) HDD_BENCH_SECTORS / 2048.0;
+
+    printf("    \"%s\": {\n", name);
+    printf("        \"seq_write_mb_per_sec\": %.1f,\n", mb * 1000000.0 / MAX(res->seq_write_us, 1));
+    printf("        \"seq_write_call_ms\": %.1f,\n", res->seq_write_call_us / 1000.0);
+    printf("        \"seq_read_mb_per_sec\": %.1f,\n", mb * 1000000.0 / MAX(res->seq_read_us, 1));
+    printf("        \"random_write_iops\": %.0f,\n", HDD_BENCH_RANDOM * 1000000.0 / MAX(res->rnd_write_us, 1));
+    printf("        \"random_write_call_ms\": %.1f,\n", res->rnd_write_call_us / 1000.0);
+    printf("        \"random_read_iops\": %.0f\n", HDD_BENCH_RANDOM * 1000000.0 / MAX(res->rnd_read_us, 1));
+    printf("    }%s\n", last ? "" : ",");
+}
+
+/* Time sequential and random 4 kB accesses to a scratch raw image, through
+   the stdio path and through the I/O thread. */
+void
+hdd_image_benchmark(void)
+{
+    hdd_bench_result_t res[2];
+    hard_disk_t        old_hdd;
+    uint8_t            id        = HDD_NUM - 1;
+    int                old_async = hdd_image_async;
+
+    memcpy(&old_hdd, &hdd[id], sizeof(hard_disk_t));
+    memset(&hdd[id], 0, sizeof(hard_disk_t));
+    path_append_filename(hdd[id].fn, usr_path, "hdd_benchmark.img");
+    hdd[id].spt    = HDD_BENCH_SPT;
+    hdd[id].hpc    = HDD_BENCH_HPC;
+    hdd[id].tracks = HDD_BENCH_TRACKS;
+
+    for (int async = 0; async < 2; async++) {
+        plat_remove(hdd[id].fn);
+        hdd_image_async = async;
+        if (!hdd_image_load(id))
+            fatal("hdd_image_benchmark: unable to create '%s'\n", hdd[id].fn);
+        hdd_image_bench_run(id, &res[async]);
+        hdd_image_close(id);
+    }
+
+    plat_remove(hdd[id].fn);
+    hdd_image_async = old_async;
+    memcpy(&hdd[id], &old_hdd, sizeof(hard_disk_t));
+
+    printf("{\n");
+    printf("    \"image_mb\": %.1f,\n", (double) HDD_BENCH_SECTORS / 2048.0);
+    printf("    \"random_requests\": %i,\n", HDD_BENCH_RANDOM);
+    hdd_image_bench_print("sync", &res[0], 0);
+    hdd_image_bench_print("async", &res[1], 0);
+    printf("    \"same_contents\": %s\n", (res[0].checksum == res[1].checksum) ? "true" : "false");
+    printf("}\n");
+    fflush(stdout);
+}
+#endif
@@ -35,6 +35,8 @@
 #include <86box/io.h>
 #include <86box/pic.h>
 #include <86box/dma.h>
+#include <86box/plat.h>
+#include <86box/savestate.h>
 
 dma_t   dma[8];
 uint8_t dma_e;
@@ -1025,6 +1027,25 @@ dma_reset(void)
     dma_at = is286;
 }
 
+/* The scatter/gather base is left alone, as its I/O handlers belong to
+   the chipset. */
+void
+dma_savestate(savestate_t *st, void *priv)
+{
+    savestate_var(st, dma);
+    savestate_var(st, dma_e);
+    savestate_var(st, dma_m);
+    savestate_var(st, dmaregs);
+    savestate_var(st, dma_wp);
+    savestate_var(st, dma_stat);
+    savestate_var(st, dma_stat_rq);
+    savestate_var(st, dma_stat_rq_pc);
+    savestate_var(st, dma_command);
+    savestate_var(st, dma_req_is_soft);
+    savestate_var(st, dma_advanced);
+    savestate_var(st, dma_ps2);
+}
+
 void
 dma_remove_sg(void)
 {
@@ -1632,47 +1653,103 @@ dma_mode(int channel)
 void
 dma_bm_read(uint32_t PhysAddress, uint8_t *DataRead, uint32_t TotalSize, int TransferSize)
 {
-    uint32_t i        = 0, n, n2;
-    uint8_t  bytes[4] = { 0, 0, 0, 0 };
-
-    n  = TotalSize & ~(TransferSize - 1);
-    n2 = TotalSize - n;
-
-    /* Do the divisible block, if there is one. */
-    if (n) {
-        for (i = 0; i < n; i += TransferSize)
-            mem_read_phys((void *) &(DataRead[i]), PhysAddress + i, TransferSize);
-    }
-
-    /* Do the non-divisible block, if there is one. */
-    if (n2) {
-        mem_read_phys((void *) bytes, PhysAddress + n, TransferSize);
-        memcpy((void *) &(DataRead[n]), bytes, n2);
-    }
+    mem_read_phys_block(DataRead, PhysAddress, TotalSize, TransferSize);
 }
 
 void
 dma_bm_write(uint32_t PhysAddress, const uint8_t *DataWrite, uint32_t TotalSize, int TransferSize)
 {
-    uint32_t i        = 0, n, n2;
-    uint8_t  bytes[4] = { 0, 0, 0, 0 };
+    mem_write_phys_block(DataWrite, PhysAddress, TotalSize, TransferSize);
 
-    n  = TotalSize & ~(TransferSize - 1);
-    n2 = TotalSize - n;
+    if (dma_at && TotalSize)
+        mem_invalidate_range(PhysAddress, PhysAddress + TotalSize - 1);
+}
 
-    /* Do the divisible block, if there is one. */
-    if (n) {
-        for (i = 0; i < n; i += TransferSize)
-            mem_write_phys((void *) &(DataWrite[i]), PhysAddress + i, TransferSize);
+#ifdef USE_INSTRUMENT
+#    define BM_BENCH_ADDR   0x100000
+#    define BM_BENCH_SIZE   65536
+#    define BM_BENCH_PASSES 1024
+
+static uint64_t
+dma_bm_bench_run(uint8_t *buf, int write, int block)
+{
+    uint64_t start = plat_get_micro_ticks();
+    uint32_t i;
+    int      pass;
+
+    for (pass = 0; pass < BM_BENCH_PASSES; pass++) {
+        if (block && write)
+            dma_bm_write(BM_BENCH_ADDR, buf, BM_BENCH_SIZE, 4);
+        else if (block)
+            dma_bm_read(BM_BENCH_ADDR, buf, BM_BENCH_SIZE, 4);
+        else if (write) {
+            /* One access per transfer unit, as bus masters used to do. */
+            for (i = 0; i < BM_BENCH_SIZE; i += 4)
+                mem_write_phys(&buf[i], BM_BENCH_ADDR + i, 4);
+            if (dma_at)
+                mem_invalidate_range(BM_BENCH_ADDR, BM_BENCH_ADDR + BM_BENCH_SIZE - 1);
+        } else {
+            for (i = 0; i < BM_BENCH_SIZE; i += 4)
+                mem_read_phys(&buf[i], BM_BENCH_ADDR + i, 4);
+        }
     }
 
-    /* Do the non-divisible block, if there is one. */
-    if (n2) {
-        mem_read_phys((void *) bytes, PhysAddress + n, TransferSize);
-        memcpy(bytes, (void *) &(DataWrite[n]), n2);
-        mem_write_phys((void *) bytes, PhysAddress + n, TransferSize);
+    return plat_get_micro_ticks() - start;
+}
+
+/* Time 64 KiB bus master transfers to and from RAM at 1 MB, one access per
+   dword and as a block, and print the rates as JSON. The machine must have
+   been initialized with at least 2 MB of RAM. */
+void
+dma_bm_benchmark(void)
+{
+    uint8_t *src, *ref, *buf;
+    uint64_t read_us, read_block_us, write_us, write_block_us;
+    double   mb    = (double) BM_BENCH_SIZE * BM_BENCH_PASSES / 1000000.0;
+    int      exact = 1;
+    int      c;
+
+    if (mem_size < 2048) {
+        printf("{ \"error\": \"at least 2 MB of RAM is needed\" }\n");
+        return;
     }
 
-    if (dma_at)
-        mem_invalidate_range(PhysAddress, PhysAddress + TotalSize - 1);
+    src = malloc(BM_BENCH_SIZE);
+    ref = malloc(BM_BENCH_SIZE);
+    buf = malloc(BM_BENCH_SIZE);
+    if (!src || !ref || !buf)
+        fatal("dma_bm_benchmark: out of memory\n");
+
+    srand(1);
+    for (c = 0; c < BM_BENCH_SIZE; c++)
+        src[c] = rand();
+
+    memcpy(buf, src, BM_BENCH_SIZE);
+    write_us = dma_bm_bench_run(buf, 1, 0);
+    read_us  = dma_bm_bench_run(ref, 0, 0);
+    if (memcmp(ref, src, BM_BENCH_SIZE))
+        exact = 0;
+
+    for (c = 0; c < BM_BENCH_SIZE; c++)
+        buf[c] = src[c] ^ 0xff;
+    write_block_us = dma_bm_bench_run(buf, 1, 1);
+    read_block_us  = dma_bm_bench_run(ref, 0, 1);
+    if (memcmp(ref, buf, BM_BENCH_SIZE))
+        exact = 0;
+
+    printf("{\n");
+    printf("    \"transfer_bytes\": %i,\n", BM_BENCH_SIZE);
+    printf("    \"passes\": %i,\n", BM_BENCH_PASSES);
+    printf("    \"read_mb_per_sec\": %.1f,\n", mb * 1000000.0 / (read_us ? read_us : 1));
+    printf("    \"read_block_mb_per_sec\": %.1f,\n", mb * 1000000.0 / (read_block_us ? read_block_us : 1));
+    printf("    \"write_mb_per_sec\": %.1f,\n", mb * 1000000.0 / (write_us ? write_us : 1));
+    printf("    \"write_block_mb_per_sec\": %.1f,\n", mb * 1000000.0 / (write_block_us ? write_block_us : 1));
+    printf("    \"exact\": %s\n", exact ? "true" : "false");
+    printf("}\n");
+    fflush(stdout);
+
+    free(buf);
+    free(ref);
+    free(src);
 }
+#endif
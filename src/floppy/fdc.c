@@ -18,6 +18,7 @@
  *          Copyright 2016-2020 Miran Grca.
  */
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -36,6 +37,7 @@
 #include <86box/fdd.h>
 #include <86box/fdc.h>
 #include <86box/fdc_ext.h>
+#include <86box/savestate.h>
 
 extern uint64_t motoron[FDD_NUM];
 
@@ -2303,6 +2305,26 @@ fdc_reset(void *priv)
         ui_sb_update_icon(SB_FLOPPY | i, 0);
 }
 
+/* The drives have no state of their own, so the track each of them is on
+   goes along with the controller. */
+static void
+fdc_savestate(savestate_t *st, void *priv)
+{
+    fdc_t *fdc = (fdc_t *) priv;
+    int    track;
+
+    savestate_data(st, fdc, offsetof(fdc_t, timer));
+    savestate_timer(st, &fdc->timer);
+    savestate_timer(st, &fdc->watchdog_timer);
+
+    for (int i = 0; i < FDD_NUM; i++) {
+        track = fdd_current_track(i);
+        savestate_var(st, track);
+        if (savestate_loading(st))
+            fdd_forced_seek(i, track - fdd_current_track(i));
+    }
+}
+
 static void
 fdc_close(void *priv)
 {
@@ -2369,7 +2391,8 @@ const device_t fdc_xt_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_xt_sec_device = {
@@ -2383,7 +2406,8 @@ const device_t fdc_xt_sec_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_xt_t1x00_device = {
@@ -2397,7 +2421,8 @@ const device_t fdc_xt_t1x00_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_xt_amstrad_device = {
@@ -2411,7 +2436,8 @@ const device_t fdc_xt_amstrad_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_xt_tandy_device = {
@@ -2425,7 +2451,8 @@ const device_t fdc_xt_tandy_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_pcjr_device = {
@@ -2439,7 +2466,8 @@ const device_t fdc_pcjr_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_at_device = {
@@ -2453,7 +2481,8 @@ const device_t fdc_at_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_at_sec_device = {
@@ -2467,7 +2496,8 @@ const device_t fdc_at_sec_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_at_actlow_device = {
@@ -2481,7 +2511,8 @@ const device_t fdc_at_actlow_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_at_ps1_device = {
@@ -2495,7 +2526,8 @@ const device_t fdc_at_ps1_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_at_smc_device = {
@@ -2509,7 +2541,8 @@ const device_t fdc_at_smc_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_at_ali_device = {
@@ -2523,7 +2556,8 @@ const device_t fdc_at_ali_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_at_winbond_device = {
@@ -2537,7 +2571,8 @@ const device_t fdc_at_winbond_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_at_nsc_device = {
@@ -2551,7 +2586,8 @@ const device_t fdc_at_nsc_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_dp8473_device = {
@@ -2565,7 +2601,8 @@ const device_t fdc_dp8473_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
 
 const device_t fdc_um8398_device = {
@@ -2579,5 +2616,6 @@ const device_t fdc_um8398_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = fdc_savestate
 };
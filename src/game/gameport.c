@@ -30,6 +30,7 @@
 #include <86box/io.h>
 #include <86box/timer.h>
 #include <86box/isapnp.h>
+#include <86box/savestate.h>
 #include <86box/gameport.h>
 #include <86box/joystick_ch_flightstick_pro.h>
 #include <86box/joystick_standard.h>
@@ -446,6 +447,13 @@ tmacm_init(const device_t *info)
     return dev;
 }
 
+/* Nothing to keep: the address belongs to whatever added the port, and the
+   axis timers only run for a few milliseconds after the port is written. */
+static void
+gameport_savestate(savestate_t *st, void *priv)
+{
+}
+
 static void
 gameport_close(void *priv)
 {
@@ -476,7 +484,8 @@ const device_t gameport_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = gameport_savestate
 };
 
 const device_t gameport_201_device = {
@@ -490,7 +499,8 @@ const device_t gameport_201_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = gameport_savestate
 };
 
 const device_t gameport_203_device = {
@@ -504,7 +514,8 @@ const device_t gameport_203_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = gameport_savestate
 };
 
 const device_t gameport_205_device = {
@@ -518,7 +529,8 @@ const device_t gameport_205_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = gameport_savestate
 };
 
 const device_t gameport_207_device = {
@@ -532,7 +544,8 @@ const device_t gameport_207_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = gameport_savestate
 };
 
 const device_t gameport_208_device = {
@@ -546,7 +559,8 @@ const device_t gameport_208_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = gameport_savestate
 };
 
 const device_t gameport_209_device = {
@@ -560,7 +574,8 @@ const device_t gameport_209_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = gameport_savestate
 };
 
 const device_t gameport_20b_device = {
@@ -574,7 +589,8 @@ const device_t gameport_20b_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = gameport_savestate
 };
 
 const device_t gameport_20d_device = {
@@ -588,7 +604,8 @@ const device_t gameport_20d_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = gameport_savestate
 };
 
 const device_t gameport_20f_device = {
@@ -602,7 +619,8 @@ const device_t gameport_20f_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = gameport_savestate
 };
 
 static const device_config_t tmacm_config[] = {
@@ -656,7 +674,8 @@ const device_t gameport_tm_acm_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = tmacm_config
+    .config        = tmacm_config,
+    .state         = gameport_savestate
 };
 
 const device_t gameport_pnp_device = {
@@ -670,7 +689,8 @@ const device_t gameport_pnp_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = gameport_savestate
 };
 
 const device_t gameport_pnp_6io_device = {
@@ -684,7 +704,8 @@ const device_t gameport_pnp_6io_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = gameport_savestate
 };
 
 const device_t gameport_sio_device = {
@@ -698,7 +719,8 @@ const device_t gameport_sio_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = gameport_savestate
 };
 
 const device_t gameport_sio_1io_device = {
@@ -712,5 +734,6 @@ const device_t gameport_sio_1io_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = gameport_savestate
 };
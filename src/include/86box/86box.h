@@ -73,6 +73,7 @@ extern int video_fps; /* (O) render speed in fps */
 #endif
 extern int settings_only;     /* (O) show only the settings dialog */
 extern int confirm_exit_cmdl; /* (O) do not ask for confirmation on quit if set to 0 */
+extern int dynarec_profile;   /* (O) profile the dynamic recompiler */
 #ifdef _WIN32
 extern uint64_t unique_id;
 extern uint64_t source_hwnd;
@@ -82,7 +83,27 @@ extern char log_path[1024]; /* (O) full path of logfile */
 extern char vm_name[1024];  /* (O) display name of the VM */
 #ifdef USE_INSTRUMENT
 extern uint8_t  instru_enabled;
+extern uint8_t  instru_benchmark;        /* run headless and unthrottled, then report */
+extern uint8_t  instru_render_benchmark; /* time the SVGA renderers, then exit */
+extern uint8_t  instru_dma_benchmark;    /* time bus master DMA, then exit */
+extern uint8_t  instru_emu8k_benchmark;  /* time the EMU8000 renderer, then exit */
+extern uint8_t  instru_mix_benchmark;    /* time the final sound mix, then exit */
+extern uint8_t  instru_hdd_cow_test;     /* check COW overlay images, then exit */
+extern uint8_t  instru_hdd_benchmark;    /* time hard disk image I/O, then exit */
+extern uint8_t  instru_timer_benchmark;  /* replay a timer trace, then exit */
+extern char    *instru_timer_trace;      /* timer trace to write or replay */
 extern uint64_t instru_run_ms;
+
+/* Event counters, reported by the benchmark runner. */
+extern uint64_t instru_ins;           /* guest instructions executed */
+extern uint64_t instru_frames;        /* frames handed to the blitter */
+extern uint64_t instru_timer_events;  /* timer callbacks run */
+extern uint64_t instru_io_accesses;   /* I/O port reads and writes */
+extern uint64_t instru_mmio_accesses; /* accesses to device memory mappings */
+
+#    define INSTRU_COUNT(var, n) instru_##var += (n)
+#else
+#    define INSTRU_COUNT(var, n)
 #endif
 
 #define window_x monitor_settings[0].mon_window_x
@@ -107,6 +128,7 @@ extern int      vid_cga_contrast, /* (C) video */
     video_filter_method,          /* (C) video */
     video_vsync,                  /* (C) video */
     video_framerate,              /* (C) video */
+    video_render_threads,         /* (C) video */
     gfxcard;                      /* (C) graphics/video card */
 extern char video_shader[512];    /* (C) video */
 extern int  bugger_enabled,       /* (C) enable ISAbugger */
@@ -124,6 +146,8 @@ extern uint32_t mem_size;         /* (C) memory size (Installed on system board)
 extern uint32_t isa_mem_size;     /* (C) memory size (ISA Memory Cards) */
 extern int      cpu,              /* (C) cpu type */
     cpu_use_dynarec,              /* (C) cpu uses/needs Dyna */
+    cpu_dynarec_cache,            /* (C) recompiler code cache in MB, 0 = default */
+    cpu_dynarec_async,            /* (C) recompiler compiles on a separate thread */
     fpu_type;                     /* (C) fpu type */
 extern int time_sync;             /* (C) enable time sync */
 extern int hdd_format_type;       /* (C) hard disk file format */
@@ -139,6 +163,7 @@ extern double mouse_sensitivity;            /* (C) Mouse sensitivity scale */
 extern double mouse_x_error, mouse_y_error; /* Mouse error accumulators */
 extern int    pit_mode;                     /* (C) force setting PIT mode */
 extern int    fm_driver;                    /* (C) select FM sound driver */
+extern int    fm_offload;                   /* (C) synthesize FM on a worker thread */
 
 extern char exe_path[2048];    /* path (dir) of executable */
 extern char usr_path[1024];    /* path (dir) of user data */
@@ -131,6 +131,7 @@ typedef struct cdrom {
 } cdrom_t;
 
 extern cdrom_t cdrom[CDROM_NUM];
+extern int     cdrom_image_readahead;
 
 extern int     cdrom_lba_to_msf_accurate(int lba);
 extern double  cdrom_seek_time(cdrom_t *dev);
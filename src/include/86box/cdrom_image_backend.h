@@ -64,8 +64,15 @@ typedef struct {
 } track_t;
 
 typedef struct {
-    int      tracks_num;
-    track_t *tracks;
+    uint64_t hits, misses, prefetches;
+} cdi_cache_stats_t;
+
+typedef struct cdi_cache_t cdi_cache_t;
+
+typedef struct {
+    int          tracks_num;
+    track_t     *tracks;
+    cdi_cache_t *cache;
 } cd_img_t;
 
 /* Binary file functions. */
@@ -88,6 +95,7 @@ extern int  cdi_load_iso(cd_img_t *cdi, const char *filename);
 extern int  cdi_load_cue(cd_img_t *cdi, const char *cuefile);
 extern int  cdi_has_data_track(cd_img_t *cdi);
 extern int  cdi_has_audio_track(cd_img_t *cdi);
+extern void cdi_get_cache_stats(cd_img_t *cdi, cdi_cache_stats_t *stats);
 
 /* Virtual ISO functions. */
 extern int           viso_read(void *p, uint8_t *buffer, uint64_t seek, size_t count);
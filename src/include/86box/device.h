@@ -111,6 +111,8 @@ typedef struct {
     const device_config_bios_t     *bios;
 } device_config_t;
 
+struct savestate_t;
+
 typedef struct _device_ {
     const char *name;
     const char *internal_name;
@@ -129,6 +131,9 @@ typedef struct _device_ {
     void (*force_redraw)(void *priv);
 
     const device_config_t *config;
+
+    /* Saves or restores the state of the device, see savestate.h. */
+    void (*state)(struct savestate_t *st, void *priv);
 } device_t;
 
 typedef struct {
@@ -156,6 +161,8 @@ extern void  device_cadd_inst_ex(const device_t *d, const device_t *cd, void *pr
 extern void  device_close_all(void);
 extern void  device_reset_all(void);
 extern void  device_reset_all_pci(void);
+extern const device_t *device_savestate_missing(void);
+extern void  device_savestate_all(struct savestate_t *st);
 extern void *device_get_priv(const device_t *d);
 extern int   device_available(const device_t *d);
 extern int   device_poll(const device_t *d, int x, int y, int z, int b);
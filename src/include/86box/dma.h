@@ -91,6 +91,9 @@ extern void dma_alias_remove_piix(void);
 
 extern void dma_bm_read(uint32_t PhysAddress, uint8_t *DataRead, uint32_t TotalSize, int TransferSize);
 extern void dma_bm_write(uint32_t PhysAddress, const uint8_t *DataWrite, uint32_t TotalSize, int TransferSize);
+#ifdef USE_INSTRUMENT
+extern void dma_bm_benchmark(void);
+#endif
 
 void dma_set_params(uint8_t advanced, uint32_t mask);
 void dma_set_mask(uint32_t mask);
@@ -184,6 +184,7 @@ typedef struct {
 
 extern hard_disk_t  hdd[HDD_NUM];
 extern unsigned int hdd_table[128][3];
+extern int          hdd_image_async;
 
 extern int   hdd_init(void);
 extern int   hdd_string_to_bus(char *str, int cdrom);
@@ -194,6 +195,8 @@ extern void     hdd_image_init(void);
 extern int      hdd_image_load(int id);
 extern void     hdd_image_seek(uint8_t id, uint32_t sector);
 extern void     hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
+extern void     hdd_image_read_async(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
+extern void     hdd_image_read_discard(uint8_t id);
 extern int      hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
 extern void     hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
 extern int      hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
@@ -204,11 +207,31 @@ extern uint32_t hdd_image_get_pos(uint8_t id);
 extern uint8_t  hdd_image_get_type(uint8_t id);
 extern void     hdd_image_unload(uint8_t id, int fn_preserve);
 extern void     hdd_image_close(uint8_t id);
+extern int      hdd_image_commit(uint8_t id);
+extern int      hdd_image_flatten(uint8_t id, const char *fn);
 extern void     hdd_image_calc_chs(uint32_t *c, uint32_t *h, uint32_t *s, uint32_t size);
 
 extern int image_is_hdi(const char *s);
 extern int image_is_hdx(const char *s, int check_signature);
 extern int image_is_vhd(const char *s, int check_signature);
+extern int image_is_cow(const char *s, int check_signature);
+
+typedef struct hdd_cow_t hdd_cow_t;
+
+extern int        hdd_cow_create(const char *fn, const char *base_fn, uint32_t spt, uint32_t hpc, uint32_t tracks);
+extern hdd_cow_t *hdd_cow_open(const char *fn);
+extern void       hdd_cow_close(hdd_cow_t *cow);
+extern void       hdd_cow_get_geometry(hdd_cow_t *cow, uint32_t *spt, uint32_t *hpc, uint32_t *tracks);
+extern uint32_t   hdd_cow_get_sectors(hdd_cow_t *cow);
+extern int        hdd_cow_read(hdd_cow_t *cow, uint32_t sector, uint32_t count, uint8_t *buffer);
+extern int        hdd_cow_write(hdd_cow_t *cow, uint32_t sector, uint32_t count, uint8_t *buffer);
+extern int        hdd_cow_zero(hdd_cow_t *cow, uint32_t sector, uint32_t count);
+extern int        hdd_cow_commit(hdd_cow_t *cow, const char *fn);
+extern int        hdd_cow_flatten(hdd_cow_t *cow, const char *dest_fn);
+#ifdef USE_INSTRUMENT
+extern int  hdd_cow_test(void);
+extern void hdd_image_benchmark(void);
+#endif
 
 extern double      hdd_timing_write(hard_disk_t *hdd, uint32_t addr, uint32_t len);
 extern double      hdd_timing_read(hard_disk_t *hdd, uint32_t addr, uint32_t len);
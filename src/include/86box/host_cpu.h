@@ -0,0 +1,29 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Header for the host CPU feature checks used to pick vector
+ *          code paths.
+ */
+
+#ifndef EMU_HOST_CPU_H
+#define EMU_HOST_CPU_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* These always return 0 on hosts that aren't x86. */
+extern int host_cpu_has_sse2(void);
+extern int host_cpu_has_ssse3(void);
+extern int host_cpu_has_avx2(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_HOST_CPU_H*/
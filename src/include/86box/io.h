@@ -103,6 +103,20 @@ extern void io_handler_interleaved(int set, uint16_t base, int size,
                                    void (*outl)(uint16_t addr, uint32_t val, void *priv),
                                    void *priv);
 
+extern void io_sethandler_block(uint16_t base, int size,
+                                int (*in)(uint16_t addr, void *buf, int count, int size, void *priv),
+                                int (*out)(uint16_t addr, const void *buf, int count, int size, void *priv),
+                                void *priv);
+
+extern void io_removehandler_block(uint16_t base, int size,
+                                   int (*in)(uint16_t addr, void *buf, int count, int size, void *priv),
+                                   int (*out)(uint16_t addr, const void *buf, int count, int size, void *priv),
+                                   void *priv);
+
+extern int io_block_available(uint16_t port, int size, int out);
+extern int io_in_block(uint16_t port, void *buf, int count, int size);
+extern int io_out_block(uint16_t port, const void *buf, int count, int size);
+
 extern uint8_t  inb(uint16_t port);
 extern void     outb(uint16_t port, uint8_t val);
 extern uint16_t inw(uint16_t port);
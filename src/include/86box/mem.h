@@ -196,8 +196,25 @@ typedef struct _mem_mapping_ {
     /* There is never a needed to pass a pointer to the mapping itself, it is much preferable to
        prepare a structure with the requires data (usually, the base address and mask) instead. */
     void *p; /* backpointer to device */
+
+    /* Position in the mapping list (0 if not in the list), and the range the
+       mapping is currently filed under in the recalculation index. */
+    uint32_t prio;
+    uint32_t index_base;
+    uint32_t index_size;
 } mem_mapping_t;
 
+/* Mapping recalculation statistics. */
+typedef struct {
+    uint64_t recalcs; /* total number of mem_mapping_recalc() calls */
+    uint64_t pages;   /* total number of 4K lookup slots updated */
+    uint64_t usecs;   /* total time spent recalculating, in microseconds */
+
+    uint32_t recalcs_sec; /* the same, over the last second */
+    uint32_t pages_sec;
+    uint32_t usecs_sec;
+} mem_recalc_stats_t;
+
 #ifdef USE_NEW_DYNAREC
 extern uint64_t *byte_dirty_mask;
 extern uint64_t *byte_code_present_mask;
@@ -303,6 +320,8 @@ extern int mem_a20_state,
     mem_a20_alt,
     mem_a20_key;
 
+extern mem_recalc_stats_t mem_recalc_stats;
+
 extern uint8_t  read_mem_b(uint32_t addr);
 extern uint16_t read_mem_w(uint32_t addr);
 extern void     write_mem_b(uint32_t addr, uint8_t val);
@@ -385,6 +404,8 @@ extern void     mem_writeb_phys(uint32_t addr, uint8_t val);
 extern void     mem_writew_phys(uint32_t addr, uint16_t val);
 extern void     mem_writel_phys(uint32_t addr, uint32_t val);
 extern void     mem_write_phys(void *src, uint32_t addr, int tranfer_size);
+extern void     mem_read_phys_block(void *dest, uint32_t addr, uint32_t size, int transfer_size);
+extern void     mem_write_phys_block(const void *src, uint32_t addr, uint32_t size, int transfer_size);
 
 extern uint8_t  mem_read_ram(uint32_t addr, void *priv);
 extern uint16_t mem_read_ramw(uint32_t addr, void *priv);
@@ -423,6 +444,7 @@ extern void mem_a20_recalc(void);
 extern void mem_init(void);
 extern void mem_close(void);
 extern void mem_reset(void);
+extern void mem_onesec(void);
 extern void mem_remap_top(int kb);
 
 #ifdef EMU_CPU_H
@@ -53,9 +53,11 @@
 #define NET_TYPE_PCAP  2 /* use the (Win)Pcap API */
 
 #define NET_MAX_FRAME  1518
-/* Queue size must be a power of 2 */
-#define NET_QUEUE_LEN      16
-#define NET_QUEUE_LEN_MASK (NET_QUEUE_LEN - 1)
+/* Default queue depth, rounded up to a power of 2 */
+#define NET_QUEUE_LEN      64
+#define NET_QUEUE_LEN_MAX  1024
+/* Packets moved per batch */
+#define NET_BATCH_LEN      16
 #define NET_CARD_MAX       4
 #define NET_HOST_INTF_MAX  64
 
@@ -106,11 +108,13 @@ typedef struct netpkt {
     int      len;
 } netpkt_t;
 
+typedef struct netqueue_t netqueue_t;
+
 typedef struct {
-    netpkt_t packets[NET_QUEUE_LEN];
-    int      head;
-    int      tail;
-} netqueue_t;
+    uint64_t rx_packets, rx_drops;
+    uint64_t tx_packets, tx_drops;
+    uint32_t rx_high_water, tx_high_water;
+} netcard_stats_t;
 
 typedef struct _netcard_t netcard_t;
 
@@ -130,10 +134,8 @@ struct _netcard_t {
     struct netdrv_t host_drv;
     NETRXCB         rx;
     NETSETLINKSTATE set_link_state;
-    netqueue_t      queues[3];
+    netqueue_t     *queues[3];
     netpkt_t        queued_pkt;
-    mutex_t        *tx_mutex;
-    mutex_t        *rx_mutex;
     pc_timer_t      timer;
     uint16_t        card_num;
     double          byte_period;
@@ -153,6 +155,7 @@ extern "C" {
 
 /* Global variables. */
 extern int      nic_do_log; /* config */
+extern int      network_queue_len; /* config */
 extern int      network_ndev;
 extern netdev_t network_devs[NET_HOST_INTF_MAX];
 
@@ -176,6 +179,7 @@ extern int             network_card_has_config(int);
 extern char           *network_card_get_internal_name(int);
 extern int             network_card_get_from_internal_name(char *);
 extern const device_t *network_card_getdevice(int);
+extern int             network_card_get_stats(int, netcard_stats_t *);
 
 extern int network_tx_pop(netcard_t *card, netpkt_t *out_pkt);
 extern int network_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size);
@@ -0,0 +1,69 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the machine save state subsystem.
+ */
+#ifndef EMU_SAVESTATE_H
+#define EMU_SAVESTATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct savestate_t savestate_t;
+
+/* Non-zero if a state is being restored rather than saved. */
+extern int savestate_loading(savestate_t *st);
+
+/* Write or read back a block of plain data. */
+extern void savestate_data(savestate_t *st, void *data, size_t len);
+#define savestate_var(st, v) savestate_data((st), &(v), sizeof(v))
+
+/* Same as above, but pages that are all zeroes do not take up any room in
+   the file. Used for RAM, video memory and such. */
+extern void savestate_block(savestate_t *st, void *data, size_t len);
+
+#ifdef _TIMER_H_
+/* Saves the state of a timer. A restored timer is enabled if it was enabled
+   when the state was saved. */
+extern void savestate_timer(savestate_t *st, pc_timer_t *timer);
+#endif
+
+#ifdef EMU_MEM_H
+/* Saves the address and enable state of a memory mapping. */
+extern void savestate_mapping(savestate_t *st, mem_mapping_t *map);
+#endif
+
+/* Write or read back a named section, running func (if any) to fill it in.
+   Data that func does not read back is skipped when loading. */
+extern void savestate_section(savestate_t *st, const char *name,
+                              void (*func)(savestate_t *st, void *priv), void *priv);
+
+extern int savestate_save(const char *fn);
+extern int savestate_load(const char *fn);
+
+/* Ask for the state to be saved or loaded before the next block of code is
+   run, from the emulation thread. */
+extern volatile int savestate_pending;
+extern void         savestate_request(int load, const char *fn);
+extern void         savestate_process(void);
+
+/* State handlers for the core of the machine. */
+extern void cpu_savestate(savestate_t *st, void *priv);
+extern void mem_savestate(savestate_t *st, void *priv);
+extern void pic_savestate(savestate_t *st, void *priv);
+extern void dma_savestate(savestate_t *st, void *priv);
+extern void pci_savestate(savestate_t *st, void *priv);
+extern void ide_savestate(savestate_t *st, void *priv);
+extern void scsi_cdrom_savestate(savestate_t *st, void *priv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_SAVESTATE_H*/
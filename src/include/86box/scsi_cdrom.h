@@ -49,6 +49,8 @@ typedef struct {
         packet_len, pos;
 
     double callback;
+
+    uint32_t buffer_len;
 } scsi_cdrom_t;
 #endif
 
@@ -335,10 +335,34 @@ typedef struct emu8k_voice_t {
     /* filter internal data. */
     int     filterq_idx;
     int32_t filt_att;
-    int64_t filt_buffer[5];
 
 } emu8k_voice_t;
 
+/* Samples worked through by the voice loop at a time. */
+#define EMU8K_RENDER_BLOCK 32
+
+/* State of the voice output stage (oscillator interpolation, filter and mixer),
+ * laid out by field rather than by voice so that it can be processed several
+ * voices at a time. The per sample values are recorded by the envelope engine
+ * for a block at a time, and the per voice values are refreshed on each update. */
+typedef struct emu8k_render_t {
+    struct {
+        int32_t vol[32];
+        int32_t filt_ctoff[32];
+        int32_t interp_pos[32]; /* offset in the interpolation table. */
+        int32_t taps[4][32];    /* samples read by the oscillator. */
+    } sample[EMU8K_RENDER_BLOCK];
+
+    int32_t filterq_idx[32];
+    int32_t mix[32]; /* -1 when the voice goes to the output, 0 otherwise. */
+    int32_t vol_l[32];
+    int32_t vol_r[32];
+    int32_t revb_send[32];
+    int32_t chor_send[32];
+
+    int64_t filt_buffer[5][32];
+} emu8k_render_t;
+
 typedef struct emu8k_t {
     emu8k_voice_t voice[32];
 
@@ -370,6 +394,8 @@ typedef struct emu8k_t {
     emu8k_reverb_eng_t reverb_engine;
     int32_t            reverb_in_buffer[SOUNDBUFLEN];
 
+    emu8k_render_t render;
+
     int     pos;
     int32_t buffer[SOUNDBUFLEN * 2];
 
@@ -381,6 +407,9 @@ void emu8k_init(emu8k_t *emu8k, uint16_t emu_addr, int onboard_ram);
 void emu8k_close(emu8k_t *emu8k);
 
 void emu8k_update(emu8k_t *emu8k);
+#ifdef USE_INSTRUMENT
+void emu8k_benchmark(void);
+#endif
 
 /*
 
@@ -40,8 +40,19 @@ typedef struct {
     void *priv;
 } fm_drv_t;
 
+/* FM synthesis on a worker thread, see snd_opl.c. */
+typedef struct fm_offload_t fm_offload_t;
+
 extern uint8_t fm_driver_get(int chip_id, fm_drv_t *drv);
 
+extern fm_offload_t *fm_offload_init(void (*write)(void *priv, uint16_t addr, uint8_t val),
+                                     void (*generate)(void *priv, int32_t *buf, int len),
+                                     void *priv);
+extern void          fm_offload_close(fm_offload_t *fo);
+extern void          fm_offload_write(fm_offload_t *fo, int pos, uint16_t addr, uint8_t val);
+extern int32_t      *fm_offload_update(fm_offload_t *fo);
+extern void          fm_offload_reset_buffer(fm_offload_t *fo);
+
 extern const fm_drv_t nuked_opl_drv;
 extern const fm_drv_t ymfm_drv;
 
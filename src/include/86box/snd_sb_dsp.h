@@ -128,6 +128,9 @@ void sb_dsp_poll(sb_dsp_t *dsp, int16_t *l, int16_t *r);
 void sb_dsp_set_stereo(sb_dsp_t *dsp, int stereo);
 
 void sb_dsp_update(sb_dsp_t *dsp);
+
+struct savestate_t;
+void sb_dsp_savestate(sb_dsp_t *dsp, struct savestate_t *st);
 void sb_update_mask(sb_dsp_t *dsp, int irqm8, int irqm16, int irqm401);
 
 void sb_dsp_irq_attach(sb_dsp_t *dsp, void (*irq_update)(void *priv, int set), void *priv);
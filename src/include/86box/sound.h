@@ -43,6 +43,9 @@ extern int sound_card_current;
 extern void sound_add_handler(void (*get_buffer)(int32_t *buffer,
                                                  int len, void *p),
                               void *p);
+extern void sound_add_handler_float(void (*get_buffer)(float *buffer,
+                                                       int len, void *p),
+                                    void *p);
 extern void sound_set_cd_audio_filter(void (*filter)(int     channel,
                                                      double *buffer, void *p),
                                       void *p);
@@ -61,6 +64,9 @@ extern void sound_speed_changed(void);
 
 extern void sound_init(void);
 extern void sound_reset(void);
+#ifdef USE_INSTRUMENT
+extern void sound_mix_benchmark(void);
+#endif
 
 extern void sound_card_reset(void);
 
@@ -50,6 +50,9 @@ typedef struct pc_timer_t {
     void *p;
 
     struct pc_timer_t *prev, *next;
+#ifdef USE_TIMER_HEAP
+    int heap_pos; /* Position in the timer heap while enabled. */
+#endif
 } pc_timer_t;
 
 #ifdef __cplusplus
@@ -76,6 +79,9 @@ extern void timer_init(void);
   timestamp - this is useful for permanently enabled timers*/
 extern void timer_add(pc_timer_t *timer, void (*callback)(void *p), void *p, int start_timer);
 
+/*Set the TSC to a new value, moving all enabled timers along with it*/
+extern void timer_set_tsc(uint64_t new_tsc);
+
 /*1us in 32:32 format*/
 extern uint64_t TIMER_USEC;
 
@@ -183,6 +189,22 @@ extern void timer_remove_head(void);
 extern pc_timer_t *timer_head;
 extern int         timer_inited;
 
+#ifdef USE_INSTRUMENT
+extern void timer_trace_close(void);
+extern int  timer_benchmark(void);
+#endif
+
+#if defined(USE_TIMER_HEAP) || defined(USE_INSTRUMENT)
+/*The heap scheduler keeps timer processing out of line, and so do
+  instrumented builds, so that timer events are counted and traced in one
+  place.*/
+static __inline void
+timer_process_inline(void)
+{
+    if (timer_head)
+        timer_process();
+}
+#else
 static __inline void
 timer_process_inline(void)
 {
@@ -212,6 +234,7 @@ timer_process_inline(void)
 
     timer_target = timer_head->ts.ts32.integer;
 }
+#endif
 
 #ifdef __cplusplus
 }
@@ -90,6 +90,7 @@ typedef struct svga_t {
         extra_banks[2],
         banked_mask,
         ca, overscan_color,
+        blit_overscan_color, /* overscan colour of the last frame blitted */
         *map8, pallook[512];
 
     PALETTE vgapal;
@@ -170,6 +171,10 @@ typedef struct svga_t {
     uint32_t (*remap_func)(struct svga_t *svga, uint32_t in_addr);
 
     void *ramdac, *clock_gen;
+
+    /*Scanline render workers, NULL if lines are rendered on the CPU thread*/
+    struct svga_render_worker_t *render_workers;
+    int                          render_threads, render_next_worker;
 } svga_t;
 
 extern int vga_on, ibm8514_on;
@@ -189,6 +194,9 @@ extern int  svga_init(const device_t *info, svga_t *svga, void *p, int memsize,
 extern void svga_recalctimings(svga_t *svga);
 extern void svga_close(svga_t *svga);
 
+struct savestate_t;
+extern void svga_savestate(svga_t *svga, struct savestate_t *st);
+
 uint8_t  svga_read(uint32_t addr, void *p);
 uint16_t svga_readw(uint32_t addr, void *p);
 uint32_t svga_readl(uint32_t addr, void *p);
@@ -221,6 +229,7 @@ uint32_t svga_mask_addr(uint32_t addr, svga_t *svga);
 uint32_t svga_mask_changedaddr(uint32_t addr, svga_t *svga);
 
 void svga_doblit(int wx, int wy, svga_t *svga);
+void svga_doblit_lines(int wx, int wy, svga_t *svga, int firstline_draw, int lastline_draw);
 
 enum {
     RAMDAC_6BIT = 0,
@@ -32,6 +32,11 @@ extern uint8_t edatlookup[4][4];
 
 void svga_recalc_remap_func(svga_t *svga);
 
+void svga_render_init(void);
+#ifdef USE_INSTRUMENT
+void svga_render_benchmark(void);
+#endif
+
 void svga_render_null(svga_t *svga);
 void svga_render_blank(svga_t *svga);
 void svga_render_overscan_left(svga_t *svga);
@@ -30,7 +30,26 @@
 
 #define TEX_DIRTY_SHIFT 10
 
-#define TEX_CACHE_MAX   64
+#define TEX_CACHE_MAX   1024
+#define TEX_CACHE_DEF   128
+
+/* Device configuration entry for the texture cache size, shared by the
+   Voodoo and Banshee/Voodoo 3 devices. */
+#define VOODOO_TEXTURE_CACHE_CONFIG                                              \
+    {                                                                            \
+        .name = "texture_cache",                                                 \
+        .description = "Texture cache entries",                                  \
+        .type = CONFIG_SELECTION,                                                \
+        .selection = {                                                           \
+            { .description = "64", .value = 64 },                                \
+            { .description = "128", .value = 128 },                              \
+            { .description = "256", .value = 256 },                              \
+            { .description = "512", .value = 512 },                              \
+            { .description = "1024", .value = TEX_CACHE_MAX },                   \
+            { .description = "" }                                                \
+        },                                                                       \
+        .default_int = TEX_CACHE_DEF                                             \
+    }
 
 #ifdef __cplusplus
 #    include <atomic>
@@ -88,6 +107,11 @@ enum {
     FIFO_WRITEL_2DREG = (0x05 << 24)
 };
 
+/*Each render thread draws every triangle, but only the scanlines
+  (y % render_threads) == thread index. Every pixel is therefore only ever
+  written by one thread, in draw order.*/
+#define VOODOO_MAX_RENDER_THREADS 32
+
 #define PARAM_SIZE       1024
 #define PARAM_MASK       (PARAM_SIZE - 1)
 #define PARAM_ENTRY_SIZE (1 << 31)
@@ -179,13 +203,35 @@ typedef struct voodoo_params_t {
 typedef struct texture_t {
     uint32_t   base;
     uint32_t   tLOD;
-    atomic_int refcount, refcount_r[4];
+    uint32_t   tformat;
+    atomic_int refcount, refcount_r[VOODOO_MAX_RENDER_THREADS];
     int        is16;
+    int        used;      /*Referenced since the eviction clock last passed*/
+    int        hash_next; /*Next entry in the same hash bucket, -1 if none*/
     uint32_t   palette_checksum;
     uint32_t   addr_start[4], addr_end[4];
     uint32_t  *data;
 } texture_t;
 
+typedef struct voodoo_tex_stats_t {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t decodes;       /*Texels decoded into the cache*/
+    uint64_t evictions;     /*Valid entries replaced on a miss*/
+    uint64_t invalidations; /*Entries dropped by texture memory writes*/
+} voodoo_tex_stats_t;
+
+typedef struct voodoo_render_stats_t {
+    uint64_t busy_time; /*plat_timer_read() ticks spent drawing triangles*/
+    uint64_t idle_time; /*Ticks spent waiting for triangles to be queued*/
+    uint64_t triangles;
+} voodoo_render_stats_t;
+
+typedef struct voodoo_render_thread_t {
+    struct voodoo_t *voodoo;
+    int              index;
+} voodoo_render_thread_t;
+
 typedef struct vert_t {
     float sVx, sVy;
     float sRed, sGreen, sBlue, sAlpha;
@@ -271,21 +317,21 @@ typedef struct voodoo_t {
     int    ncc_dirty[2];
 
     thread_t *fifo_thread;
-    thread_t *render_thread[4];
+    thread_t *render_thread[VOODOO_MAX_RENDER_THREADS];
     event_t  *wake_fifo_thread;
     event_t  *wake_main_thread;
     event_t  *fifo_not_full_event;
-    event_t  *render_not_full_event[4];
-    event_t  *wake_render_thread[4];
+    event_t  *render_not_full_event[VOODOO_MAX_RENDER_THREADS];
+    event_t  *wake_render_thread[VOODOO_MAX_RENDER_THREADS];
 
     int voodoo_busy;
-    int render_voodoo_busy[4];
+    int render_voodoo_busy[VOODOO_MAX_RENDER_THREADS];
 
-    int render_threads;
-    int odd_even_mask;
+    int                    render_threads;
+    voodoo_render_thread_t render_thread_data[VOODOO_MAX_RENDER_THREADS];
 
-    int pixel_count[4], texel_count[4], tri_count, frame_count;
-    int pixel_count_old[4], texel_count_old[4];
+    int pixel_count[VOODOO_MAX_RENDER_THREADS], texel_count[VOODOO_MAX_RENDER_THREADS], tri_count, frame_count;
+    int pixel_count_old[VOODOO_MAX_RENDER_THREADS], texel_count_old[VOODOO_MAX_RENDER_THREADS];
     int wr_count, rd_count, tex_count;
 
     int      retrace_count;
@@ -310,7 +356,7 @@ typedef struct voodoo_t {
     atomic_int   cmd_read, cmd_written, cmd_written_fifo;
 
     voodoo_params_t params_buffer[PARAM_SIZE];
-    atomic_int      params_read_idx[4], params_write_idx;
+    atomic_int      params_read_idx[VOODOO_MAX_RENDER_THREADS], params_write_idx;
 
     uint32_t   cmdfifo_base, cmdfifo_end, cmdfifo_size;
     int        cmdfifo_rp, cmdfifo_ret_addr;
@@ -482,15 +528,18 @@ typedef struct voodoo_t {
     uint8_t  thefilterb[256][256];
     uint16_t purpleline[256][3];
 
-    texture_t texture_cache[2][TEX_CACHE_MAX];
-    uint8_t   texture_present[2][16384];
-    int       texture_last_removed;
+    texture_t         *texture_cache[2];
+    int               *texture_hash[2];
+    int                texture_cache_size, texture_hash_mask;
+    uint16_t           texture_present[2][16384]; /*Number of cached LOD ranges covering each page*/
+    int                texture_last_removed[2];
+    voodoo_tex_stats_t tex_stats[2];
 
     uint32_t palette_checksum[2];
     int      palette_dirty[2];
 
-    uint64_t time;
-    int      render_time[4];
+    uint64_t              time;
+    voodoo_render_stats_t render_stats[VOODOO_MAX_RENDER_THREADS];
 
     int      force_blit_count;
     int      can_blit;
@@ -501,7 +550,7 @@ typedef struct voodoo_t {
 
     struct voodoo_set_t *set;
 
-    uint8_t fifo_thread_run, render_thread_run[4];
+    uint8_t fifo_thread_run, render_thread_run[VOODOO_MAX_RENDER_THREADS];
 
     uint8_t *vram, *changedvram;
 
@@ -193,6 +193,10 @@ extern int video_graytype;
 extern double cpuclock;
 extern int    emu_fps,
     frames;
+extern uint64_t video_blit_bytes_per_sec;   /* bytes copied out by the renderers over the last second */
+extern uint32_t video_frames_presented,     /* frames handed to the renderers over the last second */
+    video_frames_dropped,                   /* frames dropped because the renderers were busy */
+    video_blit_wait_us_per_sec;             /* time the emulation waited for the renderers */
 extern int readflash;
 
 /* Function handler pointers. */
@@ -229,6 +233,12 @@ extern void video_blit_memtoscreen_8(int x, int y, int w, int h);
 extern void video_blend_monitor(int x, int y, int monitor_index);
 extern void video_process_8_monitor(int x, int y, int monitor_index);
 extern void video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index);
+/* Same as above, but only rows dirty_y1 to dirty_y2 - 1 have changed since the previous frame. */
+extern void video_blit_memtoscreen_dirty_monitor(int x, int y, int w, int h, int dirty_y1, int dirty_y2, int monitor_index);
+/* For use by blit functions: returns the rows that have changed since the
+   last call, or 0 if there are none. Rows not returned must be left alone. */
+extern int  video_blit_get_dirty_monitor(int monitor_index, int *y1, int *y2);
+extern void video_onesec(void);
 extern void video_blit_complete_monitor(int monitor_index);
 extern void video_wait_for_blit_monitor(int monitor_index);
 extern void video_wait_for_buffer_monitor(int monitor_index);
@@ -262,6 +272,7 @@ extern uint32_t video_color_transform(uint32_t color);
 #define video_get_type()                      video_get_type_monitor(0)
 #define video_blend(x, y)                     video_blend_monitor(x, y, monitor_index_global)
 #define video_blit_memtoscreen(x, y, w, h)    video_blit_memtoscreen_monitor(x, y, w, h, monitor_index_global)
+#define video_blit_memtoscreen_dirty(x, y, w, h, y1, y2) video_blit_memtoscreen_dirty_monitor(x, y, w, h, y1, y2, monitor_index_global)
 #define video_process_8(x, y)                 video_process_8_monitor(x, y, monitor_index_global)
 #define video_blit_complete()                 video_blit_complete_monitor(monitor_index_global)
 #define video_wait_for_blit()                 video_wait_for_blit_monitor(monitor_index_global)
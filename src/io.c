@@ -46,6 +46,14 @@ typedef struct _io_ {
     struct _io_ *prev, *next;
 } io_t;
 
+/* Block handler for a data port, used by REP INS/OUTS. */
+typedef struct _io_block_ {
+    int (*in)(uint16_t addr, void *buf, int count, int size, void *priv);
+    int (*out)(uint16_t addr, const void *buf, int count, int size, void *priv);
+
+    void *priv;
+} io_block_t;
+
 typedef struct {
     uint8_t  enable;
     uint16_t base, size;
@@ -56,6 +64,8 @@ typedef struct {
 int   initialized = 0;
 io_t *io[NPORTS], *io_last[NPORTS];
 
+static io_block_t *io_block[NPORTS];
+
 #ifdef ENABLE_IO_LOG
 int io_do_log = ENABLE_IO_LOG;
 
@@ -101,6 +111,9 @@ io_init(void)
 
         /* io[c] should be NULL. */
         io[c] = io_last[c] = NULL;
+
+        free(io_block[c]);
+        io_block[c] = NULL;
     }
 }
 
@@ -275,6 +288,137 @@ io_handler_interleaved(int set, uint16_t base, int size,
     io_handler_common(set, base, size, inb, inw, inl, outb, outw, outl, priv, 2);
 }
 
+/* Block handlers.
+
+   A device may register a block handler for a data port in addition to its
+   normal handlers. It is given a buffer of count elements of size bytes and
+   returns how many it has moved, which may be fewer than asked (including
+   zero if it cannot take this transfer); the caller moves the rest through
+   inb()/outb() and friends. The normal handlers remain in charge of the
+   port, the block handler is only used while its device is the only one
+   that would see the access. */
+void
+io_sethandler_block(uint16_t base, int size,
+                    int (*in)(uint16_t addr, void *buf, int count, int size, void *priv),
+                    int (*out)(uint16_t addr, const void *buf, int count, int size, void *priv),
+                    void *priv)
+{
+    io_block_t *p;
+    int         c;
+
+    for (c = 0; c < size; c++) {
+        p = io_block[base + c];
+        if (!p) {
+            p = (io_block_t *) malloc(sizeof(io_block_t));
+            if (!p)
+                fatal("io_sethandler_block(): out of memory\n");
+            io_block[base + c] = p;
+        }
+
+        p->in   = in;
+        p->out  = out;
+        p->priv = priv;
+    }
+}
+
+void
+io_removehandler_block(uint16_t base, int size,
+                       int (*in)(uint16_t addr, void *buf, int count, int size, void *priv),
+                       int (*out)(uint16_t addr, const void *buf, int count, int size, void *priv),
+                       void *priv)
+{
+    io_block_t *p;
+    int         c;
+
+    for (c = 0; c < size; c++) {
+        p = io_block[base + c];
+        if (p && (p->in == in) && (p->out == out) && (p->priv == priv)) {
+            free(p);
+            io_block[base + c] = NULL;
+        }
+    }
+}
+
+static io_block_t *
+io_block_get(uint16_t port, int size, int out)
+{
+    io_block_t *blk = io_block[port];
+    io_t       *p;
+    int         b, w, l, i;
+
+    if (!blk || !(out ? !!blk->out : !!blk->in))
+        return NULL;
+
+    /* The port must have a single handler, belonging to the same device and
+       taking accesses of this size. */
+    p = io[port];
+    if (!p || p->next || (p->priv != blk->priv))
+        return NULL;
+    b = out ? !!p->outb : !!p->inb;
+    w = out ? !!p->outw : !!p->inw;
+    l = out ? !!p->outl : !!p->inl;
+    if (!((size == 1) ? b : ((size == 2) ? w : l)))
+        return NULL;
+
+    /* No handler on the following ports may be given part of the access. */
+    for (i = 1; i < size; i++) {
+        for (p = io[(port + i) & 0xffff]; p; p = p->next) {
+            b = out ? !!p->outb : !!p->inb;
+            w = out ? !!p->outw : !!p->inw;
+            l = out ? !!p->outl : !!p->inl;
+            if ((b && !w && ((size == 2) || !l)) || ((size == 4) && (i == 2) && w && !l))
+                return NULL;
+        }
+    }
+
+    return blk;
+}
+
+int
+io_block_available(uint16_t port, int size, int out)
+{
+    return !!io_block_get(port, size, out);
+}
+
+int
+io_in_block(uint16_t port, void *buf, int count, int size)
+{
+    io_block_t *blk;
+    int         ret;
+
+    if (amstrad_latch & 0x80000000)
+        return 0;
+
+    blk = io_block_get(port, size, 0);
+    if (!blk)
+        return 0;
+
+    ret = blk->in(port, buf, count, size, blk->priv);
+    INSTRU_COUNT(io_accesses, ret);
+
+    io_log("[%04X:%08X] in block(%04X, %i x %i) = %i\n", CS, cpu_state.pc, port, count, size, ret);
+
+    return ret;
+}
+
+int
+io_out_block(uint16_t port, const void *buf, int count, int size)
+{
+    io_block_t *blk;
+    int         ret;
+
+    blk = io_block_get(port, size, 1);
+    if (!blk)
+        return 0;
+
+    ret = blk->out(port, buf, count, size, blk->priv);
+    INSTRU_COUNT(io_accesses, ret);
+
+    io_log("[%04X:%08X] out block(%04X, %i x %i) = %i\n", CS, cpu_state.pc, port, count, size, ret);
+
+    return ret;
+}
+
 uint8_t
 inb(uint16_t port)
 {
@@ -283,6 +427,8 @@ inb(uint16_t port)
     int     found  = 0;
     int     qfound = 0;
 
+    INSTRU_COUNT(io_accesses, 1);
+
     p = io[port];
     while (p) {
         q = p->next;
@@ -322,6 +468,8 @@ outb(uint16_t port, uint8_t val)
     int   found  = 0;
     int   qfound = 0;
 
+    INSTRU_COUNT(io_accesses, 1);
+
     p = io[port];
     while (p) {
         q = p->next;
@@ -356,6 +504,8 @@ inw(uint16_t port)
     uint8_t  ret8[2];
     int      i = 0;
 
+    INSTRU_COUNT(io_accesses, 1);
+
     p = io[port];
     while (p) {
         q = p->next;
@@ -408,6 +558,8 @@ outw(uint16_t port, uint16_t val)
     int   qfound = 0;
     int   i      = 0;
 
+    INSTRU_COUNT(io_accesses, 1);
+
     p = io[port];
     while (p) {
         q = p->next;
@@ -456,6 +608,8 @@ inl(uint16_t port)
     int      qfound = 0;
     int      i      = 0;
 
+    INSTRU_COUNT(io_accesses, 1);
+
     p = io[port];
     while (p) {
         q = p->next;
@@ -535,6 +689,8 @@ outl(uint16_t port, uint32_t val)
     int   qfound = 0;
     int   i      = 0;
 
+    INSTRU_COUNT(io_accesses, 1);
+
     p = io[port];
     if (p) {
         while (p) {
@@ -23,12 +23,13 @@
 #include <wchar.h>
 #include <86box/86box.h>
 #include <86box/i2c.h>
+#include <86box/savestate.h>
 
 typedef struct {
     void   *i2c;
     uint8_t addr, *data, writable;
 
-    uint32_t addr_mask, addr_register;
+    uint32_t size, addr_mask, addr_register;
     uint8_t  addr_len, addr_pos;
 } i2c_eeprom_t;
 
@@ -128,6 +129,8 @@ i2c_eeprom_init(void *i2c, uint8_t addr, uint8_t *data, uint32_t size, uint8_t w
     i2c_eeprom_t *dev = (i2c_eeprom_t *) malloc(sizeof(i2c_eeprom_t));
     memset(dev, 0, sizeof(i2c_eeprom_t));
 
+    dev->size = size;
+
     /* Round size up to the next power of 2. */
     uint32_t pow_size = 1 << log2i(size);
     if (pow_size < size)
@@ -149,6 +152,20 @@ i2c_eeprom_init(void *i2c, uint8_t addr, uint8_t *data, uint32_t size, uint8_t w
     return dev;
 }
 
+/* Save or restore where the EEPROM is in a transfer, and its contents if it
+   can be written to. */
+void
+i2c_eeprom_savestate(void *dev_handle, savestate_t *st)
+{
+    i2c_eeprom_t *dev = (i2c_eeprom_t *) dev_handle;
+
+    savestate_var(st, dev->addr_register);
+    savestate_var(st, dev->addr_pos);
+
+    if (dev->writable)
+        savestate_data(st, dev->data, dev->size);
+}
+
 void
 i2c_eeprom_close(void *dev_handle)
 {
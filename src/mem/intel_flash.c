@@ -29,6 +29,7 @@
 #include <86box/timer.h>
 #include <86box/nvr.h>
 #include <86box/plat.h>
+#include <86box/savestate.h>
 
 #define FLAG_WORD    4
 #define FLAG_BXB     2
@@ -520,6 +521,17 @@ intel_flash_init(const device_t *info)
     return dev;
 }
 
+static void
+intel_flash_savestate(savestate_t *st, void *p)
+{
+    flash_t *dev = (flash_t *) p;
+
+    savestate_var(st, dev->command);
+    savestate_var(st, dev->status);
+    savestate_var(st, dev->program_addr);
+    savestate_data(st, dev->array, biosmask + 1);
+}
+
 static void
 intel_flash_close(void *p)
 {
@@ -557,7 +569,8 @@ const device_t intel_flash_bxt_ami_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = intel_flash_savestate
 };
 
 const device_t intel_flash_bxt_device = {
@@ -571,7 +584,8 @@ const device_t intel_flash_bxt_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = intel_flash_savestate
 };
 
 const device_t intel_flash_bxb_device = {
@@ -585,5 +599,6 @@ const device_t intel_flash_bxb_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = intel_flash_savestate
 };
@@ -37,6 +37,7 @@
 #include <86box/plat.h>
 #include <86box/rom.h>
 #include <86box/gdbstub.h>
+#include <86box/savestate.h>
 #ifdef USE_DYNAREC
 #    include "codegen_public.h"
 #else
@@ -107,6 +108,8 @@ int mem_a20_key   = 0,
 int mmuflush = 0;
 int mmu_perm = 4;
 
+mem_recalc_stats_t mem_recalc_stats;
+
 #ifdef USE_NEW_DYNAREC
 uint64_t *byte_dirty_mask;
 uint64_t *byte_code_present_mask;
@@ -122,6 +125,7 @@ static uint8_t       *page_lookupp; /* pagetable mmu_perm lookup */
 static uint8_t       *readlookupp;
 static uint8_t       *writelookupp;
 static mem_mapping_t *base_mapping, *last_mapping;
+static uint32_t       mapping_prio;
 static mem_mapping_t *read_mapping[MEM_MAPPINGS_NO];
 static mem_mapping_t *write_mapping[MEM_MAPPINGS_NO];
 static mem_mapping_t *read_mapping_bus[MEM_MAPPINGS_NO];
@@ -130,6 +134,33 @@ static uint8_t       *_mem_exec[MEM_MAPPINGS_NO];
 static uint8_t        ff_pccache[4] = { 0xff, 0xff, 0xff, 0xff };
 static mem_state_t    _mem_state[MEM_MAPPINGS_NO];
 static uint32_t       remap_start_addr, remap_start_addr2;
+static uint64_t       recalc_last_recalcs, recalc_last_pages, recalc_last_usecs;
+
+/* The mappings are additionally filed by address into 1 MB buckets, each of
+   which lists the mappings that overlap it in list order, so that a recalc
+   only has to look at the mappings that can possibly affect its range. */
+#define MEM_BUCKET_BITS 20
+#define MEM_BUCKETS_NO  (1 << (32 - MEM_BUCKET_BITS))
+
+typedef struct {
+    mem_mapping_t **maps;
+    int             count, size;
+} mem_bucket_t;
+
+static mem_bucket_t mem_buckets[MEM_BUCKETS_NO];
+
+/* Count an access that goes to device memory rather than RAM or ROM. This is
+   done once per access, however many handler calls the access takes. */
+#ifdef USE_INSTRUMENT
+#    define MEM_COUNT_MMIO(m)                                                              \
+        do {                                                                               \
+            if ((m) && !((m)->flags & (MEM_MAPPING_INTERNAL | MEM_MAPPING_IS_ROM)))       \
+                instru_mmio_accesses++;                                                    \
+        } while (0)
+#else
+#    define MEM_COUNT_MMIO(m)
+#endif
+
 #if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
 static size_t ram_size = 0, ram2_size = 0;
 #else
@@ -238,6 +269,9 @@ flushmmucache_nopc(void)
             writelookup[c]               = 0xffffffff;
         }
     }
+#ifdef USE_DYNAREC
+    codegen_flush();
+#endif
 }
 
 void
@@ -690,6 +724,7 @@ read_mem_b(uint32_t addr)
     addr &= rammask;
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
     if (map && map->read_b)
         ret = map->read_b(addr, map->p);
 
@@ -712,6 +747,7 @@ read_mem_w(uint32_t addr)
         ret = read_mem_b(addr) | (read_mem_b(addr + 1) << 8);
     else {
         map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+        MEM_COUNT_MMIO(map);
 
         if (map && map->read_w)
             ret = map->read_w(addr, map->p);
@@ -734,6 +770,7 @@ write_mem_b(uint32_t addr, uint8_t val)
     addr &= rammask;
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
     if (map && map->write_b)
         map->write_b(addr, val, map->p);
 
@@ -754,6 +791,7 @@ write_mem_w(uint32_t addr, uint16_t val)
         write_mem_b(addr + 1, val >> 8);
     } else {
         map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+        MEM_COUNT_MMIO(map);
         if (map) {
             if (map->write_w)
                 map->write_w(addr, val, map->p);
@@ -790,6 +828,7 @@ readmembl(uint32_t addr)
     addr = (uint32_t) (addr64 & rammask);
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
     if (map && map->read_b)
         return map->read_b(addr, map->p);
 
@@ -824,6 +863,7 @@ writemembl(uint32_t addr, uint8_t val)
     addr = (uint32_t) (addr64 & rammask);
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
     if (map && map->write_b)
         map->write_b(addr, val, map->p);
 }
@@ -847,6 +887,7 @@ readmembl_no_mmut(uint32_t addr, uint32_t a64)
         addr &= rammask;
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
     if (map && map->read_b)
         return map->read_b(addr, map->p);
 
@@ -877,6 +918,7 @@ writemembl_no_mmut(uint32_t addr, uint32_t a64, uint8_t val)
         addr &= rammask;
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
     if (map && map->write_b)
         map->write_b(addr, val, map->p);
 }
@@ -929,6 +971,7 @@ readmemwl(uint32_t addr)
     addr = addr64a[0] & rammask;
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
 
     if (map && map->read_w)
         return map->read_w(addr, map->p);
@@ -1002,6 +1045,7 @@ writememwl(uint32_t addr, uint16_t val)
     addr = addr64a[0] & rammask;
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
 
     if (map && map->write_w) {
         map->write_w(addr, val, map->p);
@@ -1050,6 +1094,7 @@ readmemwl_no_mmut(uint32_t addr, uint32_t *a64)
         addr &= rammask;
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
 
     if (map && map->read_w)
         return map->read_w(addr, map->p);
@@ -1105,6 +1150,7 @@ writememwl_no_mmut(uint32_t addr, uint32_t *a64, uint16_t val)
         addr &= rammask;
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
 
     if (map && map->write_w) {
         map->write_w(addr, val, map->p);
@@ -1179,6 +1225,7 @@ readmemll(uint32_t addr)
     addr = addr64a[0] & rammask;
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
 
     if (map && map->read_l)
         return map->read_l(addr, map->p);
@@ -1266,6 +1313,7 @@ writememll(uint32_t addr, uint32_t val)
     addr = addr64a[0] & rammask;
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
 
     if (map && map->write_l) {
         map->write_l(addr, val, map->p);
@@ -1320,6 +1368,7 @@ readmemll_no_mmut(uint32_t addr, uint32_t *a64)
         addr &= rammask;
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
 
     if (map && map->read_l)
         return map->read_l(addr, map->p);
@@ -1377,6 +1426,7 @@ writememll_no_mmut(uint32_t addr, uint32_t *a64, uint32_t val)
         addr &= rammask;
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
 
     if (map && map->write_l) {
         map->write_l(addr, val, map->p);
@@ -1456,6 +1506,7 @@ readmemql(uint32_t addr)
     addr = addr64a[0] & rammask;
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
     if (map && map->read_l)
         return map->read_l(addr, map->p) | ((uint64_t) map->read_l(addr + 4, map->p) << 32);
 
@@ -1534,6 +1585,7 @@ writememql(uint32_t addr, uint64_t val)
     addr = addr64a[0] & rammask;
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
+    MEM_COUNT_MMIO(map);
 
     if (map && map->write_l) {
         map->write_l(addr, val, map->p);
@@ -1620,8 +1672,10 @@ mem_readb_phys(uint32_t addr)
     if (map) {
         if (map->exec)
             ret = map->exec[(addr - map->base) & map->mask];
-        else if (map->read_b)
+        else if (map->read_b) {
+            MEM_COUNT_MMIO(map);
             ret = map->read_b(addr, map->p);
+        }
     }
 
     return ret;
@@ -1638,9 +1692,10 @@ mem_readw_phys(uint32_t addr)
     if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->exec)) {
         p   = (uint16_t *) &(map->exec[(addr - map->base) & map->mask]);
         ret = *p;
-    } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->read_w))
+    } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->read_w)) {
+        MEM_COUNT_MMIO(map);
         ret = map->read_w(addr, map->p);
-    else {
+    } else {
         ret = mem_readb_phys(addr + 1) << 8;
         ret |= mem_readb_phys(addr);
     }
@@ -1659,9 +1714,10 @@ mem_readl_phys(uint32_t addr)
     if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->exec)) {
         p   = (uint32_t *) &(map->exec[(addr - map->base) & map->mask]);
         ret = *p;
-    } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->read_l))
+    } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->read_l)) {
+        MEM_COUNT_MMIO(map);
         ret = map->read_l(addr, map->p);
-    else {
+    } else {
         ret = mem_readw_phys(addr + 2) << 16;
         ret |= mem_readw_phys(addr);
     }
@@ -1698,8 +1754,10 @@ mem_writeb_phys(uint32_t addr, uint8_t val)
     if (map) {
         if (map->exec)
             map->exec[(addr - map->base) & map->mask] = val;
-        else if (map->write_b)
+        else if (map->write_b) {
+            MEM_COUNT_MMIO(map);
             map->write_b(addr, val, map->p);
+        }
     }
 }
 
@@ -1714,9 +1772,10 @@ mem_writew_phys(uint32_t addr, uint16_t val)
     if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->exec)) {
         p  = (uint16_t *) &(map->exec[(addr - map->base) & map->mask]);
         *p = val;
-    } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->write_w))
+    } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->write_w)) {
+        MEM_COUNT_MMIO(map);
         map->write_w(addr, val, map->p);
-    else {
+    } else {
         mem_writeb_phys(addr, val & 0xff);
         mem_writeb_phys(addr + 1, (val >> 8) & 0xff);
     }
@@ -1733,9 +1792,10 @@ mem_writel_phys(uint32_t addr, uint32_t val)
     if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->exec)) {
         p  = (uint32_t *) &(map->exec[(addr - map->base) & map->mask]);
         *p = val;
-    } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->write_l))
+    } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->write_l)) {
+        MEM_COUNT_MMIO(map);
         map->write_l(addr, val, map->p);
-    else {
+    } else {
         mem_writew_phys(addr, val & 0xffff);
         mem_writew_phys(addr + 2, (val >> 16) & 0xffff);
     }
@@ -1760,6 +1820,106 @@ mem_write_phys(void *src, uint32_t addr, int transfer_size)
     }
 }
 
+/* Returns a pointer to len bytes at addr if the mapping is backed by memory
+   and they do not wrap around its mask, NULL otherwise. */
+static __inline uint8_t *
+mem_phys_block_ptr(mem_mapping_t *map, uint32_t addr, uint32_t len)
+{
+    uint32_t offset;
+
+    if (!map || !map->exec)
+        return NULL;
+
+    offset = (addr - map->base) & map->mask;
+    if ((offset + len - 1) > map->mask)
+        return NULL;
+
+    return &map->exec[offset];
+}
+
+/* Length of the next run of a block transfer that stays within one mapping
+   granule, in whole transfer_size units unless it ends the block. */
+static __inline uint32_t
+mem_phys_block_len(uint32_t addr, uint32_t size, int transfer_size)
+{
+    uint32_t len = MEM_GRANULARITY_SIZE - (addr & MEM_GRANULARITY_MASK);
+
+    if (len >= size)
+        return size;
+
+    return len & ~(transfer_size - 1);
+}
+
+/* Bulk transfers for bus masters. Each run of the block that lies in memory
+   backed RAM or ROM is copied in one go; the rest goes through the mapping
+   handlers transfer_size bytes at a time, as mem_read_phys() would. A final
+   partial unit is read whole and only the bytes within the block are kept. */
+void
+mem_read_phys_block(void *dest, uint32_t addr, uint32_t size, int transfer_size)
+{
+    uint8_t *d = (uint8_t *) dest;
+    uint8_t *p;
+    uint8_t  bytes[4];
+    uint32_t len;
+
+    mem_logical_addr = 0xffffffff;
+
+    while (size) {
+        len = mem_phys_block_len(addr, size, transfer_size);
+        p   = len ? mem_phys_block_ptr(read_mapping_bus[addr >> MEM_GRANULARITY_BITS], addr, len) : NULL;
+
+        if (p)
+            memcpy(d, p, len);
+        else if (size >= (uint32_t) transfer_size) {
+            len = transfer_size;
+            mem_read_phys(d, addr, transfer_size);
+        } else {
+            len = size;
+            mem_read_phys(bytes, addr, transfer_size);
+            memcpy(d, bytes, len);
+        }
+
+        d += len;
+        addr += len;
+        size -= len;
+    }
+}
+
+/* As above; a final partial unit is read, merged with the remaining bytes
+   and written back whole. */
+void
+mem_write_phys_block(const void *src, uint32_t addr, uint32_t size, int transfer_size)
+{
+    const uint8_t *s = (const uint8_t *) src;
+    uint8_t       *p;
+    uint8_t        bytes[4];
+    uint32_t       len;
+
+    mem_logical_addr = 0xffffffff;
+
+    while (size) {
+        len = mem_phys_block_len(addr, size, transfer_size);
+        p   = len ? mem_phys_block_ptr(write_mapping_bus[addr >> MEM_GRANULARITY_BITS], addr, len) : NULL;
+
+        if (p)
+            memcpy(p, s, len);
+        else if (size >= (uint32_t) transfer_size) {
+            len = transfer_size;
+            memcpy(bytes, s, len);
+            mem_write_phys(bytes, addr, transfer_size);
+        } else {
+            len = size;
+            mem_read_phys(bytes, addr, transfer_size);
+            memcpy(bytes, s, len);
+            mem_write_phys(bytes, addr, transfer_size);
+        }
+
+        s += len;
+        addr += len;
+        size -= len;
+    }
+}
+
 uint8_t
 mem_read_ram(uint32_t addr, void *priv)
 {
@@ -1895,6 +2055,10 @@ mem_write_ramb_page(uint32_t addr, uint8_t val, page_t *p)
         p->byte_dirty_mask[byte_offset] |= byte_mask;
         if ((p->byte_code_present_mask[byte_offset] & byte_mask) && !page_in_evict_list(p))
             page_add_to_evict_list(p);
+#    ifdef USE_DYNAREC
+        if (codegen_chain_links && (p->code_present_mask & mask))
+            codegen_chain_check_page(p);
+#    endif
     }
 }
 
@@ -1930,6 +2094,10 @@ mem_write_ramw_page(uint32_t addr, uint16_t val, page_t *p)
 
         if ((p->byte_code_present_mask[byte_offset] & byte_mask) && !page_in_evict_list(p))
             page_add_to_evict_list(p);
+#    ifdef USE_DYNAREC
+        if (codegen_chain_links && (p->code_present_mask & mask))
+            codegen_chain_check_page(p);
+#    endif
     }
 }
 
@@ -1962,6 +2130,10 @@ mem_write_raml_page(uint32_t addr, uint32_t val, page_t *p)
             if ((p->byte_code_present_mask[byte_offset + 1] & byte_mask_2) && !page_in_evict_list(p))
                 page_add_to_evict_list(p);
         }
+#    ifdef USE_DYNAREC
+        if (codegen_chain_links && (p->code_present_mask & mask))
+            codegen_chain_check_page(p);
+#    endif
     }
 }
 #else
@@ -2211,6 +2383,10 @@ mem_invalidate_range(uint32_t start_addr, uint32_t end_addr)
 
             if (!page_in_evict_list(p))
                 page_add_to_evict_list(p);
+#    ifdef USE_DYNAREC
+            if (codegen_chain_links)
+                codegen_chain_check_page(p);
+#    endif
         }
     }
 #else
@@ -2261,20 +2437,148 @@ mem_mapping_access_allowed(uint32_t flags, uint16_t access)
     return ret;
 }
 
+static void
+mem_bucket_insert(mem_bucket_t *bucket, mem_mapping_t *map)
+{
+    int i;
+
+    if (bucket->count == bucket->size) {
+        bucket->size = bucket->size ? (bucket->size << 1) : 8;
+        bucket->maps = (mem_mapping_t **) realloc(bucket->maps, bucket->size * sizeof(mem_mapping_t *));
+        if (bucket->maps == NULL)
+            fatal("mem_bucket_insert(): Out of memory\n");
+    }
+
+    /* Keep the bucket in list order, mappings are nearly always appended. */
+    for (i = bucket->count; (i > 0) && (bucket->maps[i - 1]->prio > map->prio); i--)
+        bucket->maps[i] = bucket->maps[i - 1];
+
+    bucket->maps[i] = map;
+    bucket->count++;
+}
+
+static void
+mem_bucket_remove(mem_bucket_t *bucket, mem_mapping_t *map)
+{
+    int i;
+
+    for (i = 0; i < bucket->count; i++) {
+        if (bucket->maps[i] == map) {
+            bucket->count--;
+            memmove(&bucket->maps[i], &bucket->maps[i + 1], (bucket->count - i) * sizeof(mem_mapping_t *));
+            return;
+        }
+    }
+}
+
+static __inline void
+mem_mapping_index_range(uint32_t base, uint32_t size, uint32_t *first, uint32_t *last)
+{
+    uint64_t end = (uint64_t) base + (uint64_t) size;
+
+    if (end > 0x100000000ULL)
+        end = 0x100000000ULL;
+
+    *first = base >> MEM_BUCKET_BITS;
+    *last  = (uint32_t) ((end - 1) >> MEM_BUCKET_BITS);
+}
+
+/* Re-file a mapping that is in the list under its current address range. */
+static void
+mem_mapping_index(mem_mapping_t *map)
+{
+    uint32_t b, first, last;
+
+    if (!map->prio)
+        return;
+
+    if (map->index_size && ((map->index_base != map->base) || (map->index_size != map->size))) {
+        mem_mapping_index_range(map->index_base, map->index_size, &first, &last);
+        for (b = first; b <= last; b++)
+            mem_bucket_remove(&mem_buckets[b], map);
+        map->index_size = 0;
+    }
+
+    if (map->size && !map->index_size) {
+        mem_mapping_index_range(map->base, map->size, &first, &last);
+        for (b = first; b <= last; b++)
+            mem_bucket_insert(&mem_buckets[b], map);
+        map->index_base = map->base;
+        map->index_size = map->size;
+    }
+}
+
+static void
+mem_mapping_index_clear(void)
+{
+    mem_mapping_t *map;
+    int            i;
+
+    for (i = 0; i < MEM_BUCKETS_NO; i++)
+        mem_buckets[i].count = 0;
+
+    /* Mappings of size 0 are not filed in any bucket. */
+    for (map = base_mapping; map != NULL; map = map->next)
+        map->prio = map->index_size = 0;
+
+    mapping_prio = 0;
+}
+
+static void
+mem_mapping_recalc_map(mem_mapping_t *map, uint64_t start, uint64_t end)
+{
+    uint64_t c;
+    uint32_t i;
+    int      n;
+    int      has_read  = (map->read_b || map->read_w || map->read_l);
+    int      has_write = (map->write_b || map->write_w || map->write_l);
+
+    for (c = start; c < end; c += MEM_GRANULARITY_SIZE) {
+        i = (uint32_t) (c >> MEM_GRANULARITY_BITS);
+
+        /* CPU */
+        n = !!in_smm;
+        if (map->exec && mem_mapping_access_allowed(map->flags, _mem_state[i].states[n].x))
+            _mem_exec[i] = map->exec + (c - map->base);
+        if (has_write && mem_mapping_access_allowed(map->flags, _mem_state[i].states[n].w))
+            write_mapping[i] = map;
+        if (has_read && mem_mapping_access_allowed(map->flags, _mem_state[i].states[n].r))
+            read_mapping[i] = map;
+
+        /* Bus */
+        n |= STATE_BUS;
+        if (has_write && mem_mapping_access_allowed(map->flags, _mem_state[i].states[n].w))
+            write_mapping_bus[i] = map;
+        if (has_read && mem_mapping_access_allowed(map->flags, _mem_state[i].states[n].r))
+            read_mapping_bus[i] = map;
+    }
+
+    mem_recalc_stats.pages += (end - start) >> MEM_GRANULARITY_BITS;
+}
+
 void
 mem_mapping_recalc(uint64_t base, uint64_t size)
 {
     mem_mapping_t *map;
-    int            n;
-    uint64_t       c;
+    mem_bucket_t  *bucket;
+    uint32_t       start_time;
+    uint64_t       c, end, b_start, b_end, start, stop;
+    uint32_t       b;
+    int            i;
 
     if (!size || (base_mapping == NULL))
         return;
 
-    map = base_mapping;
+    start_time = plat_get_micro_ticks();
+
+    end = base + size;
+    if (end > 0x100000000ULL)
+        end = 0x100000000ULL;
+    if (base >= end)
+        return;
 
     /* Clear out old mappings. */
-    for (c = base; c < base + size; c += MEM_GRANULARITY_SIZE) {
+    for (c = base; c < end; c += MEM_GRANULARITY_SIZE) {
         _mem_exec[c >> MEM_GRANULARITY_BITS]         = NULL;
         write_mapping[c >> MEM_GRANULARITY_BITS]     = NULL;
         read_mapping[c >> MEM_GRANULARITY_BITS]      = NULL;
@@ -2282,37 +2586,39 @@ mem_mapping_recalc(uint64_t base, uint64_t size)
         read_mapping_bus[c >> MEM_GRANULARITY_BITS]  = NULL;
     }
 
-    /* Walk mapping list. */
-    while (map != NULL) {
-        /* In range? */
-        if (map->enable && (uint64_t) map->base < ((uint64_t) base + (uint64_t) size) && ((uint64_t) map->base + (uint64_t) map->size) > (uint64_t) base) {
-            uint64_t start = (map->base < base) ? map->base : base;
-            uint64_t end   = (((uint64_t) map->base + (uint64_t) map->size) < (base + size)) ? ((uint64_t) map->base + (uint64_t) map->size) : (base + size);
-            if (start < map->base)
-                start = map->base;
-
-            for (c = start; c < end; c += MEM_GRANULARITY_SIZE) {
-                /* CPU */
-                n = !!in_smm;
-                if (map->exec && mem_mapping_access_allowed(map->flags, _mem_state[c >> MEM_GRANULARITY_BITS].states[n].x))
-                    _mem_exec[c >> MEM_GRANULARITY_BITS] = map->exec + (c - map->base);
-                if ((map->write_b || map->write_w || map->write_l) && mem_mapping_access_allowed(map->flags, _mem_state[c >> MEM_GRANULARITY_BITS].states[n].w))
-                    write_mapping[c >> MEM_GRANULARITY_BITS] = map;
-                if ((map->read_b || map->read_w || map->read_l) && mem_mapping_access_allowed(map->flags, _mem_state[c >> MEM_GRANULARITY_BITS].states[n].r))
-                    read_mapping[c >> MEM_GRANULARITY_BITS] = map;
-
-                /* Bus */
-                n |= STATE_BUS;
-                if ((map->write_b || map->write_w || map->write_l) && mem_mapping_access_allowed(map->flags, _mem_state[c >> MEM_GRANULARITY_BITS].states[n].w))
-                    write_mapping_bus[c >> MEM_GRANULARITY_BITS] = map;
-                if ((map->read_b || map->read_w || map->read_l) && mem_mapping_access_allowed(map->flags, _mem_state[c >> MEM_GRANULARITY_BITS].states[n].r))
-                    read_mapping_bus[c >> MEM_GRANULARITY_BITS] = map;
+    mem_recalc_stats.pages += (end - base + MEM_GRANULARITY_MASK) >> MEM_GRANULARITY_BITS;
+
+    /* Walk the mappings filed under each bucket in the range, in list order,
+       so that later mappings take precedence as before. */
+    for (b = (uint32_t) (base >> MEM_BUCKET_BITS); b <= (uint32_t) ((end - 1) >> MEM_BUCKET_BITS); b++) {
+        bucket  = &mem_buckets[b];
+        b_start = ((uint64_t) b) << MEM_BUCKET_BITS;
+        b_end   = b_start + (1ULL << MEM_BUCKET_BITS);
+        if (b_start < base)
+            b_start = base;
+        if (b_end > end)
+            b_end = end;
+
+        for (i = 0; i < bucket->count; i++) {
+            map = bucket->maps[i];
+
+            /* In range? */
+            if (map->enable && ((uint64_t) map->base < b_end) && (((uint64_t) map->base + (uint64_t) map->size) > b_start)) {
+                start = ((uint64_t) map->base > b_start) ? (uint64_t) map->base : b_start;
+                stop  = (((uint64_t) map->base + (uint64_t) map->size) < b_end) ? ((uint64_t) map->base + (uint64_t) map->size) : b_end;
+
+                /* Align to the mapping, the way the lookup tables are filled. */
+                start = (uint64_t) map->base + ((start - (uint64_t) map->base) & ~((uint64_t) MEM_GRANULARITY_MASK));
+
+                mem_mapping_recalc_map(map, start, stop);
             }
         }
-        map = map->next;
     }
 
     flushmmucache_cr3();
+
+    mem_recalc_stats.recalcs++;
+    mem_recalc_stats.usecs += (uint32_t) (plat_get_micro_ticks() - start_time);
 }
 
 void
@@ -2345,9 +2651,14 @@ mem_mapping_set(mem_mapping_t *map,
     map->exec    = exec;
     map->flags   = fl;
     map->p       = p;
-    map->next    = NULL;
     mem_log("mem_mapping_add(): Linked list structure: %08X -> %08X -> %08X\n", map->prev, map, map->next);
 
+    /* Remove the mapping from its old range in the index, if any. */
+    if (map->prio && map->index_size && ((map->index_base != base) || (map->index_size != size)))
+        mem_mapping_recalc(map->index_base, map->index_size);
+
+    mem_mapping_index(map);
+
     /* If the mapping is disabled, there is no need to recalc anything. */
     if (size != 0x00000000)
         mem_mapping_recalc(map->base, map->size);
@@ -2393,8 +2704,12 @@ mem_mapping_add(mem_mapping_t *map,
         map->prev          = last_mapping;
         last_mapping->next = map;
     }
+    map->next    = NULL;
     last_mapping = map;
 
+    map->prio       = ++mapping_prio;
+    map->index_size = 0;
+
     mem_mapping_set(map, base, size, read_b, read_w, read_l,
                     write_b, write_w, write_l, exec, fl, p);
 }
@@ -2436,6 +2751,8 @@ mem_mapping_set_addr(mem_mapping_t *map, uint32_t base, uint32_t size)
     map->base   = base;
     map->size   = size;
 
+    mem_mapping_index(map);
+
     mem_mapping_recalc(map->base, map->size);
 }
 
@@ -2548,6 +2865,8 @@ mem_close(void)
 {
     mem_mapping_t *map = base_mapping, *next;
 
+    mem_mapping_index_clear();
+
     while (map != NULL) {
         next      = map->next;
         map->prev = map->next = NULL;
@@ -2557,6 +2876,25 @@ mem_close(void)
     base_mapping = last_mapping = 0;
 }
 
+/* Update the per-second mapping recalculation statistics. */
+void
+mem_onesec(void)
+{
+    mem_recalc_stats.recalcs_sec = (uint32_t) (mem_recalc_stats.recalcs - recalc_last_recalcs);
+    mem_recalc_stats.pages_sec   = (uint32_t) (mem_recalc_stats.pages - recalc_last_pages);
+    mem_recalc_stats.usecs_sec   = (uint32_t) (mem_recalc_stats.usecs - recalc_last_usecs);
+
+    recalc_last_recalcs = mem_recalc_stats.recalcs;
+    recalc_last_pages   = mem_recalc_stats.pages;
+    recalc_last_usecs   = mem_recalc_stats.usecs;
+
+#ifdef ENABLE_MEM_LOG
+    if (mem_recalc_stats.recalcs_sec)
+        mem_log("Mapping recalcs: %u/s, %u pages/s, %u us/s\n",
+                mem_recalc_stats.recalcs_sec, mem_recalc_stats.pages_sec, mem_recalc_stats.usecs_sec);
+#endif
+}
+
 static void
 mem_add_ram_mapping(mem_mapping_t *mapping, uint32_t base, uint32_t size)
 {
@@ -2727,6 +3065,7 @@ mem_reset(void)
     memset(read_mapping_bus, 0x00, sizeof(read_mapping_bus));
 
     base_mapping = last_mapping = NULL;
+    mem_mapping_index_clear();
 
     /* Set the entire memory space as external. */
     memset(_mem_state, 0x00, sizeof(_mem_state));
@@ -2976,3 +3315,32 @@ mem_a20_recalc(void)
 
     mem_a20_state = state;
 }
+
+/* Save or restore the contents of RAM and the memory state. */
+void
+mem_savestate(savestate_t *st, void *priv)
+{
+    size_t size = (size_t) mem_size << 10;
+
+    if (size > (1 << 30)) {
+        savestate_block(st, ram, 1 << 30);
+        savestate_block(st, ram2, size - (1 << 30));
+    } else
+        savestate_block(st, ram, size);
+
+    savestate_var(st, _mem_state);
+    savestate_var(st, rammask);
+    savestate_var(st, mem_a20_key);
+    savestate_var(st, mem_a20_alt);
+    savestate_var(st, mem_a20_state);
+    savestate_var(st, shadowbios);
+    savestate_var(st, shadowbios_write);
+
+    if (savestate_loading(st)) {
+        mem_mapping_recalc(0ULL, 0x100000000ULL);
+        flushmmucache();
+#ifdef USE_DYNAREC
+        codegen_reset();
+#endif
+    }
+}
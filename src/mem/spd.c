@@ -27,6 +27,7 @@
 #include <86box/spd.h>
 #include <86box/version.h>
 #include <86box/machine.h>
+#include <86box/savestate.h>
 
 #define SPD_ROLLUP(x) ((x) >= 16 ? ((x) -15) : (x))
 
@@ -66,6 +67,15 @@ spd_close(void *priv)
     spd_present = 0;
 }
 
+static void
+spd_savestate(savestate_t *st, void *priv)
+{
+    for (uint8_t i = 0; i < SPD_MAX_SLOTS; i++) {
+        if (spd_modules[i])
+            i2c_eeprom_savestate(spd_modules[i]->eeprom, st);
+    }
+}
+
 static void *
 spd_init(const device_t *info)
 {
@@ -573,5 +583,6 @@ static const device_t spd_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = spd_savestate
 };
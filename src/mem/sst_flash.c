@@ -30,6 +30,7 @@
 #include <86box/timer.h>
 #include <86box/nvr.h>
 #include <86box/plat.h>
+#include <86box/savestate.h>
 
 typedef struct sst_t {
     uint8_t manufacturer, id, has_bbp, is_39,
@@ -450,6 +451,27 @@ sst_init(const device_t *info)
     return dev;
 }
 
+static void
+sst_savestate(savestate_t *st, void *p)
+{
+    sst_t *dev = (sst_t *) p;
+
+    savestate_var(st, dev->sdp);
+    savestate_var(st, dev->bbp_first_8k);
+    savestate_var(st, dev->bbp_last_8k);
+    savestate_var(st, dev->command_state);
+    savestate_var(st, dev->id_mode);
+    savestate_var(st, dev->dirty);
+    savestate_var(st, dev->page_base);
+    savestate_var(st, dev->last_addr);
+    savestate_var(st, dev->page_buffer);
+    savestate_var(st, dev->page_dirty);
+    savestate_data(st, dev->array, biosmask + 1);
+
+    if (!dev->is_39)
+        savestate_timer(st, &dev->page_write_timer);
+}
+
 static void
 sst_close(void *p)
 {
@@ -481,7 +503,8 @@ const device_t sst_flash_29ee010_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = sst_savestate
 };
 
 const device_t sst_flash_29ee020_device = {
@@ -495,7 +518,8 @@ const device_t sst_flash_29ee020_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = sst_savestate
 };
 
 const device_t winbond_flash_w29c020_device = {
@@ -509,7 +533,8 @@ const device_t winbond_flash_w29c020_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = sst_savestate
 };
 
 const device_t sst_flash_39sf010_device = {
@@ -523,7 +548,8 @@ const device_t sst_flash_39sf010_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = sst_savestate
 };
 
 const device_t sst_flash_39sf020_device = {
@@ -537,7 +563,8 @@ const device_t sst_flash_39sf020_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = sst_savestate
 };
 
 const device_t sst_flash_39sf040_device = {
@@ -551,7 +578,8 @@ const device_t sst_flash_39sf040_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = sst_savestate
 };
 
 /*
@@ -572,7 +600,8 @@ const device_t sst_flash_49lf002_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = sst_savestate
 };
 
 const device_t sst_flash_49lf004_device = {
@@ -586,5 +615,6 @@ const device_t sst_flash_49lf004_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = sst_savestate
 };
@@ -529,6 +529,44 @@ threec503_nic_hi_write(uint16_t addr, uint8_t val, void *priv)
     }
 }
 
+/* Block transfers through the FIFO data registers, as done by REP INSB/OUTSB
+   with the DMA enable bit set; same effect as the byte handlers above. */
+static int
+threec503_nic_hi_read_block(uint16_t addr, void *buf, int count, int size, void *priv)
+{
+    threec503_t *dev = (threec503_t *) priv;
+    uint8_t     *p   = (uint8_t *) buf;
+    int          c;
+
+    if ((size != 1) || !(dev->regs.ctrl & 0x80))
+        return 0;
+
+    threec503_set_drq(dev);
+
+    for (c = 0; c < count; c++)
+        p[c] = dp8390_chipmem_read(dev->dp8390, dev->regs.da++, 1);
+
+    return count;
+}
+
+static int
+threec503_nic_hi_write_block(uint16_t addr, const void *buf, int count, int size, void *priv)
+{
+    threec503_t   *dev = (threec503_t *) priv;
+    const uint8_t *p   = (const uint8_t *) buf;
+    int            c;
+
+    if ((size != 1) || !(dev->regs.ctrl & 0x80))
+        return 0;
+
+    threec503_set_drq(dev);
+
+    for (c = 0; c < count; c++)
+        dp8390_chipmem_write(dev->dp8390, dev->regs.da++, p[c], 1);
+
+    return count;
+}
+
 static void
 threec503_nic_ioset(threec503_t *dev, uint16_t addr)
 {
@@ -539,6 +577,8 @@ threec503_nic_ioset(threec503_t *dev, uint16_t addr)
     io_sethandler(addr + 0x400, 0x10,
                   threec503_nic_hi_read, NULL, NULL,
                   threec503_nic_hi_write, NULL, NULL, dev);
+    io_sethandler_block(addr + 0x40e, 2,
+                        threec503_nic_hi_read_block, threec503_nic_hi_write_block, dev);
 }
 
 static void *
@@ -552,6 +552,77 @@ nic_pnp_write_vendor_reg(uint8_t ld, uint8_t reg, uint8_t val, void *priv)
     }
 }
 
+/* Block transfers through the remote DMA data register, as done by REP
+   INSW/OUTSW. Only whole transfers that stay within the buffer memory are
+   handled; the last one is left to asic_read()/asic_write(), which signal
+   the end of the remote DMA. */
+static int
+nic_data_block_count(nic_t *dev, uint16_t addr, int size)
+{
+    dp8390_t *dp = dev->dp8390;
+
+    if (((addr - dev->base_address) != 0x10) || ((size != 4) && (size != (dp->DCR.wdsize + 1))))
+        return 0;
+    if ((size > 1) && (dp->DCR.wdsize == 0))
+        return 0;
+
+    return 1;
+}
+
+static int
+nic_read_block(uint16_t addr, void *buf, int count, int size, void *priv)
+{
+    nic_t    *dev = (nic_t *) priv;
+    dp8390_t *dp  = dev->dp8390;
+    uint8_t  *p   = (uint8_t *) buf;
+    int       n;
+
+    if (!nic_data_block_count(dev, addr, size))
+        return 0;
+
+    for (n = 0; (n < count) && (dp->remote_bytes > size); n++) {
+        if ((dp->remote_dma < dp->mem_start) || ((dp->remote_dma + size) > dp->mem_end))
+            break;
+
+        memcpy(p, &dp->mem[dp->remote_dma - dp->mem_start], size);
+        p += size;
+
+        dp->remote_dma += size;
+        if (dp->remote_dma == (dp->page_stop << 8))
+            dp->remote_dma = dp->page_start << 8;
+        dp->remote_bytes -= size;
+    }
+
+    return n;
+}
+
+static int
+nic_write_block(uint16_t addr, const void *buf, int count, int size, void *priv)
+{
+    nic_t         *dev = (nic_t *) priv;
+    dp8390_t      *dp  = dev->dp8390;
+    const uint8_t *p   = (const uint8_t *) buf;
+    int            n;
+
+    if (!nic_data_block_count(dev, addr, size))
+        return 0;
+
+    for (n = 0; (n < count) && (dp->remote_bytes > size); n++) {
+        if ((dp->remote_dma < dp->mem_start) || ((dp->remote_dma + size) > dp->mem_end))
+            break;
+
+        memcpy(&dp->mem[dp->remote_dma - dp->mem_start], p, size);
+        p += size;
+
+        dp->remote_dma += size;
+        if (dp->remote_dma == (dp->page_stop << 8))
+            dp->remote_dma = dp->page_start << 8;
+        dp->remote_bytes -= size;
+    }
+
+    return n;
+}
+
 static void
 nic_ioset(nic_t *dev, uint16_t addr)
 {
@@ -573,6 +644,8 @@ nic_ioset(nic_t *dev, uint16_t addr)
                           nic_writeb, nic_writew, NULL, dev);
         }
     }
+    io_sethandler_block(addr + 16, 1,
+                        nic_read_block, nic_write_block, dev);
 }
 
 static void
@@ -596,6 +669,8 @@ nic_ioremove(nic_t *dev, uint16_t addr)
                              nic_writeb, nic_writew, NULL, dev);
         }
     }
+    io_removehandler_block(addr + 16, 1,
+                           nic_read_block, nic_write_block, dev);
 }
 
 static void
@@ -49,7 +49,7 @@
 #endif
 #include <86box/net_event.h>
 
-#define SLIRP_PKT_BATCH NET_QUEUE_LEN
+#define SLIRP_PKT_BATCH NET_BATCH_LEN
 
 enum {
     NET_EVENT_STOP = 0,
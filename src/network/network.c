@@ -125,9 +125,34 @@ uint16_t       net_card_current = 0;
 /* Global variables. */
 int      network_ndev;
 netdev_t network_devs[NET_HOST_INTF_MAX];
+int      network_queue_len = NET_QUEUE_LEN;
 
 /* Local variables. */
 
+/* Per-card statistics. These are written by the emulation and provider
+   threads and read by the UI, so they are kept outside of netcard_t where
+   netcard_close() can't free them from under a reader. */
+static struct {
+    atomic_int            attached;
+    atomic_uint_least64_t rx_packets, rx_drops;
+    atomic_uint_least64_t tx_packets, tx_drops;
+    atomic_uint           rx_high_water, tx_high_water;
+} net_card_stats[NET_CARD_MAX];
+
+static inline void
+network_stats_inc(atomic_uint_least64_t *counter)
+{
+    atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+static inline void
+network_stats_high_water(atomic_uint *mark, uint32_t depth)
+{
+    /* Only one thread updates each mark, so a plain compare is enough. */
+    if (depth > atomic_load_explicit(mark, memory_order_relaxed))
+        atomic_store_explicit(mark, depth, memory_order_relaxed);
+}
+
 #if defined     ENABLE_NETWORK_LOG && !defined(_WIN32)
 int             network_do_log = ENABLE_NETWORK_LOG;
 static FILE    *network_dump   = NULL;
@@ -238,26 +263,57 @@ network_init(void)
 #endif
 }
 
-void
-network_queue_init(netqueue_t *queue)
+/*
+ * The queues are single producer, single consumer rings: the receive queue
+ * is filled by the host provider's thread and drained by the emulation
+ * thread, the host transmit queue the other way around, so they need no
+ * locking. The head is only ever written by the producer and the tail by
+ * the consumer; both count up freely and are masked on access.
+ */
+struct netqueue_t {
+    netpkt_t    *packets;
+    uint32_t     mask;
+    atomic_uint  head;
+    atomic_uint  tail;
+};
+
+netqueue_t *
+network_queue_init(void)
 {
-    queue->head = queue->tail = 0;
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
+    netqueue_t *queue = calloc(1, sizeof(netqueue_t));
+    uint32_t    len   = 4;
+
+    while ((len < (uint32_t) network_queue_len) && (len < NET_QUEUE_LEN_MAX))
+        len <<= 1;
+
+    queue->packets = calloc(len, sizeof(netpkt_t));
+    queue->mask    = len - 1;
+    for (uint32_t i = 0; i < len; i++)
         queue->packets[i].data = calloc(1, NET_MAX_FRAME);
-        queue->packets[i].len  = 0;
-    }
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+
+    return queue;
 }
 
-static bool
-network_queue_full(netqueue_t *queue)
+/* Number of free slots, as seen by the producer. */
+static inline uint32_t
+network_queue_space(netqueue_t *queue)
 {
-    return ((queue->head + 1) & NET_QUEUE_LEN_MASK) == queue->tail;
+    uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    return queue->mask + 1 - (head - tail);
 }
 
-static bool
-network_queue_empty(netqueue_t *queue)
+/* Number of queued packets, as seen by the consumer. */
+static inline uint32_t
+network_queue_count(netqueue_t *queue)
 {
-    return (queue->head == queue->tail);
+    uint32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+    return head - tail;
 }
 
 static inline void
@@ -268,74 +324,105 @@ network_swap_packet(netpkt_t *pkt1, netpkt_t *pkt2)
     *pkt1        = tmp;
 }
 
-int
+/* Returns the queue depth after the put, or 0 if the packet was dropped. */
+static uint32_t
 network_queue_put(netqueue_t *queue, uint8_t *data, int len)
 {
-    if (len == 0 || len > NET_MAX_FRAME || network_queue_full(queue)) {
+    uint32_t head;
+
+    if (len == 0 || len > NET_MAX_FRAME || !network_queue_space(queue))
         return 0;
-    }
 
-    netpkt_t *pkt = &queue->packets[queue->head];
+    head          = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    netpkt_t *pkt = &queue->packets[head & queue->mask];
     memcpy(pkt->data, data, len);
-    pkt->len    = len;
-    queue->head = (queue->head + 1) & NET_QUEUE_LEN_MASK;
-    return 1;
+    pkt->len = len;
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+
+    return head + 1 - atomic_load_explicit(&queue->tail, memory_order_relaxed);
 }
 
-int
+static uint32_t
 network_queue_put_swap(netqueue_t *queue, netpkt_t *src_pkt)
 {
-    if (src_pkt->len == 0 || src_pkt->len > NET_MAX_FRAME || network_queue_full(queue)) {
+    uint32_t head;
+
+    if (src_pkt->len == 0 || src_pkt->len > NET_MAX_FRAME || !network_queue_space(queue))
         return 0;
-    }
 
-    netpkt_t *dst_pkt = &queue->packets[queue->head];
+    head              = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    netpkt_t *dst_pkt = &queue->packets[head & queue->mask];
     network_swap_packet(src_pkt, dst_pkt);
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
 
-    queue->head = (queue->head + 1) & NET_QUEUE_LEN_MASK;
-    return 1;
+    return head + 1 - atomic_load_explicit(&queue->tail, memory_order_relaxed);
 }
 
+/* Dequeue up to count packets, swapping them into pkt_vec. */
 static int
-network_queue_get_swap(netqueue_t *queue, netpkt_t *dst_pkt)
+network_queue_get_swapv(netqueue_t *queue, netpkt_t *pkt_vec, int count)
 {
-    if (network_queue_empty(queue))
-        return 0;
+    uint32_t avail = network_queue_count(queue);
+    uint32_t tail  = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    int      i;
 
-    netpkt_t *src_pkt = &queue->packets[queue->tail];
-    network_swap_packet(src_pkt, dst_pkt);
-    queue->tail = (queue->tail + 1) & NET_QUEUE_LEN_MASK;
-    return 1;
+    if ((uint32_t) count > avail)
+        count = avail;
+
+    for (i = 0; i < count; i++)
+        network_swap_packet(&queue->packets[(tail + i) & queue->mask], &pkt_vec[i]);
+
+    if (count)
+        atomic_store_explicit(&queue->tail, tail + count, memory_order_release);
+
+    return count;
 }
 
-static int
-network_queue_move(netqueue_t *dst_q, netqueue_t *src_q)
+/* Move as many packets as fit, up to count, from one queue to another.
+   The caller must be the consumer of src_q and the producer of dst_q. */
+static uint32_t
+network_queue_move(netqueue_t *dst_q, netqueue_t *src_q, int count, uint32_t *depth)
 {
-    if (network_queue_empty(src_q))
-        return 0;
+    uint32_t avail = network_queue_count(src_q);
+    uint32_t space = network_queue_space(dst_q);
+    uint32_t tail  = atomic_load_explicit(&src_q->tail, memory_order_relaxed);
+    uint32_t head  = atomic_load_explicit(&dst_q->head, memory_order_relaxed);
+    uint32_t bytes = 0;
+    int      i;
 
-    if (network_queue_full(dst_q)) {
-        return 0;
+    if ((uint32_t) count > avail)
+        count = avail;
+    if ((uint32_t) count > space)
+        count = space;
+
+    for (i = 0; i < count; i++) {
+        netpkt_t *src_pkt = &src_q->packets[(tail + i) & src_q->mask];
+        netpkt_t *dst_pkt = &dst_q->packets[(head + i) & dst_q->mask];
+
+        network_swap_packet(src_pkt, dst_pkt);
+        bytes += dst_pkt->len;
     }
 
-    netpkt_t *src_pkt = &src_q->packets[src_q->tail];
-    netpkt_t *dst_pkt = &dst_q->packets[dst_q->head];
+    if (count) {
+        atomic_store_explicit(&dst_q->head, head + count, memory_order_release);
+        atomic_store_explicit(&src_q->tail, tail + count, memory_order_release);
+    }
 
-    network_swap_packet(src_pkt, dst_pkt);
-    dst_q->head = (dst_q->head + 1) & NET_QUEUE_LEN_MASK;
-    src_q->tail = (src_q->tail + 1) & NET_QUEUE_LEN_MASK;
+    *depth = dst_q->mask + 1 - space + count;
 
-    return dst_pkt->len;
+    return bytes;
 }
 
 void
 network_queue_clear(netqueue_t *queue)
 {
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
+    if (queue == NULL)
+        return;
+
+    for (uint32_t i = 0; i <= queue->mask; i++)
         free(queue->packets[i].data);
-        queue->packets[i].len = 0;
-    }
-    queue->tail = queue->head = 0;
+    free(queue->packets);
+    free(queue);
 }
 
 static void
@@ -351,12 +438,9 @@ network_rx_queue(void *priv)
     }
 
     uint32_t rx_bytes = 0;
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
+    for (int i = 0; i < NET_BATCH_LEN; i++) {
         if (card->queued_pkt.len == 0) {
-            thread_wait_mutex(card->rx_mutex);
-            int res = network_queue_get_swap(&card->queues[NET_QUEUE_RX], &card->queued_pkt);
-            thread_release_mutex(card->rx_mutex);
-            if (!res)
+            if (!network_queue_get_swapv(card->queues[NET_QUEUE_RX], &card->queued_pkt, 1))
                 break;
         }
 
@@ -369,15 +453,10 @@ network_rx_queue(void *priv)
     }
 
     /* Transmission. */
-    uint32_t tx_bytes = 0;
-    thread_wait_mutex(card->tx_mutex);
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
-        uint32_t bytes = network_queue_move(&card->queues[NET_QUEUE_TX_HOST], &card->queues[NET_QUEUE_TX_VM]);
-        if (!bytes)
-            break;
-        tx_bytes += bytes;
-    }
-    thread_release_mutex(card->tx_mutex);
+    uint32_t depth;
+    uint32_t tx_bytes = network_queue_move(card->queues[NET_QUEUE_TX_HOST], card->queues[NET_QUEUE_TX_VM],
+                                           NET_BATCH_LEN, &depth);
+    network_stats_high_water(&net_card_stats[card->card_num].tx_high_water, depth);
     if (tx_bytes) {
         /* Notify host that a packet is available in the TX queue */
         card->host_drv.notify_in(card->host_drv.priv);
@@ -399,6 +478,17 @@ network_rx_queue(void *priv)
     card->led_timer += timer_period;
 }
 
+static void
+network_stats_reset(int id)
+{
+    atomic_store_explicit(&net_card_stats[id].rx_packets, 0, memory_order_relaxed);
+    atomic_store_explicit(&net_card_stats[id].rx_drops, 0, memory_order_relaxed);
+    atomic_store_explicit(&net_card_stats[id].tx_packets, 0, memory_order_relaxed);
+    atomic_store_explicit(&net_card_stats[id].tx_drops, 0, memory_order_relaxed);
+    atomic_store_explicit(&net_card_stats[id].rx_high_water, 0, memory_order_relaxed);
+    atomic_store_explicit(&net_card_stats[id].tx_high_water, 0, memory_order_relaxed);
+}
+
 /*
  * Attach a network card to the system.
  *
@@ -414,13 +504,11 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
     card->card_drv        = card_drv;
     card->rx              = rx;
     card->set_link_state  = set_link_state;
-    card->tx_mutex        = thread_create_mutex();
-    card->rx_mutex        = thread_create_mutex();
     card->card_num        = net_card_current;
     card->byte_period     = NET_PERIOD_10M;
 
     for (int i = 0; i < 3; i++) {
-        network_queue_init(&card->queues[i]);
+        card->queues[i] = network_queue_init();
     }
 
     switch (net_cards_conf[net_card_current].net_type) {
@@ -437,10 +525,8 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
     }
 
     if (!card->host_drv.priv) {
-        thread_close_mutex(card->tx_mutex);
-        thread_close_mutex(card->rx_mutex);
         for (int i = 0; i < 3; i++) {
-            network_queue_clear(&card->queues[i]);
+            network_queue_clear(card->queues[i]);
         }
 
         free(card->queued_pkt.data);
@@ -451,6 +537,9 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
     timer_add(&card->timer, network_rx_queue, card, 0);
     timer_on_auto(&card->timer, 100);
 
+    network_stats_reset(card->card_num);
+    atomic_store_explicit(&net_card_stats[card->card_num].attached, 1, memory_order_release);
+
     return card;
 }
 
@@ -460,10 +549,10 @@ netcard_close(netcard_t *card)
     timer_stop(&card->timer);
     card->host_drv.close(card->host_drv.priv);
 
-    thread_close_mutex(card->tx_mutex);
-    thread_close_mutex(card->rx_mutex);
+    atomic_store_explicit(&net_card_stats[card->card_num].attached, 0, memory_order_release);
+
     for (int i = 0; i < 3; i++) {
-        network_queue_clear(&card->queues[i]);
+        network_queue_clear(card->queues[i]);
     }
 
     free(card->queued_pkt.data);
@@ -515,61 +604,66 @@ network_reset(void)
 void
 network_tx(netcard_t *card, uint8_t *bufp, int len)
 {
-    network_queue_put(&card->queues[NET_QUEUE_TX_VM], bufp, len);
+    if (network_queue_put(card->queues[NET_QUEUE_TX_VM], bufp, len))
+        network_stats_inc(&net_card_stats[card->card_num].tx_packets);
+    else
+        network_stats_inc(&net_card_stats[card->card_num].tx_drops);
 }
 
 int
 network_tx_pop(netcard_t *card, netpkt_t *out_pkt)
 {
-    int ret = 0;
-
-    thread_wait_mutex(card->tx_mutex);
-    ret = network_queue_get_swap(&card->queues[NET_QUEUE_TX_HOST], out_pkt);
-    thread_release_mutex(card->tx_mutex);
-
-    return ret;
+    return network_queue_get_swapv(card->queues[NET_QUEUE_TX_HOST], out_pkt, 1);
 }
 
 int
 network_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size)
 {
-    int pkt_count = 0;
+    return network_queue_get_swapv(card->queues[NET_QUEUE_TX_HOST], pkt_vec, vec_size);
+}
 
-    netqueue_t *queue = &card->queues[NET_QUEUE_TX_HOST];
-    thread_wait_mutex(card->tx_mutex);
-    for (int i = 0; i < vec_size; i++) {
-        if (!network_queue_get_swap(queue, pkt_vec))
-            break;
-        pkt_count++;
-        pkt_vec++;
+static int
+network_rx_count(netcard_t *card, uint32_t depth)
+{
+    if (!depth) {
+        network_stats_inc(&net_card_stats[card->card_num].rx_drops);
+        return 0;
     }
-    thread_release_mutex(card->tx_mutex);
 
-    return pkt_count;
+    network_stats_inc(&net_card_stats[card->card_num].rx_packets);
+    network_stats_high_water(&net_card_stats[card->card_num].rx_high_water, depth);
+
+    return 1;
 }
 
 int
 network_rx_put(netcard_t *card, uint8_t *bufp, int len)
 {
-    int ret = 0;
-
-    thread_wait_mutex(card->rx_mutex);
-    ret = network_queue_put(&card->queues[NET_QUEUE_RX], bufp, len);
-    thread_release_mutex(card->rx_mutex);
-
-    return ret;
+    return network_rx_count(card, network_queue_put(card->queues[NET_QUEUE_RX], bufp, len));
 }
 
 int
 network_rx_put_pkt(netcard_t *card, netpkt_t *pkt)
 {
-    int ret = 0;
+    return network_rx_count(card, network_queue_put_swap(card->queues[NET_QUEUE_RX], pkt));
+}
 
-    thread_wait_mutex(card->rx_mutex);
-    ret = network_queue_put_swap(&card->queues[NET_QUEUE_RX], pkt);
-    thread_release_mutex(card->rx_mutex);
+/* Statistics for the status bar; each counter is read atomically, but
+   they are not read as a set, so they may be slightly out of step. */
+int
+network_card_get_stats(int id, netcard_stats_t *stats)
+{
+    if ((id < 0) || (id >= NET_CARD_MAX) ||
+        !atomic_load_explicit(&net_card_stats[id].attached, memory_order_acquire))
+        return 0;
 
-    return ret;
+    stats->rx_packets    = atomic_load_explicit(&net_card_stats[id].rx_packets, memory_order_relaxed);
+    stats->rx_drops      = atomic_load_explicit(&net_card_stats[id].rx_drops, memory_order_relaxed);
+    stats->tx_packets    = atomic_load_explicit(&net_card_stats[id].tx_packets, memory_order_relaxed);
+    stats->tx_drops      = atomic_load_explicit(&net_card_stats[id].tx_drops, memory_order_relaxed);
+    stats->rx_high_water = atomic_load_explicit(&net_card_stats[id].rx_high_water, memory_order_relaxed);
+    stats->tx_high_water = atomic_load_explicit(&net_card_stats[id].tx_high_water, memory_order_relaxed);
+    return 1;
 }
 
 void
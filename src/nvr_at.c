@@ -219,6 +219,7 @@
  *   USA.
  */
 #include <inttypes.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -237,6 +238,7 @@
 #include <86box/rom.h>
 #include <86box/device.h>
 #include <86box/nvr.h>
+#include <86box/savestate.h>
 
 /* RTC registers and bit definitions. */
 #define RTC_SECONDS        0
@@ -960,6 +962,26 @@ nvr_at_reset(void *priv)
     nvr->regs[RTC_REGC] &= ~(REGC_PF | REGC_AF | REGC_UF | REGC_IRQF);
 }
 
+static void
+nvr_at_savestate(savestate_t *st, void *priv)
+{
+    nvr_t   *nvr   = (nvr_t *) priv;
+    local_t *local = (local_t *) nvr->data;
+
+    savestate_data(st, nvr->regs, nvr->size);
+    savestate_var(st, nvr->onesec_cnt);
+    savestate_timer(st, &nvr->onesec_time);
+
+    /* Everything up to the lock pointer, which is set up on init. */
+    savestate_data(st, local, offsetof(local_t, lock));
+    savestate_var(st, local->count);
+    savestate_var(st, local->state);
+    savestate_var(st, local->ecount);
+    savestate_var(st, local->rtc_time);
+    savestate_timer(st, &local->update_timer);
+    savestate_timer(st, &local->rtc_timer);
+}
+
 static void *
 nvr_at_init(const device_t *info)
 {
@@ -1127,7 +1149,8 @@ const device_t at_nvr_old_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
 
 const device_t at_nvr_device = {
@@ -1141,7 +1164,8 @@ const device_t at_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
 
 const device_t ps_nvr_device = {
@@ -1155,7 +1179,8 @@ const device_t ps_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
 
 const device_t amstrad_nvr_device = {
@@ -1169,7 +1194,8 @@ const device_t amstrad_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
 
 const device_t ibmat_nvr_device = {
@@ -1183,7 +1209,8 @@ const device_t ibmat_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
 
 const device_t piix4_nvr_device = {
@@ -1197,7 +1224,8 @@ const device_t piix4_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
 
 const device_t ps_no_nmi_nvr_device = {
@@ -1211,7 +1239,8 @@ const device_t ps_no_nmi_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
 
 const device_t amstrad_no_nmi_nvr_device = {
@@ -1225,7 +1254,8 @@ const device_t amstrad_no_nmi_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
 
 const device_t ami_1992_nvr_device = {
@@ -1239,7 +1269,8 @@ const device_t ami_1992_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
 
 const device_t ami_1994_nvr_device = {
@@ -1253,7 +1284,8 @@ const device_t ami_1994_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
 
 const device_t ami_1995_nvr_device = {
@@ -1267,7 +1299,8 @@ const device_t ami_1995_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
 
 const device_t via_nvr_device = {
@@ -1281,7 +1314,8 @@ const device_t via_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
 
 const device_t p6rp4_nvr_device = {
@@ -1295,7 +1329,8 @@ const device_t p6rp4_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
 
 const device_t amstrad_megapc_nvr_device = {
@@ -1309,7 +1344,8 @@ const device_t amstrad_megapc_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
 
 const device_t elt_nvr_device = {
@@ -1323,5 +1359,6 @@ const device_t elt_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nvr_at_savestate
 };
@@ -34,6 +34,7 @@
 #include <86box/dma.h>
 #include <86box/pci.h>
 #include <86box/keyboard.h>
+#include <86box/savestate.h>
 
 typedef struct {
     uint8_t bus, id, type;
@@ -1043,6 +1044,41 @@ pci_init(int type)
     pic_set_pci_flag(1);
 }
 
+/* The slots and the bus numbers are set up again by the machine and the
+   bridges, and the IRQ steering is programmed again by the chipset. */
+void
+pci_savestate(savestate_t *st, void *priv)
+{
+    uint8_t pmc = pci_pmc;
+
+    if (!machine_has_bus(machine, MACHINE_BUS_PCI))
+        return;
+
+    savestate_var(st, pmc);
+    savestate_var(st, pci_irqs);
+    savestate_var(st, pci_irq_level);
+    savestate_var(st, pci_irq_hold);
+    savestate_var(st, pci_mirqs);
+    savestate_var(st, pci_index);
+    savestate_var(st, pci_func);
+    savestate_var(st, pci_card);
+    savestate_var(st, pci_bus);
+    savestate_var(st, pci_enable);
+    savestate_var(st, pci_key);
+    savestate_var(st, trc_reg);
+
+    if (savestate_loading(st)) {
+        if (pci_switch)
+            pci_set_pmc(pmc);
+
+        if (pci_key && !pci_pmc) {
+            io_sethandler(pci_base, pci_size,
+                          pci_type2_read, NULL, NULL,
+                          pci_type2_write, NULL, NULL, NULL);
+        }
+    }
+}
+
 uint8_t
 pci_register_bus(void)
 {
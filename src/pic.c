@@ -18,6 +18,7 @@
  *          Copyright 2016-2020 Miran Grca.
  */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -37,6 +38,7 @@
 #include <86box/apm.h>
 #include <86box/nvr.h>
 #include <86box/acpi.h>
+#include <86box/savestate.h>
 
 enum {
     STATE_NONE = 0,
@@ -543,6 +545,25 @@ pic2_init(void)
     pic.slaves[2] = &pic2;
 }
 
+void
+pic_savestate(savestate_t *st, void *priv)
+{
+    /* Everything up to the slave pointers, which are set up on init. */
+    savestate_data(st, &pic, offsetof(pic_t, slaves));
+    savestate_data(st, &pic2, offsetof(pic_t, slaves));
+
+    savestate_var(st, shadow);
+    savestate_var(st, elcr_enabled);
+    savestate_var(st, latched);
+    savestate_var(st, pic_pci);
+    savestate_var(st, smi_irq_mask);
+    savestate_var(st, smi_irq_status);
+    savestate_timer(st, &pic_timer);
+
+    if (savestate_loading(st))
+        update_pending();
+}
+
 void
 picint_common(uint16_t num, int level, int set)
 {
@@ -18,6 +18,7 @@
 #include <inttypes.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -41,6 +42,7 @@
 #include <86box/sound.h>
 #include <86box/snd_speaker.h>
 #include <86box/video.h>
+#include <86box/savestate.h>
 
 pit_intf_t pit_devs[2];
 
@@ -786,6 +788,18 @@ pit_close(void *priv)
         free(dev);
 }
 
+static void
+pit_savestate(savestate_t *st, void *priv)
+{
+    pit_t *dev = (pit_t *) priv;
+
+    for (int i = 0; i < 3; i++)
+        savestate_data(st, &dev->counters[i], offsetof(ctr_t, load_func));
+
+    savestate_var(st, dev->ctrl);
+    savestate_timer(st, &dev->callback_timer);
+}
+
 static void *
 pit_init(const device_t *info)
 {
@@ -818,7 +832,8 @@ const device_t i8253_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pit_savestate
 };
 
 const device_t i8254_device = {
@@ -832,7 +847,8 @@ const device_t i8254_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pit_savestate
 };
 
 const device_t i8254_sec_device = {
@@ -846,7 +862,8 @@ const device_t i8254_sec_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pit_savestate
 };
 
 const device_t i8254_ext_io_device = {
@@ -860,7 +877,8 @@ const device_t i8254_ext_io_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pit_savestate
 };
 
 const device_t i8254_ps2_device = {
@@ -874,7 +892,8 @@ const device_t i8254_ps2_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pit_savestate
 };
 
 pit_t *
@@ -18,6 +18,7 @@
 #include <inttypes.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -41,6 +42,7 @@
 #include <86box/sound.h>
 #include <86box/snd_speaker.h>
 #include <86box/video.h>
+#include <86box/savestate.h>
 
 #define PIT_PS2          16  /* The PIT is the PS/2's second PIT. */
 #define PIT_EXT_IO       32  /* The PIT has externally specified port I/O. */
@@ -603,6 +605,19 @@ pitf_close(void *priv)
         free(dev);
 }
 
+static void
+pitf_savestate(savestate_t *st, void *priv)
+{
+    pitf_t *dev = (pitf_t *) priv;
+
+    for (int i = 0; i < 3; i++) {
+        savestate_data(st, &dev->counters[i], offsetof(ctrf_t, timer));
+        savestate_timer(st, &dev->counters[i].timer);
+    }
+
+    savestate_var(st, dev->ctrl);
+}
+
 static void *
 pitf_init(const device_t *info)
 {
@@ -637,7 +652,8 @@ const device_t i8253_fast_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pitf_savestate
 };
 
 const device_t i8254_fast_device = {
@@ -651,7 +667,8 @@ const device_t i8254_fast_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pitf_savestate
 };
 
 const device_t i8254_sec_fast_device = {
@@ -665,7 +682,8 @@ const device_t i8254_sec_fast_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pitf_savestate
 };
 
 const device_t i8254_ext_io_fast_device = {
@@ -679,7 +697,8 @@ const device_t i8254_ext_io_fast_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pitf_savestate
 };
 
 const device_t i8254_ps2_fast_device = {
@@ -693,7 +712,8 @@ const device_t i8254_ps2_fast_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = pitf_savestate
 };
 
 const pit_intf_t pit_fast_intf = {
@@ -36,6 +36,7 @@
 #include <86box/ppi.h>
 #include <86box/video.h>
 #include <86box/port_6x.h>
+#include <86box/savestate.h>
 
 #define PS2_REFRESH_TIME (16 * TIMER_USEC)
 
@@ -150,6 +151,22 @@ port_6x_refresh(void *priv)
     timer_advance_u64(&dev->refresh_timer, PS2_REFRESH_TIME);
 }
 
+static void
+port_6x_savestate(savestate_t *st, void *priv)
+{
+    port_6x_t *dev = (port_6x_t *) priv;
+
+    savestate_var(st, ppi);
+    savestate_var(st, ppispeakon);
+    savestate_var(st, speaker_gated);
+    savestate_var(st, speaker_enable);
+    savestate_var(st, was_speaker_enable);
+    savestate_var(st, dev->refresh);
+
+    if (dev->flags & PORT_6X_EXT_REF)
+        savestate_timer(st, &dev->refresh_timer);
+}
+
 static void
 port_6x_close(void *priv)
 {
@@ -200,7 +217,8 @@ const device_t port_6x_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = port_6x_savestate
 };
 
 const device_t port_6x_xi8088_device = {
@@ -214,7 +232,8 @@ const device_t port_6x_xi8088_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = port_6x_savestate
 };
 
 const device_t port_6x_ps2_device = {
@@ -228,7 +247,8 @@ const device_t port_6x_ps2_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = port_6x_savestate
 };
 
 const device_t port_6x_olivetti_device = {
@@ -242,5 +262,6 @@ const device_t port_6x_olivetti_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = port_6x_savestate
 };
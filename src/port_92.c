@@ -29,6 +29,7 @@
 #include <86box/mem.h>
 #include <86box/pit.h>
 #include <86box/port_92.h>
+#include <86box/savestate.h>
 
 #define PORT_92_INV   1
 #define PORT_92_WORD  2
@@ -166,6 +167,18 @@ port_92_remove(void *priv)
                          port_92_readb, NULL, NULL, port_92_writeb, NULL, NULL, dev);
 }
 
+static void
+port_92_savestate(savestate_t *st, void *priv)
+{
+    port_92_t *dev = (port_92_t *) priv;
+
+    savestate_var(st, dev->reg);
+    savestate_var(st, dev->flags);
+    savestate_var(st, dev->pulse_period);
+    savestate_var(st, cpu_alt_reset);
+    savestate_timer(st, &dev->pulse_timer);
+}
+
 static void
 port_92_close(void *priv)
 {
@@ -214,7 +227,8 @@ const device_t port_92_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = port_92_savestate
 };
 
 const device_t port_92_inv_device = {
@@ -228,7 +242,8 @@ const device_t port_92_inv_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = port_92_savestate
 };
 
 const device_t port_92_word_device = {
@@ -242,7 +257,8 @@ const device_t port_92_word_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = port_92_savestate
 };
 
 const device_t port_92_pci_device = {
@@ -256,5 +272,6 @@ const device_t port_92_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = port_92_savestate
 };
@@ -392,6 +392,13 @@ MachineStatus::refreshIcons()
     for (size_t i = 0; i < NET_CARD_MAX; i++) {
         d->net[i].setActive(machine_status.net[i].active);
         d->net[i].setEmpty(machine_status.net[i].empty);
+
+        netcard_stats_t stats;
+        if (d->net[i].label && network_card_get_stats(i, &stats)) {
+            d->net[i].label->setToolTip(QString("%1\n").arg(MediaMenu::ptr->netMenus[i]->title()) +
+                                        tr("Received: %1 packets, %2 dropped, queue peak %3").arg(stats.rx_packets).arg(stats.rx_drops).arg(stats.rx_high_water) + "\n" +
+                                        tr("Sent: %1 packets, %2 dropped, queue peak %3").arg(stats.tx_packets).arg(stats.tx_drops).arg(stats.tx_high_water));
+        }
     }
 
     for (int i = 0; i < 2; ++i) {
@@ -426,10 +426,12 @@ OpenGLRenderer::getBuffers()
 }
 
 void
-OpenGLRenderer::onBlit(int buf_idx, int x, int y, int w, int h)
+OpenGLRenderer::onBlit(int buf_idx, int x, int y, int w, int h, int dirty_y1, int dirty_y2)
 {
-    if (notReady())
+    if (notReady()) {
+        textureStale = true;
         return;
+    }
 
     context->makeCurrent(this);
 
@@ -448,14 +450,25 @@ OpenGLRenderer::onBlit(int buf_idx, int x, int y, int w, int h)
         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
         glTexImage2D(GL_TEXTURE_2D, 0, (GLenum) QOpenGLTexture::RGBA8_UNorm, source.width(), source.height(), 0, (GLenum) QOpenGLTexture::BGRA, (GLenum) QOpenGLTexture::UInt32_RGBA8_Rev, NULL);
         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBufferID);
+
+        textureStale = true;
     }
 
-    if (!hasBufferStorage)
-        glBufferSubData(GL_PIXEL_UNPACK_BUFFER, BUFFERBYTES * buf_idx, h * ROW_LENGTH * sizeof(uint32_t) + (y * ROW_LENGTH * sizeof(uint32_t)), (uint8_t *) unpackBuffer + BUFFERBYTES * buf_idx);
+    /* Only upload the scanlines that changed since the previous blit. */
+    if (textureStale) {
+        dirty_y1     = y;
+        dirty_y2     = y + h;
+        textureStale = false;
+    }
+
+    if (dirty_y1 < dirty_y2) {
+        if (!hasBufferStorage)
+            glBufferSubData(GL_PIXEL_UNPACK_BUFFER, BUFFERBYTES * buf_idx + dirty_y1 * ROW_LENGTH * sizeof(uint32_t), (dirty_y2 - dirty_y1) * ROW_LENGTH * sizeof(uint32_t), (uint8_t *) unpackBuffer + BUFFERBYTES * buf_idx + dirty_y1 * ROW_LENGTH * sizeof(uint32_t));
 
-    glPixelStorei(GL_UNPACK_SKIP_PIXELS, BUFFERPIXELS * buf_idx + y * ROW_LENGTH + x);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, ROW_LENGTH);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, (GLenum) QOpenGLTexture::BGRA, (GLenum) QOpenGLTexture::UInt32_RGBA8_Rev, NULL);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, BUFFERPIXELS * buf_idx + dirty_y1 * ROW_LENGTH + x);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, ROW_LENGTH);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, dirty_y1 - y, w, dirty_y2 - dirty_y1, (GLenum) QOpenGLTexture::BGRA, (GLenum) QOpenGLTexture::UInt32_RGBA8_Rev, NULL);
+    }
 
     /* TODO: check if fence sync is implementable here and still has any benefit. */
     glFinish();
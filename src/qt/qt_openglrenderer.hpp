@@ -62,7 +62,7 @@ signals:
     void errorInitializing();
 
 public slots:
-    void onBlit(int buf_idx, int x, int y, int w, int h);
+    void onBlit(int buf_idx, int x, int y, int w, int h, int dirty_y1, int dirty_y2);
 
 protected:
     void exposeEvent(QExposeEvent *event) override;
@@ -84,6 +84,8 @@ private:
 
     bool isInitialized = false;
     bool isFinalized   = false;
+    /* The texture is missing rows that were not uploaded, so the next blit uploads all of them. */
+    bool textureStale  = true;
 
     GLuint unpackBufferID = 0;
     GLuint vertexArrayID  = 0;
@@ -36,6 +36,7 @@
 
 #include "evdev_mouse.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <stdexcept>
 
@@ -340,7 +341,7 @@ RendererStack::createRenderer(Renderer renderer)
                 connect(this, &RendererStack::blitToRenderer, hw, &OpenGLRenderer::onBlit, Qt::QueuedConnection);
                 connect(hw, &OpenGLRenderer::initialized, [=]() {
                     /* Buffers are available only after initialization. */
-                    imagebufs = rendererWindow->getBuffers();
+                    setBuffers(rendererWindow->getBuffers());
                     endblit();
                     emit rendererChanged();
                 });
@@ -393,7 +394,7 @@ RendererStack::createRenderer(Renderer renderer)
                 connect(this, &RendererStack::blitToRenderer, hw, &VulkanWindowRenderer::onBlit, Qt::QueuedConnection);
                 connect(hw, &VulkanWindowRenderer::rendererInitialized, [=]() {
                     /* Buffers are available only after initialization. */
-                    imagebufs = rendererWindow->getBuffers();
+                    setBuffers(rendererWindow->getBuffers());
                     endblit();
                     emit rendererChanged();
                 });
@@ -429,12 +430,20 @@ RendererStack::createRenderer(Renderer renderer)
     }
 
     if (renderer != Renderer::OpenGL3 && renderer != Renderer::Vulkan && renderer != Renderer::Direct3D9) {
-        imagebufs = rendererWindow->getBuffers();
+        setBuffers(rendererWindow->getBuffers());
         endblit();
         emit rendererChanged();
     }
 }
 
+void
+RendererStack::setBuffers(std::vector<std::tuple<uint8_t *, std::atomic_flag *>> buffers)
+{
+    imagebufs = std::move(buffers);
+    /* New buffers hold nothing yet, so they have to be filled completely. */
+    bufDirty.assign(imagebufs.size(), { 0, 2048 });
+}
+
 void
 RendererStack::blitDummy(int x, int y, int w, int h)
 {
@@ -468,16 +477,33 @@ RendererStack::blitCommon(int x, int y, int w, int h)
     sw = this->w = w;
     sh = this->h       = h;
     uint8_t *imagebits = std::get<uint8_t *>(imagebufs[currentBuf]);
-    for (int y1 = y; y1 < (y + h); y1++) {
+
+    /* Only the scanlines changed since this buffer was last filled are copied. */
+    int dirty_y1;
+    int dirty_y2;
+    if (video_blit_get_dirty_monitor(m_monitor_index, &dirty_y1, &dirty_y2)) {
+        for (auto &dirty : bufDirty) {
+            if (dirty.first >= dirty.second)
+                dirty = { dirty_y1, dirty_y2 };
+            else
+                dirty = { std::min(dirty.first, dirty_y1), std::max(dirty.second, dirty_y2) };
+        }
+    }
+    int copy_y1 = std::max(bufDirty[currentBuf].first, y);
+    int copy_y2 = std::min(bufDirty[currentBuf].second, y + h);
+    for (int y1 = copy_y1; y1 < copy_y2; y1++) {
         auto scanline = imagebits + (y1 * rendererWindow->getBytesPerRow()) + (x * 4);
         video_copy(scanline, &(monitors[m_monitor_index].target_buffer->line[y1][x]), w * 4);
     }
+    bufDirty[currentBuf] = { 0, 0 };
+    if (dirty_y1 >= dirty_y2)
+        dirty_y1 = dirty_y2 = y;
 
     if (monitors[m_monitor_index].mon_screenshots) {
         video_screenshot_monitor((uint32_t *) imagebits, x, y, 2048, m_monitor_index);
     }
     video_blit_complete_monitor(m_monitor_index);
-    emit blitToRenderer(currentBuf, sx, sy, sw, sh);
+    emit blitToRenderer(currentBuf, sx, sy, sw, sh, dirty_y1, dirty_y2);
     currentBuf = (currentBuf + 1) % imagebufs.size();
 }
 
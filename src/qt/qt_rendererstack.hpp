@@ -81,7 +81,7 @@ public:
     void (*mouse_exit_func)()                   = nullptr;
 
 signals:
-    void blitToRenderer(int buf_idx, int x, int y, int w, int h);
+    void blitToRenderer(int buf_idx, int x, int y, int w, int h, int dirty_y1, int dirty_y2);
     void blit(int x, int y, int w, int h);
     void rendererChanged();
 
@@ -93,6 +93,7 @@ public slots:
 
 private:
     void createRenderer(Renderer renderer);
+    void setBuffers(std::vector<std::tuple<uint8_t *, std::atomic_flag *>> buffers);
 
     Ui::RendererStack *ui;
 
@@ -105,6 +106,8 @@ private:
     Renderer current_vid_api = Renderer::None;
 
     std::vector<std::tuple<uint8_t *, std::atomic_flag *>> imagebufs;
+    /* Scanlines of each buffer that are older than the emulated screen. */
+    std::vector<std::pair<int, int>>                       bufDirty;
 
     RendererCommon          *rendererWindow { nullptr };
     std::unique_ptr<QWidget> current;
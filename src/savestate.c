@@ -0,0 +1,549 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Machine save states.
+ *
+ *          A state file is written and read strictly in order, so it can
+ *          be piped through a compressor. It starts with a header (all
+ *          values in host byte order):
+ *
+ *          0x00  "86BOXSAV" signature
+ *          0x08  format version (1)
+ *          0x0C  size of the CPU state, to catch builds with other options
+ *          0x10  emulator version string (32 bytes)
+ *          0x30  machine internal name (32 bytes)
+ *          0x50  memory size in kB
+ *
+ *          followed by the sections. Each section is a 32 byte name and a
+ *          number of chunks, each made up of a 32-bit length and the data,
+ *          with a zero length ending the section. The sections are "cpu",
+ *          "mem", "pic", "dma", "pci", "ide" and "cdrom", then one for every
+ *          device in the order the devices were added, and finally "end".
+ *
+ *          A state can only be restored into the configuration it was
+ *          saved from, and is only saved if every device in it has a
+ *          state handler. The machine is hard reset before restoring.
+ */
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/version.h>
+#include "cpu.h"
+#include <86box/timer.h>
+#include <86box/mem.h>
+#include <86box/device.h>
+#include <86box/machine.h>
+#include <86box/plat.h>
+#include <86box/ui.h>
+#include <86box/savestate.h>
+
+#define SAVESTATE_MAGIC    "86BOXSAV"
+#define SAVESTATE_VERSION  2
+#define SAVESTATE_BUF_SIZE 65536
+#define SAVESTATE_PAGE     4096
+#define SAVESTATE_GROUP    64 /* Pages per zero page bitmap. */
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t cpu_state_size;
+    char     emu_version[32];
+    char     machine[32];
+    uint32_t mem_size;
+} savestate_header_t;
+
+struct savestate_t {
+    FILE *fp;
+    int   loading, error;
+
+    /* Small writes are gathered into a chunk here. When loading, this is
+       used to skip the parts of a section that are not read back. */
+    uint8_t *buf;
+    uint32_t buf_pos;
+
+    uint32_t chunk_left;
+    int      section_end;
+};
+
+typedef struct {
+    int  load;
+    char fn[1024];
+} savestate_req_t;
+
+volatile int savestate_pending = 0;
+
+/* Handed over from the thread asking for the state to the emulation
+   thread, which frees it. */
+static _Atomic(savestate_req_t *) savestate_req = NULL;
+
+static const uint8_t savestate_zero[SAVESTATE_PAGE] = { 0 };
+
+#ifdef ENABLE_SAVESTATE_LOG
+int savestate_do_log = ENABLE_SAVESTATE_LOG;
+
+static void
+savestate_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (savestate_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define savestate_log(fmt, ...)
+#endif
+
+static void
+savestate_error(savestate_t *st, const char *msg)
+{
+    if (!st->error)
+        pclog("SAVESTATE: %s\n", msg);
+
+    st->error = 1;
+}
+
+static void
+savestate_write(savestate_t *st, const void *data, size_t len)
+{
+    if (!st->error && (fwrite(data, 1, len, st->fp) != len))
+        savestate_error(st, "write error");
+}
+
+static void
+savestate_read(savestate_t *st, void *data, size_t len)
+{
+    if (!st->error && (fread(data, 1, len, st->fp) != len))
+        savestate_error(st, "unexpected end of file");
+}
+
+static void
+savestate_write_chunk(savestate_t *st, const void *data, uint32_t len)
+{
+    savestate_write(st, &len, sizeof(len));
+    savestate_write(st, data, len);
+}
+
+static void
+savestate_flush(savestate_t *st)
+{
+    if (st->buf_pos) {
+        savestate_write_chunk(st, st->buf, st->buf_pos);
+        st->buf_pos = 0;
+    }
+}
+
+/* Move on to the next chunk of the section being loaded, returns 0 at the
+   end of the section. */
+static int
+savestate_next_chunk(savestate_t *st)
+{
+    if (st->section_end || st->error)
+        return 0;
+
+    savestate_read(st, &st->chunk_left, sizeof(st->chunk_left));
+    if (st->error || !st->chunk_left) {
+        st->chunk_left  = 0;
+        st->section_end = 1;
+        return 0;
+    }
+
+    return 1;
+}
+
+int
+savestate_loading(savestate_t *st)
+{
+    return st->loading;
+}
+
+void
+savestate_data(savestate_t *st, void *data, size_t len)
+{
+    uint8_t *p = (uint8_t *) data;
+    uint32_t n;
+
+    if (st->error)
+        return;
+
+    if (st->loading) {
+        while (len) {
+            if (!st->chunk_left && !savestate_next_chunk(st)) {
+                savestate_error(st, "section is shorter than expected");
+                return;
+            }
+
+            n = (len < st->chunk_left) ? (uint32_t) len : st->chunk_left;
+            savestate_read(st, p, n);
+            st->chunk_left -= n;
+            p += n;
+            len -= n;
+        }
+    } else {
+        if (len > (SAVESTATE_BUF_SIZE - st->buf_pos)) {
+            savestate_flush(st);
+
+            /* Large blocks go out as a chunk of their own. */
+            if (len >= SAVESTATE_BUF_SIZE) {
+                savestate_write_chunk(st, p, (uint32_t) len);
+                return;
+            }
+        }
+
+        memcpy(&st->buf[st->buf_pos], p, len);
+        st->buf_pos += len;
+    }
+}
+
+void
+savestate_block(savestate_t *st, void *data, size_t len)
+{
+    uint8_t *p    = (uint8_t *) data;
+    uint64_t size = len;
+    uint64_t bitmap;
+    size_t   pos, page, n;
+    int      i;
+
+    savestate_var(st, size);
+    if (size != len) {
+        savestate_error(st, "memory block size mismatch");
+        return;
+    }
+
+    for (pos = 0; pos < len; pos += (SAVESTATE_GROUP * SAVESTATE_PAGE)) {
+        bitmap = 0;
+        if (!st->loading) {
+            for (i = 0; i < SAVESTATE_GROUP; i++) {
+                page = pos + (i * SAVESTATE_PAGE);
+                if (page >= len)
+                    break;
+                n = len - page;
+                if (n > SAVESTATE_PAGE)
+                    n = SAVESTATE_PAGE;
+                if (memcmp(&p[page], savestate_zero, n))
+                    bitmap |= (1ULL << i);
+            }
+        }
+
+        savestate_var(st, bitmap);
+
+        for (i = 0; i < SAVESTATE_GROUP; i++) {
+            page = pos + (i * SAVESTATE_PAGE);
+            if (page >= len)
+                break;
+            n = len - page;
+            if (n > SAVESTATE_PAGE)
+                n = SAVESTATE_PAGE;
+            if (bitmap & (1ULL << i))
+                savestate_data(st, &p[page], n);
+            else if (st->loading)
+                memset(&p[page], 0x00, n);
+        }
+
+        if (st->error)
+            return;
+    }
+}
+
+void
+savestate_timer(savestate_t *st, pc_timer_t *timer)
+{
+    uint64_t ts     = timer->ts.ts64;
+    double   period = timer->period;
+    int      flags  = timer->flags & (TIMER_ENABLED | TIMER_SPLIT);
+
+    savestate_var(st, ts);
+    savestate_var(st, period);
+    savestate_var(st, flags);
+
+    if (st->loading && !st->error) {
+        timer_disable(timer);
+
+        timer->ts.ts64 = ts;
+        timer->period  = period;
+        timer->flags   = (timer->flags & ~TIMER_SPLIT) | (flags & TIMER_SPLIT);
+
+        if (flags & TIMER_ENABLED)
+            timer_enable(timer);
+    }
+}
+
+void
+savestate_mapping(savestate_t *st, mem_mapping_t *map)
+{
+    int      enable = map->enable;
+    uint32_t base   = map->base;
+    uint32_t size   = map->size;
+
+    savestate_var(st, enable);
+    savestate_var(st, base);
+    savestate_var(st, size);
+
+    if (st->loading && !st->error) {
+        if (enable)
+            mem_mapping_set_addr(map, base, size);
+        else
+            mem_mapping_disable(map);
+    }
+}
+
+void
+savestate_section(savestate_t *st, const char *name,
+                  void (*func)(savestate_t *st, void *priv), void *priv)
+{
+    char     sname[32];
+    uint32_t n;
+
+    if (st->error)
+        return;
+
+    memset(sname, 0x00, sizeof(sname));
+
+    if (st->loading) {
+        savestate_read(st, sname, sizeof(sname));
+        sname[sizeof(sname) - 1] = '\0';
+        if (!st->error && strncmp(sname, name, sizeof(sname) - 1)) {
+            pclog("SAVESTATE: expected section \"%s\", found \"%s\"\n", name, sname);
+            st->error = 1;
+            return;
+        }
+
+        st->chunk_left  = 0;
+        st->section_end = 0;
+
+        if (func != NULL)
+            func(st, priv);
+
+        /* Skip whatever the handler did not read back. */
+        do {
+            while (st->chunk_left && !st->error) {
+                n = (st->chunk_left < SAVESTATE_BUF_SIZE) ? st->chunk_left : SAVESTATE_BUF_SIZE;
+                savestate_read(st, st->buf, n);
+                st->chunk_left -= n;
+            }
+        } while (savestate_next_chunk(st));
+    } else {
+        strncpy(sname, name, sizeof(sname) - 1);
+        savestate_write(st, sname, sizeof(sname));
+
+        if (func != NULL)
+            func(st, priv);
+
+        savestate_flush(st);
+
+        n = 0;
+        savestate_write(st, &n, sizeof(n));
+    }
+
+    savestate_log("SAVESTATE: section \"%s\" done\n", name);
+}
+
+static void
+savestate_header(savestate_header_t *hdr)
+{
+    memset(hdr, 0x00, sizeof(savestate_header_t));
+
+    memcpy(hdr->magic, SAVESTATE_MAGIC, sizeof(hdr->magic));
+    hdr->version        = SAVESTATE_VERSION;
+    hdr->cpu_state_size = sizeof(cpu_state_t);
+    strncpy(hdr->emu_version, EMU_VERSION_FULL, sizeof(hdr->emu_version) - 1);
+    strncpy(hdr->machine, machine_get_internal_name(), sizeof(hdr->machine) - 1);
+    hdr->mem_size = mem_size;
+}
+
+static void
+savestate_machine(savestate_t *st)
+{
+    savestate_section(st, "cpu", cpu_savestate, NULL);
+    savestate_section(st, "mem", mem_savestate, NULL);
+    savestate_section(st, "pic", pic_savestate, NULL);
+    savestate_section(st, "dma", dma_savestate, NULL);
+    savestate_section(st, "pci", pci_savestate, NULL);
+    savestate_section(st, "ide", ide_savestate, NULL);
+    savestate_section(st, "cdrom", scsi_cdrom_savestate, NULL);
+
+    device_savestate_all(st);
+
+    savestate_section(st, "end", NULL, NULL);
+}
+
+static savestate_t *
+savestate_open(const char *fn, int loading)
+{
+    savestate_t *st;
+
+    st = (savestate_t *) calloc(1, sizeof(savestate_t));
+    if (st == NULL) {
+        pclog("SAVESTATE: out of memory\n");
+        return NULL;
+    }
+
+    st->buf = (uint8_t *) malloc(SAVESTATE_BUF_SIZE);
+    if (st->buf == NULL) {
+        pclog("SAVESTATE: out of memory\n");
+        free(st);
+        return NULL;
+    }
+
+    st->fp = plat_fopen(fn, loading ? "rb" : "wb");
+    if (st->fp == NULL) {
+        pclog("SAVESTATE: unable to open \"%s\"\n", fn);
+        free(st->buf);
+        free(st);
+        return NULL;
+    }
+
+    st->loading = loading;
+
+    return st;
+}
+
+static int
+savestate_close(savestate_t *st)
+{
+    int ret = st->error ? -1 : 0;
+
+    if (fclose(st->fp) && !st->loading)
+        ret = -1;
+
+    free(st->buf);
+    free(st);
+
+    return ret;
+}
+
+int
+savestate_save(const char *fn)
+{
+    savestate_header_t hdr;
+    savestate_t       *st;
+    const device_t    *dev;
+    char               temp[512];
+
+    /* A device left out would come back as after a reset, which the
+       machine would not be expecting. */
+    dev = device_savestate_missing();
+    if (dev != NULL) {
+        snprintf(temp, sizeof(temp), "The machine state cannot be saved, because the %s does not support save states yet.", dev->name);
+        pclog("SAVESTATE: %s\n", temp);
+        ui_msgbox(MBX_ERROR | MBX_ANSI, temp);
+        return -1;
+    }
+
+    st = savestate_open(fn, 0);
+    if (st == NULL)
+        return -1;
+
+    savestate_header(&hdr);
+    savestate_write(st, &hdr, sizeof(hdr));
+
+    savestate_machine(st);
+
+    if (savestate_close(st)) {
+        pclog("SAVESTATE: failed to save \"%s\"\n", fn);
+        plat_remove((char *) fn);
+        return -1;
+    }
+
+    savestate_log("SAVESTATE: saved \"%s\"\n", fn);
+
+    return 0;
+}
+
+int
+savestate_load(const char *fn)
+{
+    savestate_header_t hdr, cur;
+    savestate_t       *st;
+
+    st = savestate_open(fn, 1);
+    if (st == NULL)
+        return -1;
+
+    savestate_header(&cur);
+    savestate_read(st, &hdr, sizeof(hdr));
+
+    if (st->error)
+        ;
+    else if (memcmp(hdr.magic, cur.magic, sizeof(hdr.magic)) || (hdr.version != cur.version))
+        savestate_error(st, "not a save state file");
+    else if ((hdr.cpu_state_size != cur.cpu_state_size) || strncmp(hdr.emu_version, cur.emu_version, sizeof(hdr.emu_version)))
+        savestate_error(st, "state was saved by a different build");
+    else if (strncmp(hdr.machine, cur.machine, sizeof(hdr.machine)) || (hdr.mem_size != cur.mem_size))
+        savestate_error(st, "state was saved from a different configuration");
+
+    if (st->error) {
+        savestate_close(st);
+        return -1;
+    }
+
+    /* Start from a freshly reset machine, so that anything which is not
+       in the state is consistent with a reset. */
+    pc_reset_hard_close();
+    pc_reset_hard_init();
+
+    savestate_machine(st);
+
+    if (savestate_close(st)) {
+        /* Do not leave a half restored machine running. */
+        pclog("SAVESTATE: failed to restore \"%s\", resetting\n", fn);
+        pc_reset_hard_close();
+        pc_reset_hard_init();
+        return -1;
+    }
+
+    savestate_log("SAVESTATE: restored \"%s\"\n", fn);
+
+    return 0;
+}
+
+void
+savestate_request(int load, const char *fn)
+{
+    savestate_req_t *req;
+
+    req = (savestate_req_t *) calloc(1, sizeof(savestate_req_t));
+    if (req == NULL) {
+        pclog("SAVESTATE: out of memory\n");
+        return;
+    }
+
+    strncpy(req->fn, fn, sizeof(req->fn) - 1);
+    req->load = load;
+
+    /* The newest request wins. */
+    free(atomic_exchange(&savestate_req, req));
+    savestate_pending = 1;
+}
+
+void
+savestate_process(void)
+{
+    savestate_req_t *req;
+
+    savestate_pending = 0;
+
+    req = atomic_exchange(&savestate_req, NULL);
+    if (req == NULL)
+        return;
+
+    if (req->load)
+        savestate_load(req->fn);
+    else
+        savestate_save(req->fn);
+
+    free(req);
+}
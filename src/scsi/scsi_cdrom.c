@@ -18,6 +18,7 @@
 #include <stdarg.h>
 #include <inttypes.h>
 #include <math.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -39,6 +40,7 @@
 #include <86box/ui.h>
 #include <86box/cdrom.h>
 #include <86box/scsi_cdrom.h>
+#include <86box/savestate.h>
 #include <86box/version.h>
 
 #pragma pack(push, 1)
@@ -847,8 +849,10 @@ static void
 scsi_cdrom_buf_alloc(scsi_cdrom_t *dev, uint32_t len)
 {
     scsi_cdrom_log("CD-ROM %i: Allocated buffer length: %i\n", dev->id, len);
-    if (!dev->buffer)
-        dev->buffer = (uint8_t *) malloc(len);
+    if (!dev->buffer) {
+        dev->buffer     = (uint8_t *) malloc(len);
+        dev->buffer_len = len;
+    }
 }
 
 static void
@@ -2859,3 +2863,42 @@ scsi_cdrom_drive_reset(int c)
         scsi_cdrom_log("ATAPI CD-ROM drive %i attached to IDE channel %i\n", c, cdrom[c].ide_channel);
     }
 }
+
+/* Only the command and audio play state is kept, the medium is expected to
+   be the same one that was inserted when the state was saved. */
+void
+scsi_cdrom_savestate(savestate_t *st, void *priv)
+{
+    scsi_cdrom_t *dev;
+    uint32_t      len;
+    int           c, present;
+
+    for (c = 0; c < CDROM_NUM; c++) {
+        dev     = (scsi_cdrom_t *) cdrom[c].priv;
+        present = (dev != NULL);
+        savestate_var(st, present);
+        if (present != (dev != NULL))
+            return;
+        if (!present)
+            continue;
+
+        savestate_var(st, dev->atapi_cdb);
+        savestate_var(st, dev->current_cdb);
+        savestate_var(st, dev->sense);
+        savestate_data(st, &dev->status, offsetof(scsi_cdrom_t, buffer_len) - offsetof(scsi_cdrom_t, status));
+
+        savestate_var(st, cdrom[c].cd_status);
+        savestate_var(st, cdrom[c].seek_pos);
+        savestate_var(st, cdrom[c].cd_end);
+
+        len = dev->buffer ? dev->buffer_len : 0;
+        savestate_var(st, len);
+        if (savestate_loading(st)) {
+            scsi_cdrom_buf_free(dev);
+            if (len)
+                scsi_cdrom_buf_alloc(dev, len);
+        }
+        if (len)
+            savestate_data(st, dev->buffer, len);
+    }
+}
@@ -27,6 +27,7 @@
 #include <86box/fdc.h>
 #include <86box/fdd_common.h>
 #include <86box/port_92.h>
+#include <86box/savestate.h>
 
 #include <86box/sio.h>
 
@@ -463,6 +464,38 @@ nsc366_reset(void *priv)
 }
 
 
+static void
+nsc366_savestate(savestate_t *st, void *priv)
+{
+    nsc366_t *dev = (nsc366_t *)priv;
+
+    savestate_var(st, dev->index);
+    savestate_var(st, dev->ldn);
+    savestate_var(st, dev->sio_config);
+    savestate_var(st, dev->ld_activate);
+    savestate_var(st, dev->io_base0);
+    savestate_var(st, dev->io_base1);
+    savestate_var(st, dev->int_num_irq);
+    savestate_var(st, dev->irq);
+    savestate_var(st, dev->dma_select0);
+    savestate_var(st, dev->dma_select1);
+    savestate_var(st, dev->dev_specific_config);
+    savestate_var(st, dev->siofc_lock);
+
+    /* The logical devices restore their own registers afterwards. */
+    if(savestate_loading(st)) {
+        nsc366_fdc(dev);
+        nsc366_lpt(dev);
+        nsc366_uart(0, dev);
+        nsc366_uart(1, dev);
+        nsc366_fscm_enable(dev);
+        nsc366_fscm(dev);
+        nsc366_vlm(dev);
+        nsc366_tms(dev);
+    }
+}
+
+
 static void
 nsc366_close(void *priv)
 {
@@ -512,7 +545,8 @@ const device_t nsc366_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw = NULL,
-    .config = NULL
+    .config = NULL,
+    .state = nsc366_savestate
 };
 
 const device_t nsc366_4f_device = {
@@ -526,5 +560,6 @@ const device_t nsc366_4f_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw = NULL,
-    .config = NULL
+    .config = NULL,
+    .state = nsc366_savestate
 };
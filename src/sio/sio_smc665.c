@@ -23,6 +23,7 @@
 #include <86box/fdd.h>
 #include <86box/fdc.h>
 #include <86box/fdd_common.h>
+#include <86box/savestate.h>
 
 #include <86box/sio.h>
 
@@ -313,6 +314,28 @@ smc665_reset(void *priv)
 }
 
 
+static void
+smc665_savestate(savestate_t *st, void *priv)
+{
+    smc665_t *dev = (smc665_t *)priv;
+
+    savestate_var(st, dev->index);
+    savestate_var(st, dev->regs);
+    savestate_var(st, dev->config_enable);
+
+    /* The FDC and UARTs restore their own registers afterwards. */
+    if(savestate_loading(st)) {
+        smc665_fdc(dev);
+        smc665_lpt(dev);
+        smc665_com34(dev);
+        smc665_fdc_feature(dev);
+
+        if(!(dev->regs[1] & 0x80))
+            smc665_config(1, dev);
+    }
+}
+
+
 static void
 smc665_close(void *priv)
 {
@@ -351,5 +374,6 @@ const device_t smc665_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw = NULL,
-    .config = NULL
+    .config = NULL,
+    .state = smc665_savestate
 };
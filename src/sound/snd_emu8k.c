@@ -11,8 +11,10 @@
 
 #include <86box/86box.h>
 #include <86box/device.h>
+#include <86box/host_cpu.h>
 #include <86box/io.h>
 #include <86box/mem.h>
+#include <86box/plat.h>
 #include <86box/rom.h>
 #include <86box/sound.h>
 #include <86box/snd_emu8k.h>
@@ -29,6 +31,17 @@
 #    define RESAMPLER_CUBIC
 #endif
 
+/* The vectorized paths only implement the default filter and resampler. */
+#if (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)) && defined FILTER_MOOG && defined RESAMPLER_CUBIC
+#    define EMU8K_RENDER_X86
+#    include <immintrin.h>
+#    if defined(__GNUC__) || defined(__clang__)
+#        define EMU8K_TARGET(t) __attribute__((target(t)))
+#    else
+#        define EMU8K_TARGET(t)
+#    endif
+#endif
+
 // #define EMU8K_DEBUG_REGISTERS
 
 char *PORT_NAMES[][8] = {
@@ -337,8 +350,10 @@ EMU8K_READ_INTERP_LINEAR(emu8k_t *emu8k, uint32_t int_addr, uint16_t fract)
 }
 #endif
 
-static inline int32_t
-EMU8K_READ_INTERP_CUBIC(emu8k_t *emu8k, uint32_t int_addr, uint16_t fract)
+/* Reads the samples for the cubic interpolation of a voice, and the offset of the
+ * coefficients for its fractional position in cubic_table. */
+static inline void
+EMU8K_READ_CUBIC_TAPS(emu8k_t *emu8k, emu8k_render_t *render, int pos, int c, uint32_t int_addr, uint16_t fract)
 {
     /*Since there are four floats in the table for each fraction, the position is 16byte aligned. */
     fract >>= 16 - CUBIC_RESOLUTION_LOG;
@@ -356,11 +371,21 @@ EMU8K_READ_INTERP_CUBIC(emu8k_t *emu8k, uint32_t int_addr, uint16_t fract)
      * Also, it takes into account the "Note that the actual audio location is the point
      * 1 word higher than this value due to interpolation offset".
      * That's why the pointers are 0, 1, 2, 3 and not -1, 0, 1, 2 */
-    int32_t       dat2  = EMU8K_READ(emu8k, int_addr + 1);
-    const float  *table = &cubic_table[fract];
-    const int32_t dat1  = EMU8K_READ(emu8k, int_addr);
-    const int32_t dat3  = EMU8K_READ(emu8k, int_addr + 2);
-    const int32_t dat4  = EMU8K_READ(emu8k, int_addr + 3);
+    render->sample[pos].interp_pos[c] = fract;
+    render->sample[pos].taps[0][c]    = EMU8K_READ(emu8k, int_addr);
+    render->sample[pos].taps[1][c]    = EMU8K_READ(emu8k, int_addr + 1);
+    render->sample[pos].taps[2][c]    = EMU8K_READ(emu8k, int_addr + 2);
+    render->sample[pos].taps[3][c]    = EMU8K_READ(emu8k, int_addr + 3);
+}
+
+static inline int32_t
+EMU8K_INTERP_CUBIC(const emu8k_render_t *render, int pos, int c)
+{
+    int32_t       dat2  = render->sample[pos].taps[1][c];
+    const float  *table = &cubic_table[render->sample[pos].interp_pos[c]];
+    const int32_t dat1  = render->sample[pos].taps[0][c];
+    const int32_t dat3  = render->sample[pos].taps[2][c];
+    const int32_t dat4  = render->sample[pos].taps[3][c];
     /* Note: I've ended using float for the table values to avoid some cases of integer overflow. */
     dat2 = dat1 * table[0] + dat2 * table[1] + dat3 * table[2] + dat4 * table[3];
     return dat2;
@@ -1653,356 +1678,688 @@ emu8k_vol_slide(emu8k_slide_t *slide, int32_t target)
     return slide->last;
 }
 
-// int32_t old_pitch[32]={0};
-// int32_t old_cut[32]={0};
-// int32_t old_vol[32]={0};
-void
-emu8k_update(emu8k_t *emu8k)
+/* Output stage of the voices: filters the oscillator output recorded for a
+ * block by the envelope engine, then mixes it to the output and effects sends. */
+static void
+emu8k_render_voices_c(emu8k_t *emu8k, int32_t *buf, int32_t *reverb_in, int32_t *chorus_in, int count)
 {
-    int new_pos = (sound_pos_global * 44100) / 48000;
-    if (emu8k->pos >= new_pos)
-        return;
-
-    int32_t       *buf;
-    emu8k_voice_t *emu_voice;
-    int            pos;
-    int            c;
+    emu8k_render_t *render = &emu8k->render;
+    int             pos;
+    int             c;
 
-    /* Clean the buffers since we will accumulate into them. */
-    buf = &emu8k->buffer[emu8k->pos * 2];
-    memset(buf, 0, 2 * (new_pos - emu8k->pos) * sizeof(emu8k->buffer[0]));
-    memset(&emu8k->chorus_in_buffer[emu8k->pos], 0, (new_pos - emu8k->pos) * sizeof(emu8k->chorus_in_buffer[0]));
-    memset(&emu8k->reverb_in_buffer[emu8k->pos], 0, (new_pos - emu8k->pos) * sizeof(emu8k->reverb_in_buffer[0]));
-
-    /* Voices section  */
     for (c = 0; c < 32; c++) {
-        emu_voice = &emu8k->voice[c];
-        buf       = &emu8k->buffer[emu8k->pos * 2];
+        int64_t  filt_buffer[5];
+        int32_t *out = buf;
+
+        filt_buffer[0] = render->filt_buffer[0][c];
+        filt_buffer[1] = render->filt_buffer[1][c];
+        filt_buffer[2] = render->filt_buffer[2][c];
+        filt_buffer[3] = render->filt_buffer[3][c];
+        filt_buffer[4] = render->filt_buffer[4][c];
 
-        for (pos = emu8k->pos; pos < new_pos; pos++) {
+        for (pos = 0; pos < count; pos++, out += 2) {
             int32_t dat;
 
-            if (emu_voice->cvcf_curr_volume) {
-                /* Waveform oscillator */
-#ifdef RESAMPLER_LINEAR
-                dat = EMU8K_READ_INTERP_LINEAR(emu8k, emu_voice->addr.int_address,
-                                               emu_voice->addr.fract_address);
+            if (!render->sample[pos].vol[c])
+                continue;
 
+#ifdef RESAMPLER_LINEAR
+            dat = render->sample[pos].taps[0][c];
 #elif defined RESAMPLER_CUBIC
-                dat = EMU8K_READ_INTERP_CUBIC(emu8k, emu_voice->addr.int_address,
-                                              emu_voice->addr.fract_address);
+            dat = EMU8K_INTERP_CUBIC(render, pos, c);
 #endif
 
-                /* Filter section */
-                if (emu_voice->filterq_idx || emu_voice->cvcf_curr_filt_ctoff != 0xFFFF) {
-                    int           cutoff = emu_voice->cvcf_curr_filt_ctoff >> 8;
-                    const int64_t coef0  = filt_coeffs[emu_voice->filterq_idx][cutoff][0];
-                    const int64_t coef1  = filt_coeffs[emu_voice->filterq_idx][cutoff][1];
-                    const int64_t coef2  = filt_coeffs[emu_voice->filterq_idx][cutoff][2];
+            /* Filter section */
+            if (render->filterq_idx[c] || render->sample[pos].filt_ctoff[c] != 0xFFFF) {
+                int           cutoff = render->sample[pos].filt_ctoff[c] >> 8;
+                const int64_t coef0  = filt_coeffs[render->filterq_idx[c]][cutoff][0];
+                const int64_t coef1  = filt_coeffs[render->filterq_idx[c]][cutoff][1];
+                const int64_t coef2  = filt_coeffs[render->filterq_idx[c]][cutoff][2];
 /* clip at twice the range */
 #define ClipBuffer(buf) (buf < -16777216) ? -16777216 : (buf > 16777216) ? 16777216 \
                                                                          : buf
 
 #ifdef FILTER_INITIAL
 #    define NOOP(x) (void) x;
-                    NOOP(coef1)
-                    /* Apply expected attenuation. (FILTER_MOOG does it implicitly, but this one doesn't).
-                     * Work in 24bits. */
-                    dat = (dat * emu_voice->filt_att) >> 8;
-
-                    int64_t vhp = ((-emu_voice->filt_buffer[0] * coef2) >> 24) - emu_voice->filt_buffer[1] - dat;
-                    emu_voice->filt_buffer[1] += (emu_voice->filt_buffer[0] * coef0) >> 24;
-                    emu_voice->filt_buffer[0] += (vhp * coef0) >> 24;
-                    dat = (int32_t) (emu_voice->filt_buffer[1] >> 8);
-                    if (dat > 32767) {
-                        dat = 32767;
-                    } else if (dat < -32768) {
-                        dat = -32768;
-                    }
+                NOOP(coef1)
+                /* Apply expected attenuation. (FILTER_MOOG does it implicitly, but this one doesn't).
+                 * Work in 24bits. */
+                dat = (dat * emu8k->voice[c].filt_att) >> 8;
+
+                int64_t vhp = ((-filt_buffer[0] * coef2) >> 24) - filt_buffer[1] - dat;
+                filt_buffer[1] += (filt_buffer[0] * coef0) >> 24;
+                filt_buffer[0] += (vhp * coef0) >> 24;
+                dat = (int32_t) (filt_buffer[1] >> 8);
+                if (dat > 32767) {
+                    dat = 32767;
+                } else if (dat < -32768) {
+                    dat = -32768;
+                }
 
 #elif defined FILTER_MOOG
 
-                    /*move to 24bits*/
-                    dat <<= 8;
+                /*move to 24bits*/
+                dat <<= 8;
 
-                    dat -= (coef2 * emu_voice->filt_buffer[4]) >> 24; /*feedback*/
-                    int64_t t1 = emu_voice->filt_buffer[1];
-                    emu_voice->filt_buffer[1] = ((dat + emu_voice->filt_buffer[0]) * coef0 - emu_voice->filt_buffer[1] * coef1) >> 24;
-                    emu_voice->filt_buffer[1] = ClipBuffer(emu_voice->filt_buffer[1]);
+                dat -= (coef2 * filt_buffer[4]) >> 24; /*feedback*/
+                int64_t t1     = filt_buffer[1];
+                filt_buffer[1] = ((dat + filt_buffer[0]) * coef0 - filt_buffer[1] * coef1) >> 24;
+                filt_buffer[1] = ClipBuffer(filt_buffer[1]);
 
-                    int64_t t2 = emu_voice->filt_buffer[2];
-                    emu_voice->filt_buffer[2] = ((emu_voice->filt_buffer[1] + t1) * coef0 - emu_voice->filt_buffer[2] * coef1) >> 24;
-                    emu_voice->filt_buffer[2] = ClipBuffer(emu_voice->filt_buffer[2]);
+                int64_t t2     = filt_buffer[2];
+                filt_buffer[2] = ((filt_buffer[1] + t1) * coef0 - filt_buffer[2] * coef1) >> 24;
+                filt_buffer[2] = ClipBuffer(filt_buffer[2]);
 
-                    int64_t t3 = emu_voice->filt_buffer[3];
-                    emu_voice->filt_buffer[3] = ((emu_voice->filt_buffer[2] + t2) * coef0 - emu_voice->filt_buffer[3] * coef1) >> 24;
-                    emu_voice->filt_buffer[3] = ClipBuffer(emu_voice->filt_buffer[3]);
+                int64_t t3     = filt_buffer[3];
+                filt_buffer[3] = ((filt_buffer[2] + t2) * coef0 - filt_buffer[3] * coef1) >> 24;
+                filt_buffer[3] = ClipBuffer(filt_buffer[3]);
 
-                    emu_voice->filt_buffer[4] = ((emu_voice->filt_buffer[3] + t3) * coef0 - emu_voice->filt_buffer[4] * coef1) >> 24;
-                    emu_voice->filt_buffer[4] = ClipBuffer(emu_voice->filt_buffer[4]);
+                filt_buffer[4] = ((filt_buffer[3] + t3) * coef0 - filt_buffer[4] * coef1) >> 24;
+                filt_buffer[4] = ClipBuffer(filt_buffer[4]);
 
-                    emu_voice->filt_buffer[0] = ClipBuffer(dat);
+                filt_buffer[0] = ClipBuffer(dat);
 
-                    dat = (int32_t) (emu_voice->filt_buffer[4] >> 8);
-                    if (dat > 32767) {
-                        dat = 32767;
-                    } else if (dat < -32768) {
-                        dat = -32768;
-                    }
+                dat = (int32_t) (filt_buffer[4] >> 8);
+                if (dat > 32767) {
+                    dat = 32767;
+                } else if (dat < -32768) {
+                    dat = -32768;
+                }
 
 #elif defined FILTER_CONSTANT
 
-                    /* Apply expected attenuation. (FILTER_MOOG does it implicitly, but this one is constant gain).
-                     * Also stay at 24bits.*/
-                    dat = (dat * emu_voice->filt_att) >> 8;
-
-                    emu_voice->filt_buffer[0] = (coef1 * emu_voice->filt_buffer[0]
-                                                 + coef0 * (dat + ((coef2 * (emu_voice->filt_buffer[0] - emu_voice->filt_buffer[1])) >> 24)))
-                        >> 24;
-                    emu_voice->filt_buffer[1] = (coef1 * emu_voice->filt_buffer[1]
-                                                 + coef0 * emu_voice->filt_buffer[0])
-                        >> 24;
-
-                    emu_voice->filt_buffer[0] = ClipBuffer(emu_voice->filt_buffer[0]);
-                    emu_voice->filt_buffer[1] = ClipBuffer(emu_voice->filt_buffer[1]);
-
-                    dat = (int32_t) (emu_voice->filt_buffer[1] >> 8);
-                    if (dat > 32767) {
-                        dat = 32767;
-                    } else if (dat < -32768) {
-                        dat = -32768;
-                    }
+                /* Apply expected attenuation. (FILTER_MOOG does it implicitly, but this one is constant gain).
+                 * Also stay at 24bits.*/
+                dat = (dat * emu8k->voice[c].filt_att) >> 8;
+
+                filt_buffer[0] = (coef1 * filt_buffer[0]
+                                  + coef0 * (dat + ((coef2 * (filt_buffer[0] - filt_buffer[1])) >> 24)))
+                    >> 24;
+                filt_buffer[1] = (coef1 * filt_buffer[1]
+                                  + coef0 * filt_buffer[0])
+                    >> 24;
+
+                filt_buffer[0] = ClipBuffer(filt_buffer[0]);
+                filt_buffer[1] = ClipBuffer(filt_buffer[1]);
+
+                dat = (int32_t) (filt_buffer[1] >> 8);
+                if (dat > 32767) {
+                    dat = 32767;
+                } else if (dat < -32768) {
+                    dat = -32768;
+                }
 
 #endif
-                }
-                if ((emu8k->hwcf3 & 0x04) && !CCCA_DMA_ACTIVE(emu_voice->ccca)) {
-                    /*volume and pan*/
-                    dat = (dat * emu_voice->cvcf_curr_volume) >> 16;
+            }
+            if (render->mix[c]) {
+                /*volume and pan*/
+                dat = (dat * render->sample[pos].vol[c]) >> 16;
 
-                    (*buf++) += (dat * emu_voice->vol_l) >> 8;
-                    (*buf++) += (dat * emu_voice->vol_r) >> 8;
+                out[0] += (dat * render->vol_l[c]) >> 8;
+                out[1] += (dat * render->vol_r[c]) >> 8;
 
-                    /* Effects section */
-                    if (emu_voice->ptrx_revb_send > 0) {
-                        emu8k->reverb_in_buffer[pos] += (dat * emu_voice->ptrx_revb_send) >> 8;
-                    }
-                    if (emu_voice->csl_chor_send > 0) {
-                        emu8k->chorus_in_buffer[pos] += (dat * emu_voice->csl_chor_send) >> 8;
-                    }
+                /* Effects section */
+                if (render->revb_send[c] > 0) {
+                    reverb_in[pos] += (dat * render->revb_send[c]) >> 8;
+                }
+                if (render->chor_send[c] > 0) {
+                    chorus_in[pos] += (dat * render->chor_send[c]) >> 8;
                 }
             }
+        }
 
-            if (emu_voice->env_engine_on) {
-                int32_t attenuation  = emu_voice->initial_att;
-                int32_t filtercut    = emu_voice->initial_filter;
-                int32_t currentpitch = emu_voice->ip;
-                /* run envelopes */
-                emu8k_envelope_t *volenv = &emu_voice->vol_envelope;
-                switch (volenv->state) {
-                    case ENV_DELAY:
-                        volenv->delay_samples--;
-                        if (volenv->delay_samples <= 0) {
-                            volenv->state         = ENV_ATTACK;
-                            volenv->delay_samples = 0;
-                        }
-                        attenuation = 0x1FFFFF;
-                        break;
+        render->filt_buffer[0][c] = filt_buffer[0];
+        render->filt_buffer[1][c] = filt_buffer[1];
+        render->filt_buffer[2][c] = filt_buffer[2];
+        render->filt_buffer[3][c] = filt_buffer[3];
+        render->filt_buffer[4][c] = filt_buffer[4];
+    }
+}
 
-                    case ENV_ATTACK:
-                        /* Attack amount is in linear amplitude */
-                        volenv->value_amp_hz += volenv->attack_amount_amp_hz;
-                        if (volenv->value_amp_hz >= (1 << 21)) {
-                            volenv->value_amp_hz = 1 << 21;
-                            volenv->value_db_oct = 0;
-                            if (volenv->hold_samples) {
-                                volenv->state = ENV_HOLD;
-                            } else {
-                                /* RAMP_UP since db value is inverted and it is 0 at this point. */
-                                volenv->state = ENV_RAMP_UP;
-                            }
-                        }
-                        attenuation += env_vol_amplitude_to_db[volenv->value_amp_hz >> 5] << 5;
-                        break;
+#ifdef EMU8K_RENDER_X86
+/* Arithmetic right shift of 64-bit lanes, which AVX2 lacks. */
+#    define EMU8K_SRA64(x, n) _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(_mm256_cmpgt_epi64(_mm256_setzero_si256(), x), 64 - (n)))
 
-                    case ENV_HOLD:
-                        volenv->hold_samples--;
-                        if (volenv->hold_samples <= 0) {
-                            volenv->state = ENV_RAMP_UP;
-                        }
-                        attenuation += volenv->value_db_oct;
-                        break;
+EMU8K_TARGET("avx2")
+static __inline __m256i
+emu8k_clip_buffer_avx2(__m256i x)
+{
+    const __m256i max = _mm256_set1_epi64x(16777216);
+    const __m256i min = _mm256_set1_epi64x(-16777216);
 
-                    case ENV_RAMP_DOWN:
-                        /* Decay/release amount is in fraction of dBs and is always positive */
-                        volenv->value_db_oct -= volenv->ramp_amount_db_oct;
-                        if (volenv->value_db_oct <= volenv->sustain_value_db_oct) {
-                            volenv->value_db_oct = volenv->sustain_value_db_oct;
-                            volenv->state        = ENV_SUSTAIN;
-                        }
-                        attenuation += volenv->value_db_oct;
-                        break;
+    x = _mm256_blendv_epi8(x, max, _mm256_cmpgt_epi64(x, max));
+    return _mm256_blendv_epi8(x, min, _mm256_cmpgt_epi64(min, x));
+}
 
-                    case ENV_RAMP_UP:
-                        /* Decay/release amount is in fraction of dBs and is always positive */
-                        volenv->value_db_oct += volenv->ramp_amount_db_oct;
-                        if (volenv->value_db_oct >= volenv->sustain_value_db_oct) {
-                            volenv->value_db_oct = volenv->sustain_value_db_oct;
-                            volenv->state        = ENV_SUSTAIN;
-                        }
-                        attenuation += volenv->value_db_oct;
-                        break;
+/* One step of the Moog filter for four voices. The operands of each multiply
+ * fit in 32 bits (the buffers are clipped to 25 bits and the coefficients to
+ * 26), so _mm256_mul_epi32() gives the same 64-bit products as the C version. */
+EMU8K_TARGET("avx2")
+static __inline __m256i
+emu8k_filter_moog_avx2(__m256i dat, __m256i fb[5], __m256i coef0, __m256i coef1, __m256i coef2, __m256i mask)
+{
+    __m256i t1, t2, t3, f1, f2, f3, f4;
 
-                    case ENV_SUSTAIN:
-                        attenuation += volenv->value_db_oct;
-                        break;
+    dat = _mm256_sub_epi64(dat, EMU8K_SRA64(_mm256_mul_epi32(coef2, fb[4]), 24)); /*feedback*/
+    t1  = fb[1];
+    f1  = _mm256_sub_epi64(_mm256_mul_epi32(_mm256_add_epi64(dat, fb[0]), coef0), _mm256_mul_epi32(fb[1], coef1));
+    f1  = emu8k_clip_buffer_avx2(EMU8K_SRA64(f1, 24));
 
-                    case ENV_STOPPED:
-                        attenuation = 0x1FFFFF;
-                        break;
-                }
+    t2 = fb[2];
+    f2 = _mm256_sub_epi64(_mm256_mul_epi32(_mm256_add_epi64(f1, t1), coef0), _mm256_mul_epi32(fb[2], coef1));
+    f2 = emu8k_clip_buffer_avx2(EMU8K_SRA64(f2, 24));
 
-                emu8k_envelope_t *modenv = &emu_voice->mod_envelope;
-                switch (modenv->state) {
-                    case ENV_DELAY:
-                        modenv->delay_samples--;
-                        if (modenv->delay_samples <= 0) {
-                            modenv->state         = ENV_ATTACK;
-                            modenv->delay_samples = 0;
-                        }
-                        break;
+    t3 = fb[3];
+    f3 = _mm256_sub_epi64(_mm256_mul_epi32(_mm256_add_epi64(f2, t2), coef0), _mm256_mul_epi32(fb[3], coef1));
+    f3 = emu8k_clip_buffer_avx2(EMU8K_SRA64(f3, 24));
 
-                    case ENV_ATTACK:
-                        /* Attack amount is in linear amplitude */
-                        modenv->value_amp_hz += modenv->attack_amount_amp_hz;
-                        modenv->value_db_oct = env_mod_hertz_to_octave[modenv->value_amp_hz >> 5] << 5;
-                        if (modenv->value_amp_hz >= (1 << 21)) {
-                            modenv->value_amp_hz = 1 << 21;
-                            modenv->value_db_oct = 1 << 21;
-                            if (modenv->hold_samples) {
-                                modenv->state = ENV_HOLD;
-                            } else {
-                                modenv->state = ENV_RAMP_DOWN;
+    f4 = _mm256_sub_epi64(_mm256_mul_epi32(_mm256_add_epi64(f3, t3), coef0), _mm256_mul_epi32(fb[4], coef1));
+    f4 = emu8k_clip_buffer_avx2(EMU8K_SRA64(f4, 24));
+
+    fb[0] = _mm256_blendv_epi8(fb[0], emu8k_clip_buffer_avx2(dat), mask);
+    fb[1] = _mm256_blendv_epi8(fb[1], f1, mask);
+    fb[2] = _mm256_blendv_epi8(fb[2], f2, mask);
+    fb[3] = _mm256_blendv_epi8(fb[3], f3, mask);
+    fb[4] = _mm256_blendv_epi8(fb[4], f4, mask);
+
+    return f4;
+}
+
+/* Same as emu8k_render_voices_c(), eight voices at a time. */
+EMU8K_TARGET("avx2")
+static void
+emu8k_render_voices_avx2(emu8k_t *emu8k, int32_t *buf, int32_t *reverb_in, int32_t *chorus_in, int count)
+{
+    emu8k_render_t *render = &emu8k->render;
+    __m256i         acc_l[EMU8K_RENDER_BLOCK];
+    __m256i         acc_r[EMU8K_RENDER_BLOCK];
+    __m256i         acc_revb[EMU8K_RENDER_BLOCK];
+    __m256i         acc_chor[EMU8K_RENDER_BLOCK];
+    const __m256i   zero  = _mm256_setzero_si256();
+    const __m256i   evens = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    int             pos;
+    int             c, d;
+
+    for (pos = 0; pos < count; pos++) {
+        acc_l[pos]    = zero;
+        acc_r[pos]    = zero;
+        acc_revb[pos] = zero;
+        acc_chor[pos] = zero;
+    }
+
+    for (c = 0; c < 32; c += 8) {
+        __m256i active = zero;
+
+        for (pos = 0; pos < count; pos++)
+            active = _mm256_or_si256(active, _mm256_loadu_si256((const __m256i *) &render->sample[pos].vol[c]));
+        if (_mm256_testz_si256(active, active))
+            continue;
+
+        const __m256i filterq_idx = _mm256_loadu_si256((const __m256i *) &render->filterq_idx[c]);
+        const __m256i coef_base   = _mm256_mullo_epi32(filterq_idx, _mm256_set1_epi32(256 * 3));
+        const __m256i no_q        = _mm256_cmpeq_epi32(filterq_idx, zero);
+        const __m256i mix         = _mm256_loadu_si256((const __m256i *) &render->mix[c]);
+        const __m256i vol_l       = _mm256_loadu_si256((const __m256i *) &render->vol_l[c]);
+        const __m256i vol_r       = _mm256_loadu_si256((const __m256i *) &render->vol_r[c]);
+        const __m256i revb_send   = _mm256_loadu_si256((const __m256i *) &render->revb_send[c]);
+        const __m256i chor_send   = _mm256_loadu_si256((const __m256i *) &render->chor_send[c]);
+        __m256i       fb_lo[5], fb_hi[5];
+
+        for (d = 0; d < 5; d++) {
+            fb_lo[d] = _mm256_loadu_si256((const __m256i *) &render->filt_buffer[d][c]);
+            fb_hi[d] = _mm256_loadu_si256((const __m256i *) &render->filt_buffer[d][c + 4]);
+        }
+
+        for (pos = 0; pos < count; pos++) {
+            const __m256i vol = _mm256_loadu_si256((const __m256i *) &render->sample[pos].vol[c]);
+            __m256i       dat, filter, ctoff;
+            __m256        interp;
+
+            if (_mm256_testz_si256(vol, vol))
+                continue;
+
+            /* Waveform oscillator. The sum is done in the same order as in EMU8K_INTERP_CUBIC(). */
+            const __m256i interp_pos = _mm256_loadu_si256((const __m256i *) &render->sample[pos].interp_pos[c]);
+
+            interp = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *) &render->sample[pos].taps[0][c])),
+                                   _mm256_i32gather_ps(&cubic_table[0], interp_pos, 4));
+            interp = _mm256_add_ps(interp, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *) &render->sample[pos].taps[1][c])),
+                                                         _mm256_i32gather_ps(&cubic_table[1], interp_pos, 4)));
+            interp = _mm256_add_ps(interp, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *) &render->sample[pos].taps[2][c])),
+                                                         _mm256_i32gather_ps(&cubic_table[2], interp_pos, 4)));
+            interp = _mm256_add_ps(interp, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *) &render->sample[pos].taps[3][c])),
+                                                         _mm256_i32gather_ps(&cubic_table[3], interp_pos, 4)));
+            dat    = _mm256_cvttps_epi32(interp);
+
+            /* Filter section, for the sounding voices that have it enabled */
+            ctoff  = _mm256_loadu_si256((const __m256i *) &render->sample[pos].filt_ctoff[c]);
+            filter = _mm256_andnot_si256(_mm256_and_si256(no_q, _mm256_cmpeq_epi32(ctoff, _mm256_set1_epi32(0xFFFF))),
+                                         _mm256_xor_si256(_mm256_cmpeq_epi32(vol, zero), _mm256_set1_epi32(-1)));
+            if (!_mm256_testz_si256(filter, filter)) {
+                const __m256i coef_idx = _mm256_add_epi32(coef_base, _mm256_mullo_epi32(_mm256_srli_epi32(ctoff, 8), _mm256_set1_epi32(3)));
+                const __m256i coef0    = _mm256_i32gather_epi32(&filt_coeffs[0][0][0], coef_idx, 4);
+                const __m256i coef1    = _mm256_i32gather_epi32(&filt_coeffs[0][0][1], coef_idx, 4);
+                const __m256i coef2    = _mm256_i32gather_epi32(&filt_coeffs[0][0][2], coef_idx, 4);
+                const __m256i dat24    = _mm256_slli_epi32(dat, 8);
+                __m256i       out_lo, out_hi, out;
+
+                out_lo = emu8k_filter_moog_avx2(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(dat24)), fb_lo,
+                                                _mm256_cvtepi32_epi64(_mm256_castsi256_si128(coef0)),
+                                                _mm256_cvtepi32_epi64(_mm256_castsi256_si128(coef1)),
+                                                _mm256_cvtepi32_epi64(_mm256_castsi256_si128(coef2)),
+                                                _mm256_cvtepi32_epi64(_mm256_castsi256_si128(filter)));
+                out_hi = emu8k_filter_moog_avx2(_mm256_cvtepi32_epi64(_mm256_extracti128_si256(dat24, 1)), fb_hi,
+                                                _mm256_cvtepi32_epi64(_mm256_extracti128_si256(coef0, 1)),
+                                                _mm256_cvtepi32_epi64(_mm256_extracti128_si256(coef1, 1)),
+                                                _mm256_cvtepi32_epi64(_mm256_extracti128_si256(coef2, 1)),
+                                                _mm256_cvtepi32_epi64(_mm256_extracti128_si256(filter, 1)));
+
+                /* The clipped buffer fits in 32 bits, so keep the low half of each lane. */
+                out = _mm256_inserti128_si256(_mm256_permutevar8x32_epi32(out_lo, evens),
+                                              _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(out_hi, evens)), 1);
+                out = _mm256_srai_epi32(out, 8);
+                out = _mm256_max_epi32(_mm256_min_epi32(out, _mm256_set1_epi32(32767)), _mm256_set1_epi32(-32768));
+                dat = _mm256_blendv_epi8(dat, out, filter);
+            }
+
+            /*volume and pan. Silent voices add nothing, as dat is multiplied by 0.*/
+            dat = _mm256_and_si256(_mm256_srai_epi32(_mm256_mullo_epi32(dat, vol), 16), mix);
+
+            acc_l[pos]    = _mm256_add_epi32(acc_l[pos], _mm256_srai_epi32(_mm256_mullo_epi32(dat, vol_l), 8));
+            acc_r[pos]    = _mm256_add_epi32(acc_r[pos], _mm256_srai_epi32(_mm256_mullo_epi32(dat, vol_r), 8));
+            acc_revb[pos] = _mm256_add_epi32(acc_revb[pos], _mm256_srai_epi32(_mm256_mullo_epi32(dat, revb_send), 8));
+            acc_chor[pos] = _mm256_add_epi32(acc_chor[pos], _mm256_srai_epi32(_mm256_mullo_epi32(dat, chor_send), 8));
+        }
+
+        for (d = 0; d < 5; d++) {
+            _mm256_storeu_si256((__m256i *) &render->filt_buffer[d][c], fb_lo[d]);
+            _mm256_storeu_si256((__m256i *) &render->filt_buffer[d][c + 4], fb_hi[d]);
+        }
+    }
+
+    for (pos = 0; pos < count; pos++) {
+        /* Sum each accumulator across voices, into left, right, reverb and chorus. */
+        __m256i sum   = _mm256_hadd_epi32(_mm256_hadd_epi32(acc_l[pos], acc_r[pos]), _mm256_hadd_epi32(acc_revb[pos], acc_chor[pos]));
+        __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+
+        buf[pos * 2] += _mm_cvtsi128_si32(total);
+        buf[pos * 2 + 1] += _mm_extract_epi32(total, 1);
+        reverb_in[pos] += _mm_extract_epi32(total, 2);
+        chorus_in[pos] += _mm_extract_epi32(total, 3);
+    }
+}
+
+/* Same as emu8k_work_reverb(), with the six reflection combs worked in parallel. */
+EMU8K_TARGET("sse2")
+static void
+emu8k_work_reverb_sse2(int32_t *inbuf, int32_t *outbuf, emu8k_reverb_eng_t *engine, int count)
+{
+    emu8k_reverb_combfilter_t *const refl = engine->reflections;
+    const __m128                     damp1_lo       = _mm_setr_ps(refl[0].damp1, refl[1].damp1, refl[2].damp1, refl[3].damp1);
+    const __m128                     damp1_hi       = _mm_setr_ps(refl[4].damp1, refl[5].damp1, 0, 0);
+    const __m128                     damp2_lo       = _mm_setr_ps(refl[0].damp2, refl[1].damp2, refl[2].damp2, refl[3].damp2);
+    const __m128                     damp2_hi       = _mm_setr_ps(refl[4].damp2, refl[5].damp2, 0, 0);
+    const __m128                     feedback_lo    = _mm_setr_ps(refl[0].feedback, refl[1].feedback, refl[2].feedback, refl[3].feedback);
+    const __m128                     feedback_hi    = _mm_setr_ps(refl[4].feedback, refl[5].feedback, 0, 0);
+    const __m128                     output_gain_lo = _mm_setr_ps(refl[0].output_gain, refl[1].output_gain, refl[2].output_gain, refl[3].output_gain);
+    const __m128                     output_gain_hi = _mm_setr_ps(refl[4].output_gain, refl[5].output_gain, 0, 0);
+    __m128i                          filterstore_lo = _mm_setr_epi32(refl[0].filterstore, refl[1].filterstore, refl[2].filterstore, refl[3].filterstore);
+    __m128i                          filterstore_hi = _mm_setr_epi32(refl[4].filterstore, refl[5].filterstore, 0, 0);
+    int32_t                          comb[8];
+    int                              pos;
+    int                              c;
+
+    for (pos = 0; pos < count; pos++) {
+        int32_t dat1, dat2, in, in2;
+        __m128  output_lo, output_hi, bufin;
+
+        in    = emu8k_reverb_damper_work(&engine->damper, inbuf[pos]);
+        in2   = (in * engine->refl_in_amp) >> 8;
+        bufin = _mm_set1_ps((float) in2);
+
+        /* get echo */
+        output_lo = _mm_cvtepi32_ps(_mm_setr_epi32(refl[0].reflection[refl[0].read_pos], refl[1].reflection[refl[1].read_pos],
+                                                   refl[2].reflection[refl[2].read_pos], refl[3].reflection[refl[3].read_pos]));
+        output_hi = _mm_cvtepi32_ps(_mm_setr_epi32(refl[4].reflection[refl[4].read_pos], refl[5].reflection[refl[5].read_pos], 0, 0));
+        /* apply lowpass */
+        filterstore_lo = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(output_lo, damp2_lo), _mm_mul_ps(_mm_cvtepi32_ps(filterstore_lo), damp1_lo)));
+        filterstore_hi = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(output_hi, damp2_hi), _mm_mul_ps(_mm_cvtepi32_ps(filterstore_hi), damp1_hi)));
+        /* appply feedback, and store new value in delayed buffer */
+        _mm_storeu_si128((__m128i *) &comb[0], _mm_cvttps_epi32(_mm_sub_ps(bufin, _mm_mul_ps(_mm_cvtepi32_ps(filterstore_lo), feedback_lo))));
+        _mm_storeu_si128((__m128i *) &comb[4], _mm_cvttps_epi32(_mm_sub_ps(bufin, _mm_mul_ps(_mm_cvtepi32_ps(filterstore_hi), feedback_hi))));
+        for (c = 0; c < 6; c++) {
+            refl[c].reflection[refl[c].read_pos] = comb[c];
+            if (++refl[c].read_pos >= refl[c].bufsize)
+                refl[c].read_pos = 0;
+        }
+        _mm_storeu_si128((__m128i *) &comb[0], _mm_cvttps_epi32(_mm_mul_ps(output_lo, output_gain_lo)));
+        _mm_storeu_si128((__m128i *) &comb[4], _mm_cvttps_epi32(_mm_mul_ps(output_hi, output_gain_hi)));
+
+        if (engine->link_return_type) {
+            dat1 = comb[2] + comb[4];
+            dat2 = comb[0] + comb[1] + comb[3] + comb[5];
+        } else {
+            dat1 = comb[0] + comb[1] + comb[2] + comb[3] + comb[4] + comb[5];
+            dat2 = dat1;
+        }
+
+        dat1 += (emu8k_reverb_tail_work(&engine->tailL, &engine->allpass[0], in + dat1) * engine->link_return_amp) >> 8;
+        dat2 += (emu8k_reverb_tail_work(&engine->tailR, &engine->allpass[4], in + dat2) * engine->link_return_amp) >> 8;
+
+        (*outbuf++) += (dat1 * engine->out_mix) >> 8;
+        (*outbuf++) += (dat2 * engine->out_mix) >> 8;
+    }
+
+    _mm_storeu_si128((__m128i *) &comb[0], filterstore_lo);
+    _mm_storeu_si128((__m128i *) &comb[4], filterstore_hi);
+    for (c = 0; c < 6; c++)
+        refl[c].filterstore = comb[c];
+}
+
+#endif
+
+static void (*emu8k_render_voices)(emu8k_t *emu8k, int32_t *buf, int32_t *reverb_in, int32_t *chorus_in, int count) = emu8k_render_voices_c;
+static void (*emu8k_render_reverb)(int32_t *inbuf, int32_t *outbuf, emu8k_reverb_eng_t *engine, int count)          = emu8k_work_reverb;
+
+static void
+emu8k_render_select(int simd)
+{
+    emu8k_render_voices = emu8k_render_voices_c;
+    emu8k_render_reverb = emu8k_work_reverb;
+
+    if (!simd)
+        return;
+
+#ifdef EMU8K_RENDER_X86
+    if (host_cpu_has_sse2())
+        emu8k_render_reverb = emu8k_work_reverb_sse2;
+    if (host_cpu_has_avx2())
+        emu8k_render_voices = emu8k_render_voices_avx2;
+#endif
+}
+
+// int32_t old_pitch[32]={0};
+// int32_t old_cut[32]={0};
+// int32_t old_vol[32]={0};
+void
+emu8k_update(emu8k_t *emu8k)
+{
+    int new_pos = (sound_pos_global * 44100) / 48000;
+    if (emu8k->pos >= new_pos)
+        return;
+
+    int32_t        *buf;
+    emu8k_voice_t  *emu_voice;
+    emu8k_render_t *render = &emu8k->render;
+    int             block_pos, block_len;
+    int             pos;
+    int             c;
+
+    /* Clean the buffers since we will accumulate into them. */
+    buf = &emu8k->buffer[emu8k->pos * 2];
+    memset(buf, 0, 2 * (new_pos - emu8k->pos) * sizeof(emu8k->buffer[0]));
+    memset(&emu8k->chorus_in_buffer[emu8k->pos], 0, (new_pos - emu8k->pos) * sizeof(emu8k->chorus_in_buffer[0]));
+    memset(&emu8k->reverb_in_buffer[emu8k->pos], 0, (new_pos - emu8k->pos) * sizeof(emu8k->reverb_in_buffer[0]));
+
+    /* These only change on register writes, which update before. */
+    for (c = 0; c < 32; c++) {
+        emu_voice = &emu8k->voice[c];
+
+        render->filterq_idx[c] = emu_voice->filterq_idx;
+        render->mix[c]         = ((emu8k->hwcf3 & 0x04) && !CCCA_DMA_ACTIVE(emu_voice->ccca)) ? -1 : 0;
+        render->vol_l[c]       = emu_voice->vol_l;
+        render->vol_r[c]       = emu_voice->vol_r;
+        render->revb_send[c]   = emu_voice->ptrx_revb_send;
+        render->chor_send[c]   = emu_voice->csl_chor_send;
+    }
+
+    for (block_pos = emu8k->pos; block_pos < new_pos; block_pos += block_len) {
+        block_len = new_pos - block_pos;
+        if (block_len > EMU8K_RENDER_BLOCK)
+            block_len = EMU8K_RENDER_BLOCK;
+
+        /* Voices section. The envelope engine runs first, recording what the
+         * output stage needs for each sample, then the output stage does all the
+         * voices at once. */
+        for (c = 0; c < 32; c++) {
+            emu_voice = &emu8k->voice[c];
+
+            for (pos = 0; pos < block_len; pos++) {
+                render->sample[pos].vol[c]        = emu_voice->cvcf_curr_volume;
+                render->sample[pos].filt_ctoff[c] = emu_voice->cvcf_curr_filt_ctoff;
+
+                if (emu_voice->cvcf_curr_volume) {
+                    /* Waveform oscillator */
+#ifdef RESAMPLER_LINEAR
+                    render->sample[pos].taps[0][c] = EMU8K_READ_INTERP_LINEAR(emu8k, emu_voice->addr.int_address,
+                                                                       emu_voice->addr.fract_address);
+
+#elif defined RESAMPLER_CUBIC
+                    EMU8K_READ_CUBIC_TAPS(emu8k, render, pos, c, emu_voice->addr.int_address,
+                                          emu_voice->addr.fract_address);
+#endif
+                } else
+                    render->sample[pos].interp_pos[c] = 0;
+
+                if (emu_voice->env_engine_on) {
+                    int32_t attenuation  = emu_voice->initial_att;
+                    int32_t filtercut    = emu_voice->initial_filter;
+                    int32_t currentpitch = emu_voice->ip;
+                    /* run envelopes */
+                    emu8k_envelope_t *volenv = &emu_voice->vol_envelope;
+                    switch (volenv->state) {
+                        case ENV_DELAY:
+                            volenv->delay_samples--;
+                            if (volenv->delay_samples <= 0) {
+                                volenv->state         = ENV_ATTACK;
+                                volenv->delay_samples = 0;
                             }
-                        }
-                        break;
+                            attenuation = 0x1FFFFF;
+                            break;
+
+                        case ENV_ATTACK:
+                            /* Attack amount is in linear amplitude */
+                            volenv->value_amp_hz += volenv->attack_amount_amp_hz;
+                            if (volenv->value_amp_hz >= (1 << 21)) {
+                                volenv->value_amp_hz = 1 << 21;
+                                volenv->value_db_oct = 0;
+                                if (volenv->hold_samples) {
+                                    volenv->state = ENV_HOLD;
+                                } else {
+                                    /* RAMP_UP since db value is inverted and it is 0 at this point. */
+                                    volenv->state = ENV_RAMP_UP;
+                                }
+                            }
+                            attenuation += env_vol_amplitude_to_db[volenv->value_amp_hz >> 5] << 5;
+                            break;
 
-                    case ENV_HOLD:
-                        modenv->hold_samples--;
-                        if (modenv->hold_samples <= 0) {
-                            modenv->state = ENV_RAMP_UP;
-                        }
-                        break;
+                        case ENV_HOLD:
+                            volenv->hold_samples--;
+                            if (volenv->hold_samples <= 0) {
+                                volenv->state = ENV_RAMP_UP;
+                            }
+                            attenuation += volenv->value_db_oct;
+                            break;
+
+                        case ENV_RAMP_DOWN:
+                            /* Decay/release amount is in fraction of dBs and is always positive */
+                            volenv->value_db_oct -= volenv->ramp_amount_db_oct;
+                            if (volenv->value_db_oct <= volenv->sustain_value_db_oct) {
+                                volenv->value_db_oct = volenv->sustain_value_db_oct;
+                                volenv->state        = ENV_SUSTAIN;
+                            }
+                            attenuation += volenv->value_db_oct;
+                            break;
+
+                        case ENV_RAMP_UP:
+                            /* Decay/release amount is in fraction of dBs and is always positive */
+                            volenv->value_db_oct += volenv->ramp_amount_db_oct;
+                            if (volenv->value_db_oct >= volenv->sustain_value_db_oct) {
+                                volenv->value_db_oct = volenv->sustain_value_db_oct;
+                                volenv->state        = ENV_SUSTAIN;
+                            }
+                            attenuation += volenv->value_db_oct;
+                            break;
 
-                    case ENV_RAMP_DOWN:
-                        /* Decay/release amount is in fraction of octave and is always positive */
-                        modenv->value_db_oct -= modenv->ramp_amount_db_oct;
-                        if (modenv->value_db_oct <= modenv->sustain_value_db_oct) {
-                            modenv->value_db_oct = modenv->sustain_value_db_oct;
-                            modenv->state        = ENV_SUSTAIN;
-                        }
-                        break;
+                        case ENV_SUSTAIN:
+                            attenuation += volenv->value_db_oct;
+                            break;
 
-                    case ENV_RAMP_UP:
-                        /* Decay/release amount is in fraction of octave and is always positive */
-                        modenv->value_db_oct += modenv->ramp_amount_db_oct;
-                        if (modenv->value_db_oct >= modenv->sustain_value_db_oct) {
-                            modenv->value_db_oct = modenv->sustain_value_db_oct;
-                            modenv->state        = ENV_SUSTAIN;
-                        }
-                        break;
-                }
+                        case ENV_STOPPED:
+                            attenuation = 0x1FFFFF;
+                            break;
+                    }
 
-                /* run lfos */
-                if (emu_voice->lfo1_delay_samples) {
-                    emu_voice->lfo1_delay_samples--;
-                } else {
-                    emu_voice->lfo1_count.addr += emu_voice->lfo1_speed;
-                    emu_voice->lfo1_count.int_address &= 0xFFFF;
-                }
-                if (emu_voice->lfo2_delay_samples) {
-                    emu_voice->lfo2_delay_samples--;
-                } else {
-                    emu_voice->lfo2_count.addr += emu_voice->lfo2_speed;
-                    emu_voice->lfo2_count.int_address &= 0xFFFF;
-                }
+                    emu8k_envelope_t *modenv = &emu_voice->mod_envelope;
+                    switch (modenv->state) {
+                        case ENV_DELAY:
+                            modenv->delay_samples--;
+                            if (modenv->delay_samples <= 0) {
+                                modenv->state         = ENV_ATTACK;
+                                modenv->delay_samples = 0;
+                            }
+                            break;
+
+                        case ENV_ATTACK:
+                            /* Attack amount is in linear amplitude */
+                            modenv->value_amp_hz += modenv->attack_amount_amp_hz;
+                            modenv->value_db_oct = env_mod_hertz_to_octave[modenv->value_amp_hz >> 5] << 5;
+                            if (modenv->value_amp_hz >= (1 << 21)) {
+                                modenv->value_amp_hz = 1 << 21;
+                                modenv->value_db_oct = 1 << 21;
+                                if (modenv->hold_samples) {
+                                    modenv->state = ENV_HOLD;
+                                } else {
+                                    modenv->state = ENV_RAMP_DOWN;
+                                }
+                            }
+                            break;
 
-                if (emu_voice->fixed_modenv_pitch_height) {
-                    /* modenv range 1<<21, pitch height range 1<<14 desired range 0x1000 (+/-one octave) */
-                    currentpitch += ((modenv->value_db_oct >> 9) * emu_voice->fixed_modenv_pitch_height) >> 14;
-                }
+                        case ENV_HOLD:
+                            modenv->hold_samples--;
+                            if (modenv->hold_samples <= 0) {
+                                modenv->state = ENV_RAMP_UP;
+                            }
+                            break;
+
+                        case ENV_RAMP_DOWN:
+                            /* Decay/release amount is in fraction of octave and is always positive */
+                            modenv->value_db_oct -= modenv->ramp_amount_db_oct;
+                            if (modenv->value_db_oct <= modenv->sustain_value_db_oct) {
+                                modenv->value_db_oct = modenv->sustain_value_db_oct;
+                                modenv->state        = ENV_SUSTAIN;
+                            }
+                            break;
+
+                        case ENV_RAMP_UP:
+                            /* Decay/release amount is in fraction of octave and is always positive */
+                            modenv->value_db_oct += modenv->ramp_amount_db_oct;
+                            if (modenv->value_db_oct >= modenv->sustain_value_db_oct) {
+                                modenv->value_db_oct = modenv->sustain_value_db_oct;
+                                modenv->state        = ENV_SUSTAIN;
+                            }
+                            break;
+                    }
 
-                if (emu_voice->fixed_lfo1_vibrato) {
-                    /* table range 1<<15, pitch mod range 1<<14 desired range 0x1000 (+/-one octave) */
-                    int32_t lfo1_vibrato = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_vibrato) >> 17;
-                    currentpitch += lfo1_vibrato;
-                }
-                if (emu_voice->fixed_lfo2_vibrato) {
-                    /* table range 1<<15, pitch mod range 1<<14 desired range 0x1000 (+/-one octave) */
-                    int32_t lfo2_vibrato = (lfotable[emu_voice->lfo2_count.int_address] * emu_voice->fixed_lfo2_vibrato) >> 17;
-                    currentpitch += lfo2_vibrato;
-                }
+                    /* run lfos */
+                    if (emu_voice->lfo1_delay_samples) {
+                        emu_voice->lfo1_delay_samples--;
+                    } else {
+                        emu_voice->lfo1_count.addr += emu_voice->lfo1_speed;
+                        emu_voice->lfo1_count.int_address &= 0xFFFF;
+                    }
+                    if (emu_voice->lfo2_delay_samples) {
+                        emu_voice->lfo2_delay_samples--;
+                    } else {
+                        emu_voice->lfo2_count.addr += emu_voice->lfo2_speed;
+                        emu_voice->lfo2_count.int_address &= 0xFFFF;
+                    }
 
-                if (emu_voice->fixed_modenv_filter_height) {
-                    /* modenv range 1<<21, pitch height range 1<<14 desired range 0x200000 (+/-full filter range) */
-                    filtercut += ((modenv->value_db_oct >> 9) * emu_voice->fixed_modenv_filter_height) >> 5;
-                }
+                    if (emu_voice->fixed_modenv_pitch_height) {
+                        /* modenv range 1<<21, pitch height range 1<<14 desired range 0x1000 (+/-one octave) */
+                        currentpitch += ((modenv->value_db_oct >> 9) * emu_voice->fixed_modenv_pitch_height) >> 14;
+                    }
 
-                if (emu_voice->fixed_lfo1_filt_mod) {
-                    /* table range 1<<15, pitch mod range 1<<14 desired range 0x100000 (+/-three octaves) */
-                    int32_t lfo1_filtmod = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_filt_mod) >> 9;
-                    filtercut += lfo1_filtmod;
-                }
+                    if (emu_voice->fixed_lfo1_vibrato) {
+                        /* table range 1<<15, pitch mod range 1<<14 desired range 0x1000 (+/-one octave) */
+                        int32_t lfo1_vibrato = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_vibrato) >> 17;
+                        currentpitch += lfo1_vibrato;
+                    }
+                    if (emu_voice->fixed_lfo2_vibrato) {
+                        /* table range 1<<15, pitch mod range 1<<14 desired range 0x1000 (+/-one octave) */
+                        int32_t lfo2_vibrato = (lfotable[emu_voice->lfo2_count.int_address] * emu_voice->fixed_lfo2_vibrato) >> 17;
+                        currentpitch += lfo2_vibrato;
+                    }
+
+                    if (emu_voice->fixed_modenv_filter_height) {
+                        /* modenv range 1<<21, pitch height range 1<<14 desired range 0x200000 (+/-full filter range) */
+                        filtercut += ((modenv->value_db_oct >> 9) * emu_voice->fixed_modenv_filter_height) >> 5;
+                    }
 
-                if (emu_voice->fixed_lfo1_tremolo) {
-                    /* table range 1<<15, pitch mod range 1<<14 desired range 0x40000 (+/-12dBs). */
-                    int32_t lfo1_tremolo = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_tremolo) >> 11;
-                    attenuation += lfo1_tremolo;
+                    if (emu_voice->fixed_lfo1_filt_mod) {
+                        /* table range 1<<15, pitch mod range 1<<14 desired range 0x100000 (+/-three octaves) */
+                        int32_t lfo1_filtmod = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_filt_mod) >> 9;
+                        filtercut += lfo1_filtmod;
+                    }
+
+                    if (emu_voice->fixed_lfo1_tremolo) {
+                        /* table range 1<<15, pitch mod range 1<<14 desired range 0x40000 (+/-12dBs). */
+                        int32_t lfo1_tremolo = (lfotable[emu_voice->lfo1_count.int_address] * emu_voice->fixed_lfo1_tremolo) >> 11;
+                        attenuation += lfo1_tremolo;
+                    }
+
+                    if (currentpitch > 0xFFFF)
+                        currentpitch = 0xFFFF;
+                    if (currentpitch < 0)
+                        currentpitch = 0;
+                    if (attenuation > 0x1FFFFF)
+                        attenuation = 0x1FFFFF;
+                    if (attenuation < 0)
+                        attenuation = 0;
+                    if (filtercut > 0x1FFFFF)
+                        filtercut = 0x1FFFFF;
+                    if (filtercut < 0)
+                        filtercut = 0;
+
+                    emu_voice->vtft_vol_target    = env_vol_db_to_vol_target[attenuation >> 5];
+                    emu_voice->vtft_filter_target = filtercut >> 5;
+                    emu_voice->ptrx_pit_target    = freqtable[currentpitch] >> 18;
+                }
+                /*
+                I've recopilated these sentences to get an idea of how to loop
+
+                - Set its PSST register and its CLS register to zero to cause no loops to occur.
+                -Setting the Loop Start Offset and the Loop End Offset to the same value, will cause the oscillator to loop the entire memory.
+
+                -Setting the PlayPosition greater than the Loop End Offset, will cause the oscillator to play in reverse, back to the Loop End Offset.
+                   It's pretty neat, but appears to be uncontrollable (the rate at which the samples are played in reverse).
+
+                -Note that due to interpolator offset, the actual loop point is one greater than the start address
+                -Note that due to interpolator offset, the actual loop point will end at an address one greater than the loop address
+                -Note that the actual audio location is the point 1 word higher than this value due to interpolation offset
+                -In programs that use the awe, they generally set the loop address as "loopaddress -1" to compensate for the above.
+                (Note: I am already using address+1 in the interpolators so these things are already as they should.)
+                */
+                emu_voice->addr.addr += ((uint64_t) emu_voice->cpf_curr_pitch) << 18;
+                if (emu_voice->addr.addr >= emu_voice->loop_end.addr) {
+                    emu_voice->addr.int_address -= (emu_voice->loop_end.int_address - emu_voice->loop_start.int_address);
+                    emu_voice->addr.int_address &= EMU8K_MEM_ADDRESS_MASK;
                 }
 
-                if (currentpitch > 0xFFFF)
-                    currentpitch = 0xFFFF;
-                if (currentpitch < 0)
-                    currentpitch = 0;
-                if (attenuation > 0x1FFFFF)
-                    attenuation = 0x1FFFFF;
-                if (attenuation < 0)
-                    attenuation = 0;
-                if (filtercut > 0x1FFFFF)
-                    filtercut = 0x1FFFFF;
-                if (filtercut < 0)
-                    filtercut = 0;
-
-                emu_voice->vtft_vol_target    = env_vol_db_to_vol_target[attenuation >> 5];
-                emu_voice->vtft_filter_target = filtercut >> 5;
-                emu_voice->ptrx_pit_target    = freqtable[currentpitch] >> 18;
-            }
-            /*
-            I've recopilated these sentences to get an idea of how to loop
-
-            - Set its PSST register and its CLS register to zero to cause no loops to occur.
-            -Setting the Loop Start Offset and the Loop End Offset to the same value, will cause the oscillator to loop the entire memory.
-
-            -Setting the PlayPosition greater than the Loop End Offset, will cause the oscillator to play in reverse, back to the Loop End Offset.
-               It's pretty neat, but appears to be uncontrollable (the rate at which the samples are played in reverse).
-
-            -Note that due to interpolator offset, the actual loop point is one greater than the start address
-            -Note that due to interpolator offset, the actual loop point will end at an address one greater than the loop address
-            -Note that the actual audio location is the point 1 word higher than this value due to interpolation offset
-            -In programs that use the awe, they generally set the loop address as "loopaddress -1" to compensate for the above.
-            (Note: I am already using address+1 in the interpolators so these things are already as they should.)
-            */
-            emu_voice->addr.addr += ((uint64_t) emu_voice->cpf_curr_pitch) << 18;
-            if (emu_voice->addr.addr >= emu_voice->loop_end.addr) {
-                emu_voice->addr.int_address -= (emu_voice->loop_end.int_address - emu_voice->loop_start.int_address);
-                emu_voice->addr.int_address &= EMU8K_MEM_ADDRESS_MASK;
+                /* TODO: How and when are the target and current values updated */
+                emu_voice->cpf_curr_pitch       = emu_voice->ptrx_pit_target;
+                emu_voice->cvcf_curr_volume     = emu8k_vol_slide(&emu_voice->volumeslide, emu_voice->vtft_vol_target);
+                emu_voice->cvcf_curr_filt_ctoff = emu_voice->vtft_filter_target;
             }
-
-            /* TODO: How and when are the target and current values updated */
-            emu_voice->cpf_curr_pitch       = emu_voice->ptrx_pit_target;
-            emu_voice->cvcf_curr_volume     = emu8k_vol_slide(&emu_voice->volumeslide, emu_voice->vtft_vol_target);
-            emu_voice->cvcf_curr_filt_ctoff = emu_voice->vtft_filter_target;
         }
 
+        emu8k_render_voices(emu8k, &emu8k->buffer[block_pos * 2], &emu8k->reverb_in_buffer[block_pos],
+                            &emu8k->chorus_in_buffer[block_pos], block_len);
+    }
+
+    for (c = 0; c < 32; c++) {
+        emu_voice = &emu8k->voice[c];
+
         /* Update EMU voice registers. */
         emu_voice->ccca               = (((uint32_t) emu_voice->ccca_qcontrol) << 24) | emu_voice->addr.int_address;
         emu_voice->cpf_curr_frac_addr = emu_voice->addr.fract_address;
@@ -2015,7 +2372,7 @@ emu8k_update(emu8k_t *emu8k)
     }
 
     buf = &emu8k->buffer[emu8k->pos * 2];
-    emu8k_work_reverb(&emu8k->reverb_in_buffer[emu8k->pos], buf, &emu8k->reverb_engine, new_pos - emu8k->pos);
+    emu8k_render_reverb(&emu8k->reverb_in_buffer[emu8k->pos], buf, &emu8k->reverb_engine, new_pos - emu8k->pos);
     emu8k_work_chorus(&emu8k->chorus_in_buffer[emu8k->pos], buf, &emu8k->chorus_engine, new_pos - emu8k->pos);
     emu8k_work_eq(buf, new_pos - emu8k->pos);
 
@@ -2057,62 +2414,12 @@ emu8k_change_addr(emu8k_t *emu8k, uint16_t emu_addr)
     }
 }
 
-/* onboard_ram in kilobytes */
-void
-emu8k_init(emu8k_t *emu8k, uint16_t emu_addr, int onboard_ram)
+/* Builds the conversion tables, and sets the power on state of the effects engine. */
+static void
+emu8k_init_engine(emu8k_t *emu8k)
 {
-    uint32_t const BLOCK_SIZE_WORDS = 0x10000;
-    FILE          *f;
-    int            c;
-    double         out;
-
-    f = rom_fopen("roms/sound/awe32.raw", "rb");
-    if (!f)
-        fatal("AWE32.RAW not found\n");
-
-    emu8k->rom = malloc(1024 * 1024);
-    if (fread(emu8k->rom, 1, 1048576, f) != 1048576)
-        fatal("emu8k_init(): Error reading data\n");
-    fclose(f);
-    /*AWE-DUMP creates ROM images offset by 2 bytes, so if we detect this
-      then correct it*/
-    if (emu8k->rom[3] == 0x314d && emu8k->rom[4] == 0x474d) {
-        memmove(&emu8k->rom[0], &emu8k->rom[1], (1024 * 1024) - 2);
-        emu8k->rom[0x7ffff] = 0;
-    }
-
-    emu8k->empty = malloc(2 * BLOCK_SIZE_WORDS);
-    memset(emu8k->empty, 0, 2 * BLOCK_SIZE_WORDS);
-
-    int j = 0;
-    for (; j < 0x8; j++) {
-        emu8k->ram_pointers[j] = emu8k->rom + (j * BLOCK_SIZE_WORDS);
-    }
-    for (; j < 0x20; j++) {
-        emu8k->ram_pointers[j] = emu8k->empty;
-    }
-
-    if (onboard_ram) {
-        /*Clip to 28MB, since that's the max that we can address. */
-        if (onboard_ram > 0x7000)
-            onboard_ram = 0x7000;
-        emu8k->ram = malloc(onboard_ram * 1024);
-        memset(emu8k->ram, 0, onboard_ram * 1024);
-        const int i_end = onboard_ram >> 7;
-        int       i     = 0;
-        for (; i < i_end; i++, j++) {
-            emu8k->ram_pointers[j] = emu8k->ram + (i * BLOCK_SIZE_WORDS);
-        }
-        emu8k->ram_end_addr = EMU8K_RAM_MEM_START + (onboard_ram << 9);
-    } else {
-        emu8k->ram          = 0;
-        emu8k->ram_end_addr = EMU8K_RAM_MEM_START;
-    }
-    for (; j < 0x100; j++) {
-        emu8k->ram_pointers[j] = emu8k->empty;
-    }
-
-    emu8k_change_addr(emu8k, emu_addr);
+    int    c;
+    double out;
 
     /*Create frequency table. (Convert initial pitch register value to a linear speed change)
      * The input is encoded such as 0xe000 is center note (no pitch shift)
@@ -2280,9 +2587,325 @@ emu8k_init(emu8k_t *emu8k, uint16_t emu_addr, int onboard_ram)
     emu8k->hwcf3 = 0x00;
 }
 
+/* onboard_ram in kilobytes */
+void
+emu8k_init(emu8k_t *emu8k, uint16_t emu_addr, int onboard_ram)
+{
+    uint32_t const BLOCK_SIZE_WORDS = 0x10000;
+    FILE          *f;
+
+    f = rom_fopen("roms/sound/awe32.raw", "rb");
+    if (!f)
+        fatal("AWE32.RAW not found\n");
+
+    emu8k->rom = malloc(1024 * 1024);
+    if (fread(emu8k->rom, 1, 1048576, f) != 1048576)
+        fatal("emu8k_init(): Error reading data\n");
+    fclose(f);
+    /*AWE-DUMP creates ROM images offset by 2 bytes, so if we detect this
+      then correct it*/
+    if (emu8k->rom[3] == 0x314d && emu8k->rom[4] == 0x474d) {
+        memmove(&emu8k->rom[0], &emu8k->rom[1], (1024 * 1024) - 2);
+        emu8k->rom[0x7ffff] = 0;
+    }
+
+    emu8k->empty = malloc(2 * BLOCK_SIZE_WORDS);
+    memset(emu8k->empty, 0, 2 * BLOCK_SIZE_WORDS);
+
+    int j = 0;
+    for (; j < 0x8; j++) {
+        emu8k->ram_pointers[j] = emu8k->rom + (j * BLOCK_SIZE_WORDS);
+    }
+    for (; j < 0x20; j++) {
+        emu8k->ram_pointers[j] = emu8k->empty;
+    }
+
+    if (onboard_ram) {
+        /*Clip to 28MB, since that's the max that we can address. */
+        if (onboard_ram > 0x7000)
+            onboard_ram = 0x7000;
+        emu8k->ram = malloc(onboard_ram * 1024);
+        memset(emu8k->ram, 0, onboard_ram * 1024);
+        const int i_end = onboard_ram >> 7;
+        int       i     = 0;
+        for (; i < i_end; i++, j++) {
+            emu8k->ram_pointers[j] = emu8k->ram + (i * BLOCK_SIZE_WORDS);
+        }
+        emu8k->ram_end_addr = EMU8K_RAM_MEM_START + (onboard_ram << 9);
+    } else {
+        emu8k->ram          = 0;
+        emu8k->ram_end_addr = EMU8K_RAM_MEM_START;
+    }
+    for (; j < 0x100; j++) {
+        emu8k->ram_pointers[j] = emu8k->empty;
+    }
+
+    emu8k_change_addr(emu8k, emu_addr);
+
+    emu8k_init_engine(emu8k);
+    emu8k_render_select(1);
+}
+
 void
 emu8k_close(emu8k_t *emu8k)
 {
     free(emu8k->rom);
     free(emu8k->ram);
 }
+
+#ifdef USE_INSTRUMENT
+/*EMU8000 benchmark.
+
+  Plays the same synthetic song twice, first through the plain C output stage
+  and reverb and then through the ones picked for this host. It prints the
+  rates as JSON, along with whether the C output matches a stored checksum of
+  the voice loop from before the block renderer and whether the C and SIMD
+  paths give the same output. Everything goes through the register
+  interface as a driver would do it: the effects engine is set up, then notes
+  with random envelopes, LFOs, filters and pans are started and released on
+  all 32 voices, over looped waveforms in onboard RAM. No ROM is needed.*/
+#    define BENCH_SECONDS   10
+#    define BENCH_RAM_KB    512
+#    define BENCH_WAVES     32
+#    define BENCH_WAVE_SIZE 4096
+/* The song as rendered by the voice loop from before the block renderer,
+   with the output pointer fix applied. Generated on x86-64; the engine's
+   tables come from the C library's math functions, so another one may give
+   a different result. */
+#    define BENCH_OLD_CHECKSUM 0x5aed423e
+
+static uint32_t emu8k_bench_seed;
+
+static uint32_t
+emu8k_bench_rand(void)
+{
+    emu8k_bench_seed = emu8k_bench_seed * 1103515245 + 12345;
+    return emu8k_bench_seed >> 8;
+}
+
+/* A triangle wave from -32768 to 32767 over a 16-bit phase. */
+static int32_t
+emu8k_bench_triangle(uint32_t phase)
+{
+    phase &= 0xffff;
+    return (phase < 0x8000) ? ((int32_t) (phase * 2) - 0x8000) : (0x17fff - (int32_t) (phase * 2));
+}
+
+/* FNV-1a over the sample values, independent of the host byte order. */
+static uint32_t
+emu8k_bench_checksum(const int32_t *buf, int len)
+{
+    uint32_t sum = 2166136261u;
+
+    for (int c = 0; c < len; c++) {
+        for (int b = 0; b < 32; b += 8) {
+            sum ^= ((uint32_t) buf[c] >> b) & 0xff;
+            sum *= 16777619u;
+        }
+    }
+
+    return sum;
+}
+
+static void
+emu8k_bench_outw(emu8k_t *emu8k, uint16_t port, int reg, int voice, uint16_t val)
+{
+    emu8k_outw(emu8k->addr + 0x802, (reg << 5) | voice, emu8k);
+    emu8k_outw(port, val, emu8k);
+}
+
+static void
+emu8k_bench_outl(emu8k_t *emu8k, uint16_t port, int reg, int voice, uint32_t val)
+{
+    emu8k_bench_outw(emu8k, port, reg, voice, val & 0xffff);
+    emu8k_outw(port + 2, val >> 16, emu8k);
+}
+
+static void
+emu8k_bench_note_on(emu8k_t *emu8k, int voice)
+{
+    const uint16_t data0 = emu8k->addr;
+    const uint16_t data1 = emu8k->addr + 0x400;
+    const uint16_t data2 = emu8k->addr + 0x402;
+    const uint16_t data3 = emu8k->addr + 0x800;
+    const uint32_t start = EMU8K_RAM_MEM_START + (emu8k_bench_rand() % BENCH_WAVES) * BENCH_WAVE_SIZE;
+    const uint16_t pitch = 0xd000 + (emu8k_bench_rand() & 0x1fff);
+
+    /* Stop the voice, then set it up with the envelope engine off. */
+    emu8k_bench_outw(emu8k, data1, 5, voice, 0x0080);
+    emu8k_bench_outl(emu8k, data0, 3, voice, 0x0000ffff);
+    emu8k_bench_outl(emu8k, data0, 2, voice, 0x0000ffff);
+    emu8k_bench_outl(emu8k, data0, 1, voice, 0);
+    emu8k_bench_outl(emu8k, data0, 0, voice, 0);
+
+    emu8k_bench_outw(emu8k, data1, 4, voice, 0x8000 - (emu8k_bench_rand() & 0xff));
+    emu8k_bench_outw(emu8k, data2, 4, voice, 0x7f00 | (0x10 + (emu8k_bench_rand() & 0x3f)));
+    emu8k_bench_outw(emu8k, data1, 6, voice, 0x8000);
+    emu8k_bench_outw(emu8k, data1, 7, voice, (emu8k_bench_rand() & 0x7f00) | 0x20);
+    emu8k_bench_outw(emu8k, data2, 6, voice, 0x7f00 | (0x18 + (emu8k_bench_rand() & 0x3f)));
+    emu8k_bench_outw(emu8k, data2, 5, voice, 0x8000);
+    emu8k_bench_outw(emu8k, data2, 7, voice, 0x8000 - (emu8k_bench_rand() & 0x3ff));
+
+    emu8k_bench_outw(emu8k, data3, 0, voice, pitch);
+    emu8k_bench_outw(emu8k, data3, 1, voice, ((0x60 + (emu8k_bench_rand() & 0x9f)) << 8) | (emu8k_bench_rand() & 0x3f));
+    emu8k_bench_outw(emu8k, data3, 2, voice, emu8k_bench_rand() & 0x3f3f);
+    emu8k_bench_outw(emu8k, data3, 3, voice, emu8k_bench_rand() & 0x0f1f);
+    emu8k_bench_outw(emu8k, data3, 4, voice, emu8k_bench_rand() & 0x0f3f);
+    emu8k_bench_outw(emu8k, data3, 5, voice, emu8k_bench_rand() & 0x0f3f);
+
+    emu8k_bench_outl(emu8k, data0, 6, voice, ((emu8k_bench_rand() & 0xff) << 24) | (start + 0x100));
+    emu8k_bench_outl(emu8k, data0, 7, voice, ((emu8k_bench_rand() & 0x7f) << 24) | (start + BENCH_WAVE_SIZE - 8));
+    emu8k_bench_outl(emu8k, data1, 0, voice, ((emu8k_bench_rand() & 0xf) << 28) | start);
+
+    emu8k_bench_outl(emu8k, data0, 1, voice, ((uint32_t) (freqtable[pitch] >> 18) << 16) | ((emu8k_bench_rand() & 0x7f) << 8));
+    emu8k_bench_outl(emu8k, data0, 0, voice, (uint32_t) (freqtable[pitch] >> 18) << 16);
+    emu8k_bench_outl(emu8k, data0, 3, voice, 0xffffffff);
+    emu8k_bench_outl(emu8k, data0, 2, voice, 0x0000ffff);
+
+    /* Turning on the envelope engine starts the note. */
+    emu8k_bench_outw(emu8k, data1, 5, voice, (emu8k_bench_rand() & 0x7f00) | 0x18);
+}
+
+static void
+emu8k_bench_note_off(emu8k_t *emu8k, int voice)
+{
+    emu8k_bench_outw(emu8k, emu8k->addr + 0x400, 5, voice, 0x8000 | (0x10 + (emu8k_bench_rand() & 0x3f)));
+    emu8k_bench_outw(emu8k, emu8k->addr + 0x400, 7, voice, 0x8000 | (0x10 + (emu8k_bench_rand() & 0x3f)));
+}
+
+static uint32_t
+emu8k_bench_run(int16_t *wave, int32_t *out)
+{
+    emu8k_t *emu8k;
+    uint16_t data1, data2;
+    uint32_t start;
+    int      buffers = BENCH_SECONDS * 50;
+    int      voice   = 0;
+    int      b, c, j;
+
+    emu8k = calloc(1, sizeof(emu8k_t));
+    if (!emu8k)
+        fatal("emu8k_benchmark: out of memory\n");
+    emu8k->empty = calloc(1, 0x20000);
+    if (!emu8k->empty)
+        fatal("emu8k_benchmark: out of memory\n");
+
+    for (j = 0; j < 0x100; j++)
+        emu8k->ram_pointers[j] = emu8k->empty;
+    for (j = 0; j < (BENCH_RAM_KB >> 7); j++)
+        emu8k->ram_pointers[0x20 + j] = wave + (j * 0x10000);
+    emu8k->ram          = wave;
+    emu8k->ram_end_addr = EMU8K_RAM_MEM_START + (BENCH_RAM_KB << 9);
+    emu8k->addr         = 0x620;
+    data1               = emu8k->addr + 0x400;
+    data2               = emu8k->addr + 0x402;
+
+    emu8k_init_engine(emu8k);
+    emu8k_bench_seed = 1;
+    sound_pos_global = 0;
+
+    start = plat_get_micro_ticks();
+
+    /* Unmute, then set up the reverb and chorus. */
+    emu8k_bench_outw(emu8k, data1, 1, 31, 0x0004);
+    emu8k_bench_outw(emu8k, data1, 2, 0x03, 0x0090);
+    emu8k_bench_outw(emu8k, data1, 2, 0x05, 0x0070);
+    emu8k_bench_outw(emu8k, data1, 2, 0x07, 0x8474);
+    emu8k_bench_outw(emu8k, data1, 2, 0x09, 0x0007);
+    emu8k_bench_outw(emu8k, data1, 2, 0x0f, 0x00b0);
+    emu8k_bench_outw(emu8k, data1, 2, 0x11, 0x0006);
+    emu8k_bench_outw(emu8k, data1, 2, 0x17, 0x0090);
+    emu8k_bench_outw(emu8k, data1, 2, 0x19, 0x0005);
+    emu8k_bench_outw(emu8k, data1, 2, 0x1f, 0x0070);
+    emu8k_bench_outw(emu8k, data2, 2, 0x01, 0x0006);
+    emu8k_bench_outw(emu8k, data2, 2, 0x07, 0x0080);
+    emu8k_bench_outw(emu8k, data2, 2, 0x09, 0x0005);
+    emu8k_bench_outw(emu8k, data2, 2, 0x0f, 0x0060);
+    emu8k_bench_outw(emu8k, data2, 2, 0x11, 0x0004);
+    emu8k_bench_outw(emu8k, data2, 2, 0x14, 0x0500);
+    emu8k_bench_outw(emu8k, data2, 2, 0x16, 0x0600);
+    emu8k_bench_outw(emu8k, data2, 2, 0x17, 0x0050);
+    emu8k_bench_outw(emu8k, data2, 2, 0x1d, 0x0040);
+    emu8k_bench_outw(emu8k, data1, 3, 0x01, 0x00a0);
+    emu8k_bench_outw(emu8k, data1, 3, 0x09, 0x0040);
+    emu8k_bench_outw(emu8k, data1, 3, 0x0c, 0x0400);
+    emu8k_bench_outw(emu8k, data2, 3, 0x03, 0x0060);
+    emu8k_bench_outw(emu8k, data2, 3, 0x1f, 0x0070);
+    emu8k_bench_outl(emu8k, data1, 1, 9, 0x00000800);
+    emu8k_bench_outl(emu8k, data1, 1, 10, 0x00000400);
+
+    for (b = 0; b < buffers; b++) {
+        /* A few note events somewhere in each buffer. */
+        sound_pos_global = emu8k_bench_rand() % SOUNDBUFLEN;
+        for (c = emu8k_bench_rand() & 3; c > 0; c--) {
+            emu8k_bench_note_on(emu8k, voice);
+            voice = (voice + 1) & 31;
+        }
+        if (emu8k_bench_rand() & 1)
+            emu8k_bench_note_off(emu8k, emu8k_bench_rand() & 31);
+
+        sound_pos_global = SOUNDBUFLEN;
+        emu8k_update(emu8k);
+        memcpy(&out[b * (SOUNDBUFLEN * 44100 / 48000) * 2], emu8k->buffer, emu8k->pos * 2 * sizeof(int32_t));
+        emu8k->pos = 0;
+    }
+
+    start = plat_get_micro_ticks() - start;
+
+    free(emu8k->empty);
+    free(emu8k);
+
+    return start;
+}
+
+void
+emu8k_benchmark(void)
+{
+    const int samples    = BENCH_SECONDS * 50 * (SOUNDBUFLEN * 44100 / 48000);
+    int       old_pos    = sound_pos_global;
+    int16_t  *wave;
+    int32_t  *ref, *out;
+    uint32_t  c_us, simd_us;
+    uint32_t  checksum;
+    int       c;
+
+    wave = malloc(BENCH_RAM_KB * 1024);
+    ref  = malloc(samples * 2 * sizeof(int32_t));
+    out  = malloc(samples * 2 * sizeof(int32_t));
+    if (!wave || !ref || !out)
+        fatal("emu8k_benchmark: out of memory\n");
+
+    /* Waveforms with a few harmonics and some noise, like sampled instruments.
+       Integer only, so that the song is the same with any C library. */
+    emu8k_bench_seed = 1;
+    for (c = 0; c < (BENCH_RAM_KB * 512); c++) {
+        uint32_t phase = ((c % BENCH_WAVE_SIZE) * (1 + (c / BENCH_WAVE_SIZE) % 8)) << 8;
+
+        wave[c] = (int16_t) ((12000 * emu8k_bench_triangle(phase) + 6000 * emu8k_bench_triangle(phase * 2) +
+                              3000 * emu8k_bench_triangle(phase * 5)) / 32768 +
+                             (int) (emu8k_bench_rand() % 2000) - 1000);
+    }
+
+    emu8k_render_select(0);
+    c_us = emu8k_bench_run(wave, ref);
+    emu8k_render_select(1);
+    simd_us          = emu8k_bench_run(wave, out);
+    sound_pos_global = old_pos;
+    checksum         = emu8k_bench_checksum(ref, samples * 2);
+
+    printf("{\n");
+    printf("    \"seconds\": %i,\n", BENCH_SECONDS);
+    printf("    \"voices\": 32,\n");
+    printf("    \"c_ksamples_per_sec\": %.1f,\n", (double) samples * 1000.0 / (c_us ? c_us : 1));
+    printf("    \"simd_ksamples_per_sec\": %.1f,\n", (double) samples * 1000.0 / (simd_us ? simd_us : 1));
+    printf("    \"checksum\": \"%08x\",\n", checksum);
+    printf("    \"matches_old\": %s,\n", (checksum == BENCH_OLD_CHECKSUM) ? "true" : "false");
+    printf("    \"exact\": %s\n", memcmp(ref, out, samples * 2 * sizeof(int32_t)) ? "false" : "true");
+    printf("}\n");
+    fflush(stdout);
+
+    free(out);
+    free(ref);
+    free(wave);
+}
+#endif
@@ -44,6 +44,9 @@ enum {
     GUS_MAX     = 1,
 };
 
+/*Number of output samples rendered ahead by gus_render_block()*/
+#define GUS_BLOCK_LEN 64
+
 typedef struct gus_t {
     int reset;
 
@@ -74,6 +77,21 @@ typedef struct gus_t {
     int16_t buffer[2][SOUNDBUFLEN];
     int     pos;
 
+    /*Voice output rendered ahead of the sample timer. The voice state is
+      that at the end of the block; the state at its start is kept so that
+      gus_sync_voices() can return to the sample the timer has reached.*/
+    int32_t  block_l[GUS_BLOCK_LEN], block_r[GUS_BLOCK_LEN];
+    int      block_len, block_pos;
+    uint32_t block_waveirqs, block_rampirqs;
+    uint32_t block_cur[32];
+    int      block_rcur[32];
+    uint8_t  block_ctrl[32], block_rctrl[32];
+
+    /*Samples scaled by the volume vol_tab_vol[voice], for voices whose
+      volume isn't ramping*/
+    int16_t vol_tab[32][256];
+    int     vol_tab_vol[32];
+
     pc_timer_t samp_timer;
     uint64_t   samp_latch;
 
@@ -124,6 +142,8 @@ int gusfreqs[] = {
 
 double vol16bit[4096];
 
+static void gus_sync_voices(gus_t *gus);
+
 void
 gus_update_int_status(gus_t *gus)
 {
@@ -214,6 +234,9 @@ writegus(uint16_t addr, uint8_t val, void *p)
     else
         port = addr & 0xf0f;
 
+    if ((port == 0x304) || (port == 0x305) || (port == 0x307))
+        gus_sync_voices(gus);
+
     switch (port) {
         case 0x300: /*MIDI control*/
             old            = gus->midi_ctrl;
@@ -633,6 +656,9 @@ readgus(uint16_t addr, void *p)
     else
         port = addr & 0xf0f;
 
+    if ((port == 0x304) || (port == 0x305) || (port == 0x307))
+        gus_sync_voices(gus);
+
     switch (port) {
         case 0x300: /*MIDI status*/
             val = gus->midi_status;
@@ -920,138 +946,292 @@ gus_update(gus_t *gus)
     }
 }
 
-void
-gus_poll_wave(void *p)
+/*Steps voice d for up to n samples, adding its output to out_l/out_r. Stops
+  after a sample that raises a new wave or ramp IRQ, which is recorded in
+  block_waveirqs/block_rampirqs rather than set, and returns the number of
+  samples stepped.*/
+static int
+gus_render_voice(gus_t *gus, int d, int n, int32_t *out_l, int32_t *out_r)
 {
-    gus_t   *gus = (gus_t *) p;
+    uint8_t *ram     = gus->ram;
+    uint32_t cur     = gus->cur[d];
+    uint32_t start   = gus->start[d];
+    uint32_t end     = gus->end[d];
+    uint32_t step    = gus->freq[d] >> 1;
+    int      interp  = !(gus->freq[d] >> 10);
+    uint8_t  ctrl    = gus->ctrl[d];
+    int      rcur    = gus->rcur[d];
+    int      rstart  = gus->rstart[d];
+    int      rend    = gus->rend[d];
+    int      rfreq   = gus->rfreq[d];
+    uint8_t  rctrl   = gus->rctrl[d];
+    int      pan_l   = gus->pan_l[d];
+    int      pan_r   = gus->pan_r[d];
+    int      waveirq = gus->waveirqs[d];
+    int      rampirq = gus->rampirqs[d];
+    int16_t *vol_tab = NULL;
     uint32_t addr;
-    int      d;
     int16_t  v;
     int32_t  vl;
-    int      update_irqs = 0;
-
-    gus_update(gus);
-
-    timer_advance_u64(&gus->samp_timer, gus->samp_latch);
+    int      new_irq;
+    int      c;
+
+    if ((ctrl & 3) && (rctrl & 3))
+        return n;
+
+    if (rctrl & 3) {
+        /*The volume stays put, so look the scaled samples up. Samples are
+          always in the 8-bit range at this point.*/
+        int vol = ((rcur >> 14) > 4095) ? 4095 : ((rcur >> 10) & 4095);
+
+        vol_tab = gus->vol_tab[d];
+        if (gus->vol_tab_vol[d] != vol) {
+            for (c = 0; c < 256; c++) {
+                v          = c - 128;
+                vol_tab[c] = (int16_t) (float) (v) *24.0 * vol16bit[vol];
+            }
+            gus->vol_tab_vol[d] = vol;
+        }
+    }
 
-    gus->out_l = gus->out_r = 0;
+    for (c = 0; c < n;) {
+        new_irq = 0;
 
-    if ((gus->reset & 3) != 3)
-        return;
-    for (d = 0; d < 32; d++) {
-        if (!(gus->ctrl[d] & 3)) {
-            if (gus->ctrl[d] & 4) {
-                addr = gus->cur[d] >> 9;
+        if (!(ctrl & 3)) {
+            if (ctrl & 4) {
+                addr = cur >> 9;
                 addr = (addr & 0xC0000) | ((addr << 1) & 0x3FFFE);
-                if (!(gus->freq[d] >> 10)) /*Interpolate*/
-                {
-                    vl = (int16_t) (int8_t) ((gus->ram[(addr + 1) & 0xFFFFF] ^ 0x80) - 0x80) * (511 - (gus->cur[d] & 511));
-                    vl += (int16_t) (int8_t) ((gus->ram[(addr + 3) & 0xFFFFF] ^ 0x80) - 0x80) * (gus->cur[d] & 511);
+                if (interp) {
+                    vl = (int16_t) (int8_t) ((ram[(addr + 1) & 0xFFFFF] ^ 0x80) - 0x80) * (511 - (cur & 511));
+                    vl += (int16_t) (int8_t) ((ram[(addr + 3) & 0xFFFFF] ^ 0x80) - 0x80) * (cur & 511);
                     v = vl >> 9;
                 } else
-                    v = (int16_t) (int8_t) ((gus->ram[(addr + 1) & 0xFFFFF] ^ 0x80) - 0x80);
+                    v = (int16_t) (int8_t) ((ram[(addr + 1) & 0xFFFFF] ^ 0x80) - 0x80);
             } else {
-                if (!(gus->freq[d] >> 10)) /*Interpolate*/
-                {
-                    vl = ((int8_t) ((gus->ram[(gus->cur[d] >> 9) & 0xFFFFF] ^ 0x80) - 0x80)) * (511 - (gus->cur[d] & 511));
-                    vl += ((int8_t) ((gus->ram[((gus->cur[d] >> 9) + 1) & 0xFFFFF] ^ 0x80) - 0x80)) * (gus->cur[d] & 511);
+                if (interp) {
+                    vl = ((int8_t) ((ram[(cur >> 9) & 0xFFFFF] ^ 0x80) - 0x80)) * (511 - (cur & 511));
+                    vl += ((int8_t) ((ram[((cur >> 9) + 1) & 0xFFFFF] ^ 0x80) - 0x80)) * (cur & 511);
                     v = vl >> 9;
                 } else
-                    v = (int16_t) (int8_t) ((gus->ram[(gus->cur[d] >> 9) & 0xFFFFF] ^ 0x80) - 0x80);
+                    v = (int16_t) (int8_t) ((ram[(cur >> 9) & 0xFFFFF] ^ 0x80) - 0x80);
             }
 
-            if ((gus->rcur[d] >> 14) > 4095)
+            if (vol_tab)
+                v = vol_tab[v + 128];
+            else if ((rcur >> 14) > 4095)
                 v = (int16_t) (float) (v) *24.0 * vol16bit[4095];
             else
-                v = (int16_t) (float) (v) *24.0 * vol16bit[(gus->rcur[d] >> 10) & 4095];
-
-            gus->out_l += (v * gus->pan_l[d]) / 7;
-            gus->out_r += (v * gus->pan_r[d]) / 7;
-
-            if (gus->ctrl[d] & 0x40) {
-                gus->cur[d] -= (gus->freq[d] >> 1);
-                if (gus->cur[d] <= gus->start[d]) {
-                    int diff = gus->start[d] - gus->cur[d];
-
-                    if (gus->ctrl[d] & 8) {
-                        if (gus->ctrl[d] & 0x10)
-                            gus->ctrl[d] ^= 0x40;
-                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? (gus->end[d] - diff) : (gus->start[d] + diff);
-                    } else if (!(gus->rctrl[d] & 4)) {
-                        gus->ctrl[d] |= 1;
-                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? gus->end[d] : gus->start[d];
+                v = (int16_t) (float) (v) *24.0 * vol16bit[(rcur >> 10) & 4095];
+
+            out_l[c] += (v * pan_l) / 7;
+            out_r[c] += (v * pan_r) / 7;
+
+            if (ctrl & 0x40) {
+                cur -= step;
+                if (cur <= start) {
+                    int diff = start - cur;
+
+                    if (ctrl & 8) {
+                        if (ctrl & 0x10)
+                            ctrl ^= 0x40;
+                        cur = (ctrl & 0x40) ? (end - diff) : (start + diff);
+                    } else if (!(rctrl & 4)) {
+                        ctrl |= 1;
+                        cur = (ctrl & 0x40) ? end : start;
                     }
 
-                    if ((gus->ctrl[d] & 0x20) && !gus->waveirqs[d]) {
-                        gus->waveirqs[d] = 1;
-                        update_irqs      = 1;
+                    if ((ctrl & 0x20) && !waveirq) {
+                        gus->block_waveirqs |= (1 << d);
+                        new_irq = 1;
                     }
                 }
             } else {
-                gus->cur[d] += (gus->freq[d] >> 1);
-
-                if (gus->cur[d] >= gus->end[d]) {
-                    int diff = gus->cur[d] - gus->end[d];
-
-                    if (gus->ctrl[d] & 8) {
-                        if (gus->ctrl[d] & 0x10)
-                            gus->ctrl[d] ^= 0x40;
-                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? (gus->end[d] - diff) : (gus->start[d] + diff);
-                    } else if (!(gus->rctrl[d] & 4)) {
-                        gus->ctrl[d] |= 1;
-                        gus->cur[d] = (gus->ctrl[d] & 0x40) ? gus->end[d] : gus->start[d];
+                cur += step;
+
+                if (cur >= end) {
+                    int diff = cur - end;
+
+                    if (ctrl & 8) {
+                        if (ctrl & 0x10)
+                            ctrl ^= 0x40;
+                        cur = (ctrl & 0x40) ? (end - diff) : (start + diff);
+                    } else if (!(rctrl & 4)) {
+                        ctrl |= 1;
+                        cur = (ctrl & 0x40) ? end : start;
                     }
 
-                    if ((gus->ctrl[d] & 0x20) && !gus->waveirqs[d]) {
-                        gus->waveirqs[d] = 1;
-                        update_irqs      = 1;
+                    if ((ctrl & 0x20) && !waveirq) {
+                        gus->block_waveirqs |= (1 << d);
+                        new_irq = 1;
                     }
                 }
             }
         }
-        if (!(gus->rctrl[d] & 3)) {
-            if (gus->rctrl[d] & 0x40) {
-                gus->rcur[d] -= gus->rfreq[d];
-                if (gus->rcur[d] <= gus->rstart[d]) {
-                    int diff = gus->rstart[d] - gus->rcur[d];
-                    if (!(gus->rctrl[d] & 8)) {
-                        gus->rctrl[d] |= 1;
-                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? gus->rstart[d] : gus->rend[d];
+        if (!(rctrl & 3)) {
+            if (rctrl & 0x40) {
+                rcur -= rfreq;
+                if (rcur <= rstart) {
+                    int diff = rstart - rcur;
+                    if (!(rctrl & 8)) {
+                        rctrl |= 1;
+                        rcur = (rctrl & 0x40) ? rstart : rend;
                     } else {
-                        if (gus->rctrl[d] & 0x10)
-                            gus->rctrl[d] ^= 0x40;
-                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? (gus->rend[d] - diff) : (gus->rstart[d] + diff);
+                        if (rctrl & 0x10)
+                            rctrl ^= 0x40;
+                        rcur = (rctrl & 0x40) ? (rend - diff) : (rstart + diff);
                     }
 
-                    if ((gus->rctrl[d] & 0x20) && !gus->rampirqs[d]) {
-                        gus->rampirqs[d] = 1;
-                        update_irqs      = 1;
+                    if ((rctrl & 0x20) && !rampirq) {
+                        gus->block_rampirqs |= (1 << d);
+                        new_irq = 1;
                     }
                 }
             } else {
-                gus->rcur[d] += gus->rfreq[d];
-                if (gus->rcur[d] >= gus->rend[d]) {
-                    int diff = gus->rcur[d] - gus->rend[d];
-                    if (!(gus->rctrl[d] & 8)) {
-                        gus->rctrl[d] |= 1;
-                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? gus->rstart[d] : gus->rend[d];
+                rcur += rfreq;
+                if (rcur >= rend) {
+                    int diff = rcur - rend;
+                    if (!(rctrl & 8)) {
+                        rctrl |= 1;
+                        rcur = (rctrl & 0x40) ? rstart : rend;
                     } else {
-                        if (gus->rctrl[d] & 0x10)
-                            gus->rctrl[d] ^= 0x40;
-                        gus->rcur[d] = (gus->rctrl[d] & 0x40) ? (gus->rend[d] - diff) : (gus->rstart[d] + diff);
+                        if (rctrl & 0x10)
+                            rctrl ^= 0x40;
+                        rcur = (rctrl & 0x40) ? (rend - diff) : (rstart + diff);
                     }
 
-                    if ((gus->rctrl[d] & 0x20) && !gus->rampirqs[d]) {
-                        gus->rampirqs[d] = 1;
-                        update_irqs      = 1;
+                    if ((rctrl & 0x20) && !rampirq) {
+                        gus->block_rampirqs |= (1 << d);
+                        new_irq = 1;
                     }
                 }
             }
         }
+
+        c++;
+        if (new_irq)
+            break;
     }
 
-    if (update_irqs)
+    gus->cur[d]   = cur;
+    gus->ctrl[d]  = ctrl;
+    gus->rcur[d]  = rcur;
+    gus->rctrl[d] = rctrl;
+
+    return c;
+}
+
+static void
+gus_save_voices(gus_t *gus)
+{
+    memcpy(gus->block_cur, gus->cur, sizeof(gus->block_cur));
+    memcpy(gus->block_rcur, gus->rcur, sizeof(gus->block_rcur));
+    memcpy(gus->block_ctrl, gus->ctrl, sizeof(gus->block_ctrl));
+    memcpy(gus->block_rctrl, gus->rctrl, sizeof(gus->block_rctrl));
+}
+
+static void
+gus_restore_voices(gus_t *gus)
+{
+    memcpy(gus->cur, gus->block_cur, sizeof(gus->block_cur));
+    memcpy(gus->rcur, gus->block_rcur, sizeof(gus->block_rcur));
+    memcpy(gus->ctrl, gus->block_ctrl, sizeof(gus->block_ctrl));
+    memcpy(gus->rctrl, gus->block_rctrl, sizeof(gus->block_rctrl));
+}
+
+/*Renders the output for the next GUS_BLOCK_LEN samples one voice at a time.
+  The block is cut short after the first sample that raises a voice IRQ, so
+  that gus_poll_wave() can raise it on time.*/
+static void
+gus_render_block(gus_t *gus)
+{
+    int n = GUS_BLOCK_LEN;
+    int d;
+    int len;
+
+    gus->block_pos      = 0;
+    gus->block_waveirqs = 0;
+    gus->block_rampirqs = 0;
+
+    memset(gus->block_l, 0, sizeof(gus->block_l));
+    memset(gus->block_r, 0, sizeof(gus->block_r));
+
+    if ((gus->reset & 3) != 3) {
+        gus->block_len = n;
+        return;
+    }
+
+    gus_save_voices(gus);
+
+    for (d = 0; d < 32; d++) {
+        len = gus_render_voice(gus, d, n, gus->block_l, gus->block_r);
+        if (len < n) {
+            n = len;
+            if (d) {
+                /*Earlier voices have run past the new end of the block, go
+                  through them again. None of them raises an IRQ before it.*/
+                gus_restore_voices(gus);
+                gus->block_waveirqs = 0;
+                gus->block_rampirqs = 0;
+                memset(gus->block_l, 0, sizeof(gus->block_l));
+                memset(gus->block_r, 0, sizeof(gus->block_r));
+                d = -1;
+            }
+        }
+    }
+
+    gus->block_len = n;
+}
+
+/*Brings the voice state back to the last sample output, before the guest
+  accesses it. The rest of the block is dropped and rendered again on the
+  next sample.*/
+static void
+gus_sync_voices(gus_t *gus)
+{
+    int d;
+
+    if (gus->block_pos == gus->block_len)
+        return;
+
+    if ((gus->reset & 3) == 3) {
+        gus_restore_voices(gus);
+        for (d = 0; d < 32; d++)
+            gus_render_voice(gus, d, gus->block_pos, gus->block_l, gus->block_r);
+    }
+
+    gus->block_len      = gus->block_pos;
+    gus->block_waveirqs = 0;
+    gus->block_rampirqs = 0;
+}
+
+void
+gus_poll_wave(void *p)
+{
+    gus_t *gus = (gus_t *) p;
+    int    d;
+
+    gus_update(gus);
+
+    timer_advance_u64(&gus->samp_timer, gus->samp_latch);
+
+    if (gus->block_pos == gus->block_len)
+        gus_render_block(gus);
+
+    gus->out_l = gus->block_l[gus->block_pos];
+    gus->out_r = gus->block_r[gus->block_pos];
+    gus->block_pos++;
+
+    if ((gus->block_pos == gus->block_len) && (gus->block_waveirqs | gus->block_rampirqs)) {
+        for (d = 0; d < 32; d++) {
+            if (gus->block_waveirqs & (1 << d))
+                gus->waveirqs[d] = 1;
+            if (gus->block_rampirqs & (1 << d))
+                gus->rampirqs[d] = 1;
+        }
+        gus->block_waveirqs = 0;
+        gus->block_rampirqs = 0;
         gus_update_int_status(gus);
+    }
 }
 
 static void
@@ -1137,9 +1317,10 @@ gus_init(const device_t *info)
     memset(gus->ram, 0x00, (gus->gus_end_ram));
 
     for (c = 0; c < 32; c++) {
-        gus->ctrl[c]  = 1;
-        gus->rctrl[c] = 1;
-        gus->rfreq[c] = 63 * 512;
+        gus->ctrl[c]        = 1;
+        gus->rctrl[c]       = 1;
+        gus->rfreq[c]       = 63 * 512;
+        gus->vol_tab_vol[c] = -1;
     }
 
     for (c = 4095; c >= 0; c--) {
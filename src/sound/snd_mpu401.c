@@ -20,6 +20,7 @@
  *           Copyright 2016-2020 Miran Grca.
  */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -36,6 +37,7 @@
 #include <86box/pic.h>
 #include <86box/plat.h>
 #include <86box/timer.h>
+#include <86box/savestate.h>
 #include <86box/snd_mpu401.h>
 #include <86box/sound.h>
 
@@ -1675,6 +1677,23 @@ mpu401_change_addr(mpu_t *mpu, uint16_t addr)
                       mpu401_read, NULL, NULL, mpu401_write, NULL, NULL, mpu);
 }
 
+/* Everything up to the timers is plain data. The address is kept as well,
+   as a card can move it at run time. */
+void
+mpu401_savestate(mpu_t *mpu, savestate_t *st)
+{
+    uint16_t addr = mpu->addr;
+
+    savestate_var(st, addr);
+    savestate_data(st, &mpu->uart_mode, offsetof(mpu_t, mpu401_event_callback) - offsetof(mpu_t, uart_mode));
+    savestate_timer(st, &mpu->mpu401_event_callback);
+    savestate_timer(st, &mpu->mpu401_eoi_callback);
+    savestate_timer(st, &mpu->mpu401_reset_callback);
+
+    if (savestate_loading(st) && (addr != mpu->addr))
+        mpu401_change_addr(mpu, addr);
+}
+
 void
 mpu401_init(mpu_t *mpu, uint16_t addr, int irq, int mode, int receive_input)
 {
@@ -1797,6 +1816,14 @@ mpu401_standalone_init(const device_t *info)
     return (mpu);
 }
 
+static void
+mpu401_standalone_savestate(savestate_t *st, void *priv)
+{
+    mpu_t *mpu = (mpu_t *) priv;
+
+    mpu401_savestate(mpu, st);
+}
+
 static void
 mpu401_standalone_close(void *priv)
 {
@@ -1972,7 +1999,8 @@ const device_t mpu401_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = mpu401_standalone_config
+    .config        = mpu401_standalone_config,
+    .state         = mpu401_standalone_savestate
 };
 
 const device_t mpu401_mca_device = {
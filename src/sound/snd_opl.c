@@ -19,6 +19,7 @@
  *          Copyright 2016-2020 Miran Grca.
  */
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -31,6 +32,7 @@
 #include <86box/device.h>
 #include <86box/io.h>
 #include <86box/sound.h>
+#include <86box/thread.h>
 #include <86box/snd_opl.h>
 
 static uint32_t fm_dev_inst[FM_DRV_MAX][FM_MAX];
@@ -75,3 +77,201 @@ fm_driver_get(int chip_id, fm_drv_t *drv)
 
     return 1;
 };
+
+/*
+ * FM synthesis on a worker thread.
+ *
+ * With fm_offload set, the drivers no longer synthesize on the CPU thread.
+ * Writes to the synthesis side of the chip are instead recorded in a ring,
+ * along with the sample of the current sound buffer they take effect at, and
+ * a worker thread renders the stream by generating up to each write before
+ * applying it. The driver answers status and timer reads from its own state,
+ * so nothing on the CPU thread ever waits for the synthesis.
+ *
+ * The card takes the buffer at the end of each sound buffer period, through
+ * fm_offload_update(). That marks the end of the period in the ring, and
+ * returns the buffer for the period before, which the worker has had a whole
+ * period to render. FM output thus lags by one sound buffer; it is otherwise
+ * the same as that of the synchronous driver, as the writes land on the same
+ * samples.
+ */
+#define FM_OFFLOAD_RING_SIZE 8192
+#define FM_OFFLOAD_RING_MASK (FM_OFFLOAD_RING_SIZE - 1)
+
+/* Marks the end of a sound buffer period. */
+#define FM_OFFLOAD_END 0xffff
+
+typedef struct fm_offload_entry_t {
+    uint16_t pos;
+    uint16_t addr;
+    uint8_t  val;
+} fm_offload_entry_t;
+
+struct fm_offload_t {
+    void (*write)(void *priv, uint16_t addr, uint8_t val);
+    void (*generate)(void *priv, int32_t *buf, int len);
+    void *priv;
+
+    thread_t *thread;
+    event_t  *wake, *idle;
+    int       run;
+
+    /* CPU thread. */
+    int      ended;
+    uint32_t submitted;
+
+    /* Worker thread. */
+    int render_buf;
+    int render_pos;
+
+    atomic_uint        completed;
+    atomic_uint        read_pos, write_pos;
+    fm_offload_entry_t ring[FM_OFFLOAD_RING_SIZE];
+
+    /* Period n is rendered into buffer[n & 1]. The card reads the buffer
+       of period n - 1 at the end of period n, before anything is queued for
+       period n + 1, so two are enough. */
+    int32_t buffer[2][SOUNDBUFLEN * 2];
+};
+
+static void
+fm_offload_thread(void *priv)
+{
+    fm_offload_t       *fo = (fm_offload_t *) priv;
+    fm_offload_entry_t *entry;
+    unsigned int        pos;
+    int                 end;
+
+    while (1) {
+        thread_wait_event(fo->wake, -1);
+        thread_reset_event(fo->wake);
+        if (!fo->run)
+            break;
+
+        while ((pos = atomic_load(&fo->read_pos)) != atomic_load(&fo->write_pos)) {
+            entry = &fo->ring[pos & FM_OFFLOAD_RING_MASK];
+
+            end = (entry->pos == FM_OFFLOAD_END) ? SOUNDBUFLEN : entry->pos;
+            if (end > fo->render_pos) {
+                fo->generate(fo->priv, &fo->buffer[fo->render_buf][fo->render_pos * 2], end - fo->render_pos);
+                fo->render_pos = end;
+            }
+
+            if (entry->pos == FM_OFFLOAD_END) {
+                fo->render_buf ^= 1;
+                fo->render_pos = 0;
+                atomic_fetch_add(&fo->completed, 1);
+            } else
+                fo->write(fo->priv, entry->addr, entry->val);
+
+            atomic_store(&fo->read_pos, pos + 1);
+        }
+
+        thread_set_event(fo->idle);
+    }
+}
+
+/* Wait until the worker has rendered all but the last period queued, or
+   has emptied the ring. */
+static void
+fm_offload_wait(fm_offload_t *fo, int drain)
+{
+    while (drain ? (atomic_load(&fo->read_pos) != atomic_load(&fo->write_pos)) :
+                   (atomic_load(&fo->completed) < (fo->submitted - 1))) {
+        thread_reset_event(fo->idle);
+        if (drain ? (atomic_load(&fo->read_pos) == atomic_load(&fo->write_pos)) :
+                    (atomic_load(&fo->completed) >= (fo->submitted - 1)))
+            break;
+        thread_set_event(fo->wake);
+        thread_wait_event(fo->idle, -1);
+    }
+}
+
+static void
+fm_offload_push(fm_offload_t *fo, uint16_t pos, uint16_t addr, uint8_t val)
+{
+    unsigned int        write_pos = atomic_load(&fo->write_pos);
+    fm_offload_entry_t *entry;
+
+    if ((write_pos - atomic_load(&fo->read_pos)) >= FM_OFFLOAD_RING_SIZE)
+        fm_offload_wait(fo, 1);
+
+    entry       = &fo->ring[write_pos & FM_OFFLOAD_RING_MASK];
+    entry->pos  = pos;
+    entry->addr = addr;
+    entry->val  = val;
+    atomic_store(&fo->write_pos, write_pos + 1);
+
+    /* Keep the worker going through long runs of writes. */
+    if (((write_pos + 1) & (FM_OFFLOAD_RING_SIZE / 4 - 1)) == 0)
+        thread_set_event(fo->wake);
+}
+
+fm_offload_t *
+fm_offload_init(void (*write)(void *priv, uint16_t addr, uint8_t val),
+                void (*generate)(void *priv, int32_t *buf, int len),
+                void *priv)
+{
+    fm_offload_t *fo = (fm_offload_t *) calloc(1, sizeof(fm_offload_t));
+
+    if (!fo)
+        fatal("fm_offload_init: out of memory\n");
+
+    fo->write    = write;
+    fo->generate = generate;
+    fo->priv     = priv;
+
+    atomic_init(&fo->completed, 0);
+    atomic_init(&fo->read_pos, 0);
+    atomic_init(&fo->write_pos, 0);
+
+    fo->run    = 1;
+    fo->wake   = thread_create_event();
+    fo->idle   = thread_create_event();
+    fo->thread = thread_create(fm_offload_thread, fo);
+
+    return fo;
+}
+
+void
+fm_offload_close(fm_offload_t *fo)
+{
+    if (!fo)
+        return;
+
+    fm_offload_wait(fo, 1);
+    fo->run = 0;
+    thread_set_event(fo->wake);
+    thread_wait(fo->thread);
+    thread_destroy_event(fo->wake);
+    thread_destroy_event(fo->idle);
+    free(fo);
+}
+
+/* Log a write to take effect at sample pos of the current sound buffer. */
+void
+fm_offload_write(fm_offload_t *fo, int pos, uint16_t addr, uint8_t val)
+{
+    fm_offload_push(fo, pos, addr, val);
+}
+
+int32_t *
+fm_offload_update(fm_offload_t *fo)
+{
+    if (!fo->ended) {
+        fm_offload_push(fo, FM_OFFLOAD_END, 0, 0);
+        fo->ended = 1;
+        fo->submitted++;
+        thread_set_event(fo->wake);
+
+        fm_offload_wait(fo, 0);
+    }
+
+    return fo->buffer[fo->submitted & 1];
+}
+
+void
+fm_offload_reset_buffer(fm_offload_t *fo)
+{
+    fo->ended = 0;
+}
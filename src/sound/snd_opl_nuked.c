@@ -50,6 +50,7 @@
 #include <86box/timer.h>
 #include <86box/device.h>
 #include <86box/snd_opl.h>
+#include <86box/savestate.h>
 
 #define WRBUF_SIZE  1024
 #define WRBUF_DELAY 1
@@ -178,14 +179,18 @@ typedef struct {
     int8_t  flags, pad;
 
     uint16_t port;
-    uint8_t  status, timer_ctrl;
+    uint8_t  status, timer_ctrl, newm;
     uint16_t timer_count[2],
         timer_cur_count[2];
 
+    uint8_t regs[0x200]; /* Last value written to each register, for save states. */
+
     pc_timer_t timers[2];
 
     int     pos;
     int32_t buffer[SOUNDBUFLEN * 2];
+
+    fm_offload_t *offload;
 } nuked_drv_t;
 
 enum {
@@ -1470,6 +1475,25 @@ nuked_drv_set_do_cycles(void *priv, int8_t do_cycles)
         dev->flags &= ~FLAG_CYCLES;
 }
 
+static void
+nuked_drv_write_reg(void *priv, uint16_t reg, uint8_t val)
+{
+    nuked_drv_t *dev = (nuked_drv_t *) priv;
+
+    nuked_write_reg_buffered(&dev->opl, reg, val);
+}
+
+static void
+nuked_drv_generate(void *priv, int32_t *buf, int len)
+{
+    nuked_drv_t *dev = (nuked_drv_t *) priv;
+
+    nuked_generate_stream(&dev->opl, buf, len);
+
+    for (int c = 0; c < (len * 2); c++)
+        buf[c] /= 2;
+}
+
 static void *
 nuked_drv_init(const device_t *info)
 {
@@ -1486,6 +1510,10 @@ nuked_drv_init(const device_t *info)
     timer_add(&dev->timers[0], nuked_timer_1, dev, 0);
     timer_add(&dev->timers[1], nuked_timer_2, dev, 0);
 
+    /* The status and timers stay here, so only the synthesis moves. */
+    if (fm_offload)
+        dev->offload = fm_offload_init(nuked_drv_write_reg, nuked_drv_generate, dev);
+
     return dev;
 }
 
@@ -1493,6 +1521,7 @@ static void
 nuked_drv_close(void *priv)
 {
     nuked_drv_t *dev = (nuked_drv_t *) priv;
+    fm_offload_close(dev->offload);
     free(dev);
 }
 
@@ -1501,17 +1530,14 @@ nuked_drv_update(void *priv)
 {
     nuked_drv_t *dev = (nuked_drv_t *) priv;
 
+    if (dev->offload)
+        return fm_offload_update(dev->offload);
+
     if (dev->pos >= sound_pos_global)
         return dev->buffer;
 
-    nuked_generate_stream(&dev->opl,
-                          &dev->buffer[dev->pos * 2],
-                          sound_pos_global - dev->pos);
-
-    for (; dev->pos < sound_pos_global; dev->pos++) {
-        dev->buffer[dev->pos * 2] /= 2;
-        dev->buffer[(dev->pos * 2) + 1] /= 2;
-    }
+    nuked_drv_generate(dev, &dev->buffer[dev->pos * 2], sound_pos_global - dev->pos);
+    dev->pos = sound_pos_global;
 
     return dev->buffer;
 }
@@ -1524,7 +1550,8 @@ nuked_drv_read(uint16_t port, void *priv)
     if (dev->flags & FLAG_CYCLES)
         cycles -= ((int) (isa_timing * 8));
 
-    nuked_drv_update(dev);
+    if (!dev->offload)
+        nuked_drv_update(dev);
 
     uint8_t ret = 0xff;
 
@@ -1543,10 +1570,17 @@ static void
 nuked_drv_write(uint16_t port, uint8_t val, void *priv)
 {
     nuked_drv_t *dev = (nuked_drv_t *) priv;
-    nuked_drv_update(dev);
+
+    if (!dev->offload)
+        nuked_drv_update(dev);
 
     if ((port & 0x0001) == 0x0001) {
-        nuked_write_reg_buffered(&dev->opl, dev->port, val);
+        dev->regs[dev->port] = val;
+
+        if (dev->offload)
+            fm_offload_write(dev->offload, sound_pos_global, dev->port, val);
+        else
+            nuked_write_reg_buffered(&dev->opl, dev->port, val);
 
         switch (dev->port) {
             case 0x02: /* Timer 1 */
@@ -1570,21 +1604,66 @@ nuked_drv_write(uint16_t port, uint8_t val, void *priv)
                     nuked_log("Status mask now %02X (val = %02X)\n", (val & ~CTRL_TMR_MASK) & CTRL_TMR_MASK, val);
                 }
                 break;
+
+            case 0x105: /* OPL3 mode */
+                dev->newm = val & 0x01;
+                break;
         }
     } else {
-        dev->port = nuked_write_addr(&dev->opl, port, val) & 0x01ff;
+        /* The chip itself belongs to the worker when offloaded. */
+        if (dev->offload)
+            dev->port = ((port & 0x0002) && ((val == 0x05) || dev->newm)) ? (val | 0x0100) : val;
+        else
+            dev->port = nuked_write_addr(&dev->opl, port, val) & 0x01ff;
 
         if (!(dev->flags & FLAG_OPL3))
             dev->port &= 0x00ff;
     }
 }
 
+/* The NukedOPL object points into itself, so instead of saving it, the
+   registers are written to the new chip again, OPL3 mode first. Notes that
+   were playing start over from their attack phase. */
+static void
+nuked_drv_savestate(savestate_t *st, void *priv)
+{
+    nuked_drv_t *dev = (nuked_drv_t *) priv;
+    uint16_t     reg;
+
+    savestate_var(st, dev->port);
+    savestate_var(st, dev->status);
+    savestate_var(st, dev->timer_ctrl);
+    savestate_var(st, dev->newm);
+    savestate_var(st, dev->timer_count);
+    savestate_var(st, dev->timer_cur_count);
+    savestate_var(st, dev->regs);
+    savestate_timer(st, &dev->timers[0]);
+    savestate_timer(st, &dev->timers[1]);
+
+    if (!savestate_loading(st))
+        return;
+
+    for (int i = -1; i < 0x200; i++) {
+        reg = (i < 0) ? 0x105 : i;
+        if ((i >= 0) && (reg == 0x105))
+            continue;
+
+        if (dev->offload)
+            fm_offload_write(dev->offload, sound_pos_global, reg, dev->regs[reg]);
+        else
+            nuked_write_reg(&dev->opl, reg, dev->regs[reg]);
+    }
+}
+
 static void
 nuked_drv_reset_buffer(void *priv)
 {
     nuked_drv_t *dev = (nuked_drv_t *) priv;
 
-    dev->pos = 0;
+    if (dev->offload)
+        fm_offload_reset_buffer(dev->offload);
+    else
+        dev->pos = 0;
 }
 
 const device_t ym3812_nuked_device = {
@@ -1598,7 +1677,8 @@ const device_t ym3812_nuked_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nuked_drv_savestate
 };
 
 const device_t ymf262_nuked_device = {
@@ -1612,7 +1692,8 @@ const device_t ymf262_nuked_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = nuked_drv_savestate
 };
 
 const fm_drv_t nuked_opl_drv = {
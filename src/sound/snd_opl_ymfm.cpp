@@ -29,6 +29,7 @@ extern "C" {
 #include <86box/snd_opl.h>
 #include <86box/mem.h>
 #include <86box/rom.h>
+#include <86box/savestate.h>
 }
 
 #define RSM_FRAC 10
@@ -37,12 +38,34 @@ enum {
     FLAG_CYCLES = (1 << 0)
 };
 
+// Timer expiries are passed to the synthesizing chip through the write log
+// with this bit set in the address, for the sake of CSM mode.
+#define OFFLOAD_TIMER 0x8000
+
+// Interface of the chip that synthesizes on the worker thread, when the
+// synthesis is offloaded. Its timers are not used, as status reads and timers
+// are handled by the chip on the CPU thread.
+class YMFMRenderInterface : public ymfm::ymfm_interface {
+public:
+    YMFMRenderInterface()
+        : m_special_flags(0)
+    {
+    }
+
+    void timer_expired(uint32_t tnum) { m_engine->engine_timer_expired(tnum); }
+
+    virtual uint32_t get_special_flags(void) override { return m_special_flags; }
+
+    uint32_t m_special_flags;
+};
+
 class YMFMChipBase {
 public:
     YMFMChipBase(uint32_t clock, fm_type type, uint32_t samplerate)
         : m_buf_pos(0)
         , m_flags(0)
         , m_type(type)
+        , m_offload(nullptr)
     {
         memset(m_buffer, 0, sizeof(m_buffer));
     }
@@ -55,22 +78,43 @@ public:
     int8_t   flags() const { return m_flags; }
     void     set_do_cycles(int8_t do_cycles) { do_cycles ? m_flags |= FLAG_CYCLES : m_flags &= ~FLAG_CYCLES; }
     int32_t *buffer() const { return (int32_t *) m_buffer; }
-    void     reset_buffer() { m_buf_pos = 0; }
+
+    void reset_buffer()
+    {
+        m_buf_pos = 0;
+        if (m_offload)
+            fm_offload_reset_buffer(m_offload);
+    }
+
+    // Brings the output up to the current sample after a register access.
+    // When offloaded, this only moves the sample the following writes are
+    // logged at, so that they land where they would have without offloading.
+    void sync()
+    {
+        if (m_offload)
+            m_buf_pos = sound_pos_global;
+        else
+            update();
+    }
 
     virtual uint32_t sample_rate() const = 0;
 
     virtual void     write(uint16_t addr, uint8_t data)                      = 0;
     virtual void     generate(int32_t *data, uint32_t num_samples)           = 0;
     virtual void     generate_resampled(int32_t *data, uint32_t num_samples) = 0;
+    virtual void     generate_stream(int32_t *data, uint32_t num_samples)    = 0;
     virtual int32_t *update()                                                = 0;
     virtual uint8_t  read(uint16_t addr)                                     = 0;
     virtual void     set_clock(uint32_t clock)                               = 0;
+    virtual void     start_offload()                                         = 0;
+    virtual void     savestate(savestate_t *st)                              = 0;
 
 protected:
-    int32_t m_buffer[SOUNDBUFLEN * 2];
-    int     m_buf_pos;
-    int8_t  m_flags;
-    fm_type m_type;
+    int32_t       m_buffer[SOUNDBUFLEN * 2];
+    int           m_buf_pos;
+    int8_t        m_flags;
+    fm_type       m_type;
+    fm_offload_t *m_offload;
 };
 
 template <typename ChipType>
@@ -79,6 +123,7 @@ public:
     YMFMChip(uint32_t clock, fm_type type, uint32_t samplerate)
         : YMFMChipBase(clock, type, samplerate)
         , m_chip(*this)
+        , m_render_chip(nullptr)
         , m_clock(clock)
         , m_samplerate(samplerate)
         , m_samplecnt(0)
@@ -99,6 +144,16 @@ public:
 
         timer_add(&m_timers[0], YMFMChip::timer1, this, 0);
         timer_add(&m_timers[1], YMFMChip::timer2, this, 0);
+
+        // The ymfm constructors leave the registers uninitialized. This also
+        // stops the timers, so it has to come after they are added.
+        m_chip.reset();
+    }
+
+    virtual ~YMFMChip()
+    {
+        fm_offload_close(m_offload);
+        delete m_render_chip;
     }
 
     virtual uint32_t sample_rate() const override
@@ -118,7 +173,7 @@ public:
         else {
             double period = m_clock_us * duration_in_clocks;
             if (period < m_subtract[tnum])
-                m_engine->engine_timer_expired(tnum);
+                timer_expired(tnum);
             else
                 timer_on_auto(timer, period);
         }
@@ -136,8 +191,10 @@ public:
 
     virtual void generate(int32_t *data, uint32_t num_samples) override
     {
+        ChipType &chip = synth_chip();
+
         for (uint32_t i = 0; i < num_samples; i++) {
-            m_chip.generate(&m_output);
+            chip.generate(&m_output);
             if (ChipType::OUTPUTS == 1) {
                 *data++ = m_output.data[(m_type == FM_YMF278B) ? 4 : 0];
                 *data++ = m_output.data[(m_type == FM_YMF278B) ? 4 : 0];
@@ -150,11 +207,13 @@ public:
 
     virtual void generate_resampled(int32_t *data, uint32_t num_samples) override
     {
+        ChipType &chip = synth_chip();
+
         for (uint32_t i = 0; i < num_samples; i++) {
             while (m_samplecnt >= m_rateratio) {
                 m_oldsamples[0] = m_samples[0];
                 m_oldsamples[1] = m_samples[1];
-                m_chip.generate(&m_output);
+                chip.generate(&m_output);
                 if (ChipType::OUTPUTS == 1) {
                     m_samples[0] = m_output.data[(m_type == FM_YMF278B) ? 4 : 0];
                     m_samples[1] = m_output.data[(m_type == FM_YMF278B) ? 4 : 0];
@@ -176,24 +235,45 @@ public:
         }
     }
 
+    virtual void generate_stream(int32_t *data, uint32_t num_samples) override
+    {
+        generate_resampled(data, num_samples);
+
+        for (uint32_t i = 0; i < (num_samples * 2); i++)
+            data[i] /= 2;
+    }
+
     virtual int32_t *update() override
     {
+        if (m_offload)
+            return fm_offload_update(m_offload);
+
         if (m_buf_pos >= sound_pos_global)
             return m_buffer;
 
-        generate_resampled(&m_buffer[m_buf_pos * 2], sound_pos_global - m_buf_pos);
-
-        for (; m_buf_pos < sound_pos_global; m_buf_pos++) {
-            m_buffer[m_buf_pos * 2] /= 2;
-            m_buffer[(m_buf_pos * 2) + 1] /= 2;
-        }
+        generate_stream(&m_buffer[m_buf_pos * 2], sound_pos_global - m_buf_pos);
+        m_buf_pos = sound_pos_global;
 
         return m_buffer;
     }
 
     virtual void write(uint16_t addr, uint8_t data) override
     {
+        // The chip here still takes every write, as it answers the reads
+        // and runs the timers.
         m_chip.write(addr, data);
+        if (m_offload)
+            fm_offload_write(m_offload, m_buf_pos, addr, data);
+    }
+
+    virtual void start_offload() override
+    {
+        m_render_intf.m_special_flags = get_special_flags();
+        m_render_chip                 = new ChipType(m_render_intf);
+        // Start from the same power-on state as the emulated chip; only the
+        // writes from here on are replayed on the worker.
+        m_render_chip->reset();
+        m_offload                     = fm_offload_init(YMFMChip::render_write, YMFMChip::render_generate, this);
     }
 
     virtual uint8_t read(uint16_t addr) override
@@ -201,21 +281,78 @@ public:
         return m_chip.read(addr);
     }
 
+    // The chip state goes through ymfm's own serializer. A restore happens
+    // right after the hard reset, before the worker has been given anything
+    // to render, so the render chip can be written from here.
+    virtual void savestate(savestate_t *st) override
+    {
+        std::vector<uint8_t> buf;
+        uint32_t             len;
+
+        if (!savestate_loading(st)) {
+            ymfm::ymfm_saved_state state(buf, true);
+            m_chip.save_restore(state);
+        }
+
+        len = buf.size();
+        savestate_var(st, len);
+        buf.resize(len);
+        savestate_data(st, buf.data(), len);
+
+        savestate_var(st, m_duration_in_clocks);
+        savestate_timer(st, &m_timers[0]);
+        savestate_timer(st, &m_timers[1]);
+
+        if (savestate_loading(st)) {
+            ymfm::ymfm_saved_state state(buf, false);
+            m_chip.save_restore(state);
+
+            if (m_render_chip) {
+                ymfm::ymfm_saved_state render_state(buf, false);
+                m_render_chip->save_restore(render_state);
+            }
+        }
+    }
+
     virtual uint32_t get_special_flags(void) override
     {
         return ((m_type == FM_YMF262) || (m_type == FM_YMF289B) || (m_type == FM_YMF278B)) ? 0x8000 : 0x0000;
     }
 
+    void timer_expired(uint32_t tnum)
+    {
+        m_engine->engine_timer_expired(tnum);
+        if (m_offload)
+            fm_offload_write(m_offload, m_buf_pos, OFFLOAD_TIMER | tnum, 0);
+    }
+
     static void timer1(void *priv)
     {
         YMFMChip<ChipType> *drv = (YMFMChip<ChipType> *) priv;
-        drv->m_engine->engine_timer_expired(0);
+        drv->timer_expired(0);
     }
 
     static void timer2(void *priv)
     {
         YMFMChip<ChipType> *drv = (YMFMChip<ChipType> *) priv;
-        drv->m_engine->engine_timer_expired(1);
+        drv->timer_expired(1);
+    }
+
+    // Called on the worker thread when offloaded.
+    static void render_write(void *priv, uint16_t addr, uint8_t data)
+    {
+        YMFMChip<ChipType> *drv = (YMFMChip<ChipType> *) priv;
+
+        if (addr & OFFLOAD_TIMER)
+            drv->m_render_intf.timer_expired(addr & ~OFFLOAD_TIMER);
+        else
+            drv->m_render_chip->write(addr, data);
+    }
+
+    static void render_generate(void *priv, int32_t *buf, int len)
+    {
+        YMFMChip<ChipType> *drv = (YMFMChip<ChipType> *) priv;
+        drv->generate_stream(buf, len);
     }
 
     virtual uint8_t ymfm_external_read(ymfm::access_class type, uint32_t address) override
@@ -227,7 +364,11 @@ public:
     }
 
 private:
+    ChipType &synth_chip() { return m_render_chip ? *m_render_chip : m_chip; }
+
     ChipType                       m_chip;
+    YMFMRenderInterface            m_render_intf;
+    ChipType                      *m_render_chip;
     uint32_t                       m_clock;
     double                         m_clock_us, m_subtract[2];
     typename ChipType::output_data m_output;
@@ -303,6 +444,11 @@ ymfm_drv_init(const device_t *info)
 
     fm->set_do_cycles(1);
 
+    /* The OPL4 status has a busy bit that is cleared as samples are
+       generated, so it is left to synthesize on the CPU thread. */
+    if (fm_offload && (info->local != FM_YMF278B))
+        fm->start_offload();
+
     return fm;
 }
 
@@ -328,7 +474,7 @@ ymfm_drv_read(uint16_t port, void *priv)
         cycles -= ((int) (isa_timing * 8));
 
     uint8_t ret = drv->read(port);
-    drv->update();
+    drv->sync();
 
     ymfm_log("YMFM read port %04x, status = %02x\n", port, ret);
     return ret;
@@ -342,7 +488,15 @@ ymfm_drv_write(uint16_t port, uint8_t val, void *priv)
     if ((port == 0x380) || (port == 0x381))
         port |= 4;
     drv->write(port, val);
-    drv->update();
+    drv->sync();
+}
+
+static void
+ymfm_drv_savestate(savestate_t *st, void *priv)
+{
+    YMFMChipBase *drv = (YMFMChipBase *) priv;
+
+    drv->savestate(st);
 }
 
 static int32_t *
@@ -379,7 +533,8 @@ const device_t ym3812_ymfm_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = ymfm_drv_savestate
 };
 
 const device_t ymf262_ymfm_device = {
@@ -393,7 +548,8 @@ const device_t ymf262_ymfm_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = ymfm_drv_savestate
 };
 
 const device_t ymf289b_ymfm_device = {
@@ -407,7 +563,8 @@ const device_t ymf289b_ymfm_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = ymfm_drv_savestate
 };
 
 const device_t ymf278b_ymfm_device = {
@@ -421,7 +578,8 @@ const device_t ymf278b_ymfm_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = ymfm_drv_savestate
 };
 
 const fm_drv_t ymfm_drv {
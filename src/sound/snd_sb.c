@@ -18,6 +18,7 @@
  *           Copyright 2016-2020 Miran Grca.
  */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,6 +39,7 @@
 #include <86box/midi.h>
 #include <86box/pic.h>
 #include <86box/rom.h>
+#include <86box/savestate.h>
 #include <86box/sound.h>
 #include <86box/timer.h>
 #include <86box/snd_sb.h>
@@ -2255,6 +2257,25 @@ sb_speed_changed(void *p)
     sb_dsp_speed_changed(&sb->dsp);
 }
 
+/* For the plain ISA cards. The OPL and the game port are devices of their
+   own, and the I/O ports come from the configuration. */
+static void
+sb_savestate(savestate_t *st, void *priv)
+{
+    sb_t *sb = (sb_t *) priv;
+
+    if (sb->cms_enabled)
+        savestate_data(st, &sb->cms, offsetof(cms_t, buffer));
+
+    sb_dsp_savestate(&sb->dsp, st);
+
+    if (sb->mixer_enabled)
+        savestate_data(st, &sb->mixer_sb2, offsetof(sb_t, mpu) - offsetof(sb_t, mixer_sb2));
+
+    if (sb->mpu)
+        mpu401_savestate(sb->mpu, st);
+}
+
 // clang-format off
 static const device_config_t sb_config[] = {
     {
@@ -3453,7 +3474,8 @@ const device_t sb_1_device = {
     { .available = NULL },
     .speed_changed = sb_speed_changed,
     .force_redraw  = NULL,
-    .config        = sb_config
+    .config        = sb_config,
+    .state         = sb_savestate
 };
 
 const device_t sb_15_device = {
@@ -3467,7 +3489,8 @@ const device_t sb_15_device = {
     { .available = NULL },
     .speed_changed = sb_speed_changed,
     .force_redraw  = NULL,
-    .config        = sb15_config
+    .config        = sb15_config,
+    .state         = sb_savestate
 };
 
 const device_t sb_mcv_device = {
@@ -3495,7 +3518,8 @@ const device_t sb_2_device = {
     { .available = NULL },
     .speed_changed = sb_speed_changed,
     .force_redraw  = NULL,
-    .config        = sb2_config
+    .config        = sb2_config,
+    .state         = sb_savestate
 };
 
 const device_t sb_pro_v1_device = {
@@ -3509,7 +3533,8 @@ const device_t sb_pro_v1_device = {
     { .available = NULL },
     .speed_changed = sb_speed_changed,
     .force_redraw  = NULL,
-    .config        = sb_pro_config
+    .config        = sb_pro_config,
+    .state         = sb_savestate
 };
 
 const device_t sb_pro_v2_device = {
@@ -3523,7 +3548,8 @@ const device_t sb_pro_v2_device = {
     { .available = NULL },
     .speed_changed = sb_speed_changed,
     .force_redraw  = NULL,
-    .config        = sb_pro_config
+    .config        = sb_pro_config,
+    .state         = sb_savestate
 };
 
 const device_t sb_pro_mcv_device = {
@@ -3551,7 +3577,8 @@ const device_t sb_pro_compat_device = {
     { .available = NULL },
     .speed_changed = sb_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = sb_savestate
 };
 
 const device_t sb_16_device = {
@@ -3565,7 +3592,8 @@ const device_t sb_16_device = {
     { .available = NULL },
     .speed_changed = sb_speed_changed,
     .force_redraw  = NULL,
-    .config        = sb_16_config
+    .config        = sb_16_config,
+    .state         = sb_savestate
 };
 
 const device_t sb_16_reply_mca_device = {
@@ -3607,7 +3635,8 @@ const device_t sb_16_compat_device = {
     { .available = NULL },
     .speed_changed = sb_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = sb_savestate
 };
 
 const device_t sb_16_compat_nompu_device = {
@@ -3621,7 +3650,8 @@ const device_t sb_16_compat_nompu_device = {
     { .available = NULL },
     .speed_changed = sb_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = sb_savestate
 };
 
 const device_t sb_32_pnp_device = {
@@ -7,6 +7,7 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,6 +25,7 @@
 #include <86box/snd_azt2316a.h>
 #include <86box/sound.h>
 #include <86box/timer.h>
+#include <86box/savestate.h>
 #include <86box/snd_sb.h>
 
 #define ADPCM_4  1
@@ -1565,6 +1567,30 @@ sb_dsp_update(sb_dsp_t *dsp)
     }
 }
 
+/* The callbacks and the parent are set up by the card, and the output and
+   record buffers start over empty. */
+void
+sb_dsp_savestate(sb_dsp_t *dsp, savestate_t *st)
+{
+    savestate_data(st, &dsp->sb_8_length, offsetof(sb_dsp_t, dma_readb) - offsetof(sb_dsp_t, sb_8_length));
+    savestate_data(st, &dsp->sb_read_data, offsetof(sb_dsp_t, irq_update) - offsetof(sb_dsp_t, sb_read_data));
+    savestate_data(st, &dsp->sbe2, offsetof(sb_dsp_t, output_timer) - offsetof(sb_dsp_t, sbe2));
+    savestate_data(st, &dsp->sblatcho, offsetof(sb_dsp_t, wb_timer) - offsetof(sb_dsp_t, sblatcho));
+    savestate_data(st, &dsp->wb_full, offsetof(sb_dsp_t, record_buffer) - offsetof(sb_dsp_t, wb_full));
+    savestate_var(st, dsp->azt_eeprom);
+    savestate_timer(st, &dsp->output_timer);
+    savestate_timer(st, &dsp->input_timer);
+    savestate_timer(st, &dsp->wb_timer);
+
+    if (savestate_loading(st)) {
+        dsp->record_pos_read = dsp->record_pos_write = 0;
+        dsp->pos                                     = 0;
+
+        if ((dsp->sb_type >= SB16) && dsp->sb_freq)
+            recalc_sb16_filter(0, dsp->sb_freq);
+    }
+}
+
 void
 sb_dsp_close(sb_dsp_t *dsp)
 {
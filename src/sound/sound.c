@@ -23,12 +23,20 @@
 #include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    define SOUND_MIX_X86
+#    include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#    define SOUND_MIX_NEON
+#    include <arm_neon.h>
+#endif
 #define HAVE_STDARG_H
 
 #include <86box/86box.h>
 #include <86box/cdrom.h>
 #include <86box/device.h>
 #include <86box/filters.h>
+#include <86box/host_cpu.h>
 #include <86box/hdc_ide.h>
 #include <86box/machine.h>
 #include <86box/midi.h>
@@ -48,6 +56,7 @@ typedef struct {
 
 typedef struct {
     void (*get_buffer)(int32_t *buffer, int len, void *p);
+    void (*get_buffer_float)(float *buffer, int len, void *p);
     void *priv;
 } sound_handler_t;
 
@@ -63,7 +72,9 @@ static event_t   *sound_cd_start_event;
 static int32_t   *outbuffer;
 static float     *outbuffer_ex;
 static int16_t   *outbuffer_ex_int16;
+static float     *outbuffer_float;
 static int        sound_handlers_num;
+static int        sound_handlers_float;
 static pc_timer_t sound_poll_timer;
 static uint64_t   sound_poll_latch;
 
@@ -168,6 +179,369 @@ sound_log(const char *fmt, ...)
 #    define sound_log(fmt, ...)
 #endif
 
+/* Final mixing stage: converts the mixed 32-bit samples to the output format,
+   clamping them to 16 bits. If any floating point handlers are registered,
+   their buffer (in 16-bit sample units) is added in floating point before the
+   clamp, so a near full scale integer mix can't overflow. The length is
+   always a multiple of 16 samples. */
+static void
+sound_mix_int16_c(int16_t *dst, const int32_t *src, const float *src_f, int len)
+{
+    int32_t v;
+    float   f;
+
+    if (src_f != NULL) {
+        for (int c = 0; c < len; c++) {
+            f = ((float) src[c]) + src_f[c];
+            if (f > 32767.0f)
+                f = 32767.0f;
+            if (f < -32768.0f)
+                f = -32768.0f;
+            dst[c] = (int16_t) f;
+        }
+        return;
+    }
+
+    for (int c = 0; c < len; c++) {
+        v = src[c];
+        if (v > 32767)
+            v = 32767;
+        if (v < -32768)
+            v = -32768;
+        dst[c] = v;
+    }
+}
+
+static void
+sound_mix_float_c(float *dst, const int32_t *src, const float *src_f, int len)
+{
+    if (src_f != NULL) {
+        for (int c = 0; c < len; c++)
+            dst[c] = (((float) src[c]) + src_f[c]) * (1.0f / 32768.0f);
+        return;
+    }
+
+    for (int c = 0; c < len; c++)
+        dst[c] = ((float) src[c]) * (1.0f / 32768.0f);
+}
+
+#if defined(SOUND_MIX_X86)
+#    if defined(__GNUC__) || defined(__clang__)
+#        define SOUND_TARGET(t) __attribute__((target(t)))
+#    else
+#        define SOUND_TARGET(t)
+#    endif
+
+SOUND_TARGET("sse2")
+static void
+sound_mix_int16_sse2(int16_t *dst, const int32_t *src, const float *src_f, int len)
+{
+    const __m128 max = _mm_set1_ps(32767.0f);
+    const __m128 min = _mm_set1_ps(-32768.0f);
+    __m128i      a, b;
+
+    for (int c = 0; c < len; c += 8) {
+        a = _mm_loadu_si128((const __m128i *) &src[c]);
+        b = _mm_loadu_si128((const __m128i *) &src[c + 4]);
+        if (src_f != NULL) {
+            /* Clamp before converting back, the sum may not fit in 32 bits. */
+            a = _mm_cvttps_epi32(_mm_max_ps(_mm_min_ps(_mm_add_ps(_mm_cvtepi32_ps(a), _mm_loadu_ps(&src_f[c])), max), min));
+            b = _mm_cvttps_epi32(_mm_max_ps(_mm_min_ps(_mm_add_ps(_mm_cvtepi32_ps(b), _mm_loadu_ps(&src_f[c + 4])), max), min));
+        }
+        /* The signed saturating pack is exactly the clamp. */
+        _mm_storeu_si128((__m128i *) &dst[c], _mm_packs_epi32(a, b));
+    }
+}
+
+SOUND_TARGET("sse2")
+static void
+sound_mix_float_sse2(float *dst, const int32_t *src, const float *src_f, int len)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    __m128       v;
+
+    for (int c = 0; c < len; c += 4) {
+        v = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *) &src[c]));
+        if (src_f != NULL)
+            v = _mm_add_ps(v, _mm_loadu_ps(&src_f[c]));
+        _mm_storeu_ps(&dst[c], _mm_mul_ps(v, scale));
+    }
+}
+
+SOUND_TARGET("avx2")
+static void
+sound_mix_int16_avx2(int16_t *dst, const int32_t *src, const float *src_f, int len)
+{
+    const __m256 max = _mm256_set1_ps(32767.0f);
+    const __m256 min = _mm256_set1_ps(-32768.0f);
+    __m256i      a, b;
+
+    for (int c = 0; c < len; c += 16) {
+        a = _mm256_loadu_si256((const __m256i *) &src[c]);
+        b = _mm256_loadu_si256((const __m256i *) &src[c + 8]);
+        if (src_f != NULL) {
+            a = _mm256_cvttps_epi32(_mm256_max_ps(_mm256_min_ps(_mm256_add_ps(_mm256_cvtepi32_ps(a), _mm256_loadu_ps(&src_f[c])), max), min));
+            b = _mm256_cvttps_epi32(_mm256_max_ps(_mm256_min_ps(_mm256_add_ps(_mm256_cvtepi32_ps(b), _mm256_loadu_ps(&src_f[c + 8])), max), min));
+        }
+        /* The pack works within 128-bit lanes, put the quadwords back in order. */
+        _mm256_storeu_si256((__m256i *) &dst[c], _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xd8));
+    }
+}
+
+SOUND_TARGET("avx2")
+static void
+sound_mix_float_avx2(float *dst, const int32_t *src, const float *src_f, int len)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+    __m256       v;
+
+    for (int c = 0; c < len; c += 8) {
+        v = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *) &src[c]));
+        if (src_f != NULL)
+            v = _mm256_add_ps(v, _mm256_loadu_ps(&src_f[c]));
+        _mm256_storeu_ps(&dst[c], _mm256_mul_ps(v, scale));
+    }
+}
+
+#elif defined(SOUND_MIX_NEON)
+static void
+sound_mix_int16_neon(int16_t *dst, const int32_t *src, const float *src_f, int len)
+{
+    int32x4_t a, b;
+
+    for (int c = 0; c < len; c += 8) {
+        a = vld1q_s32(&src[c]);
+        b = vld1q_s32(&src[c + 4]);
+        if (src_f != NULL) {
+            /* Float to integer conversion truncates and saturates on ARM. */
+            a = vcvtq_s32_f32(vaddq_f32(vcvtq_f32_s32(a), vld1q_f32(&src_f[c])));
+            b = vcvtq_s32_f32(vaddq_f32(vcvtq_f32_s32(b), vld1q_f32(&src_f[c + 4])));
+        }
+        vst1q_s16(&dst[c], vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+}
+
+static void
+sound_mix_float_neon(float *dst, const int32_t *src, const float *src_f, int len)
+{
+    float32x4_t v;
+
+    for (int c = 0; c < len; c += 4) {
+        v = vcvtq_f32_s32(vld1q_s32(&src[c]));
+        if (src_f != NULL)
+            v = vaddq_f32(v, vld1q_f32(&src_f[c]));
+        vst1q_f32(&dst[c], vmulq_n_f32(v, 1.0f / 32768.0f));
+    }
+}
+#endif
+
+static void (*sound_mix_int16)(int16_t *dst, const int32_t *src, const float *src_f, int len) = sound_mix_int16_c;
+static void (*sound_mix_float)(float *dst, const int32_t *src, const float *src_f, int len)   = sound_mix_float_c;
+
+static void
+sound_mix_init(void)
+{
+#if defined(SOUND_MIX_X86)
+    if (host_cpu_has_avx2()) {
+        sound_mix_int16 = sound_mix_int16_avx2;
+        sound_mix_float = sound_mix_float_avx2;
+    } else if (host_cpu_has_sse2()) {
+        sound_mix_int16 = sound_mix_int16_sse2;
+        sound_mix_float = sound_mix_float_sse2;
+    }
+#elif defined(SOUND_MIX_NEON)
+    sound_mix_int16 = sound_mix_int16_neon;
+    sound_mix_float = sound_mix_float_neon;
+#endif
+}
+
+#ifdef USE_INSTRUMENT
+#    define MIX_BENCH_LEN    (SOUNDBUFLEN * 2)
+#    define MIX_BENCH_PASSES 20000
+
+typedef struct {
+    const char *name;
+    void (*mix_int16)(int16_t *dst, const int32_t *src, const float *src_f, int len);
+    void (*mix_float)(float *dst, const int32_t *src, const float *src_f, int len);
+} sound_mix_path_t;
+
+/* The conversion loop sound_poll() had before the mix functions, kept as the
+   reference the other paths must match. */
+static void
+sound_mix_reference(int16_t *dst, float *dst_f, int32_t *src, int len, int is_float)
+{
+    for (int c = 0; c < len; c++) {
+        if (is_float)
+            dst_f[c] = ((float) src[c]) / 32768.0;
+        else {
+            if (src[c] > 32767)
+                src[c] = 32767;
+            if (src[c] < -32768)
+                src[c] = -32768;
+
+            dst[c] = src[c];
+        }
+    }
+}
+
+/* Times each available conversion path against the old loop, on a mix that
+   includes both clipped and extreme samples, and checks that the results are
+   identical. The paths are also checked against the C version with a float
+   handler buffer mixed in, which pushes some samples past the int32 range. */
+void
+sound_mix_benchmark(void)
+{
+    sound_mix_path_t paths[4];
+    int              num = 0;
+    int32_t         *src;
+    int32_t         *tmp;
+    float           *mix_f;
+    int16_t         *ref;
+    int16_t         *out;
+    float           *ref_f;
+    float           *out_f;
+    uint32_t         start;
+    uint32_t         int16_us;
+    uint32_t         float_us;
+    uint32_t         mixed_us;
+    uint32_t         seed = 0x12345678;
+    int              exact;
+    int              mixed_exact;
+    int              i;
+    int              c;
+
+    paths[num].name      = "c";
+    paths[num].mix_int16 = sound_mix_int16_c;
+    paths[num].mix_float = sound_mix_float_c;
+    num++;
+#    if defined(SOUND_MIX_X86)
+    if (host_cpu_has_sse2()) {
+        paths[num].name      = "sse2";
+        paths[num].mix_int16 = sound_mix_int16_sse2;
+        paths[num].mix_float = sound_mix_float_sse2;
+        num++;
+    }
+    if (host_cpu_has_avx2()) {
+        paths[num].name      = "avx2";
+        paths[num].mix_int16 = sound_mix_int16_avx2;
+        paths[num].mix_float = sound_mix_float_avx2;
+        num++;
+    }
+#    elif defined(SOUND_MIX_NEON)
+    paths[num].name      = "neon";
+    paths[num].mix_int16 = sound_mix_int16_neon;
+    paths[num].mix_float = sound_mix_float_neon;
+    num++;
+#    endif
+
+    src   = (int32_t *) malloc(MIX_BENCH_LEN * sizeof(int32_t));
+    tmp   = (int32_t *) malloc(MIX_BENCH_LEN * sizeof(int32_t));
+    mix_f = (float *) malloc(MIX_BENCH_LEN * sizeof(float));
+    ref   = (int16_t *) malloc(MIX_BENCH_LEN * sizeof(int16_t));
+    out   = (int16_t *) malloc(MIX_BENCH_LEN * sizeof(int16_t));
+    ref_f = (float *) malloc(MIX_BENCH_LEN * sizeof(float));
+    out_f = (float *) malloc(MIX_BENCH_LEN * sizeof(float));
+    if (!src || !tmp || !mix_f || !ref || !out || !ref_f || !out_f)
+        fatal("sound_mix_benchmark: out of memory\n");
+
+    /* Mostly in range, with some samples clipping and a few at the limits. */
+    for (c = 0; c < MIX_BENCH_LEN; c++) {
+        seed     = seed * 1103515245 + 12345;
+        src[c]   = (int32_t) ((seed >> 8) % 131072) - 65536;
+        seed     = seed * 1103515245 + 12345;
+        mix_f[c] = ((float) ((int32_t) ((seed >> 8) % 131072) - 65536)) * 0.75f;
+    }
+    src[0] = INT32_MAX;
+    src[1] = INT32_MIN;
+    src[2] = 32767;
+    src[3] = -32768;
+    src[4] = 32768;
+    src[5] = -32769;
+    /* Sums that would wrap around if added as integers. */
+    mix_f[0] = 65536.0f;
+    mix_f[1] = -65536.0f;
+    mix_f[6] = 1.0e10f;
+    mix_f[7] = -1.0e10f;
+
+    printf("{\n");
+    printf("    \"samples\": %i,\n", MIX_BENCH_LEN);
+    printf("    \"passes\": %i,\n", MIX_BENCH_PASSES);
+
+    /* The old loop clamped the mix buffer in place, so give it a copy. */
+    start = plat_get_micro_ticks();
+    for (i = 0; i < MIX_BENCH_PASSES; i++) {
+        memcpy(tmp, src, MIX_BENCH_LEN * sizeof(int32_t));
+        sound_mix_reference(ref, ref_f, tmp, MIX_BENCH_LEN, 0);
+    }
+    int16_us = plat_get_micro_ticks() - start;
+    start    = plat_get_micro_ticks();
+    for (i = 0; i < MIX_BENCH_PASSES; i++)
+        sound_mix_reference(ref, ref_f, src, MIX_BENCH_LEN, 1);
+    float_us = plat_get_micro_ticks() - start;
+    printf("    \"old\": { \"int16_ns_per_sample\": %.3f, \"float_ns_per_sample\": %.3f },\n",
+           int16_us * 1000.0 / ((double) MIX_BENCH_PASSES * MIX_BENCH_LEN),
+           float_us * 1000.0 / ((double) MIX_BENCH_PASSES * MIX_BENCH_LEN));
+
+    /* The saturated ends must stay saturated with the float buffer added. */
+    sound_mix_int16_c(out, src, mix_f, MIX_BENCH_LEN);
+    printf("    \"float_handler_saturates\": %s,\n",
+           ((out[0] == 32767) && (out[1] == -32768) && (out[6] == 32767) && (out[7] == -32768)) ? "true" : "false");
+
+    for (c = 0; c < num; c++) {
+        start = plat_get_micro_ticks();
+        for (i = 0; i < MIX_BENCH_PASSES; i++)
+            paths[c].mix_int16(out, src, NULL, MIX_BENCH_LEN);
+        int16_us = plat_get_micro_ticks() - start;
+        start    = plat_get_micro_ticks();
+        for (i = 0; i < MIX_BENCH_PASSES; i++)
+            paths[c].mix_float(out_f, src, NULL, MIX_BENCH_LEN);
+        float_us = plat_get_micro_ticks() - start;
+
+        exact = !memcmp(ref, out, MIX_BENCH_LEN * sizeof(int16_t)) && !memcmp(ref_f, out_f, MIX_BENCH_LEN * sizeof(float));
+
+        start = plat_get_micro_ticks();
+        for (i = 0; i < MIX_BENCH_PASSES; i++)
+            paths[c].mix_int16(out, src, mix_f, MIX_BENCH_LEN);
+        mixed_us = plat_get_micro_ticks() - start;
+
+        sound_mix_int16_c(ref, src, mix_f, MIX_BENCH_LEN);
+        mixed_exact = !memcmp(ref, out, MIX_BENCH_LEN * sizeof(int16_t));
+        sound_mix_float_c(ref_f, src, mix_f, MIX_BENCH_LEN);
+        paths[c].mix_float(out_f, src, mix_f, MIX_BENCH_LEN);
+        mixed_exact = mixed_exact && !memcmp(ref_f, out_f, MIX_BENCH_LEN * sizeof(float));
+
+        /* Put the plain references back for the next path. */
+        memcpy(tmp, src, MIX_BENCH_LEN * sizeof(int32_t));
+        sound_mix_reference(ref, ref_f, tmp, MIX_BENCH_LEN, 0);
+        sound_mix_reference(ref, ref_f, src, MIX_BENCH_LEN, 1);
+
+        printf("    \"%s\": { \"int16_ns_per_sample\": %.3f, \"float_ns_per_sample\": %.3f, \"float_handler_ns_per_sample\": %.3f, \"exact\": %s, \"float_handler_exact\": %s },\n",
+               paths[c].name,
+               int16_us * 1000.0 / ((double) MIX_BENCH_PASSES * MIX_BENCH_LEN),
+               float_us * 1000.0 / ((double) MIX_BENCH_PASSES * MIX_BENCH_LEN),
+               mixed_us * 1000.0 / ((double) MIX_BENCH_PASSES * MIX_BENCH_LEN),
+               exact ? "true" : "false", mixed_exact ? "true" : "false");
+    }
+
+    sound_mix_init();
+    for (c = 0; c < num; c++) {
+        if ((paths[c].mix_int16 == sound_mix_int16) && (paths[c].mix_float == sound_mix_float))
+            break;
+    }
+    printf("    \"selected\": \"%s\"\n", (c < num) ? paths[c].name : "unknown");
+    printf("}\n");
+    fflush(stdout);
+
+    free(src);
+    free(tmp);
+    free(mix_f);
+    free(ref);
+    free(out);
+    free(ref_f);
+    free(out_f);
+}
+#endif
+
 int
 sound_card_available(int card)
 {
@@ -388,6 +762,10 @@ sound_init(void)
     outbuffer = calloc(SOUNDBUFLEN * 2, sizeof(int32_t));
     memset(outbuffer, 0x00, SOUNDBUFLEN * 2 * sizeof(int32_t));
 
+    outbuffer_float = calloc(SOUNDBUFLEN * 2, sizeof(float));
+
+    sound_mix_init();
+
     for (i = 0; i < CDROM_NUM; i++) {
         if (cdrom[i].bus_type != CDROM_BUS_DISABLED)
             available_cdrom_drives++;
@@ -419,6 +797,17 @@ sound_add_handler(void (*get_buffer)(int32_t *buffer, int len, void *p), void *p
     sound_handlers_num++;
 }
 
+/* Same as above, for cards that generate floating point samples. These add
+   to the buffer in 16-bit sample units (full scale is +/-32768). */
+void
+sound_add_handler_float(void (*get_buffer)(float *buffer, int len, void *p), void *p)
+{
+    sound_handlers[sound_handlers_num].get_buffer_float = get_buffer;
+    sound_handlers[sound_handlers_num].priv             = p;
+    sound_handlers_num++;
+    sound_handlers_float++;
+}
+
 void
 sound_set_cd_audio_filter(void (*filter)(int channel, double *buffer, void *p), void *p)
 {
@@ -440,27 +829,23 @@ sound_poll(void *priv)
         int c;
 
         memset(outbuffer, 0x00, SOUNDBUFLEN * 2 * sizeof(int32_t));
+        if (sound_handlers_float)
+            memset(outbuffer_float, 0x00, SOUNDBUFLEN * 2 * sizeof(float));
 
-        for (c = 0; c < sound_handlers_num; c++)
-            sound_handlers[c].get_buffer(outbuffer, SOUNDBUFLEN, sound_handlers[c].priv);
-
-        for (c = 0; c < SOUNDBUFLEN * 2; c++) {
-            if (sound_is_float)
-                outbuffer_ex[c] = ((float) outbuffer[c]) / 32768.0;
-            else {
-                if (outbuffer[c] > 32767)
-                    outbuffer[c] = 32767;
-                if (outbuffer[c] < -32768)
-                    outbuffer[c] = -32768;
-
-                outbuffer_ex_int16[c] = outbuffer[c];
-            }
+        for (c = 0; c < sound_handlers_num; c++) {
+            if (sound_handlers[c].get_buffer_float)
+                sound_handlers[c].get_buffer_float(outbuffer_float, SOUNDBUFLEN, sound_handlers[c].priv);
+            else
+                sound_handlers[c].get_buffer(outbuffer, SOUNDBUFLEN, sound_handlers[c].priv);
         }
 
-        if (sound_is_float)
+        if (sound_is_float) {
+            sound_mix_float(outbuffer_ex, outbuffer, sound_handlers_float ? outbuffer_float : NULL, SOUNDBUFLEN * 2);
             givealbuffer(outbuffer_ex);
-        else
+        } else {
+            sound_mix_int16(outbuffer_ex_int16, outbuffer, sound_handlers_float ? outbuffer_float : NULL, SOUNDBUFLEN * 2);
             givealbuffer(outbuffer_ex_int16);
+        }
 
         if (cd_thread_enable) {
             cd_buf_update--;
@@ -488,11 +873,16 @@ sound_reset(void)
     midi_out_device_init();
     midi_in_device_init();
 
-    inital();
+#ifdef USE_INSTRUMENT
+    /* The benchmark runner has no audio output. */
+    if (!instru_benchmark)
+#endif
+        inital();
 
     timer_add(&sound_poll_timer, sound_poll, NULL, 1);
 
-    sound_handlers_num = 0;
+    sound_handlers_num   = 0;
+    sound_handlers_float = 0;
     memset(sound_handlers, 0x00, 8 * sizeof(sound_handler_t));
 
     filter_cd_audio   = NULL;
@@ -1,9 +1,11 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
 #include <86box/86box.h>
 #include <86box/timer.h>
+#include <86box/plat.h>
 
 uint64_t TIMER_USEC;
 uint32_t timer_target;
@@ -15,6 +17,344 @@ pc_timer_t *timer_head = NULL;
 /* Are we initialized? */
 int timer_inited = 0;
 
+#ifdef USE_INSTRUMENT
+/*With --timer-trace, every change to the set of enabled timers is written to
+  a file, so that --timer-benchmark can replay the same sequence against
+  either scheduler without the rest of the emulator.*/
+enum {
+    TIMER_TRACE_INIT = 0,
+    TIMER_TRACE_ENABLE,
+    TIMER_TRACE_DISABLE,
+    TIMER_TRACE_PROCESS,
+    TIMER_TRACE_CALLBACK,
+    TIMER_TRACE_RETURN,
+    TIMER_TRACE_SET_TSC
+};
+
+#    define TIMER_TRACE_IDS 4096
+
+typedef struct timer_trace_t {
+    uint64_t ts;
+    uint32_t id;
+    uint32_t op;
+} timer_trace_t;
+
+static FILE       *timer_trace_fp = NULL;
+static pc_timer_t *timer_trace_ids[TIMER_TRACE_IDS];
+static uint32_t    timer_trace_num = 0;
+
+/*Map a timer to a small number, using an open-addressed table of the timers
+  seen so far.*/
+static uint32_t
+timer_trace_id(pc_timer_t *timer)
+{
+    uint32_t slot = (uint32_t) ((((uintptr_t) timer) >> 3) * 0x9e3779b1u) & (TIMER_TRACE_IDS - 1);
+
+    while (timer_trace_ids[slot] != timer) {
+        if (timer_trace_ids[slot] == NULL) {
+            if (++timer_trace_num == TIMER_TRACE_IDS)
+                fatal("timer_trace_id - too many timers\n");
+            timer_trace_ids[slot] = timer;
+            break;
+        }
+        slot = (slot + 1) & (TIMER_TRACE_IDS - 1);
+    }
+
+    return slot;
+}
+
+static void
+timer_trace(uint32_t op, pc_timer_t *timer, uint64_t ts)
+{
+    timer_trace_t rec;
+
+    rec.ts = ts;
+    rec.op = op;
+    if (timer != NULL)
+        rec.id = timer_trace_id(timer);
+    else if (op == TIMER_TRACE_SET_TSC)
+        rec.id = (uint32_t) (ts - tsc); /* the replay has not seen the old TSC */
+    else
+        rec.id = 0;
+
+    fwrite(&rec, sizeof(timer_trace_t), 1, timer_trace_fp);
+}
+
+void
+timer_trace_close(void)
+{
+    if (timer_trace_fp != NULL) {
+        fclose(timer_trace_fp);
+        timer_trace_fp = NULL;
+    }
+}
+
+#    define TIMER_TRACE(op, timer, ts)      \
+        do {                                \
+            if (timer_trace_fp != NULL)     \
+                timer_trace(op, timer, ts); \
+        } while (0)
+#else
+#    define TIMER_TRACE(op, timer, ts)
+#endif
+
+#ifdef USE_TIMER_HEAP
+/*With the heap scheduler, enabled timers are stored in a 4-ary min-heap
+  instead of the linked list, and timer_head always points to the root of the
+  heap, so the CPU loops see the same interface either way. The sort key is
+  kept in the heap entry itself so that sifting does not have to touch the
+  timer structures.*/
+#define TIMER_HEAP_SHIFT 2
+#define TIMER_HEAP_ARITY (1 << TIMER_HEAP_SHIFT)
+
+typedef struct timer_heap_entry_t {
+    uint64_t    ts;
+    uint32_t    seq;
+    pc_timer_t *timer;
+} timer_heap_entry_t;
+
+static timer_heap_entry_t *timer_heap         = NULL;
+static int                 timer_heap_count   = 0;
+static int                 timer_heap_size    = 0;
+static uint32_t            timer_heap_seq     = 0;
+static pc_timer_t         *timer_heap_expired = NULL;
+
+/*True if entry a is to be processed before entry b. Timers with the same
+  timestamp are processed in the reverse order of being enabled, which is
+  the order the linked list implementation produces.*/
+static __inline int
+timer_heap_before(const timer_heap_entry_t *a, const timer_heap_entry_t *b)
+{
+    int64_t diff = (int64_t) (a->ts - b->ts);
+
+    if (diff)
+        return (diff < 0);
+
+    return ((int32_t) (a->seq - b->seq) > 0);
+}
+
+static void
+timer_heap_up(int pos, timer_heap_entry_t *entry)
+{
+    int parent;
+
+    while (pos > 0) {
+        parent = (pos - 1) >> TIMER_HEAP_SHIFT;
+        if (!timer_heap_before(entry, &timer_heap[parent]))
+            break;
+
+        timer_heap[pos]                 = timer_heap[parent];
+        timer_heap[pos].timer->heap_pos = pos;
+        pos                             = parent;
+    }
+
+    timer_heap[pos]        = *entry;
+    entry->timer->heap_pos = pos;
+}
+
+static void
+timer_heap_down(int pos, timer_heap_entry_t *entry)
+{
+    int child;
+    int last;
+    int i;
+
+    while (1) {
+        child = (pos << TIMER_HEAP_SHIFT) + 1;
+        if (child >= timer_heap_count)
+            break;
+
+        last = child + TIMER_HEAP_ARITY;
+        if (last > timer_heap_count)
+            last = timer_heap_count;
+
+        for (i = child + 1; i < last; i++) {
+            if (timer_heap_before(&timer_heap[i], &timer_heap[child]))
+                child = i;
+        }
+
+        if (!timer_heap_before(&timer_heap[child], entry))
+            break;
+
+        timer_heap[pos]                 = timer_heap[child];
+        timer_heap[pos].timer->heap_pos = pos;
+        pos                             = child;
+    }
+
+    timer_heap[pos]        = *entry;
+    entry->timer->heap_pos = pos;
+}
+
+static __inline void
+timer_heap_update_head(void)
+{
+    if (timer_heap_count) {
+        timer_head   = timer_heap[0].timer;
+        timer_target = timer_head->ts.ts32.integer;
+    } else
+        timer_head = NULL;
+}
+
+/*Place entry at pos, which has either been vacated or holds a stale entry,
+  and restore the heap order around it.*/
+static void
+timer_heap_place(int pos, timer_heap_entry_t *entry)
+{
+    if ((pos > 0) && timer_heap_before(entry, &timer_heap[(pos - 1) >> TIMER_HEAP_SHIFT]))
+        timer_heap_up(pos, entry);
+    else
+        timer_heap_down(pos, entry);
+}
+
+static void
+timer_heap_remove(int pos)
+{
+    timer_heap_entry_t last;
+
+    timer_heap_count--;
+
+    if (pos != timer_heap_count) {
+        last = timer_heap[timer_heap_count];
+        timer_heap_place(pos, &last);
+    }
+
+    timer_heap_update_head();
+}
+
+/*Remove the timer whose callback has just been run from the heap, unless the
+  callback has already re-enabled it in place.*/
+static __inline void
+timer_heap_settle(void)
+{
+    if (timer_heap_expired != NULL) {
+        timer_heap_remove(timer_heap_expired->heap_pos);
+        timer_heap_expired = NULL;
+    }
+}
+
+void
+timer_enable(pc_timer_t *timer)
+{
+    timer_heap_entry_t entry;
+
+    if (!timer_inited || (timer == NULL))
+        return;
+
+    if (timer->flags & TIMER_ENABLED)
+        timer_disable(timer);
+
+    TIMER_TRACE(TIMER_TRACE_ENABLE, timer, timer->ts.ts64);
+
+    timer->flags |= TIMER_ENABLED;
+
+    entry.ts    = timer->ts.ts64;
+    entry.seq   = timer_heap_seq++;
+    entry.timer = timer;
+
+    if (timer == timer_heap_expired) {
+        /* The common case of a callback re-arming its own timer: the timer
+           is still in the heap, so just move it to its new position. */
+        timer_heap_expired = NULL;
+        timer_heap_place(timer->heap_pos, &entry);
+    } else {
+        if (timer_heap_count == timer_heap_size) {
+            timer_heap_size = timer_heap_size ? (timer_heap_size << 1) : 64;
+            timer_heap      = (timer_heap_entry_t *) realloc(timer_heap, timer_heap_size * sizeof(timer_heap_entry_t));
+            if (timer_heap == NULL)
+                fatal("timer_enable - out of memory\n");
+        }
+
+        timer_heap_up(timer_heap_count++, &entry);
+    }
+
+    timer_heap_update_head();
+}
+
+void
+timer_disable(pc_timer_t *timer)
+{
+    if (!timer_inited || (timer == NULL) || !(timer->flags & TIMER_ENABLED))
+        return;
+
+    TIMER_TRACE(TIMER_TRACE_DISABLE, timer, 0);
+
+    if ((timer->heap_pos >= timer_heap_count) || (timer_heap[timer->heap_pos].timer != timer))
+        fatal("timer_disable - timer not in heap\n");
+
+    timer->flags &= ~TIMER_ENABLED;
+
+    timer_heap_remove(timer->heap_pos);
+}
+
+void
+timer_process(void)
+{
+    pc_timer_t *timer;
+
+    TIMER_TRACE(TIMER_TRACE_PROCESS, NULL, tsc);
+
+    while (1) {
+        timer_heap_settle();
+
+        timer = timer_head;
+
+        if ((timer == NULL) || !TIMER_LESS_THAN_VAL(timer, (uint32_t) tsc))
+            break;
+
+        /* Leave the timer in the heap while its callback runs, since most
+           callbacks immediately re-arm it. */
+        timer->flags &= ~TIMER_ENABLED;
+        timer_heap_expired = timer;
+
+        TIMER_TRACE(TIMER_TRACE_CALLBACK, timer, 0);
+
+        if (timer->flags & TIMER_SPLIT)
+            timer_advance_ex(timer, 0);   /* We're splitting a > 1 s period into multiple <= 1 s periods. */
+        else if (timer->callback != NULL) { /* Make sure it's no NULL, so that we can have a NULL callback when no operation is needed. */
+            INSTRU_COUNT(timer_events, 1);
+            timer->callback(timer->p);
+        }
+
+        TIMER_TRACE(TIMER_TRACE_RETURN, NULL, 0);
+    }
+}
+
+void
+timer_close(void)
+{
+    int i;
+
+    /* Mark all timers as disabled so that a timer that outlives the heap
+       is not looked up in it again. */
+    for (i = 0; i < timer_heap_count; i++)
+        timer_heap[i].timer->flags &= ~TIMER_ENABLED;
+
+    timer_heap_count   = 0;
+    timer_heap_expired = NULL;
+    timer_head         = NULL;
+
+    timer_inited = 0;
+}
+
+void
+timer_set_tsc(uint64_t new_tsc)
+{
+    uint32_t delta = (uint32_t) (new_tsc - tsc);
+    int      i;
+
+    TIMER_TRACE(TIMER_TRACE_SET_TSC, NULL, new_tsc);
+
+    /* Moving every timer by the same amount keeps the heap order. */
+    for (i = 0; i < timer_heap_count; i++) {
+        timer_heap[i].ts += ((uint64_t) delta) << 32;
+        timer_heap[i].timer->ts.ts32.integer += delta;
+    }
+
+    tsc = new_tsc;
+
+    timer_heap_update_head();
+}
+#else
 void
 timer_enable(pc_timer_t *timer)
 {
@@ -26,6 +366,8 @@ timer_enable(pc_timer_t *timer)
     if (timer->flags & TIMER_ENABLED)
         timer_disable(timer);
 
+    TIMER_TRACE(TIMER_TRACE_ENABLE, timer, timer->ts.ts64);
+
     if (timer->next || timer->prev)
         fatal("timer_enable - timer->next\n");
 
@@ -85,6 +427,8 @@ timer_disable(pc_timer_t *timer)
     if (!timer_inited || (timer == NULL) || !(timer->flags & TIMER_ENABLED))
         return;
 
+    TIMER_TRACE(TIMER_TRACE_DISABLE, timer, 0);
+
     if (!timer->next && !timer->prev && timer != timer_head)
         fatal("timer_disable - !timer->next\n");
 
@@ -104,6 +448,8 @@ timer_process(void)
 {
     pc_timer_t *timer;
 
+    TIMER_TRACE(TIMER_TRACE_PROCESS, NULL, tsc);
+
     if (!timer_head)
         return;
 
@@ -120,10 +466,16 @@ timer_process(void)
         timer->next = timer->prev = NULL;
         timer->flags &= ~TIMER_ENABLED;
 
+        TIMER_TRACE(TIMER_TRACE_CALLBACK, timer, 0);
+
         if (timer->flags & TIMER_SPLIT)
             timer_advance_ex(timer, 0);   /* We're splitting a > 1 s period into multiple <= 1 s periods. */
-        else if (timer->callback != NULL) /* Make sure it's no NULL, so that we can have a NULL callback when no operation is needed. */
+        else if (timer->callback != NULL) { /* Make sure it's no NULL, so that we can have a NULL callback when no operation is needed. */
+            INSTRU_COUNT(timer_events, 1);
             timer->callback(timer->p);
+        }
+
+        TIMER_TRACE(TIMER_TRACE_RETURN, NULL, 0);
     }
 
     timer_target = timer_head->ts.ts32.integer;
@@ -148,6 +500,24 @@ timer_close(void)
     timer_inited = 0;
 }
 
+void
+timer_set_tsc(uint64_t new_tsc)
+{
+    uint32_t    delta = (uint32_t) (new_tsc - tsc);
+    pc_timer_t *timer;
+
+    TIMER_TRACE(TIMER_TRACE_SET_TSC, NULL, new_tsc);
+
+    for (timer = timer_head; timer != NULL; timer = timer->next)
+        timer->ts.ts32.integer += delta;
+
+    tsc = new_tsc;
+
+    if (timer_head)
+        timer_target = timer_head->ts.ts32.integer;
+}
+#endif
+
 void
 timer_init(void)
 {
@@ -155,6 +525,15 @@ timer_init(void)
     tsc          = 0;
 
     timer_inited = 1;
+
+#ifdef USE_INSTRUMENT
+    if ((instru_timer_trace != NULL) && !instru_timer_benchmark && (timer_trace_fp == NULL)) {
+        timer_trace_fp = fopen(instru_timer_trace, "wb");
+        if (timer_trace_fp == NULL)
+            fatal("timer_init - cannot write timer trace %s\n", instru_timer_trace);
+    }
+#endif
+    TIMER_TRACE(TIMER_TRACE_INIT, NULL, 0);
 }
 
 void
@@ -235,3 +614,176 @@ timer_on_auto(pc_timer_t *timer, double period)
     else
         timer_stop(timer);
 }
+
+#ifdef USE_INSTRUMENT
+/*Replay state for --timer-benchmark. Each traced timer is stood in for by a
+  dummy timer whose callback replays whatever its original callback did, up
+  to the matching return record, so the scheduler sees the same sequence of
+  calls in the same nesting as it did in the emulator.*/
+static timer_trace_t *timer_bench_trace;
+static size_t         timer_bench_len;
+static size_t         timer_bench_pos;
+static pc_timer_t     timer_bench_timers[TIMER_TRACE_IDS];
+static uint64_t       timer_bench_mismatches;
+
+#    define TIMER_BENCH_PASSES 3
+
+static void timer_bench_callback(void *priv);
+
+static void
+timer_bench_reset(void)
+{
+    int i;
+
+    timer_close();
+    for (i = 0; i < TIMER_TRACE_IDS; i++)
+        timer_add(&timer_bench_timers[i], timer_bench_callback, (void *) (uintptr_t) i, 0);
+    timer_init();
+}
+
+/*Replay records until the end of the trace, or until the return record that
+  ends the callback being replayed.*/
+static void
+timer_bench_replay(int in_callback)
+{
+    const timer_trace_t *rec;
+    pc_timer_t          *timer;
+
+    while (timer_bench_pos < timer_bench_len) {
+        rec = &timer_bench_trace[timer_bench_pos++];
+
+        switch (rec->op) {
+            case TIMER_TRACE_INIT:
+                timer_bench_reset();
+                break;
+            case TIMER_TRACE_ENABLE:
+                timer          = &timer_bench_timers[rec->id];
+                timer->ts.ts64 = rec->ts;
+                timer_enable(timer);
+                break;
+            case TIMER_TRACE_DISABLE:
+                timer_disable(&timer_bench_timers[rec->id]);
+                break;
+            case TIMER_TRACE_PROCESS:
+                tsc = rec->ts;
+                timer_process();
+                break;
+            case TIMER_TRACE_SET_TSC:
+                tsc = rec->ts - rec->id;
+                timer_set_tsc(rec->ts);
+                break;
+            case TIMER_TRACE_RETURN:
+                if (in_callback)
+                    return;
+                timer_bench_mismatches++;
+                break;
+            default:
+                /* A callback the scheduler did not run. */
+                timer_bench_mismatches++;
+                break;
+        }
+    }
+}
+
+static void
+timer_bench_callback(void *priv)
+{
+    const timer_trace_t *rec = &timer_bench_trace[timer_bench_pos];
+
+    if ((timer_bench_pos < timer_bench_len) && (rec->op == TIMER_TRACE_CALLBACK) && (rec->id == (uint32_t) (uintptr_t) priv)) {
+        timer_bench_pos++;
+        timer_bench_replay(1);
+    } else
+        timer_bench_mismatches++;
+}
+
+int
+timer_benchmark(void)
+{
+    FILE    *fp;
+    long     size;
+    uint64_t counts[TIMER_TRACE_SET_TSC + 1] = { 0 };
+    uint64_t events;
+    uint8_t *seen;
+    int      timers = 0;
+    uint32_t start;
+    uint32_t us;
+    uint32_t best_us = 0;
+    size_t   i;
+    int      pass;
+
+    fp = fopen(instru_timer_trace, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "timer_benchmark: cannot open %s\n", instru_timer_trace);
+        return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    timer_bench_len   = (size > 0) ? ((size_t) size / sizeof(timer_trace_t)) : 0;
+    timer_bench_trace = (timer_trace_t *) malloc(MAX(timer_bench_len, 1) * sizeof(timer_trace_t));
+    if ((timer_bench_trace == NULL) || (fread(timer_bench_trace, sizeof(timer_trace_t), timer_bench_len, fp) != timer_bench_len)) {
+        fprintf(stderr, "timer_benchmark: cannot read %s\n", instru_timer_trace);
+        fclose(fp);
+        free(timer_bench_trace);
+        return 1;
+    }
+    fclose(fp);
+
+    seen = (uint8_t *) calloc(TIMER_TRACE_IDS, 1);
+    for (i = 0; i < timer_bench_len; i++) {
+        if ((seen == NULL) || (timer_bench_trace[i].op > TIMER_TRACE_SET_TSC) || ((timer_bench_trace[i].op != TIMER_TRACE_SET_TSC) && (timer_bench_trace[i].id >= TIMER_TRACE_IDS))) {
+            fprintf(stderr, "timer_benchmark: %s is not a timer trace\n", instru_timer_trace);
+            free(timer_bench_trace);
+            free(seen);
+            return 1;
+        }
+        counts[timer_bench_trace[i].op]++;
+        if ((timer_bench_trace[i].op == TIMER_TRACE_ENABLE) && !seen[timer_bench_trace[i].id]) {
+            seen[timer_bench_trace[i].id] = 1;
+            timers++;
+        }
+    }
+    free(seen);
+
+    for (pass = 0; pass < TIMER_BENCH_PASSES; pass++) {
+        timer_bench_mismatches = 0;
+        timer_bench_pos        = 0;
+        timer_bench_reset();
+
+        start = plat_get_micro_ticks();
+        timer_bench_replay(0);
+        us = plat_get_micro_ticks() - start;
+
+        if ((pass == 0) || (us < best_us))
+            best_us = us;
+    }
+
+    timer_close();
+    free(timer_bench_trace);
+    timer_bench_trace = NULL;
+
+    /* Callback and return records are replayed by the callbacks themselves,
+       so they are not scheduler operations of their own. */
+    events = counts[TIMER_TRACE_ENABLE] + counts[TIMER_TRACE_DISABLE] + counts[TIMER_TRACE_PROCESS];
+
+#    ifdef USE_TIMER_HEAP
+    printf("{\n    \"backend\": \"heap\",\n");
+#    else
+    printf("{\n    \"backend\": \"list\",\n");
+#    endif
+    printf("    \"timers\": %i,\n", timers);
+    printf("    \"enables\": %llu,\n", (unsigned long long) counts[TIMER_TRACE_ENABLE]);
+    printf("    \"disables\": %llu,\n", (unsigned long long) counts[TIMER_TRACE_DISABLE]);
+    printf("    \"process_calls\": %llu,\n", (unsigned long long) counts[TIMER_TRACE_PROCESS]);
+    printf("    \"callbacks\": %llu,\n", (unsigned long long) counts[TIMER_TRACE_CALLBACK]);
+    printf("    \"replay_ms\": %.3f,\n", best_us / 1000.0);
+    printf("    \"ns_per_event\": %.2f,\n", events ? ((best_us * 1000.0) / (double) events) : 0.0);
+    printf("    \"mismatches\": %llu\n", (unsigned long long) timer_bench_mismatches);
+    printf("}\n");
+    fflush(stdout);
+
+    return (timer_bench_mismatches != 0);
+}
+#endif
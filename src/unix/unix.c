@@ -22,6 +22,7 @@
 #include <stdatomic.h>
 
 #include <86box/86box.h>
+#include "cpu.h"
 #include <86box/mem.h>
 #include <86box/rom.h>
 #include <86box/keyboard.h>
@@ -33,12 +34,23 @@
 #include <86box/thread.h>
 #include <86box/device.h>
 #include <86box/gameport.h>
+#include <86box/machine.h>
+#include <86box/dma.h>
 #include <86box/unix_sdl.h>
 #include <86box/timer.h>
 #include <86box/nvr.h>
 #include <86box/video.h>
+#include <86box/vid_svga.h>
+#include <86box/vid_svga_render.h>
+#include <86box/sound.h>
+#include <86box/snd_emu8k.h>
+#include <86box/hdd.h>
 #include <86box/ui.h>
 #include <86box/gdbstub.h>
+#include <86box/savestate.h>
+#ifdef USE_DYNAREC
+#    include "codegen_public.h"
+#endif
 
 #ifdef __APPLE__
 #    include "macOSXGlue.h"
@@ -570,6 +582,69 @@ main_thread(void *param)
 
 thread_t *thMain = NULL;
 
+#ifdef USE_INSTRUMENT
+/* Headless benchmark: run the machine unthrottled, with no video or audio
+   output, for a fixed amount of emulated time and print the event counters
+   as JSON. Each pc_run() call emulates 10 ms. */
+static void
+unix_benchmark(void)
+{
+    uint64_t slices = (instru_run_ms + 9) / 10;
+    uint64_t run    = 0;
+    uint64_t start_us, wall_us;
+    double   emu_secs, wall_secs;
+
+    SDL_InitSubSystem(SDL_INIT_TIMER);
+    timer_freq = SDL_GetPerformanceFrequency();
+
+    instru_ins           = 0;
+    instru_frames        = 0;
+    instru_timer_events  = 0;
+    instru_io_accesses   = 0;
+    instru_mmio_accesses = 0;
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    codegen_cache_allocs     = 0;
+    codegen_cache_evictions  = 0;
+    codegen_cache_recompiles = 0;
+#endif
+
+    start_us = plat_get_ticks_common();
+    while (!is_quit && cpu_thread_run && (run < slices)) {
+        pc_run();
+        run++;
+    }
+    wall_us = plat_get_ticks_common() - start_us;
+    if (!wall_us)
+        wall_us = 1;
+
+    emu_secs  = (double) run / 100.0;
+    wall_secs = (double) wall_us / 1000000.0;
+
+    printf("{\n");
+    printf("    \"machine\": \"%s\",\n", machine_get_internal_name());
+    printf("    \"cpu\": \"%s\",\n", cpu_s->name);
+    printf("    \"emulated_seconds\": %.2f,\n", emu_secs);
+    printf("    \"wall_seconds\": %.3f,\n", wall_secs);
+    printf("    \"speed_percent\": %.1f,\n", (emu_secs * 100.0) / wall_secs);
+    printf("    \"instructions\": %" PRIu64 ",\n", instru_ins);
+    printf("    \"mips\": %.2f,\n", (double) instru_ins / wall_secs / 1000000.0);
+    printf("    \"guest_mips\": %.2f,\n", emu_secs ? ((double) instru_ins / emu_secs / 1000000.0) : 0.0);
+    printf("    \"frames\": %" PRIu64 ",\n", instru_frames);
+    printf("    \"timer_events\": %" PRIu64 ",\n", instru_timer_events);
+    printf("    \"io_accesses\": %" PRIu64 ",\n", instru_io_accesses);
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    printf("    \"mmio_accesses\": %" PRIu64 ",\n", instru_mmio_accesses);
+    printf("    \"code_cache_allocs\": %" PRIu64 ",\n", codegen_cache_allocs);
+    printf("    \"code_cache_evictions\": %" PRIu64 ",\n", codegen_cache_evictions);
+    printf("    \"code_cache_recompiles\": %" PRIu64 "\n", codegen_cache_recompiles);
+#else
+    printf("    \"mmio_accesses\": %" PRIu64 "\n", instru_mmio_accesses);
+#endif
+    printf("}\n");
+    fflush(stdout);
+}
+#endif
+
 void
 do_start(void)
 {
@@ -910,6 +985,11 @@ monitor_thread(void *param)
                         "zipeject <id> - eject ZIP image from ZIP drive <id>.\n"
                         "carteject <id> - eject cartridge from drive <id>.\n"
                         "moeject <id> - eject image from MO drive <id>.\n\n"
+                        "savestate <filename> - save the state of the emulated system.\n"
+                        "loadstate <filename> - restore a saved state of the emulated system.\n\n"
+                        "hddcow <base> <overlay> - create a copy-on-write overlay of raw image <base>.\n"
+                        "hddcommit <id> - merge the overlay of hard disk <id> into its base image.\n"
+                        "hddflatten <id> <filename> - write hard disk <id> out as a raw image.\n\n"
                         "hardreset - hard reset the emulated system.\n"
                         "pause - pause the the emulated system.\n"
                         "fullscreen - toggle fullscreen.\n"
@@ -924,6 +1004,48 @@ monitor_thread(void *param)
                     printf("%s", dopause ? "Paused.\n" : "Unpaused.\n");
                 } else if (strncasecmp(xargv[0], "hardreset", 9) == 0) {
                     pc_reset_hard();
+                } else if (strncasecmp(xargv[0], "savestate", 9) == 0 && cmdargc >= 2) {
+                    printf("Saving state to %s\n", xargv[1]);
+                    savestate_request(0, xargv[1]);
+                } else if (strncasecmp(xargv[0], "loadstate", 9) == 0 && cmdargc >= 2) {
+                    printf("Restoring state from %s\n", xargv[1]);
+                    savestate_request(1, xargv[1]);
+                } else if (strncasecmp(xargv[0], "hddcow", 6) == 0 && cmdargc >= 3) {
+                    uint32_t c, h, s;
+                    char     base[PATH_MAX];
+                    FILE    *f = NULL;
+
+                    /* Relative base names would be taken as relative to the
+                       overlay, so store the full path. */
+                    if (realpath(xargv[1], base) != NULL)
+                        f = plat_fopen64(base, "rb");
+
+                    if (f == NULL)
+                        fprintf(stderr, "Unable to open %s\n", xargv[1]);
+                    else {
+                        fseeko64(f, 0, SEEK_END);
+                        hdd_image_calc_chs(&c, &h, &s, (uint32_t) (ftello64(f) >> 20));
+                        fclose(f);
+
+                        if (hdd_cow_create(xargv[2], base, s, h, c))
+                            printf("Created %s (%u/%u/%u) on top of %s\n", xargv[2], c, h, s, base);
+                        else
+                            fprintf(stderr, "Unable to create %s\n", xargv[2]);
+                    }
+                } else if (strncasecmp(xargv[0], "hddcommit", 9) == 0 && cmdargc >= 2) {
+                    uint8_t id = atoi(xargv[1]);
+
+                    if ((id < HDD_NUM) && hdd_image_commit(id))
+                        printf("Committed hard disk %hhu\n", id);
+                    else
+                        fprintf(stderr, "Unable to commit hard disk %hhu\n", id);
+                } else if (strncasecmp(xargv[0], "hddflatten", 10) == 0 && cmdargc >= 3) {
+                    uint8_t id = atoi(xargv[1]);
+
+                    if ((id < HDD_NUM) && hdd_image_flatten(id, xargv[2]))
+                        printf("Wrote hard disk %hhu to %s\n", id, xargv[2]);
+                    else
+                        fprintf(stderr, "Unable to write hard disk %hhu to %s\n", id, xargv[2]);
                 } else if (strncasecmp(xargv[0], "cdload", 6) == 0 && cmdargc >= 3) {
                     uint8_t id;
                     bool    err = false;
@@ -1077,6 +1199,46 @@ main(int argc, char **argv)
         return 6;
     }
 
+#ifdef USE_INSTRUMENT
+    if (instru_render_benchmark) {
+        SDL_InitSubSystem(SDL_INIT_TIMER);
+        svga_render_benchmark();
+        SDL_Quit();
+        return 0;
+    }
+    if (instru_emu8k_benchmark) {
+        SDL_InitSubSystem(SDL_INIT_TIMER);
+        emu8k_benchmark();
+        SDL_Quit();
+        return 0;
+    }
+    if (instru_mix_benchmark) {
+        SDL_InitSubSystem(SDL_INIT_TIMER);
+        sound_mix_benchmark();
+        SDL_Quit();
+        return 0;
+    }
+    if (instru_hdd_cow_test) {
+        int ret = hdd_cow_test();
+        SDL_Quit();
+        return ret;
+    }
+    if (instru_hdd_benchmark) {
+        SDL_InitSubSystem(SDL_INIT_TIMER);
+        hdd_image_benchmark();
+        SDL_Quit();
+        return 0;
+    }
+    if (instru_timer_benchmark) {
+        int ret;
+
+        SDL_InitSubSystem(SDL_INIT_TIMER);
+        ret = timer_benchmark();
+        SDL_Quit();
+        return ret;
+    }
+#endif
+
     gfxcard_2   = 0;
     eventthread = SDL_ThreadID();
     blitmtx     = SDL_CreateMutex();
@@ -1095,6 +1257,24 @@ main(int argc, char **argv)
     } else
         fprintf(stderr, "libedit not found, line editing will be limited.\n");
     mousemutex = SDL_CreateMutex();
+
+#ifdef USE_INSTRUMENT
+    if (instru_benchmark || instru_dma_benchmark) {
+        /* No window, console or timers, just the machine. */
+        pc_reset_hard_init();
+        if (instru_dma_benchmark) {
+            SDL_InitSubSystem(SDL_INIT_TIMER);
+            dma_bm_benchmark();
+        } else
+            unix_benchmark();
+        pc_close(NULL);
+        SDL_DestroyMutex(blitmtx);
+        SDL_DestroyMutex(mousemutex);
+        SDL_Quit();
+        return 0;
+    }
+#endif
+
     sdl_initho();
 
     if (start_in_fullscreen) {
@@ -26,6 +26,7 @@
 #include <86box/device.h>
 #include <86box/io.h>
 #include <86box/mem.h>
+#include <86box/savestate.h>
 #include <86box/usb.h>
 #include "cpu.h"
 
@@ -379,6 +380,16 @@ usb_reset(void *priv)
     dev->ohci_enable = 0;
 }
 
+/* The I/O and memory windows are mapped by the southbridge. */
+static void
+usb_savestate(savestate_t *st, void *priv)
+{
+    usb_t *dev = (usb_t *) priv;
+
+    savestate_var(st, dev->uhci_io);
+    savestate_var(st, dev->ohci_mmio);
+}
+
 static void
 usb_close(void *priv)
 {
@@ -426,5 +437,6 @@ const device_t usb_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = usb_savestate
 };
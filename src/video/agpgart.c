@@ -24,6 +24,7 @@
 #include <86box/device.h>
 #include <86box/mem.h>
 #include <86box/agpgart.h>
+#include <86box/savestate.h>
 
 #ifdef ENABLE_AGPGART_LOG
 int agpgart_do_log = ENABLE_AGPGART_LOG;
@@ -128,6 +129,26 @@ agpgart_aperture_writel(uint32_t addr, uint32_t val, void *priv)
     mem_writel_phys(agpgart_translate(addr, dev), val);
 }
 
+static void
+agpgart_savestate(savestate_t *st, void *priv)
+{
+    agpgart_t *dev    = (agpgart_t *) priv;
+    int        enable = dev->aperture_enable;
+    uint32_t   base   = dev->aperture_base;
+    uint32_t   size   = dev->aperture_size;
+    uint32_t   gart   = dev->gart_base;
+
+    savestate_var(st, enable);
+    savestate_var(st, base);
+    savestate_var(st, size);
+    savestate_var(st, gart);
+
+    if (savestate_loading(st)) {
+        agpgart_set_aperture(dev, base, size, enable);
+        agpgart_set_gart(dev, gart);
+    }
+}
+
 static void *
 agpgart_init(const device_t *info)
 {
@@ -169,5 +190,6 @@ const device_t agpgart_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .state         = agpgart_savestate
 };
@@ -3458,7 +3458,7 @@ ibm8514_poll(ibm8514_t *dev, svga_t *svga)
             wx = x;
 
             wy = dev->lastline - dev->firstline;
-            svga_doblit(wx, wy, svga);
+            svga_doblit_lines(wx, wy, svga, dev->firstline_draw, dev->lastline_draw);
 
             dev->firstline = 2000;
             dev->lastline  = 0;
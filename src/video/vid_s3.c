@@ -37,6 +37,7 @@
 #include <86box/vid_ddc.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
+#include <86box/savestate.h>
 #include "cpu.h"
 
 #define ROM_ORCHID_86C911              "roms/video/s3/BIOS.BIN"
@@ -8534,6 +8535,53 @@ s3_trio64v2_dx_available(void)
     return rom_present(ROM_TRIO64V2_DX_VBE20);
 }
 
+/* The extension registers are restored before the VGA part, as the timings
+   are recalculated from both. External RAMDACs and clock chips are devices
+   of their own. */
+static void
+s3_savestate(savestate_t *st, void *p)
+{
+    s3_t *s3 = (s3_t *) p;
+
+    s3_wait_fifo_idle(s3);
+
+    savestate_var(st, s3->bank);
+    savestate_var(st, s3->ma_ext);
+    savestate_var(st, s3->width);
+    savestate_var(st, s3->bpp);
+    savestate_var(st, s3->int_line);
+    savestate_var(st, s3->packed_mmio);
+    savestate_var(st, s3->pci_regs);
+    savestate_var(st, s3->data_available);
+    savestate_var(st, s3->accel);
+    savestate_var(st, s3->videoengine);
+    savestate_var(st, s3->streams);
+    savestate_var(st, s3->subsys_cntl);
+    savestate_var(st, s3->subsys_stat);
+    savestate_var(st, s3->hwc_fg_col);
+    savestate_var(st, s3->hwc_bg_col);
+    savestate_var(st, s3->hwc_col_stack_pos);
+    savestate_var(st, s3->translate);
+    savestate_var(st, s3->enable_8514);
+    savestate_var(st, s3->color_16bit);
+
+    svga_savestate(&s3->svga, st);
+
+    if (s3->has_bios)
+        savestate_mapping(st, &s3->bios_rom.mapping);
+
+    if (savestate_loading(st)) {
+        if (s3->pci) {
+            if (s3->pci_regs[PCI_REG_COMMAND] & PCI_COMMAND_IO)
+                s3_io_set(s3);
+            else
+                s3_io_remove(s3);
+        }
+
+        s3_updatemapping(s3);
+    }
+}
+
 static void
 s3_close(void *p)
 {
@@ -8660,7 +8708,8 @@ const device_t s3_orchid_86c911_isa_device = {
     { .available = s3_orchid_86c911_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_orchid_86c911_config
+    .config        = s3_orchid_86c911_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_diamond_stealth_vram_isa_device = {
@@ -8674,7 +8723,8 @@ const device_t s3_diamond_stealth_vram_isa_device = {
     { .available = s3_diamond_stealth_vram_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_orchid_86c911_config
+    .config        = s3_orchid_86c911_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_ami_86c924_isa_device = {
@@ -8688,7 +8738,8 @@ const device_t s3_ami_86c924_isa_device = {
     { .available = s3_ami_86c924_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_orchid_86c911_config
+    .config        = s3_orchid_86c911_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_spea_mirage_86c801_isa_device = {
@@ -8702,7 +8753,8 @@ const device_t s3_spea_mirage_86c801_isa_device = {
     { .available = s3_spea_mirage_86c801_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_86c805_onboard_vlb_device = {
@@ -8716,7 +8768,8 @@ const device_t s3_86c805_onboard_vlb_device = {
     { .available = NULL },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_spea_mirage_86c805_vlb_device = {
@@ -8730,7 +8783,8 @@ const device_t s3_spea_mirage_86c805_vlb_device = {
     { .available = s3_spea_mirage_86c805_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_mirocrystal_8s_805_vlb_device = {
@@ -8744,7 +8798,8 @@ const device_t s3_mirocrystal_8s_805_vlb_device = {
     { .available = s3_mirocrystal_8s_805_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_mirocrystal_10sd_805_vlb_device = {
@@ -8758,7 +8813,8 @@ const device_t s3_mirocrystal_10sd_805_vlb_device = {
     { .available = s3_mirocrystal_10sd_805_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_86c801_isa_device = {
@@ -8772,7 +8828,8 @@ const device_t s3_phoenix_86c801_isa_device = {
     { .available = s3_phoenix_86c80x_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_86c805_vlb_device = {
@@ -8786,7 +8843,8 @@ const device_t s3_phoenix_86c805_vlb_device = {
     { .available = s3_phoenix_86c80x_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_metheus_86c928_isa_device = {
@@ -8800,7 +8858,8 @@ const device_t s3_metheus_86c928_isa_device = {
     { .available = s3_metheus_86c928_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_metheus_86c928_vlb_device = {
@@ -8814,7 +8873,8 @@ const device_t s3_metheus_86c928_vlb_device = {
     { .available = s3_metheus_86c928_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_spea_mercury_lite_86c928_pci_device = {
@@ -8828,7 +8888,8 @@ const device_t s3_spea_mercury_lite_86c928_pci_device = {
     { .available = s3_spea_mercury_lite_pci_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_mirocrystal_20sd_864_vlb_device = {
@@ -8842,7 +8903,8 @@ const device_t s3_mirocrystal_20sd_864_vlb_device = {
     { .available = s3_mirocrystal_20sd_864_vlb_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_bahamas64_vlb_device = {
@@ -8856,7 +8918,8 @@ const device_t s3_bahamas64_vlb_device = {
     { .available = s3_bahamas64_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_bahamas64_pci_device = {
@@ -8870,7 +8933,8 @@ const device_t s3_bahamas64_pci_device = {
     { .available = s3_bahamas64_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_mirocrystal_20sv_964_vlb_device = {
@@ -8884,7 +8948,8 @@ const device_t s3_mirocrystal_20sv_964_vlb_device = {
     { .available = s3_mirocrystal_20sv_964_vlb_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_mirocrystal_20sv_964_pci_device = {
@@ -8898,7 +8963,8 @@ const device_t s3_mirocrystal_20sv_964_pci_device = {
     { .available = s3_mirocrystal_20sv_964_pci_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_diamond_stealth64_964_vlb_device = {
@@ -8912,7 +8978,8 @@ const device_t s3_diamond_stealth64_964_vlb_device = {
     { .available = s3_diamond_stealth64_964_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_diamond_stealth64_964_pci_device = {
@@ -8926,7 +8993,8 @@ const device_t s3_diamond_stealth64_964_pci_device = {
     { .available = s3_diamond_stealth64_964_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_9fx_771_pci_device = {
@@ -8940,7 +9008,8 @@ const device_t s3_9fx_771_pci_device = {
     { .available = s3_9fx_771_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_vision968_pci_device = {
@@ -8954,7 +9023,8 @@ const device_t s3_phoenix_vision968_pci_device = {
     { .available = s3_phoenix_vision968_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_vision968_vlb_device = {
@@ -8968,7 +9038,8 @@ const device_t s3_phoenix_vision968_vlb_device = {
     { .available = s3_phoenix_vision968_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_mirovideo_40sv_ergo_968_pci_device = {
@@ -8982,7 +9053,8 @@ const device_t s3_mirovideo_40sv_ergo_968_pci_device = {
     { .available = s3_mirovideo_40sv_ergo_968_pci_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_spea_mercury_p64v_pci_device = {
@@ -8996,7 +9068,8 @@ const device_t s3_spea_mercury_p64v_pci_device = {
     { .available = s3_spea_mercury_p64v_pci_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_9fx_vlb_device = {
@@ -9010,7 +9083,8 @@ const device_t s3_9fx_vlb_device = {
     { .available = s3_9fx_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_9fx_pci_device = {
@@ -9024,7 +9098,8 @@ const device_t s3_9fx_pci_device = {
     { .available = s3_9fx_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_trio32_vlb_device = {
@@ -9038,7 +9113,8 @@ const device_t s3_phoenix_trio32_vlb_device = {
     { .available = s3_phoenix_trio32_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_phoenix_trio32_config
+    .config        = s3_phoenix_trio32_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_trio32_pci_device = {
@@ -9052,7 +9128,8 @@ const device_t s3_phoenix_trio32_pci_device = {
     { .available = s3_phoenix_trio32_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_phoenix_trio32_config
+    .config        = s3_phoenix_trio32_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_diamond_stealth_se_vlb_device = {
@@ -9066,7 +9143,8 @@ const device_t s3_diamond_stealth_se_vlb_device = {
     { .available = s3_diamond_stealth_se_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_phoenix_trio32_config
+    .config        = s3_phoenix_trio32_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_diamond_stealth_se_pci_device = {
@@ -9080,7 +9158,8 @@ const device_t s3_diamond_stealth_se_pci_device = {
     { .available = s3_diamond_stealth_se_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_phoenix_trio32_config
+    .config        = s3_phoenix_trio32_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_trio64_vlb_device = {
@@ -9094,7 +9173,8 @@ const device_t s3_phoenix_trio64_vlb_device = {
     { .available = s3_phoenix_trio64_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_trio64_onboard_pci_device = {
@@ -9108,7 +9188,8 @@ const device_t s3_phoenix_trio64_onboard_pci_device = {
     { .available = NULL },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_trio64_pci_device = {
@@ -9122,7 +9203,8 @@ const device_t s3_phoenix_trio64_pci_device = {
     { .available = s3_phoenix_trio64_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_trio64vplus_onboard_pci_device = {
@@ -9136,7 +9218,8 @@ const device_t s3_phoenix_trio64vplus_onboard_pci_device = {
     { .available = NULL },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_trio64vplus_pci_device = {
@@ -9150,7 +9233,8 @@ const device_t s3_phoenix_trio64vplus_pci_device = {
     { .available = s3_phoenix_trio64vplus_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_vision864_vlb_device = {
@@ -9164,7 +9248,8 @@ const device_t s3_phoenix_vision864_vlb_device = {
     { .available = s3_phoenix_vision864_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_vision864_pci_device = {
@@ -9178,7 +9263,8 @@ const device_t s3_phoenix_vision864_pci_device = {
     { .available = s3_phoenix_vision864_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_9fx_531_pci_device = {
@@ -9192,7 +9278,8 @@ const device_t s3_9fx_531_pci_device = {
     { .available = s3_9fx_531_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_vision868_vlb_device = {
@@ -9206,7 +9293,8 @@ const device_t s3_phoenix_vision868_vlb_device = {
     { .available = s3_phoenix_vision868_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_phoenix_vision868_pci_device = {
@@ -9220,7 +9308,8 @@ const device_t s3_phoenix_vision868_pci_device = {
     { .available = s3_phoenix_vision868_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_diamond_stealth64_vlb_device = {
@@ -9234,7 +9323,8 @@ const device_t s3_diamond_stealth64_vlb_device = {
     { .available = s3_diamond_stealth64_764_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_diamond_stealth64_pci_device = {
@@ -9248,7 +9338,8 @@ const device_t s3_diamond_stealth64_pci_device = {
     { .available = s3_diamond_stealth64_764_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_spea_mirage_p64_vlb_device = {
@@ -9262,7 +9353,8 @@ const device_t s3_spea_mirage_p64_vlb_device = {
     { .available = s3_spea_mirage_p64_vlb_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_9fx_config
+    .config        = s3_9fx_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_elsa_winner2000_pro_x_964_pci_device = {
@@ -9276,7 +9368,8 @@ const device_t s3_elsa_winner2000_pro_x_964_pci_device = {
     { .available = s3_elsa_winner2000_pro_x_964_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_968_config
+    .config        = s3_968_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_elsa_winner2000_pro_x_pci_device = {
@@ -9290,7 +9383,8 @@ const device_t s3_elsa_winner2000_pro_x_pci_device = {
     { .available = s3_elsa_winner2000_pro_x_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_968_config
+    .config        = s3_968_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_trio64v2_dx_pci_device = {
@@ -9304,7 +9398,8 @@ const device_t s3_trio64v2_dx_pci_device = {
     { .available = s3_trio64v2_dx_available },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
 
 const device_t s3_trio64v2_dx_onboard_pci_device = {
@@ -9318,5 +9413,6 @@ const device_t s3_trio64v2_dx_onboard_pci_device = {
     { .available = NULL },
     .speed_changed = s3_speed_changed,
     .force_redraw  = s3_force_redraw,
-    .config        = s3_standard_config
+    .config        = s3_standard_config,
+    .state         = s3_savestate
 };
@@ -21,6 +21,8 @@
  */
 #include <inttypes.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -37,12 +39,15 @@
 #include <86box/mem.h>
 #include <86box/rom.h>
 #include <86box/plat.h>
+#include <86box/thread.h>
 #include <86box/ui.h>
 #include <86box/video.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
+#include <86box/savestate.h>
 
 void svga_doblit(int wx, int wy, svga_t *svga);
+void svga_doblit_lines(int wx, int wy, svga_t *svga, int firstline_draw, int lastline_draw);
 
 svga_t *svga_8514;
 
@@ -410,6 +415,59 @@ svga_set_ramdac_type(svga_t *svga, int type)
     }
 }
 
+/* Save or restore the state of the standard VGA part of a card. Cards with
+   extensions save their own registers on top of this. */
+void
+svga_savestate(svga_t *svga, savestate_t *st)
+{
+    int c;
+
+    /* The runs of plain registers and counters in the structure. */
+    savestate_data(st, &svga->fast, offsetof(svga_t, hblank_overscan) + 1 - offsetof(svga_t, fast));
+    savestate_data(st, &svga->dac_addr, offsetof(svga_t, hblank_end_len) + sizeof(int) - offsetof(svga_t, dac_addr));
+    savestate_data(st, &svga->crtcreg, offsetof(svga_t, ksc5601_udc_area_msb) + 2 - offsetof(svga_t, crtcreg));
+
+    savestate_var(st, svga->crtc);
+    savestate_var(st, svga->gdcreg);
+    savestate_var(st, svga->attrregs);
+    savestate_var(st, svga->seqregs);
+    savestate_var(st, svga->egapal);
+    savestate_var(st, svga->vgapal);
+    savestate_var(st, svga->latch);
+    savestate_var(st, svga->charseta);
+    savestate_var(st, svga->charsetb);
+    savestate_var(st, svga->ma_latch);
+    savestate_var(st, svga->ca_adj);
+    savestate_var(st, svga->ma);
+    savestate_var(st, svga->maback);
+    savestate_var(st, svga->ca);
+    savestate_var(st, svga->write_bank);
+    savestate_var(st, svga->read_bank);
+    savestate_var(st, svga->extra_banks);
+    savestate_var(st, svga->banked_mask);
+    savestate_var(st, svga->dispontime);
+    savestate_var(st, svga->dispofftime);
+
+    savestate_block(st, svga->vram, svga->vram_max);
+    savestate_mapping(st, &svga->mapping);
+    savestate_timer(st, &svga->timer);
+
+    if (savestate_loading(st)) {
+        for (c = 0; c < 256; c++) {
+            if (svga->ramdac_type == RAMDAC_8BIT)
+                svga->pallook[c] = makecol32(svga->vgapal[c].r, svga->vgapal[c].g, svga->vgapal[c].b);
+            else
+                svga->pallook[c] = makecol32(video_6to8[svga->vgapal[c].r & 0x3f],
+                                             video_6to8[svga->vgapal[c].g & 0x3f],
+                                             video_6to8[svga->vgapal[c].b & 0x3f]);
+        }
+        svga->overscan_color = svga->pallook[svga->attrregs[0x11]];
+
+        svga_recalctimings(svga);
+        svga->fullchange = changeframecount;
+    }
+}
+
 void
 svga_recalctimings(svga_t *svga)
 {
@@ -619,6 +677,276 @@ svga_recalctimings(svga_t *svga)
     }
 }
 
+/*Scanline render workers.
+
+  With video_render_threads set, lines drawn by the packed pixel renderers
+  are not drawn on the CPU thread. svga_do_render() instead records what the
+  renderer needs for the line and queues it to one of the workers, which run
+  the unchanged renderer against a private copy of svga_t. Whether the line
+  has changed is decided when it is queued, as changedvram and fullchange
+  move on before the worker gets to it. The palette is copied to the workers
+  when it changes, after they have drawn the lines queued with the old one.
+  Lines with a cursor or overlay, text and planar modes are still drawn on
+  the CPU thread. svga_doblit() waits for the workers before the frame is
+  handed to the blitter.*/
+#define SVGA_RENDER_THREADS_MAX 8
+#define SVGA_RENDER_QUEUE_SIZE  4096
+#define SVGA_RENDER_QUEUE_MASK  (SVGA_RENDER_QUEUE_SIZE - 1)
+
+typedef struct svga_render_line_t {
+    void (*render)(svga_t *svga);
+    uint32_t (*remap_func)(struct svga_t *svga, uint32_t in_addr);
+    uint32_t ma, overscan_color;
+    int      displine, y_add, x_add, overscan_x_add,
+        hdisp, scrollcache, sc, vram_display_mask;
+    uint8_t remap_required, force_old_addr, scrblank;
+} svga_render_line_t;
+
+typedef struct svga_render_worker_t {
+    svga_t   *shadow;
+    thread_t *thread;
+    event_t  *wake, *idle;
+    int       run;
+
+    atomic_uint        read_pos, write_pos;
+    svga_render_line_t lines[SVGA_RENDER_QUEUE_SIZE];
+} svga_render_worker_t;
+
+static int
+svga_render_worker_busy(svga_render_worker_t *worker)
+{
+    return atomic_load(&worker->read_pos) != atomic_load(&worker->write_pos);
+}
+
+static void
+svga_render_thread(void *param)
+{
+    svga_render_worker_t *worker = (svga_render_worker_t *) param;
+    svga_t               *shadow = worker->shadow;
+    svga_render_line_t   *line;
+    unsigned int          pos;
+
+    while (1) {
+        thread_wait_event(worker->wake, -1);
+        thread_reset_event(worker->wake);
+        if (!worker->run)
+            break;
+
+        while ((pos = atomic_load(&worker->read_pos)) != atomic_load(&worker->write_pos)) {
+            line = &worker->lines[pos & SVGA_RENDER_QUEUE_MASK];
+
+            shadow->ma                = line->ma;
+            shadow->displine          = line->displine;
+            shadow->y_add             = line->y_add;
+            shadow->x_add             = line->x_add;
+            shadow->hdisp             = line->hdisp;
+            shadow->scrollcache       = line->scrollcache;
+            shadow->sc                = line->sc;
+            shadow->vram_display_mask = line->vram_display_mask;
+            shadow->remap_required    = line->remap_required;
+            shadow->remap_func        = line->remap_func;
+            shadow->force_old_addr    = line->force_old_addr;
+            shadow->overscan_color    = line->overscan_color;
+            shadow->scrblank          = line->scrblank;
+
+            line->render(shadow);
+
+            shadow->x_add = line->overscan_x_add;
+            svga_render_overscan_left(shadow);
+            svga_render_overscan_right(shadow);
+
+            atomic_store(&worker->read_pos, pos + 1);
+        }
+
+        thread_set_event(worker->idle);
+    }
+}
+
+/*Wait until the workers have drawn every queued line*/
+static void
+svga_render_wait(svga_t *svga)
+{
+    svga_render_worker_t *worker;
+    int                   c;
+
+    for (c = 0; c < svga->render_threads; c++) {
+        worker = &svga->render_workers[c];
+        while (svga_render_worker_busy(worker)) {
+            thread_reset_event(worker->idle);
+            if (!svga_render_worker_busy(worker))
+                break;
+            thread_wait_event(worker->idle, -1);
+        }
+    }
+}
+
+static void
+svga_render_start_threads(svga_t *svga, int threads)
+{
+    svga_render_worker_t *worker;
+    int                   c;
+
+    svga->render_workers = calloc(threads, sizeof(svga_render_worker_t));
+    if (!svga->render_workers)
+        fatal("svga_render_start_threads: out of memory\n");
+    svga->render_threads     = threads;
+    svga->render_next_worker = 0;
+
+    for (c = 0; c < threads; c++) {
+        worker         = &svga->render_workers[c];
+        worker->shadow = calloc(1, sizeof(svga_t));
+        if (!worker->shadow)
+            fatal("svga_render_start_threads: out of memory\n");
+        worker->shadow->vram        = svga->vram;
+        worker->shadow->changedvram = svga->changedvram;
+        worker->shadow->map8        = worker->shadow->pallook;
+        /*The line was found to have changed when it was queued*/
+        worker->shadow->fullchange = 1;
+
+        worker->run  = 1;
+        worker->wake = thread_create_event();
+        worker->idle = thread_create_event();
+        atomic_init(&worker->read_pos, 0);
+        atomic_init(&worker->write_pos, 0);
+        worker->thread = thread_create(svga_render_thread, worker);
+    }
+}
+
+static void
+svga_render_stop_threads(svga_t *svga)
+{
+    svga_render_worker_t *worker;
+    int                   c;
+
+    if (!svga->render_workers)
+        return;
+
+    svga_render_wait(svga);
+    for (c = 0; c < svga->render_threads; c++) {
+        worker      = &svga->render_workers[c];
+        worker->run = 0;
+        thread_set_event(worker->wake);
+        thread_wait(worker->thread);
+        thread_destroy_event(worker->wake);
+        thread_destroy_event(worker->idle);
+        free(worker->shadow);
+    }
+    free(svga->render_workers);
+    svga->render_workers = NULL;
+    svga->render_threads = 0;
+}
+
+/*Whether the renderer depends on nothing but the fields in svga_render_line_t,
+  VRAM and the palette*/
+static int
+svga_render_can_queue(svga_t *svga)
+{
+    void (*render)(svga_t *svga) = svga->render;
+
+    if (svga->hwcursor_on || svga->dac_hwcursor_on || svga->overlay_on)
+        return 0;
+
+    /*Both monitors are written through buffer32, which follows whichever
+      monitor the CPU thread is updating*/
+    if ((MONITORS_NUM > 1) && monitors[1].target_buffer)
+        return 0;
+
+    if ((render == svga_render_8bpp_lowres) || (render == svga_render_8bpp_highres))
+        return svga->map8 == svga->pallook;
+
+    return (render == svga_render_15bpp_lowres) || (render == svga_render_15bpp_highres) || (render == svga_render_15bpp_mix_lowres) || (render == svga_render_15bpp_mix_highres) || (render == svga_render_16bpp_lowres) || (render == svga_render_16bpp_highres) || (render == svga_render_24bpp_lowres) || (render == svga_render_24bpp_highres) || (render == svga_render_32bpp_lowres) || (render == svga_render_32bpp_highres) || (render == svga_render_ABGR8888_highres) || (render == svga_render_RGBA8888_highres);
+}
+
+/*Whether the renderer would draw this line. Covers the pages checked by any
+  of the queued renderers.*/
+static int
+svga_render_line_changed(svga_t *svga)
+{
+    uint32_t pages = svga->vram_max >> 12;
+    uint32_t page[2];
+    int      c, d;
+
+    if (svga->fullchange)
+        return 1;
+
+    page[0] = (svga->ma & svga->vram_mask) >> 12;
+    page[1] = svga->remap_func ? ((svga->remap_func(svga, svga->ma) & svga->vram_mask) >> 12) : page[0];
+    for (c = 0; c < 2; c++) {
+        for (d = 0; (d < 3) && ((page[c] + d) < pages); d++) {
+            if (svga->changedvram[page[c] + d])
+                return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void
+svga_render_queue_line(svga_t *svga)
+{
+    svga_render_worker_t *worker;
+    svga_render_line_t   *line;
+    unsigned int          pos;
+    int                   c;
+
+    if (!svga_render_line_changed(svga)) {
+        /*Nothing for the renderer to draw, only the borders*/
+        svga->x_add = (overscan_x >> 1);
+        svga_render_overscan_left(svga);
+        svga_render_overscan_right(svga);
+        svga->x_add = (overscan_x >> 1) - svga->scrollcache;
+        return;
+    }
+
+    /*Bring the workers' palettes up to date once they are done with the old one*/
+    if (memcmp(svga->render_workers[0].shadow->pallook, svga->pallook, sizeof(svga->pallook))) {
+        svga_render_wait(svga);
+        for (c = 0; c < svga->render_threads; c++)
+            memcpy(svga->render_workers[c].shadow->pallook, svga->pallook, sizeof(svga->pallook));
+    }
+
+    if ((svga->displine + svga->y_add) >= 0) {
+        if (svga->firstline_draw == 2000)
+            svga->firstline_draw = svga->displine;
+        svga->lastline_draw = svga->displine;
+    }
+
+    worker = &svga->render_workers[svga->render_next_worker];
+    svga->render_next_worker++;
+    if (svga->render_next_worker >= svga->render_threads)
+        svga->render_next_worker = 0;
+
+    pos = atomic_load(&worker->write_pos);
+    while ((pos - atomic_load(&worker->read_pos)) >= SVGA_RENDER_QUEUE_SIZE) {
+        thread_reset_event(worker->idle);
+        if ((pos - atomic_load(&worker->read_pos)) < SVGA_RENDER_QUEUE_SIZE)
+            break;
+        thread_wait_event(worker->idle, 1);
+    }
+
+    line                    = &worker->lines[pos & SVGA_RENDER_QUEUE_MASK];
+    line->render            = svga->render;
+    line->remap_func        = svga->remap_func;
+    line->ma                = svga->ma;
+    line->overscan_color    = svga->overscan_color;
+    line->displine          = svga->displine;
+    line->y_add             = svga->y_add;
+    line->x_add             = svga->x_add;
+    line->overscan_x_add    = (overscan_x >> 1);
+    line->hdisp             = svga->hdisp;
+    line->scrollcache       = svga->scrollcache;
+    line->sc                = svga->sc;
+    line->vram_display_mask = svga->vram_display_mask;
+    line->remap_required    = svga->remap_required;
+    line->force_old_addr    = svga->force_old_addr;
+    line->scrblank          = svga->scrblank;
+
+    atomic_store(&worker->write_pos, pos + 1);
+    /*A worker that still has lines queued will find this one too*/
+    if (atomic_load(&worker->read_pos) == pos)
+        thread_set_event(worker->wake);
+}
+
 static void
 svga_do_render(svga_t *svga)
 {
@@ -628,7 +956,9 @@ svga_do_render(svga_t *svga)
         return;
     }
 
-    if (!svga->override) {
+    if (!svga->override && svga->render_workers && svga_render_can_queue(svga))
+        svga_render_queue_line(svga);
+    else if (!svga->override) {
         svga->render(svga);
 
         svga->x_add = (overscan_x >> 1);
@@ -671,9 +1001,13 @@ svga_poll(void *p)
     int      ret, old_ma;
 
     if (!vga_on && ibm8514_enabled && ibm8514_on) {
+        if (svga->render_workers)
+            svga_render_wait(svga);
         ibm8514_poll(&svga->dev8514, svga);
         return;
     } else if (!vga_on && xga_enabled && svga->xga.on) {
+        if (svga->render_workers)
+            svga_render_wait(svga);
         xga_poll(&svga->xga, svga);
         return;
     }
@@ -855,10 +1189,10 @@ svga_poll(void *p)
             if (!svga->override) {
                 if (svga->vertical_linedbl) {
                     wy = (svga->lastline - svga->firstline) << 1;
-                    svga_doblit(wx, wy, svga);
+                    svga_doblit_lines(wx, wy, svga, svga->firstline_draw, svga->lastline_draw);
                 } else {
                     wy = svga->lastline - svga->firstline;
-                    svga_doblit(wx, wy, svga);
+                    svga_doblit_lines(wx, wy, svga, svga->firstline_draw, svga->lastline_draw);
                 }
             }
 
@@ -956,6 +1290,8 @@ svga_init(const device_t *info, svga_t *svga, void *p, int memsize,
     svga->x_add = 8;
     svga->y_add = 16;
 
+    svga_render_init();
+
     svga->crtc[0]           = 63;
     svga->crtc[6]           = 255;
     svga->dispontime        = 1000ull << 32;
@@ -1006,12 +1342,17 @@ svga_init(const device_t *info, svga_t *svga, void *p, int memsize,
 
     svga->map8 = svga->pallook;
 
+    if (video_render_threads > 0)
+        svga_render_start_threads(svga, MIN(video_render_threads, SVGA_RENDER_THREADS_MAX));
+
     return 0;
 }
 
 void
 svga_close(svga_t *svga)
 {
+    svga_render_stop_threads(svga);
+
     free(svga->changedvram);
     free(svga->vram);
 
@@ -1397,13 +1738,22 @@ svga_read_linear(uint32_t addr, void *p)
     return svga_read_common(addr, 1, p);
 }
 
+/* Blit the frame, copying out only the lines between firstline_draw and
+   lastline_draw (as tracked by whichever engine drew the frame, 2000 if it
+   redrew nothing); a firstline_draw of -1 copies out the whole area. */
 void
-svga_doblit(int wx, int wy, svga_t *svga)
+svga_doblit_lines(int wx, int wy, svga_t *svga, int firstline_draw, int lastline_draw)
 {
     int       y_add, x_add, y_start, x_start, bottom;
     uint32_t *p;
     int       i, j;
     int       xs_temp, ys_temp;
+    int       full_blit = 0;
+    int       dirty_y1, dirty_y2;
+
+    /*The frame must be complete before it is handed to the blitter*/
+    if (svga->render_workers)
+        svga_render_wait(svga);
 
     y_add   = (enable_overscan) ? overscan_y : 0;
     x_add   = (enable_overscan) ? overscan_x : 0;
@@ -1453,6 +1803,8 @@ svga_doblit(int wx, int wy, svga_t *svga)
 
         if (video_force_resize_get())
             video_force_resize_set(0);
+
+        full_blit = 1;
     }
 
     if ((wx >= 160) && ((wy + 1) >= 120)) {
@@ -1472,12 +1824,35 @@ svga_doblit(int wx, int wy, svga_t *svga)
         }
     }
 
-    video_blit_memtoscreen(x_start, y_start, xsize + x_add, ysize + y_add);
+    /* Only the lines the renderers redrew from changed video memory this
+       frame (plus the overscan, when its colour changes) need to be copied
+       out again. */
+    if (svga->overscan_color != svga->blit_overscan_color) {
+        svga->blit_overscan_color = svga->overscan_color;
+        full_blit                 = 1;
+    }
+    if (full_blit || (firstline_draw < 0)) {
+        dirty_y1 = y_start;
+        dirty_y2 = y_start + ysize + y_add;
+    } else if (firstline_draw == 2000)
+        dirty_y1 = dirty_y2 = 0;
+    else {
+        dirty_y1 = firstline_draw + svga->y_add;
+        dirty_y2 = lastline_draw + svga->y_add + 1;
+    }
+
+    video_blit_memtoscreen_dirty(x_start, y_start, xsize + x_add, ysize + y_add, dirty_y1, dirty_y2);
 
     if (svga->vertical_linedbl)
         svga->vertical_linedbl >>= 1;
 }
 
+void
+svga_doblit(int wx, int wy, svga_t *svga)
+{
+    svga_doblit_lines(wx, wy, svga, -1, 0);
+}
+
 void
 svga_writeb_linear(uint32_t addr, uint8_t val, void *p)
 {
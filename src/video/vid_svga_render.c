@@ -18,17 +18,348 @@
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    define SVGA_RENDER_X86
+#    include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#    define SVGA_RENDER_NEON
+#    include <arm_neon.h>
+#endif
 #include <86box/86box.h>
 #include <86box/device.h>
+#include <86box/host_cpu.h>
 #include <86box/mem.h>
 #include <86box/timer.h>
+#include <86box/plat.h>
 #include <86box/video.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_svga_render.h>
 #include <86box/vid_svga_render_remap.h>
 
+/*Scanline converters for the packed pixel modes.
+
+  The highres renderers hand a whole scanline to these when it can be read
+  from VRAM without wrapping around the display mask, otherwise they convert
+  it a pixel at a time as before. The vector versions are picked at runtime
+  and give exactly the same output as the lookup tables : a 5 bit component
+  c becomes (c * 1053) >> 7 and a 6 bit one ((c * 255) * 8323) >> 19, which
+  match calc_15to32()/calc_16to32() for every input.*/
+static void
+svga_line_8bpp_c(uint32_t *p, const uint8_t *src, int n, const uint32_t *map)
+{
+    for (int x = 0; x < n; x++)
+        p[x] = map[src[x]];
+}
+
+static void
+svga_line_15bpp_c(uint32_t *p, const uint8_t *src, int n)
+{
+    for (int x = 0; x < n; x++)
+        p[x] = video_15to32[*(uint16_t *) &src[x << 1]];
+}
+
+static void
+svga_line_16bpp_c(uint32_t *p, const uint8_t *src, int n)
+{
+    for (int x = 0; x < n; x++)
+        p[x] = video_16to32[*(uint16_t *) &src[x << 1]];
+}
+
+static void
+svga_line_24bpp_c(uint32_t *p, const uint8_t *src, int n)
+{
+    for (int x = 0; x < n; x++)
+        p[x] = src[x * 3] | (src[x * 3 + 1] << 8) | (src[x * 3 + 2] << 16);
+}
+
+static void
+svga_line_32bpp_c(uint32_t *p, const uint8_t *src, int n)
+{
+    for (int x = 0; x < n; x++)
+        p[x] = *(uint32_t *) &src[x << 2] & 0xffffff;
+}
+
+#if defined(SVGA_RENDER_X86)
+#    if defined(__GNUC__) || defined(__clang__)
+#        define SVGA_TARGET(t) __attribute__((target(t)))
+#    else
+#        define SVGA_TARGET(t)
+#    endif
+
+SVGA_TARGET("sse2")
+static void
+svga_line_15bpp_sse2(uint32_t *p, const uint8_t *src, int n)
+{
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    __m128i       v, r, g, b;
+    int           x;
+
+    for (x = 0; (x + 8) <= n; x += 8) {
+        v = _mm_loadu_si128((const __m128i *) &src[x << 1]);
+        b = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(v, mask5), _mm_set1_epi16(1053)), 7);
+        g = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(v, 5), mask5), _mm_set1_epi16(1053)), 7);
+        r = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(v, 10), mask5), _mm_set1_epi16(1053)), 7);
+        b = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+        _mm_storeu_si128((__m128i *) &p[x], _mm_unpacklo_epi16(b, r));
+        _mm_storeu_si128((__m128i *) &p[x + 4], _mm_unpackhi_epi16(b, r));
+    }
+    svga_line_15bpp_c(&p[x], &src[x << 1], n - x);
+}
+
+SVGA_TARGET("sse2")
+static void
+svga_line_16bpp_sse2(uint32_t *p, const uint8_t *src, int n)
+{
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    __m128i       v, r, g, b;
+    int           x;
+
+    for (x = 0; (x + 8) <= n; x += 8) {
+        v = _mm_loadu_si128((const __m128i *) &src[x << 1]);
+        b = _mm_srli_epi16(_mm_mullo_epi16(_mm_and_si128(v, mask5), _mm_set1_epi16(1053)), 7);
+        g = _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(v, 5), _mm_set1_epi16(0x3f)), _mm_set1_epi16(255));
+        g = _mm_srli_epi16(_mm_mulhi_epu16(g, _mm_set1_epi16(8323)), 3);
+        r = _mm_srli_epi16(_mm_mullo_epi16(_mm_srli_epi16(v, 11), _mm_set1_epi16(1053)), 7);
+        b = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+        _mm_storeu_si128((__m128i *) &p[x], _mm_unpacklo_epi16(b, r));
+        _mm_storeu_si128((__m128i *) &p[x + 4], _mm_unpackhi_epi16(b, r));
+    }
+    svga_line_16bpp_c(&p[x], &src[x << 1], n - x);
+}
+
+SVGA_TARGET("ssse3")
+static void
+svga_line_24bpp_ssse3(uint32_t *p, const uint8_t *src, int n)
+{
+    const __m128i shuf = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    int           x;
+
+    /* Each load takes 16 bytes for 12 bytes of pixels, stay clear of the end. */
+    for (x = 0; (x + 6) <= n; x += 4)
+        _mm_storeu_si128((__m128i *) &p[x], _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) &src[x * 3]), shuf));
+    svga_line_24bpp_c(&p[x], &src[x * 3], n - x);
+}
+
+SVGA_TARGET("sse2")
+static void
+svga_line_32bpp_sse2(uint32_t *p, const uint8_t *src, int n)
+{
+    const __m128i mask = _mm_set1_epi32(0xffffff);
+    int           x;
+
+    for (x = 0; (x + 4) <= n; x += 4)
+        _mm_storeu_si128((__m128i *) &p[x], _mm_and_si128(_mm_loadu_si128((const __m128i *) &src[x << 2]), mask));
+    svga_line_32bpp_c(&p[x], &src[x << 2], n - x);
+}
+
+SVGA_TARGET("avx2")
+static void
+svga_line_8bpp_avx2(uint32_t *p, const uint8_t *src, int n, const uint32_t *map)
+{
+    __m256i idx;
+    int     x;
+
+    for (x = 0; (x + 8) <= n; x += 8) {
+        idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) &src[x]));
+        _mm256_storeu_si256((__m256i *) &p[x], _mm256_i32gather_epi32((const int *) map, idx, 4));
+    }
+    svga_line_8bpp_c(&p[x], &src[x], n - x, map);
+}
+
+SVGA_TARGET("avx2")
+static void
+svga_line_15bpp_avx2(uint32_t *p, const uint8_t *src, int n)
+{
+    const __m256i mask5 = _mm256_set1_epi16(0x1f);
+    __m256i       v, r, g, b;
+    int           x;
+
+    for (x = 0; (x + 16) <= n; x += 16) {
+        /* The unpacks work within 128-bit lanes, so order the quadwords to
+           come out in pixel order. */
+        v = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *) &src[x << 1]), 0xd8);
+        b = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_and_si256(v, mask5), _mm256_set1_epi16(1053)), 7);
+        g = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi16(v, 5), mask5), _mm256_set1_epi16(1053)), 7);
+        r = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi16(v, 10), mask5), _mm256_set1_epi16(1053)), 7);
+        b = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+        _mm256_storeu_si256((__m256i *) &p[x], _mm256_unpacklo_epi16(b, r));
+        _mm256_storeu_si256((__m256i *) &p[x + 8], _mm256_unpackhi_epi16(b, r));
+    }
+    svga_line_15bpp_sse2(&p[x], &src[x << 1], n - x);
+}
+
+SVGA_TARGET("avx2")
+static void
+svga_line_16bpp_avx2(uint32_t *p, const uint8_t *src, int n)
+{
+    const __m256i mask5 = _mm256_set1_epi16(0x1f);
+    __m256i       v, r, g, b;
+    int           x;
+
+    for (x = 0; (x + 16) <= n; x += 16) {
+        v = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i *) &src[x << 1]), 0xd8);
+        b = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_and_si256(v, mask5), _mm256_set1_epi16(1053)), 7);
+        g = _mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi16(v, 5), _mm256_set1_epi16(0x3f)), _mm256_set1_epi16(255));
+        g = _mm256_srli_epi16(_mm256_mulhi_epu16(g, _mm256_set1_epi16(8323)), 3);
+        r = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_srli_epi16(v, 11), _mm256_set1_epi16(1053)), 7);
+        b = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+        _mm256_storeu_si256((__m256i *) &p[x], _mm256_unpacklo_epi16(b, r));
+        _mm256_storeu_si256((__m256i *) &p[x + 8], _mm256_unpackhi_epi16(b, r));
+    }
+    svga_line_16bpp_sse2(&p[x], &src[x << 1], n - x);
+}
+
+SVGA_TARGET("avx2")
+static void
+svga_line_32bpp_avx2(uint32_t *p, const uint8_t *src, int n)
+{
+    const __m256i mask = _mm256_set1_epi32(0xffffff);
+    int           x;
+
+    for (x = 0; (x + 8) <= n; x += 8)
+        _mm256_storeu_si256((__m256i *) &p[x], _mm256_and_si256(_mm256_loadu_si256((const __m256i *) &src[x << 2]), mask));
+    svga_line_32bpp_c(&p[x], &src[x << 2], n - x);
+}
+
+#elif defined(SVGA_RENDER_NEON)
+static void
+svga_line_15bpp_neon(uint32_t *p, const uint8_t *src, int n)
+{
+    const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+    uint16x8_t       v, r, g, b;
+    uint16x8x2_t     out;
+    int              x;
+
+    for (x = 0; (x + 8) <= n; x += 8) {
+        v   = vld1q_u16((const uint16_t *) &src[x << 1]);
+        b   = vshrq_n_u16(vmulq_n_u16(vandq_u16(v, mask5), 1053), 7);
+        g   = vshrq_n_u16(vmulq_n_u16(vandq_u16(vshrq_n_u16(v, 5), mask5), 1053), 7);
+        r   = vshrq_n_u16(vmulq_n_u16(vandq_u16(vshrq_n_u16(v, 10), mask5), 1053), 7);
+        out = vzipq_u16(vorrq_u16(b, vshlq_n_u16(g, 8)), r);
+        vst1q_u32(&p[x], vreinterpretq_u32_u16(out.val[0]));
+        vst1q_u32(&p[x + 4], vreinterpretq_u32_u16(out.val[1]));
+    }
+    svga_line_15bpp_c(&p[x], &src[x << 1], n - x);
+}
+
+static void
+svga_line_16bpp_neon(uint32_t *p, const uint8_t *src, int n)
+{
+    uint16x8_t   v, r, g, b;
+    uint16x8x2_t out;
+    int          x;
+
+    for (x = 0; (x + 8) <= n; x += 8) {
+        v   = vld1q_u16((const uint16_t *) &src[x << 1]);
+        b   = vshrq_n_u16(vmulq_n_u16(vandq_u16(v, vdupq_n_u16(0x1f)), 1053), 7);
+        g   = vmulq_n_u16(vandq_u16(vshrq_n_u16(v, 5), vdupq_n_u16(0x3f)), 255);
+        g   = vcombine_u16(vshrn_n_u32(vmull_n_u16(vget_low_u16(g), 8323), 16),
+                           vshrn_n_u32(vmull_n_u16(vget_high_u16(g), 8323), 16));
+        g   = vshrq_n_u16(g, 3);
+        r   = vshrq_n_u16(vmulq_n_u16(vshrq_n_u16(v, 11), 1053), 7);
+        out = vzipq_u16(vorrq_u16(b, vshlq_n_u16(g, 8)), r);
+        vst1q_u32(&p[x], vreinterpretq_u32_u16(out.val[0]));
+        vst1q_u32(&p[x + 4], vreinterpretq_u32_u16(out.val[1]));
+    }
+    svga_line_16bpp_c(&p[x], &src[x << 1], n - x);
+}
+
+static void
+svga_line_24bpp_neon(uint32_t *p, const uint8_t *src, int n)
+{
+    uint8x16x3_t in;
+    uint8x16x4_t out;
+    int          x;
+
+    out.val[3] = vdupq_n_u8(0);
+    for (x = 0; (x + 16) <= n; x += 16) {
+        in         = vld3q_u8(&src[x * 3]);
+        out.val[0] = in.val[0];
+        out.val[1] = in.val[1];
+        out.val[2] = in.val[2];
+        vst4q_u8((uint8_t *) &p[x], out);
+    }
+    svga_line_24bpp_c(&p[x], &src[x * 3], n - x);
+}
+
+static void
+svga_line_32bpp_neon(uint32_t *p, const uint8_t *src, int n)
+{
+    const uint32x4_t mask = vdupq_n_u32(0xffffff);
+    int              x;
+
+    for (x = 0; (x + 4) <= n; x += 4)
+        vst1q_u32(&p[x], vandq_u32(vld1q_u32((const uint32_t *) &src[x << 2]), mask));
+    svga_line_32bpp_c(&p[x], &src[x << 2], n - x);
+}
+#endif
+
+static void (*svga_line_8bpp)(uint32_t *p, const uint8_t *src, int n, const uint32_t *map) = svga_line_8bpp_c;
+static void (*svga_line_15bpp)(uint32_t *p, const uint8_t *src, int n)                     = svga_line_15bpp_c;
+static void (*svga_line_16bpp)(uint32_t *p, const uint8_t *src, int n)                     = svga_line_16bpp_c;
+static void (*svga_line_24bpp)(uint32_t *p, const uint8_t *src, int n)                     = svga_line_24bpp_c;
+static void (*svga_line_32bpp)(uint32_t *p, const uint8_t *src, int n)                     = svga_line_32bpp_c;
+
+static void
+svga_render_select(int simd)
+{
+    svga_line_8bpp  = svga_line_8bpp_c;
+    svga_line_15bpp = svga_line_15bpp_c;
+    svga_line_16bpp = svga_line_16bpp_c;
+    svga_line_24bpp = svga_line_24bpp_c;
+    svga_line_32bpp = svga_line_32bpp_c;
+
+    if (!simd)
+        return;
+
+#if defined(SVGA_RENDER_X86)
+    if (host_cpu_has_sse2()) {
+        svga_line_15bpp = svga_line_15bpp_sse2;
+        svga_line_16bpp = svga_line_16bpp_sse2;
+        svga_line_32bpp = svga_line_32bpp_sse2;
+    }
+    if (host_cpu_has_ssse3())
+        svga_line_24bpp = svga_line_24bpp_ssse3;
+    if (host_cpu_has_avx2()) {
+        svga_line_8bpp  = svga_line_8bpp_avx2;
+        svga_line_15bpp = svga_line_15bpp_avx2;
+        svga_line_16bpp = svga_line_16bpp_avx2;
+        svga_line_32bpp = svga_line_32bpp_avx2;
+    }
+#elif defined(SVGA_RENDER_NEON)
+    svga_line_15bpp = svga_line_15bpp_neon;
+    svga_line_16bpp = svga_line_16bpp_neon;
+    svga_line_24bpp = svga_line_24bpp_neon;
+    svga_line_32bpp = svga_line_32bpp_neon;
+#endif
+}
+
+void
+svga_render_init(void)
+{
+    svga_render_select(1);
+}
+
+/* Number of pixels drawn by a "for (x = 0; x <= limit; x += step)" loop. */
+static __inline int
+svga_render_line_pixels(int limit, int step)
+{
+    return (limit < 0) ? 0 : (((limit / step) + 1) * step);
+}
+
+/* Whether len bytes from addr can be read from VRAM without wrapping around
+   the display mask. */
+static __inline int
+svga_render_contiguous(svga_t *svga, uint32_t addr, int len)
+{
+    uint32_t mask = svga->vram_display_mask;
+
+    return !(mask & (mask + 1)) && (((addr & mask) + len) <= (mask + 1));
+}
+
 void
 svga_render_null(svga_t *svga)
 {
@@ -936,6 +1267,7 @@ void
 svga_render_8bpp_highres(svga_t *svga)
 {
     int       x;
+    int       n;
     uint32_t *p;
     uint32_t  dat;
     uint32_t  changed_addr;
@@ -980,7 +1312,11 @@ svga_render_8bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            n = svga_render_line_pixels(svga->hdisp /* + svga->scrollcache*/, 8);
+            if (!svga->remap_required && svga_render_contiguous(svga, svga->ma, n)) {
+                svga_line_8bpp(p, &svga->vram[svga->ma & svga->vram_display_mask], n, svga->map8);
+                svga->ma += n;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp /* + svga->scrollcache*/); x += 8) {
                     dat  = *(uint32_t *) (&svga->vram[svga->ma & svga->vram_display_mask]);
                     p[0] = svga->map8[dat & 0xff];
@@ -1191,6 +1527,7 @@ void
 svga_render_15bpp_highres(svga_t *svga)
 {
     int       x;
+    int       n;
     uint32_t *p;
     uint32_t  dat;
     uint32_t  changed_addr, addr;
@@ -1236,7 +1573,11 @@ svga_render_15bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            n = svga_render_line_pixels(svga->hdisp + svga->scrollcache, 8);
+            if (!svga->remap_required && svga_render_contiguous(svga, svga->ma, n << 1)) {
+                svga_line_15bpp(p, &svga->vram[svga->ma & svga->vram_display_mask], n);
+                svga->ma += n << 1;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 8) {
                     dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1)) & svga->vram_display_mask]);
                     *p++ = video_15to32[dat & 0xffff];
@@ -1421,6 +1762,7 @@ void
 svga_render_16bpp_highres(svga_t *svga)
 {
     int       x;
+    int       n;
     uint32_t *p;
     uint32_t  dat;
     uint32_t  changed_addr, addr;
@@ -1466,7 +1808,11 @@ svga_render_16bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            n = svga_render_line_pixels(svga->hdisp + svga->scrollcache, 8);
+            if (!svga->remap_required && svga_render_contiguous(svga, svga->ma, n << 1)) {
+                svga_line_16bpp(p, &svga->vram[svga->ma & svga->vram_display_mask], n);
+                svga->ma += n << 1;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 8) {
                     dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 1)) & svga->vram_display_mask]);
                     *p++ = video_16to32[dat & 0xffff];
@@ -1578,6 +1924,7 @@ void
 svga_render_24bpp_highres(svga_t *svga)
 {
     int       x;
+    int       n;
     uint32_t *p;
     uint32_t  changed_addr, addr;
     uint32_t  dat0, dat1, dat2;
@@ -1621,7 +1968,11 @@ svga_render_24bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            n = svga_render_line_pixels(svga->hdisp + svga->scrollcache, 4);
+            if (!svga->remap_required && svga_render_contiguous(svga, svga->ma, n * 3)) {
+                svga_line_24bpp(p, &svga->vram[svga->ma & svga->vram_display_mask], n);
+                svga->ma += n * 3;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x += 4) {
                     dat0 = *(uint32_t *) (&svga->vram[svga->ma & svga->vram_display_mask]);
                     dat1 = *(uint32_t *) (&svga->vram[(svga->ma + 4) & svga->vram_display_mask]);
@@ -1715,6 +2066,7 @@ void
 svga_render_32bpp_highres(svga_t *svga)
 {
     int       x;
+    int       n;
     uint32_t *p;
     uint32_t  dat;
     uint32_t  changed_addr, addr;
@@ -1747,7 +2099,11 @@ svga_render_32bpp_highres(svga_t *svga)
                 svga->firstline_draw = svga->displine;
             svga->lastline_draw = svga->displine;
 
-            if (!svga->remap_required) {
+            n = svga_render_line_pixels(svga->hdisp + svga->scrollcache, 1);
+            if (!svga->remap_required && svga_render_contiguous(svga, svga->ma, n << 2)) {
+                svga_line_32bpp(p, &svga->vram[svga->ma & svga->vram_display_mask], n);
+                svga->ma += n << 2;
+            } else if (!svga->remap_required) {
                 for (x = 0; x <= (svga->hdisp + svga->scrollcache); x++) {
                     dat  = *(uint32_t *) (&svga->vram[(svga->ma + (x << 2)) & svga->vram_display_mask]);
                     *p++ = dat & 0xffffff;
@@ -1844,3 +2200,109 @@ svga_render_RGBA8888_highres(svga_t *svga)
         svga->ma &= svga->vram_display_mask;
     }
 }
+
+#ifdef USE_INSTRUMENT
+/*Render benchmark.
+
+  Draws frames of random VRAM through each of the packed pixel highres
+  renderers, first with the plain C scanline converters and then with the
+  ones picked for this host. The rates are printed as JSON, along with
+  whether both produced the same frame.*/
+#    define BENCH_WIDTH  1600
+#    define BENCH_HEIGHT 1200
+#    define BENCH_FRAMES 20
+#    define BENCH_VRAM   (8 << 20)
+
+static uint32_t
+svga_render_bench_run(svga_t *svga, void (*render)(svga_t *svga), int pitch)
+{
+    uint32_t start = plat_get_micro_ticks();
+
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+        for (int y = 0; y < BENCH_HEIGHT; y++) {
+            svga->displine = y;
+            svga->ma       = y * pitch;
+            render(svga);
+        }
+    }
+
+    return plat_get_micro_ticks() - start;
+}
+
+void
+svga_render_benchmark(void)
+{
+    static const struct {
+        const char *name;
+        void (*render)(svga_t *svga);
+        int bytes_per_pixel;
+    } modes[] = {
+        { "8bpp",  svga_render_8bpp_highres,  1 },
+        { "15bpp", svga_render_15bpp_highres, 2 },
+        { "16bpp", svga_render_16bpp_highres, 2 },
+        { "24bpp", svga_render_24bpp_highres, 3 },
+        { "32bpp", svga_render_32bpp_highres, 4 }
+    };
+    svga_t   *svga;
+    uint32_t *ref;
+    uint32_t  c_us, simd_us;
+    double    pixels = (double) BENCH_WIDTH * BENCH_HEIGHT * BENCH_FRAMES;
+    int       exact;
+    int       m, y;
+
+    svga = calloc(1, sizeof(svga_t));
+    ref  = malloc(BENCH_WIDTH * BENCH_HEIGHT * sizeof(uint32_t));
+    if (!svga || !ref)
+        fatal("svga_render_benchmark: out of memory\n");
+    svga->vram        = malloc(BENCH_VRAM);
+    svga->changedvram = calloc(BENCH_VRAM >> 12, 1);
+    if (!svga->vram || !svga->changedvram)
+        fatal("svga_render_benchmark: out of memory\n");
+
+    srand(1);
+    for (m = 0; m < BENCH_VRAM; m++)
+        svga->vram[m] = rand();
+    for (m = 0; m < 256; m++)
+        svga->pallook[m] = (rand() << 16) ^ rand();
+
+    svga->vram_display_mask = BENCH_VRAM - 1;
+    svga->hdisp             = BENCH_WIDTH;
+    svga->fullchange        = 1;
+    svga->map8              = svga->pallook;
+    svga->remap_func        = address_remap_func_0;
+
+    printf("{\n");
+    printf("    \"width\": %i,\n", BENCH_WIDTH);
+    printf("    \"height\": %i,\n", BENCH_HEIGHT);
+    printf("    \"frames\": %i,\n", BENCH_FRAMES);
+    printf("    \"modes\": [\n");
+    for (m = 0; m < (int) (sizeof(modes) / sizeof(modes[0])); m++) {
+        svga_render_select(0);
+        c_us = svga_render_bench_run(svga, modes[m].render, BENCH_WIDTH * modes[m].bytes_per_pixel);
+        for (y = 0; y < BENCH_HEIGHT; y++) {
+            memcpy(&ref[y * BENCH_WIDTH], buffer32->line[y], BENCH_WIDTH * sizeof(uint32_t));
+            memset(buffer32->line[y], 0, BENCH_WIDTH * sizeof(uint32_t));
+        }
+
+        svga_render_select(1);
+        simd_us = svga_render_bench_run(svga, modes[m].render, BENCH_WIDTH * modes[m].bytes_per_pixel);
+        exact   = 1;
+        for (y = 0; y < BENCH_HEIGHT; y++) {
+            if (memcmp(&ref[y * BENCH_WIDTH], buffer32->line[y], BENCH_WIDTH * sizeof(uint32_t)))
+                exact = 0;
+        }
+
+        printf("        { \"mode\": \"%s\", \"c_mpixels_per_sec\": %.1f, \"simd_mpixels_per_sec\": %.1f, \"exact\": %s }%s\n",
+               modes[m].name, pixels / (c_us ? c_us : 1), pixels / (simd_us ? simd_us : 1),
+               exact ? "true" : "false", (m < (int) (sizeof(modes) / sizeof(modes[0])) - 1) ? "," : "");
+    }
+    printf("    ]\n");
+    printf("}\n");
+    fflush(stdout);
+
+    free(svga->changedvram);
+    free(svga->vram);
+    free(svga);
+    free(ref);
+}
+#endif
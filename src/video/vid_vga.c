@@ -30,6 +30,7 @@
 #include <86box/video.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_vga.h>
+#include <86box/savestate.h>
 
 static video_timings_t timing_ps1_svga_isa = { .type = VIDEO_ISA, .write_b = 6, .write_w = 8, .write_l = 16, .read_b = 6, .read_w = 8, .read_l = 16 };
 static video_timings_t timing_ps1_svga_mca = { .type = VIDEO_MCA, .write_b = 6, .write_w = 8, .write_l = 16, .read_b = 6, .read_w = 8, .read_l = 16 };
@@ -174,6 +175,14 @@ vga_speed_changed(void *p)
     svga_recalctimings(&vga->svga);
 }
 
+static void
+vga_savestate(savestate_t *st, void *p)
+{
+    vga_t *vga = (vga_t *) p;
+
+    svga_savestate(&vga->svga, st);
+}
+
 void
 vga_force_redraw(void *p)
 {
@@ -193,7 +202,8 @@ const device_t vga_device = {
     { .available = vga_available },
     .speed_changed = vga_speed_changed,
     .force_redraw  = vga_force_redraw,
-    .config        = NULL
+    .config        = NULL,
+    .state         = vga_savestate
 };
 
 const device_t ps1vga_device = {
@@ -207,7 +217,8 @@ const device_t ps1vga_device = {
     { .available = vga_available },
     .speed_changed = vga_speed_changed,
     .force_redraw  = vga_force_redraw,
-    .config        = NULL
+    .config        = NULL,
+    .state         = vga_savestate
 };
 
 const device_t ps1vga_mca_device = {
@@ -221,5 +232,6 @@ const device_t ps1vga_mca_device = {
     { .available = vga_available },
     .speed_changed = vga_speed_changed,
     .force_redraw  = vga_force_redraw,
-    .config        = NULL
+    .config        = NULL,
+    .state         = vga_savestate
 };
@@ -952,7 +952,7 @@ banshee_status(banshee_t *banshee)
     int       fifo_entries = FIFO_ENTRIES;
     int       swap_count   = voodoo->swap_count;
     int       written      = voodoo->cmd_written + voodoo->cmd_written_fifo;
-    int       busy         = (written - voodoo->cmd_read) || (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr) || voodoo->render_voodoo_busy[0] || voodoo->render_voodoo_busy[1] || voodoo->render_voodoo_busy[2] || voodoo->render_voodoo_busy[3] || voodoo->voodoo_busy;
+    int       busy         = (written - voodoo->cmd_read) || (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr) || voodoo_render_busy(voodoo) || voodoo->voodoo_busy;
     uint32_t  ret;
 
     ret = 0;
@@ -2830,26 +2830,14 @@ static const device_config_t banshee_sgram_config[] = {
     {
         .name = "render_threads",
         .description = "Render threads",
-        .type = CONFIG_SELECTION,
-        .selection = {
-            {
-                .description = "1",
-                .value = 1
-            },
-            {
-                .description = "2",
-                .value = 2
-            },
-            {
-                .description = "4",
-                .value = 4
-            },
-            {
-                .description = ""
-            }
+        .type = CONFIG_SPINNER,
+        .spinner = {
+            .min = 1,
+            .max = VOODOO_MAX_RENDER_THREADS
         },
         .default_int = 2
     },
+    VOODOO_TEXTURE_CACHE_CONFIG,
 #ifndef NO_CODEGEN
     {
         .name = "recompiler",
@@ -2885,26 +2873,14 @@ static const device_config_t banshee_sdram_config[] = {
     {
         .name = "render_threads",
         .description = "Render threads",
-        .type = CONFIG_SELECTION,
-        .selection = {
-            {
-                .description = "1",
-                .value = 1
-            },
-            {
-                .description = "2",
-                .value = 2
-            },
-            {
-                .description = "4",
-                .value = 4
-            },
-            {
-                .description = ""
-            }
+        .type = CONFIG_SPINNER,
+        .spinner = {
+            .min = 1,
+            .max = VOODOO_MAX_RENDER_THREADS
         },
         .default_int = 2
     },
+    VOODOO_TEXTURE_CACHE_CONFIG,
 #ifndef NO_CODEGEN
     {
         .name = "recompiler",
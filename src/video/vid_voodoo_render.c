@@ -17,6 +17,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stddef.h>
@@ -625,6 +626,26 @@ voodoo_tmu_fetch_and_blend(voodoo_t *voodoo, voodoo_params_t *params, voodoo_sta
 int voodoo_recomp = 0;
 #endif
 
+/*Advance the per-line interpolants by nr lines*/
+static inline void
+voodoo_skip_lines(voodoo_params_t *params, voodoo_state_t *state, int nr)
+{
+    state->base_r += params->dRdY * nr;
+    state->base_g += params->dGdY * nr;
+    state->base_b += params->dBdY * nr;
+    state->base_a += params->dAdY * nr;
+    state->base_z += params->dZdY * nr;
+    state->tmu[0].base_s += params->tmu[0].dSdY * nr;
+    state->tmu[0].base_t += params->tmu[0].dTdY * nr;
+    state->tmu[0].base_w += params->tmu[0].dWdY * nr;
+    state->tmu[1].base_s += params->tmu[1].dSdY * nr;
+    state->tmu[1].base_t += params->tmu[1].dTdY * nr;
+    state->tmu[1].base_w += params->tmu[1].dWdY * nr;
+    state->base_w += params->dWdY * nr;
+    state->xstart += state->dx1 * nr;
+    state->xend += state->dx2 * nr;
+}
+
 static void
 voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int ystart, int yend, int odd_even)
 {
@@ -672,9 +693,13 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
     //        int last_x;
     //        voodoo_render_log("voodoo_triangle : bottom-half %X %X %X %X %X %i  %i %i %i\n", xstart, xend, dx1, dx2, dx2 * 36, xdir,  y, yend, ydir);
 
+    /* Texel storage is only allocated once an entry has been filled. */
     for (c = 0; c <= LOD_MAX; c++) {
-        state->tex[0][c] = &voodoo->texture_cache[0][params->tex_entry[0]].data[texture_offset[c]];
-        state->tex[1][c] = &voodoo->texture_cache[1][params->tex_entry[1]].data[texture_offset[c]];
+        uint32_t *data0 = voodoo->texture_cache[0][params->tex_entry[0]].data;
+        uint32_t *data1 = voodoo->texture_cache[1][params->tex_entry[1]].data;
+
+        state->tex[0][c] = data0 ? &data0[texture_offset[c]] : NULL;
+        state->tex[1][c] = data1 ? &data1[texture_offset[c]] : NULL;
     }
 
     state->tformat = params->tformat[0];
@@ -784,12 +809,22 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
         else
             real_y >>= 4;
 
-        if (SLI_ENABLED) {
-            if (((real_y >> 1) & voodoo->odd_even_mask) != odd_even)
-                goto next_line;
-        } else {
-            if ((real_y & voodoo->odd_even_mask) != odd_even)
+        if (voodoo->render_threads > 1) {
+            /*Lines are dealt out to the render threads in turn (in pairs
+              with SLI, as only every other line is drawn). Go directly to the
+              next line drawn by this thread rather than stepping through the
+              lines in between one at a time.*/
+            int line = SLI_ENABLED ? (real_y >> 1) : real_y;
+            int skip = (params->fbzMode & (1 << 17)) ? (line - odd_even) : (odd_even - line);
+
+            skip %= voodoo->render_threads;
+            if (skip < 0)
+                skip += voodoo->render_threads;
+            if (skip) {
+                voodoo_skip_lines(params, state, (skip - 1) * y_diff);
+                state->y += (skip - 1) * y_diff;
                 goto next_line;
+            }
         }
 
         start_x = x;
@@ -1467,15 +1502,21 @@ voodoo_triangle(voodoo_t *voodoo, voodoo_params_t *params, int odd_even)
 }
 
 static void
-render_thread(void *param, int odd_even)
+voodoo_render_thread(void *param)
 {
-    voodoo_t *voodoo = (voodoo_t *) param;
+    voodoo_render_thread_t *data     = (voodoo_render_thread_t *) param;
+    voodoo_t               *voodoo   = data->voodoo;
+    int                     odd_even = data->index;
+    voodoo_render_stats_t  *stats    = &voodoo->render_stats[odd_even];
 
     while (voodoo->render_thread_run[odd_even]) {
+        uint64_t idle_start = plat_timer_read();
+
         thread_set_event(voodoo->render_not_full_event[odd_even]);
         thread_wait_event(voodoo->wake_render_thread[odd_even], -1);
         thread_reset_event(voodoo->wake_render_thread[odd_even]);
         voodoo->render_voodoo_busy[odd_even] = 1;
+        stats->idle_time += plat_timer_read() - idle_start;
 
         while (!PARAM_EMPTY(odd_even)) {
             uint64_t         start_time = plat_timer_read();
@@ -1490,7 +1531,8 @@ render_thread(void *param, int odd_even)
                 thread_set_event(voodoo->render_not_full_event[odd_even]);
 
             end_time = plat_timer_read();
-            voodoo->render_time[odd_even] += end_time - start_time;
+            stats->busy_time += end_time - start_time;
+            stats->triangles++;
         }
 
         voodoo->render_voodoo_busy[odd_even] = 0;
@@ -1498,24 +1540,56 @@ render_thread(void *param, int odd_even)
 }
 
 void
-voodoo_render_thread_1(void *param)
-{
-    render_thread(param, 0);
-}
-void
-voodoo_render_thread_2(void *param)
+voodoo_render_start_threads(voodoo_t *voodoo)
 {
-    render_thread(param, 1);
+    int c;
+
+    if (voodoo->render_threads < 1)
+        voodoo->render_threads = 1;
+    else if (voodoo->render_threads > VOODOO_MAX_RENDER_THREADS)
+        voodoo->render_threads = VOODOO_MAX_RENDER_THREADS;
+
+    for (c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_thread_data[c].voodoo = voodoo;
+        voodoo->render_thread_data[c].index  = c;
+        memset(&voodoo->render_stats[c], 0, sizeof(voodoo_render_stats_t));
+
+        voodoo->wake_render_thread[c]    = thread_create_event();
+        voodoo->render_not_full_event[c] = thread_create_event();
+        voodoo->render_thread_run[c]     = 1;
+        voodoo->render_thread[c]         = thread_create(voodoo_render_thread, &voodoo->render_thread_data[c]);
+    }
 }
+
 void
-voodoo_render_thread_3(void *param)
+voodoo_render_stop_threads(voodoo_t *voodoo)
 {
-    render_thread(param, 2);
+    int c;
+
+    for (c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_thread_run[c] = 0;
+        thread_set_event(voodoo->wake_render_thread[c]);
+        thread_wait(voodoo->render_thread[c]);
+    }
+
+    for (c = 0; c < voodoo->render_threads; c++) {
+#ifdef ENABLE_VOODOO_RENDER_LOG
+        voodoo_render_stats_t *stats = &voodoo->render_stats[c];
+        uint64_t               total = stats->busy_time + stats->idle_time;
+
+        voodoo_render_log("Render thread %i: %" PRIu64 " triangles, %i%% busy\n",
+                          c, stats->triangles, total ? (int) ((stats->busy_time * 100) / total) : 0);
+#endif
+
+        thread_destroy_event(voodoo->wake_render_thread[c]);
+        thread_destroy_event(voodoo->render_not_full_event[c]);
+    }
 }
+
 void
-voodoo_render_thread_4(void *param)
+voodoo_render_get_stats(voodoo_t *voodoo, int thread, voodoo_render_stats_t *stats)
 {
-    render_thread(param, 3);
+    memcpy(stats, &voodoo->render_stats[thread], sizeof(voodoo_render_stats_t));
 }
 
 void
@@ -1523,22 +1597,14 @@ voodoo_queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
 {
     voodoo_params_t *params_new = &voodoo->params_buffer[voodoo->params_write_idx & PARAM_MASK];
 
-    while (PARAM_FULL(0) || (voodoo->render_threads >= 2 && PARAM_FULL(1)) || (voodoo->render_threads == 4 && (PARAM_FULL(2) || PARAM_FULL(3)))) {
-        thread_reset_event(voodoo->render_not_full_event[0]);
-        if (voodoo->render_threads >= 2)
-            thread_reset_event(voodoo->render_not_full_event[1]);
-        if (voodoo->render_threads == 4) {
-            thread_reset_event(voodoo->render_not_full_event[2]);
-            thread_reset_event(voodoo->render_not_full_event[3]);
+    int              c;
+
+    for (c = 0; c < voodoo->render_threads; c++) {
+        while (PARAM_FULL(c)) {
+            thread_reset_event(voodoo->render_not_full_event[c]);
+            if (PARAM_FULL(c))
+                thread_wait_event(voodoo->render_not_full_event[c], -1); /*Wait for room in ringbuffer*/
         }
-        if (PARAM_FULL(0))
-            thread_wait_event(voodoo->render_not_full_event[0], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads >= 2 && PARAM_FULL(1))
-            thread_wait_event(voodoo->render_not_full_event[1], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads == 4 && PARAM_FULL(2))
-            thread_wait_event(voodoo->render_not_full_event[2], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads == 4 && PARAM_FULL(3))
-            thread_wait_event(voodoo->render_not_full_event[3], -1); /*Wait for room in ringbuffer*/
     }
 
     voodoo_use_texture(voodoo, params, 0);
@@ -1549,6 +1615,10 @@ voodoo_queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
 
     voodoo->params_write_idx++;
 
-    if (PARAM_ENTRIES(0) < 4 || (voodoo->render_threads >= 2 && PARAM_ENTRIES(1) < 4) || (voodoo->render_threads == 4 && (PARAM_ENTRIES(2) < 4 || PARAM_ENTRIES(3) < 4)))
-        voodoo_wake_render_thread(voodoo);
+    for (c = 0; c < voodoo->render_threads; c++) {
+        if (PARAM_ENTRIES(c) < 4) {
+            voodoo_wake_render_thread(voodoo);
+            break;
+        }
+    }
 }
@@ -17,6 +17,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stddef.h>
@@ -234,14 +235,165 @@ voodoo_recalc_tex3(voodoo_t *voodoo, int tmu)
 
 #define makergba(r, g, b, a) ((b) | ((g) << 8) | ((r) << 16) | ((a) << 24))
 
+/*Size of a decoded texture, all LODs at their fixed offsets*/
+#define TEX_DATA_SIZE ((256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4)
+
+static inline int
+voodoo_texture_hash(voodoo_t *voodoo, uint32_t base, uint32_t tLOD, uint32_t tformat, uint32_t palette_checksum)
+{
+    uint32_t h = (base * 0x9e3779b1) ^ (tLOD * 0x85ebca6b) ^ (tformat * 0xc2b2ae35) ^ palette_checksum;
+
+    h ^= h >> 15;
+    h *= 0x2c1b3c6d;
+    h ^= h >> 12;
+
+    return h & voodoo->texture_hash_mask;
+}
+
+/*Returns non-zero if any render thread still has a triangle queued that uses this texture*/
+static inline int
+voodoo_texture_busy(voodoo_t *voodoo, texture_t *tex)
+{
+    int c;
+
+    for (c = 0; c < voodoo->render_threads; c++) {
+        if (tex->refcount != tex->refcount_r[c])
+            return 1;
+    }
+
+    return 0;
+}
+
+/*Add (delta = 1) or remove (delta = -1) the pages covered by a texture
+  from the per-page reference counts checked on texture memory writes*/
+static void
+voodoo_texture_mark(voodoo_t *voodoo, int tmu, texture_t *tex, int delta)
+{
+    uint32_t page_mask = voodoo->texture_mask >> TEX_DIRTY_SHIFT;
+    uint32_t page, pages;
+    int      d;
+
+    for (d = 0; d < 4; d++) {
+        if (tex->addr_end[d] == 0)
+            continue;
+
+        page  = (tex->addr_start[d] & voodoo->texture_mask) >> TEX_DIRTY_SHIFT;
+        pages = ((((tex->addr_end[d] & voodoo->texture_mask) >> TEX_DIRTY_SHIFT) - page) & page_mask) + 1;
+        while (pages--) {
+            voodoo->texture_present[tmu][page] += delta;
+            page = (page + 1) & page_mask;
+        }
+    }
+}
+
+static int
+voodoo_texture_overlaps(voodoo_t *voodoo, texture_t *tex, uint32_t dirty_page)
+{
+    uint32_t page_mask = voodoo->texture_mask >> TEX_DIRTY_SHIFT;
+    uint32_t page, pages;
+    int      d;
+
+    for (d = 0; d < 4; d++) {
+        if (tex->addr_end[d] == 0)
+            continue;
+
+        page  = (tex->addr_start[d] & voodoo->texture_mask) >> TEX_DIRTY_SHIFT;
+        pages = ((((tex->addr_end[d] & voodoo->texture_mask) >> TEX_DIRTY_SHIFT) - page) & page_mask) + 1;
+        if (((dirty_page - page) & page_mask) < pages)
+            return 1;
+    }
+
+    return 0;
+}
+
+/*Drop a valid entry from its hash bucket and the page reference counts*/
+static void
+voodoo_texture_remove(voodoo_t *voodoo, int tmu, int c)
+{
+    texture_t *tex = &voodoo->texture_cache[tmu][c];
+    int       *link;
+
+    link = &voodoo->texture_hash[tmu][voodoo_texture_hash(voodoo, tex->base, tex->tLOD, tex->tformat, tex->palette_checksum)];
+    while (*link != c)
+        link = &voodoo->texture_cache[tmu][*link].hash_next;
+    *link          = tex->hash_next;
+    tex->hash_next = -1;
+
+    voodoo_texture_mark(voodoo, tmu, tex, -1);
+    tex->base = -1;
+}
+
+void
+voodoo_texture_cache_init(voodoo_t *voodoo, int entries)
+{
+    int c, tmu;
+
+    /*Both TMUs get entries, the render code touches TMU 1's reference
+      counts even on single TMU boards. The texel storage itself is only
+      allocated when an entry is first filled.*/
+    /*The eviction clock and the hash mask both need a power of two*/
+    while (entries & (entries - 1))
+        entries &= entries - 1;
+    if (entries < 64)
+        entries = 64;
+    else if (entries > TEX_CACHE_MAX)
+        entries = TEX_CACHE_MAX;
+
+    voodoo->texture_cache_size = entries;
+    voodoo->texture_hash_mask  = (entries * 2) - 1;
+
+    for (tmu = 0; tmu < 2; tmu++) {
+        voodoo->texture_cache[tmu] = calloc(entries, sizeof(texture_t));
+        voodoo->texture_hash[tmu]  = malloc(entries * 2 * sizeof(int));
+        if (!voodoo->texture_cache[tmu] || !voodoo->texture_hash[tmu])
+            fatal("voodoo_texture_cache_init : out of memory for %i texture cache entries\n", entries);
+        for (c = 0; c < entries; c++) {
+            voodoo->texture_cache[tmu][c].base      = -1; /*invalid*/
+            voodoo->texture_cache[tmu][c].hash_next = -1;
+        }
+        for (c = 0; c < entries * 2; c++)
+            voodoo->texture_hash[tmu][c] = -1;
+        voodoo->texture_last_removed[tmu] = 0;
+        memset(&voodoo->tex_stats[tmu], 0, sizeof(voodoo_tex_stats_t));
+    }
+}
+
+void
+voodoo_texture_cache_close(voodoo_t *voodoo)
+{
+    int c, tmu;
+
+    for (tmu = 0; tmu < 2; tmu++) {
+        voodoo_texture_log("TMU %i texture cache: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " texels decoded, %" PRIu64 " evictions, %" PRIu64 " invalidations\n",
+                           tmu, voodoo->tex_stats[tmu].hits, voodoo->tex_stats[tmu].misses, voodoo->tex_stats[tmu].decodes,
+                           voodoo->tex_stats[tmu].evictions, voodoo->tex_stats[tmu].invalidations);
+
+        for (c = 0; c < voodoo->texture_cache_size; c++)
+            free(voodoo->texture_cache[tmu][c].data);
+        free(voodoo->texture_cache[tmu]);
+        free(voodoo->texture_hash[tmu]);
+        voodoo->texture_cache[tmu] = NULL;
+        voodoo->texture_hash[tmu]  = NULL;
+    }
+}
+
+void
+voodoo_texture_get_stats(voodoo_t *voodoo, int tmu, voodoo_tex_stats_t *stats)
+{
+    memcpy(stats, &voodoo->tex_stats[tmu], sizeof(voodoo_tex_stats_t));
+}
+
 void
 voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
 {
-    int      c, d;
-    int      lod;
-    int      lod_min, lod_max;
-    uint32_t addr = 0, addr_end;
-    uint32_t palette_checksum;
+    int        c, n;
+    int        lod;
+    int        lod_min, lod_max;
+    int        h;
+    uint32_t   addr = 0;
+    uint32_t   tLOD = params->tLOD[tmu] & 0xf00fff;
+    uint32_t   palette_checksum;
+    texture_t *tex;
 
     lod_min = (params->tLOD[tmu] >> 2) & 15;
     lod_max = (params->tLOD[tmu] >> 8) & 15;
@@ -266,35 +418,55 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
         addr = params->texBaseAddr[tmu];
 
     /*Try to find texture in cache*/
-    for (c = 0; c < TEX_CACHE_MAX; c++) {
-        if (voodoo->texture_cache[tmu][c].base == addr && voodoo->texture_cache[tmu][c].tLOD == (params->tLOD[tmu] & 0xf00fff) && voodoo->texture_cache[tmu][c].palette_checksum == palette_checksum) {
+    h = voodoo_texture_hash(voodoo, addr, tLOD, params->tformat[tmu], palette_checksum);
+    for (c = voodoo->texture_hash[tmu][h]; c != -1; c = voodoo->texture_cache[tmu][c].hash_next) {
+        tex = &voodoo->texture_cache[tmu][c];
+        if (tex->base == addr && tex->tLOD == tLOD && tex->tformat == params->tformat[tmu] && tex->palette_checksum == palette_checksum) {
             params->tex_entry[tmu] = c;
-            voodoo->texture_cache[tmu][c].refcount++;
+            tex->used              = 1;
+            tex->refcount++;
+            voodoo->tex_stats[tmu].hits++;
             return;
         }
     }
-
-    /*Texture not found, search for unused texture*/
-    do {
-        for (c = 0; c < TEX_CACHE_MAX; c++) {
-            voodoo->texture_last_removed++;
-            voodoo->texture_last_removed &= (TEX_CACHE_MAX - 1);
-            if (voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[0] && (voodoo->render_threads == 1 || voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[1]))
-                break;
+    voodoo->tex_stats[tmu].misses++;
+
+    /*Texture not found, pick an entry to replace. Entries referenced since
+      the last pass get a second chance, two passes are therefore enough to
+      find any entry that is not in use by the render threads.*/
+    for (;;) {
+        for (n = 0; n < voodoo->texture_cache_size * 2; n++) {
+            voodoo->texture_last_removed[tmu] = (voodoo->texture_last_removed[tmu] + 1) & (voodoo->texture_cache_size - 1);
+            tex                               = &voodoo->texture_cache[tmu][voodoo->texture_last_removed[tmu]];
+            if (voodoo_texture_busy(voodoo, tex))
+                continue;
+            if (tex->used && tex->base != -1) {
+                tex->used = 0;
+                continue;
+            }
+            break;
         }
-        if (c == TEX_CACHE_MAX)
-            voodoo_wait_for_render_thread_idle(voodoo);
-    } while (c == TEX_CACHE_MAX);
-    if (c == TEX_CACHE_MAX)
-        fatal("Texture cache full!\n");
+        if (n < voodoo->texture_cache_size * 2)
+            break;
+        voodoo_wait_for_render_thread_idle(voodoo);
+    }
 
-    c = voodoo->texture_last_removed;
+    c = voodoo->texture_last_removed[tmu];
 
-    if ((voodoo->params.tLOD[tmu] & LOD_SPLIT) && (voodoo->params.tLOD[tmu] & LOD_ODD) && (voodoo->params.tLOD[tmu] & LOD_TMULTIBASEADDR))
-        voodoo->texture_cache[tmu][c].base = params->texBaseAddr1[tmu];
-    else
-        voodoo->texture_cache[tmu][c].base = params->texBaseAddr[tmu];
-    voodoo->texture_cache[tmu][c].tLOD = params->tLOD[tmu] & 0xf00fff;
+    if (tex->base != -1) {
+        voodoo_texture_remove(voodoo, tmu, c);
+        voodoo->tex_stats[tmu].evictions++;
+    }
+    if (!tex->data) {
+        tex->data = malloc(TEX_DATA_SIZE);
+        if (!tex->data)
+            fatal("voodoo_use_texture : out of memory for texture data\n");
+    }
+
+    tex->base    = addr;
+    tex->tLOD    = tLOD;
+    tex->tformat = params->tformat[tmu];
+    tex->used    = 1;
 
     lod_min = (params->tLOD[tmu] >> 2) & 15;
     lod_max = (params->tLOD[tmu] >> 8) & 15;
@@ -310,6 +482,8 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
 
         // voodoo_texture_log("  LOD %i : %08x - %08x %i %i,%i\n", lod, params->tex_base[tmu][lod] & voodoo->texture_mask, addr, voodoo->params.tformat[tmu], voodoo->params.tex_w_mask[tmu][lod],voodoo->params.tex_h_mask[tmu][lod]);
 
+        voodoo->tex_stats[tmu].decodes += (voodoo->params.tex_w_mask[tmu][lod] + 1) * (voodoo->params.tex_h_mask[tmu][lod] + 1);
+
         switch (params->tformat[tmu]) {
             case TEX_RGB332:
                 for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
@@ -494,86 +668,65 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
         }
     }
 
-    voodoo->texture_cache[tmu][c].is16 = voodoo->params.tformat[tmu] & 8;
+    tex->is16 = voodoo->params.tformat[tmu] & 8;
 
     if (params->tformat[tmu] == TEX_PAL8 || params->tformat[tmu] == TEX_APAL8 || params->tformat[tmu] == TEX_APAL88)
-        voodoo->texture_cache[tmu][c].palette_checksum = palette_checksum;
+        tex->palette_checksum = palette_checksum;
     else
-        voodoo->texture_cache[tmu][c].palette_checksum = 0;
+        tex->palette_checksum = 0;
 
     if (lod_min == 0) {
-        voodoo->texture_cache[tmu][c].addr_start[0] = voodoo->params.tex_base[tmu][0];
-        voodoo->texture_cache[tmu][c].addr_end[0]   = voodoo->params.tex_end[tmu][0];
+        tex->addr_start[0] = voodoo->params.tex_base[tmu][0];
+        tex->addr_end[0]   = voodoo->params.tex_end[tmu][0];
     } else
-        voodoo->texture_cache[tmu][c].addr_start[0] = voodoo->texture_cache[tmu][c].addr_end[0] = 0;
+        tex->addr_start[0] = tex->addr_end[0] = 0;
 
     if (lod_min <= 1 && lod_max >= 1) {
-        voodoo->texture_cache[tmu][c].addr_start[1] = voodoo->params.tex_base[tmu][1];
-        voodoo->texture_cache[tmu][c].addr_end[1]   = voodoo->params.tex_end[tmu][1];
+        tex->addr_start[1] = voodoo->params.tex_base[tmu][1];
+        tex->addr_end[1]   = voodoo->params.tex_end[tmu][1];
     } else
-        voodoo->texture_cache[tmu][c].addr_start[1] = voodoo->texture_cache[tmu][c].addr_end[1] = 0;
+        tex->addr_start[1] = tex->addr_end[1] = 0;
 
     if (lod_min <= 2 && lod_max >= 2) {
-        voodoo->texture_cache[tmu][c].addr_start[2] = voodoo->params.tex_base[tmu][2];
-        voodoo->texture_cache[tmu][c].addr_end[2]   = voodoo->params.tex_end[tmu][2];
+        tex->addr_start[2] = voodoo->params.tex_base[tmu][2];
+        tex->addr_end[2]   = voodoo->params.tex_end[tmu][2];
     } else
-        voodoo->texture_cache[tmu][c].addr_start[2] = voodoo->texture_cache[tmu][c].addr_end[2] = 0;
+        tex->addr_start[2] = tex->addr_end[2] = 0;
 
     if (lod_max >= 3) {
-        voodoo->texture_cache[tmu][c].addr_start[3] = voodoo->params.tex_base[tmu][(lod_min > 3) ? lod_min : 3];
-        voodoo->texture_cache[tmu][c].addr_end[3]   = voodoo->params.tex_end[tmu][(lod_max < 8) ? lod_max : 8];
+        tex->addr_start[3] = voodoo->params.tex_base[tmu][(lod_min > 3) ? lod_min : 3];
+        tex->addr_end[3]   = voodoo->params.tex_end[tmu][(lod_max < 8) ? lod_max : 8];
     } else
-        voodoo->texture_cache[tmu][c].addr_start[3] = voodoo->texture_cache[tmu][c].addr_end[3] = 0;
+        tex->addr_start[3] = tex->addr_end[3] = 0;
 
-    for (d = 0; d < 4; d++) {
-        addr     = voodoo->texture_cache[tmu][c].addr_start[d];
-        addr_end = voodoo->texture_cache[tmu][c].addr_end[d];
-
-        if (addr_end != 0) {
-            for (; addr <= addr_end; addr += (1 << TEX_DIRTY_SHIFT))
-                voodoo->texture_present[tmu][(addr & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] = 1;
-        }
-    }
+    voodoo_texture_mark(voodoo, tmu, tex, 1);
+    tex->hash_next               = voodoo->texture_hash[tmu][h];
+    voodoo->texture_hash[tmu][h] = c;
 
     params->tex_entry[tmu] = c;
-    voodoo->texture_cache[tmu][c].refcount++;
+    tex->refcount++;
 }
 
 void
 flush_texture_cache(voodoo_t *voodoo, uint32_t dirty_addr, int tmu)
 {
-    int wait_for_idle = 0;
-    int c;
-
-    memset(voodoo->texture_present[tmu], 0, sizeof(voodoo->texture_present[0]));
-    //        voodoo_texture_log("Evict %08x %i\n", dirty_addr, sizeof(voodoo->texture_present));
-    for (c = 0; c < TEX_CACHE_MAX; c++) {
-        if (voodoo->texture_cache[tmu][c].base != -1) {
-            int d;
-
-            for (d = 0; d < 4; d++) {
-                int addr_start = voodoo->texture_cache[tmu][c].addr_start[d];
-                int addr_end   = voodoo->texture_cache[tmu][c].addr_end[d];
-
-                if (addr_end != 0) {
-                    int addr_start_masked = addr_start & voodoo->texture_mask & ~0x3ff;
-                    int addr_end_masked   = ((addr_end & voodoo->texture_mask) + 0x3ff) & ~0x3ff;
-
-                    if (addr_end_masked < addr_start_masked)
-                        addr_end_masked = voodoo->texture_mask + 1;
-                    if (dirty_addr >= addr_start_masked && dirty_addr < addr_end_masked) {
-                        //                                voodoo_texture_log("  Evict texture %i %08x\n", c, voodoo->texture_cache[tmu][c].base);
-
-                        if (voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[0] || (voodoo->render_threads == 2 && voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[1]))
-                            wait_for_idle = 1;
-
-                        voodoo->texture_cache[tmu][c].base = -1;
-                    } else {
-                        for (; addr_start <= addr_end; addr_start += (1 << TEX_DIRTY_SHIFT))
-                            voodoo->texture_present[tmu][(addr_start & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] = 1;
-                    }
-                }
-            }
+    uint32_t dirty_page    = (dirty_addr & voodoo->texture_mask) >> TEX_DIRTY_SHIFT;
+    int      wait_for_idle = 0;
+    int      c;
+
+    //        voodoo_texture_log("Evict %08x\n", dirty_addr);
+    /*The page count drops as overlapping entries are removed, stop as soon
+      as nothing else can cover the written page*/
+    for (c = 0; c < voodoo->texture_cache_size && voodoo->texture_present[tmu][dirty_page]; c++) {
+        texture_t *tex = &voodoo->texture_cache[tmu][c];
+
+        if (tex->base != -1 && voodoo_texture_overlaps(voodoo, tex, dirty_page)) {
+            //                voodoo_texture_log("  Evict texture %i %08x\n", c, tex->base);
+            if (voodoo_texture_busy(voodoo, tex))
+                wait_for_idle = 1;
+
+            voodoo_texture_remove(voodoo, tmu, c);
+            voodoo->tex_stats[tmu].invalidations++;
         }
     }
     if (wait_for_idle)
@@ -2549,7 +2549,7 @@ xga_poll(xga_t *xga, svga_t *svga)
             wx = x;
 
             wy = xga->lastline - xga->firstline;
-            svga_doblit(wx, wy, svga);
+            svga_doblit_lines(wx, wy, svga, xga->firstline_draw, xga->lastline_draw);
 
             xga->firstline = 2000;
             xga->lastline  = 0;
@@ -54,6 +54,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <string.h>
 #include <stdlib.h>
 #include <wchar.h>
@@ -234,13 +235,40 @@ const uint32_t shade[5][256] =
 	}
 };
 
+/* Frame handoff between the emulation and blit threads.
+
+   The emulated card draws into target_buffer, the renderer copies it out
+   into its own buffers and presents those at its own pace. A finished frame
+   is posted to a mailbox and the emulation carries on without waiting for
+   the blit thread. If the blit thread is still busy presenting when the card
+   starts on the next frame, the frame still sitting in the mailbox is dropped
+   instead of waiting. The card only waits while the renderer is actually
+   copying the frame out. */
+enum {
+    BLIT_FREE = 0, /* target_buffer belongs to the emulated card */
+    BLIT_PENDING,  /* a frame is posted, the blit thread has not picked it up */
+    BLIT_COPYING   /* the renderer is copying the frame out */
+};
+
 typedef struct blit_data_struct {
-    int x, y, w, h;
-    int busy;
-    int buffer_in_use;
-    int thread_run;
+    int        x, y, w, h;
+    int        busy;
+    atomic_int buffer_state;
+    int        thread_run;
     int monitor_index;
 
+    /* Rows of the target buffer that have changed since the renderer last
+       asked for them, empty if dirty_y1 >= dirty_y2. */
+    int dirty_y1, dirty_y2;
+    int dirty_read;
+
+    /* Updated by the blit thread and the card, and collected by
+       video_onesec(). */
+    atomic_uint_least64_t blit_bytes;
+    atomic_uint           frames_presented;
+    atomic_uint           frames_dropped;
+    atomic_uint           wait_us;
+
     thread_t *blit_thread;
     event_t  *wake_blit_thread;
     event_t  *blit_complete;
@@ -249,6 +277,11 @@ typedef struct blit_data_struct {
 
 static uint32_t cga_2_table[16];
 
+uint64_t video_blit_bytes_per_sec    = 0;
+uint32_t video_frames_presented      = 0;
+uint32_t video_frames_dropped        = 0;
+uint32_t video_blit_wait_us_per_sec = 0;
+
 static void (*blit_func)(int x, int y, int w, int h, int monitor_index);
 
 #ifdef ENABLE_VIDEO_LOG
@@ -278,9 +311,9 @@ video_setblit(void (*blit)(int, int, int, int, int))
 void
 video_blit_complete_monitor(int monitor_index)
 {
-    blit_data_t *blit_data_ptr   = monitors[monitor_index].mon_blit_data_ptr;
-    blit_data_ptr->buffer_in_use = 0;
+    blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
 
+    atomic_store(&blit_data_ptr->buffer_state, BLIT_FREE);
     thread_set_event(blit_data_ptr->buffer_not_in_use);
 }
 
@@ -289,7 +322,9 @@ video_wait_for_blit_monitor(int monitor_index)
 {
     blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
 
-    while (blit_data_ptr->busy)
+    /* The blit thread only marks itself busy after taking the frame, so a
+       frame being copied out counts as well. */
+    while (blit_data_ptr->busy || (atomic_load(&blit_data_ptr->buffer_state) != BLIT_FREE))
         thread_wait_event(blit_data_ptr->blit_complete, -1);
     thread_reset_event(blit_data_ptr->blit_complete);
 }
@@ -298,10 +333,23 @@ void
 video_wait_for_buffer_monitor(int monitor_index)
 {
     blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+    int          state         = BLIT_PENDING;
+    uint32_t     start;
 
-    while (blit_data_ptr->buffer_in_use)
-        thread_wait_event(blit_data_ptr->buffer_not_in_use, -1);
-    thread_reset_event(blit_data_ptr->buffer_not_in_use);
+    /* A frame the blit thread has not got to yet is dropped, its changed
+       rows stay queued for the next one. */
+    if (atomic_compare_exchange_strong(&blit_data_ptr->buffer_state, &state, BLIT_FREE)) {
+        atomic_fetch_add(&blit_data_ptr->frames_dropped, 1);
+        return;
+    }
+
+    if (state == BLIT_COPYING) {
+        start = plat_get_micro_ticks();
+        while (atomic_load(&blit_data_ptr->buffer_state) == BLIT_COPYING)
+            thread_wait_event(blit_data_ptr->buffer_not_in_use, -1);
+        thread_reset_event(blit_data_ptr->buffer_not_in_use);
+        atomic_fetch_add(&blit_data_ptr->wait_us, plat_get_micro_ticks() - start);
+    }
 }
 
 static png_structp png_ptr[MONITORS_NUM];
@@ -446,13 +494,31 @@ static void
 blit_thread(void *param)
 {
     blit_data_t *data = param;
+    int          state;
+
     while (data->thread_run) {
         thread_wait_event(data->wake_blit_thread, -1);
         thread_reset_event(data->wake_blit_thread);
+
+        /* Take the newest posted frame, unless the card dropped it. */
+        state = BLIT_PENDING;
+        if (!atomic_compare_exchange_strong(&data->buffer_state, &state, BLIT_COPYING)) {
+            thread_set_event(data->blit_complete);
+            continue;
+        }
+
         MTR_BEGIN("video", "blit_thread");
+        data->busy = 1;
+        atomic_fetch_add(&data->frames_presented, 1);
 
-        if (blit_func)
+        if (blit_func) {
+            data->dirty_read = 0;
             blit_func(data->x, data->y, data->w, data->h, data->monitor_index);
+            /* Renderers that don't ask for the changed rows copy everything. */
+            if (!data->dirty_read)
+                atomic_fetch_add(&data->blit_bytes, (uint64_t) data->w * data->h * sizeof(uint32_t));
+        } else
+            video_blit_complete_monitor(data->monitor_index);
 
         data->busy = 0;
 
@@ -462,26 +528,111 @@ blit_thread(void *param)
 }
 
 void
-video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index)
+video_blit_memtoscreen_dirty_monitor(int x, int y, int w, int h, int dirty_y1, int dirty_y2, int monitor_index)
 {
+    blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+
     MTR_BEGIN("video", "video_blit_memtoscreen");
 
     if ((w <= 0) || (h <= 0))
         return;
 
-    video_wait_for_blit_monitor(monitor_index);
+    INSTRU_COUNT(frames, 1);
 
-    monitors[monitor_index].mon_blit_data_ptr->busy          = 1;
-    monitors[monitor_index].mon_blit_data_ptr->buffer_in_use = 1;
-    monitors[monitor_index].mon_blit_data_ptr->x             = x;
-    monitors[monitor_index].mon_blit_data_ptr->y             = y;
-    monitors[monitor_index].mon_blit_data_ptr->w             = w;
-    monitors[monitor_index].mon_blit_data_ptr->h             = h;
+    /* Cards that do not wait for the buffer before drawing get the same
+       treatment here. */
+    video_wait_for_buffer_monitor(monitor_index);
 
-    thread_set_event(monitors[monitor_index].mon_blit_data_ptr->wake_blit_thread);
+    /* If the area has moved, nothing the renderer has from the last frame
+       can be kept. */
+    if ((x != blit_data_ptr->x) || (y != blit_data_ptr->y) || (w != blit_data_ptr->w) || (h != blit_data_ptr->h)) {
+        dirty_y1 = y;
+        dirty_y2 = y + h;
+    }
+    if (dirty_y1 < y)
+        dirty_y1 = y;
+    if (dirty_y2 > (y + h))
+        dirty_y2 = y + h;
+
+    /* Merge with any rows the renderer has not picked up yet. */
+    if (dirty_y1 < dirty_y2) {
+        if (blit_data_ptr->dirty_y1 >= blit_data_ptr->dirty_y2) {
+            blit_data_ptr->dirty_y1 = dirty_y1;
+            blit_data_ptr->dirty_y2 = dirty_y2;
+        } else {
+            if (dirty_y1 < blit_data_ptr->dirty_y1)
+                blit_data_ptr->dirty_y1 = dirty_y1;
+            if (dirty_y2 > blit_data_ptr->dirty_y2)
+                blit_data_ptr->dirty_y2 = dirty_y2;
+        }
+    }
+
+    blit_data_ptr->x = x;
+    blit_data_ptr->y = y;
+    blit_data_ptr->w = w;
+    blit_data_ptr->h = h;
+
+    atomic_store(&blit_data_ptr->buffer_state, BLIT_PENDING);
+    thread_set_event(blit_data_ptr->wake_blit_thread);
     MTR_END("video", "video_blit_memtoscreen");
 }
 
+void
+video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index)
+{
+    video_blit_memtoscreen_dirty_monitor(x, y, w, h, y, y + h, monitor_index);
+}
+
+int
+video_blit_get_dirty_monitor(int monitor_index, int *y1, int *y2)
+{
+    blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
+
+    *y1 = blit_data_ptr->dirty_y1;
+    *y2 = blit_data_ptr->dirty_y2;
+    if (*y1 < blit_data_ptr->y)
+        *y1 = blit_data_ptr->y;
+    if (*y2 > (blit_data_ptr->y + blit_data_ptr->h))
+        *y2 = blit_data_ptr->y + blit_data_ptr->h;
+
+    blit_data_ptr->dirty_y1   = blit_data_ptr->dirty_y2 = 0;
+    blit_data_ptr->dirty_read = 1;
+
+    if (*y1 >= *y2)
+        return 0;
+
+    atomic_fetch_add(&blit_data_ptr->blit_bytes, (uint64_t) blit_data_ptr->w * (*y2 - *y1) * sizeof(uint32_t));
+    return 1;
+}
+
+void
+video_onesec(void)
+{
+    blit_data_t *blit_data_ptr;
+    uint64_t     bytes     = 0;
+    uint32_t     presented = 0;
+    uint32_t     dropped   = 0;
+    uint32_t     wait_us   = 0;
+    int          c;
+
+    for (c = 0; c < MONITORS_NUM; c++) {
+        blit_data_ptr = monitors[c].mon_blit_data_ptr;
+        if (blit_data_ptr) {
+            bytes += atomic_exchange(&blit_data_ptr->blit_bytes, 0);
+            presented += atomic_exchange(&blit_data_ptr->frames_presented, 0);
+            dropped += atomic_exchange(&blit_data_ptr->frames_dropped, 0);
+            wait_us += atomic_exchange(&blit_data_ptr->wait_us, 0);
+        }
+    }
+
+    video_blit_bytes_per_sec   = bytes;
+    video_frames_presented     = presented;
+    video_frames_dropped       = dropped;
+    video_blit_wait_us_per_sec = wait_us;
+    video_log("Blitted %" PRIu64 " bytes/s, %u frames presented, %u dropped, %u us waiting\n",
+              video_blit_bytes_per_sec, presented, dropped, wait_us);
+}
+
 uint8_t
 pixels8(uint32_t *pixels)
 {
@@ -834,6 +985,7 @@ video_monitor_init(int index)
     monitors[index].mon_blit_data_ptr->blit_complete     = thread_create_event();
     monitors[index].mon_blit_data_ptr->buffer_not_in_use = thread_create_event();
     monitors[index].mon_blit_data_ptr->thread_run        = 1;
+    atomic_init(&monitors[index].mon_blit_data_ptr->buffer_state, BLIT_FREE);
     monitors[index].mon_blit_data_ptr->monitor_index     = index;
     monitors[index].mon_pal_lookup                       = calloc(sizeof(uint32_t), 256);
     monitors[index].mon_cga_palette                      = calloc(1, sizeof(int));
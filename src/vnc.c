@@ -40,6 +40,7 @@
 static rfbScreenInfoPtr rfb = NULL;
 static int              clients;
 static int              updatingSize;
+static int              markAll = 1;
 static int              allowedX,
     allowedY;
 static int ptr_x, ptr_y, ptr_but;
@@ -162,13 +163,24 @@ vnc_blit(int x, int y, int w, int h, int monitor_index)
 {
     uint32_t *p;
     int       yy;
+    int       dirty_y1;
+    int       dirty_y2;
 
     if (monitor_index || (x < 0) || (y < 0) || (w <= 0) || (h <= 0) || (w > 2048) || (h > 2048) || (buffer32 == NULL)) {
         video_blit_complete_monitor(monitor_index);
         return;
     }
 
-    for (yy = 0; yy < h; yy++) {
+    /* The framebuffer is copied from the top of buffer32, so only trust the
+       dirty range when the blit area starts there. */
+    if (!video_blit_get_dirty_monitor(monitor_index, &dirty_y1, &dirty_y2))
+        dirty_y1 = dirty_y2 = 0;
+    if (y || markAll) {
+        dirty_y1 = 0;
+        dirty_y2 = h;
+    }
+
+    for (yy = dirty_y1; yy < dirty_y2; yy++) {
         p = (uint32_t *) &(((uint32_t *) rfb->frameBuffer)[yy * VNC_MAX_X]);
 
         if ((y + yy) >= 0 && (y + yy) < VNC_MAX_Y)
@@ -180,8 +192,13 @@ vnc_blit(int x, int y, int w, int h, int monitor_index)
 
     video_blit_complete_monitor(monitor_index);
 
-    if (!updatingSize)
+    if (updatingSize)
+        markAll = 1;
+    else if (markAll) {
         rfbMarkRectAsModified(rfb, 0, 0, allowedX, allowedY);
+        markAll = 0;
+    } else if (dirty_y1 < dirty_y2 && dirty_y1 < allowedY)
+        rfbMarkRectAsModified(rfb, 0, dirty_y1, allowedX, (dirty_y2 < allowedY) ? dirty_y2 : allowedY);
 }
 
 /* Initialize VNC for operation. */
@@ -208,6 +225,7 @@ vnc_init(UNUSED(void *arg))
     if (rfb == NULL) {
         wcstombs(title, ui_window_title(NULL), sizeof(title));
         updatingSize = 0;
+        markAll      = 1;
         allowedX     = scrnsz_x;
         allowedY     = scrnsz_y;
 